@@ -7,6 +7,7 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace CryptoNote
@@ -18,7 +19,18 @@ namespace CryptoNote
 
         [[nodiscard]] virtual std::vector<std::string> getRawKeys() const = 0;
 
-        virtual void submitRawResult(const std::vector<std::string> &values, const std::vector<bool> &resultStates) = 0;
+        /* The column family of each raw key, in the same order. Databases
+           without column families ignore them. Empty if every key is in
+           the default column family. */
+        [[nodiscard]] virtual std::vector<std::string> getRawKeyColumnFamilies() const
+        {
+            return {};
+        }
+
+        /* The values point into buffers owned by the database, and are only
+           valid until this returns */
+        virtual void
+            submitRawResult(const std::vector<std::string_view> &values, const std::vector<bool> &resultStates) = 0;
     };
 
 } // namespace CryptoNote
@@ -20,6 +20,8 @@ namespace CryptoNote
         virtual std::vector<std::pair<std::string, std::string>> extractRawDataToInsert() = 0;
         virtual std::vector<std::string> extractRawKeysToRemove() = 0;
 
+        /* Data grouped by column family. Databases without column families
+           store them along with the data above. */
         virtual std::unordered_map<std::string, std::vector<std::pair<std::string, std::string>>>
         extractRawDataToInsertWithCF() { return {}; }
         virtual std::unordered_map<std::string, std::vector<std::string>> extractRawKeysToRemoveWithCF() { return {}; }
@@ -438,6 +438,18 @@ namespace WalletTypes
         uint64_t height;
     };
 
+    /* The response of the binary wallet sync endpoint, the same data as the
+       JSON /getwalletsyncdata response */
+    struct WalletSyncData
+    {
+        std::vector<WalletBlockInfo> blocks;
+
+        /* Only given once the wallet is synced */
+        std::optional<TopBlock> topBlock;
+
+        bool synced = false;
+    };
+
     inline void to_json(nlohmann::json &j, const TopBlock &t)
     {
         j = {{"hash", t.hash}, {"height", t.height}};
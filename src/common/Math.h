@@ -7,6 +7,9 @@
 #pragma once
 
 #include <algorithm>
+#include <deque>
+#include <iterator>
+#include <set>
 #include <vector>
 
 namespace Common
@@ -36,4 +39,116 @@ namespace Common
         }
     }
 
+    /* The median of the last capacity values pushed, as medianValue() would
+       give it. Pushing a value updates it in O(log n), instead of sorting the
+       whole window again. */
+    template<class T> class MedianWindow
+    {
+      public:
+        explicit MedianWindow(size_t capacity): m_capacity(capacity) {}
+
+        /* Adds the value, and drops the oldest one if the window is full */
+        void push(const T &value)
+        {
+            m_values.push_back(value);
+            insert(value);
+
+            if (m_values.size() > m_capacity)
+            {
+                erase(m_values.front());
+                m_values.pop_front();
+            }
+        }
+
+        T median() const
+        {
+            if (m_values.empty())
+            {
+                return T();
+            }
+
+            if (m_lower.size() > m_upper.size())
+            { // 1, 3, 5...
+                return *m_lower.rbegin();
+            }
+            else
+            { // 2, 4, 6...
+                return (*m_lower.rbegin() + *m_upper.begin()) / 2;
+            }
+        }
+
+        size_t size() const
+        {
+            return m_values.size();
+        }
+
+        bool empty() const
+        {
+            return m_values.empty();
+        }
+
+        void clear()
+        {
+            m_values.clear();
+            m_lower.clear();
+            m_upper.clear();
+        }
+
+      private:
+        /* Every value in m_lower is <= every value in m_upper, and m_lower
+           has as many values as m_upper, or one more */
+        void insert(const T &value)
+        {
+            if (m_lower.empty() || value <= *m_lower.rbegin())
+            {
+                m_lower.insert(value);
+            }
+            else
+            {
+                m_upper.insert(value);
+            }
+
+            rebalance();
+        }
+
+        void erase(const T &value)
+        {
+            if (value <= *m_lower.rbegin())
+            {
+                m_lower.erase(m_lower.find(value));
+            }
+            else
+            {
+                m_upper.erase(m_upper.find(value));
+            }
+
+            rebalance();
+        }
+
+        void rebalance()
+        {
+            if (m_lower.size() > m_upper.size() + 1)
+            {
+                const auto largest = std::prev(m_lower.end());
+                m_upper.insert(*largest);
+                m_lower.erase(largest);
+            }
+            else if (m_upper.size() > m_lower.size())
+            {
+                const auto smallest = m_upper.begin();
+                m_lower.insert(*smallest);
+                m_upper.erase(smallest);
+            }
+        }
+
+        size_t m_capacity;
+
+        /* In the order they were pushed */
+        std::deque<T> m_values;
+
+        std::multiset<T> m_lower;
+
+        std::multiset<T> m_upper;
+    };
+
 } // namespace Common
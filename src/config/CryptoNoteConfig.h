@@ -323,8 +323,70 @@ namespace CryptoNote
     const uint64_t BLOCKS_SYNCHRONIZING_DEFAULT_COUNT = 100;
     // by default, blocks count in blocks downloading, reduced from 100 to 20 prior the 2,325,000 fork
 
+    // how many blocks ahead of the one being committed are validated in parallel while syncing
+    const size_t BLOCK_VALIDATION_PIPELINE_DEPTH = 8;
+
+    // while syncing, how many windows of blocks may be requested from one peer at once
+    const size_t BLOCK_DOWNLOAD_WINDOWS_PER_PEER = 2;
+
+    // while syncing, how many windows of blocks may be downloading or waiting to be validated
+    const size_t BLOCK_DOWNLOAD_MAX_WINDOWS = 64;
+
+    // a window of blocks not received within this long is requested from another peer
+    const uint64_t BLOCK_DOWNLOAD_WINDOW_TIMEOUT_SECONDS = 30;
+
+    // transaction hashes are announced to each peer in batches, on average this often
+    const uint64_t TRANSACTION_ANNOUNCE_INTERVAL_MILLISECONDS = 2000;
+
+    // the most transaction hashes announced or requested in one message
+    const size_t TRANSACTION_ANNOUNCE_MAX_COUNT = 1000;
+
+    // a transaction requested from a peer which doesn't arrive within this long is requested from the next one
+    const uint64_t TRANSACTION_REQUEST_TIMEOUT_SECONDS = 10;
+
+    // how many other peers announcing a requested transaction are remembered, to ask next if it doesn't arrive
+    const size_t TRANSACTION_REQUEST_MAX_ANNOUNCERS = 8;
+
+    // the most transaction hashes queued to be announced to a peer, further ones aren't announced to it
+    const size_t TRANSACTION_ANNOUNCE_MAX_PENDING = TRANSACTION_ANNOUNCE_MAX_COUNT * 5;
+
+    // the most announced transactions asked for from one peer and not received yet, further ones aren't asked for
+    const size_t TRANSACTION_REQUEST_MAX_PER_PEER = TRANSACTION_ANNOUNCE_MAX_COUNT * 5;
+
+    // the most announced transactions asked for from all peers and not received yet
+    const size_t TRANSACTION_REQUEST_MAX_TOTAL = TRANSACTION_ANNOUNCE_MAX_COUNT * 50;
+
+    // how many of the transactions each peer is known to have are remembered
+    const size_t P2P_KNOWN_TRANSACTIONS_LIMIT = 50000;
+
+    // bytes of the salted transaction hash used as a transaction's short id in a compact block
+    const size_t COMPACT_BLOCK_SHORT_ID_SIZE = 6;
+
+    // blocks with more transactions than this are relayed as lite blocks instead of compact blocks
+    const size_t COMPACT_BLOCK_MAX_TRANSACTIONS = 10000;
+
     const size_t COMMAND_RPC_GET_BLOCKS_FAST_MAX_COUNT = 100;
 
+    // how many of the most recent blocks are kept parsed, ready to send to syncing wallets
+    const uint64_t WALLET_SYNC_CACHE_DEFAULT_BLOCKS = 10000;
+
+    // JSON-RPC batches with more requests than this are rejected whole
+    const size_t RPC_MAX_JSON_RPC_BATCH_SIZE = 16;
+
+    // streamed RPC responses are sent in chunks of about this many bytes
+    const size_t RPC_STREAM_CHUNK_SIZE = 64 * 1024;
+
+    // streamed RPC responses read this many blocks from the chain at a time
+    const uint64_t RPC_STREAM_BLOCKS_PER_CHUNK = 10;
+
+    // long polling RPC requests give up waiting for a change after this long
+    const uint64_t RPC_LONG_POLL_TIMEOUT_SECONDS = 30;
+
+    // at most this many long polling RPC requests wait at once, the rest are answered straight
+    // away. Kept well under httplib's worker count (at least 8), so waiting polls can't take
+    // every worker and block other requests.
+    const size_t RPC_MAX_LONG_POLLS = 4;
+
     const int P2P_DEFAULT_PORT = 42069;
 
     const int RPC_DEFAULT_PORT = 6969;
@@ -337,13 +399,21 @@ namespace CryptoNote
 
     // P2P Network Configuration Section - This defines our current P2P network version
     // and the minimum version for communication between nodes
-    const uint8_t P2P_CURRENT_VERSION = 10;
+    const uint8_t P2P_CURRENT_VERSION = 12;
 
     const uint8_t P2P_MINIMUM_VERSION = 9;
 
     // This defines the minimum P2P version required for lite blocks propogation
     const uint8_t P2P_LITE_BLOCKS_PROPOGATION_VERSION = 0;
 
+    // This defines the minimum P2P version required for announcing transactions by hash,
+    // rather than sending the whole transactions to every peer
+    const uint8_t P2P_TRANSACTION_ANNOUNCE_VERSION = 11;
+
+    // This defines the minimum P2P version required for compact blocks propogation, which
+    // refer to the transactions the peer likely has in its pool by short ids
+    const uint8_t P2P_COMPACT_BLOCKS_VERSION = 12;
+
     // This defines the number of versions ahead we must see peers before we start displaying
     // warning messages that we need to upgrade our software.
     const uint8_t P2P_UPGRADE_WINDOW = 2;
@@ -373,6 +443,13 @@ namespace CryptoNote
     const uint64_t LEVELDB_MAX_OPEN_FILES = 512; // 512 files
     const uint64_t LEVELDB_MAX_FILE_SIZE_MB = 1024; // 1024MB = 1GB
 
+    // size of the in memory spent key image filter used with --db-key-image-index=filter
+    const uint64_t SPENT_KEY_IMAGE_FILTER_SIZE_MB = 32; // 32 MB
+
+    // most key images kept with --db-key-image-index=full, about 100 bytes each. Past this,
+    // lookups of the key images which didn't fit fall back to the database
+    const uint64_t SPENT_KEY_IMAGE_INDEX_MAX_ENTRIES = 20000000; // ~2 GB
+
     const char LATEST_VERSION_URL[] = "https://github.com/derogold/derogold/releases";
 
     const std::string LICENSE_URL = "https://github.com/derogold/derogold/blob/master/LICENSE";
@@ -1811,6 +1811,55 @@ void ge_tobytes(unsigned char *s, const ge_p2 *h)
     s[31] ^= fe_isnegative(x) << 7;
 }
 
+/* New code */
+
+/* Encodes count points into s (32 bytes each). The Z coordinates are inverted
+   together using Montgomery's trick, so a single field inversion is shared
+   between all of the points instead of one per point. scratch must have room
+   for count field elements. */
+void ge_p2_batch_tobytes(unsigned char *s, const ge_p2 *h, size_t count, fe *scratch)
+{
+    fe acc;
+    fe recip;
+    fe x;
+    fe y;
+    size_t i;
+
+    if (count == 0)
+    {
+        return;
+    }
+
+    /* scratch[i] = Z[0] * ... * Z[i] */
+    fe_copy(scratch[0], h[0].Z);
+
+    for (i = 1; i < count; i++)
+    {
+        fe_mul(scratch[i], scratch[i - 1], h[i].Z);
+    }
+
+    fe_invert(acc, scratch[count - 1]);
+
+    for (i = count; i-- > 0;)
+    {
+        /* acc = 1 / (Z[0] * ... * Z[i]) */
+        if (i > 0)
+        {
+            fe_mul(recip, acc, scratch[i - 1]);
+            fe_mul(acc, acc, h[i].Z);
+        }
+        else
+        {
+            fe_copy(recip, acc);
+        }
+
+        fe_mul(x, h[i].X, recip);
+        fe_mul(y, h[i].Y, recip);
+        fe_tobytes(s + 32 * i, y);
+        s[32 * i + 31] ^= fe_isnegative(x) << 7;
+    }
+}
+
 /* From sc_reduce.c */
 
 /*
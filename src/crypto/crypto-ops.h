@@ -1,5 +1,6 @@
 #pragma once
 
+#include <stddef.h>
 #include <stdint.h>
 
 /* From fe.h */
@@ -108,6 +109,8 @@ void ge_sub(ge_p1p1 *, const ge_p3 *, const ge_cached *);
 
 void ge_tobytes(unsigned char *, const ge_p2 *);
 
+void ge_p2_batch_tobytes(unsigned char *, const ge_p2 *, size_t, fe *);
+
 /* From sc_reduce.c */
 
 void sc_reduce(unsigned char *);
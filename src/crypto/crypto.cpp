@@ -11,6 +11,7 @@
 #include "hash.h"
 #include "random.h"
 
+#include <algorithm>
 #include <alloca.h>
 #include <cassert>
 #include <cstddef>
@@ -18,6 +19,7 @@
 #include <cstdlib>
 #include <cstring>
 #include <memory>
+#include <unordered_map>
 
 namespace Crypto
 {
@@ -619,6 +621,192 @@ namespace Crypto
         return sc_isnonzero(reinterpret_cast<unsigned char *>(&h)) == 0;
     }
 
+    void RingSignatureBatch::addRing(
+        const Hash &prefixHash,
+        const KeyImage &keyImage,
+        const std::vector<PublicKey> &publicKeys,
+        const std::vector<Signature> &signatures)
+    {
+        m_rings.push_back({prefixHash, keyImage, publicKeys, signatures});
+    }
+
+    bool RingSignatureBatch::verify() const
+    {
+        std::vector<size_t> invalidRings;
+        return verify(invalidRings);
+    }
+
+    bool RingSignatureBatch::verify(std::vector<size_t> &invalidRings) const
+    {
+        invalidRings.clear();
+
+        struct DecodedMember
+        {
+            bool valid;
+            ge_p3 point;
+            ge_p3 hashedPoint;
+        };
+
+        /* Ring members are frequently reused as decoys, so each distinct key is
+           only decompressed and hashed to a point once per batch */
+        std::unordered_map<PublicKey, DecodedMember> members;
+
+        struct PendingRing
+        {
+            size_t ringIndex;
+            size_t commitmentOffset;
+            EllipticCurveScalar sum;
+        };
+
+        std::vector<PendingRing> pending;
+
+        /* The L and R commitments of every ring member, interleaved in the
+           same layout as rs_comm so each ring can be hashed in place */
+        std::vector<ge_p2> commitments;
+
+        for (size_t ringIndex = 0; ringIndex < m_rings.size(); ringIndex++)
+        {
+            const auto &ring = m_rings[ringIndex];
+
+            ge_p3 image_unp;
+            ge_dsmp image_pre;
+
+            if (ring.signatures.size() < ring.publicKeys.size()
+                || ge_frombytes_vartime(&image_unp, reinterpret_cast<const unsigned char *>(&ring.keyImage)) != 0)
+            {
+                invalidRings.push_back(ringIndex);
+                continue;
+            }
+
+            ge_dsm_precomp(image_pre, &image_unp);
+
+            if (ge_check_subgroup_precomp_vartime(image_pre) != 0)
+            {
+                invalidRings.push_back(ringIndex);
+                continue;
+            }
+
+            PendingRing pendingRing;
+            pendingRing.ringIndex = ringIndex;
+            pendingRing.commitmentOffset = commitments.size();
+            sc_0(reinterpret_cast<unsigned char *>(&pendingRing.sum));
+
+            bool valid = true;
+
+            for (size_t i = 0; i < ring.publicKeys.size(); i++)
+            {
+                const unsigned char *signature = reinterpret_cast<const unsigned char *>(&ring.signatures[i]);
+
+                if (sc_check(signature) != 0 || sc_check(signature + 32) != 0)
+                {
+                    valid = false;
+                    break;
+                }
+
+                auto [it, inserted] = members.try_emplace(ring.publicKeys[i]);
+
+                DecodedMember &member = it->second;
+
+                if (inserted)
+                {
+                    member.valid = ge_frombytes_vartime(
+                                       &member.point, reinterpret_cast<const unsigned char *>(&ring.publicKeys[i]))
+                                   == 0;
+
+                    if (member.valid)
+                    {
+                        hash_to_ec(ring.publicKeys[i], member.hashedPoint);
+                    }
+                }
+
+                if (!member.valid)
+                {
+                    valid = false;
+                    break;
+                }
+
+                ge_p2 l;
+                ge_p2 r;
+
+                ge_double_scalarmult_base_vartime(&l, signature, &member.point, signature + 32);
+
+                ge_double_scalarmult_precomp_vartime(&r, signature + 32, &member.hashedPoint, signature, image_pre);
+
+                commitments.push_back(l);
+                commitments.push_back(r);
+
+                sc_add(
+                    reinterpret_cast<unsigned char *>(&pendingRing.sum),
+                    reinterpret_cast<unsigned char *>(&pendingRing.sum),
+                    signature);
+            }
+
+            if (!valid)
+            {
+                commitments.resize(pendingRing.commitmentOffset);
+                invalidRings.push_back(ringIndex);
+                continue;
+            }
+
+            pending.push_back(pendingRing);
+        }
+
+        std::vector<EllipticCurvePoint> encoded(commitments.size());
+
+        {
+            std::vector<fe> scratch(commitments.size());
+
+            ge_p2_batch_tobytes(
+                reinterpret_cast<unsigned char *>(encoded.data()), commitments.data(), commitments.size(), scratch.data());
+        }
+
+        std::vector<uint8_t> buffer;
+
+        for (const auto &pendingRing : pending)
+        {
+            const auto &ring = m_rings[pendingRing.ringIndex];
+
+            const size_t bufferSize = rs_comm_size(ring.publicKeys.size());
+
+            buffer.resize(bufferSize);
+
+            std::memcpy(buffer.data(), &ring.prefixHash, sizeof(Hash));
+
+            std::memcpy(
+                buffer.data() + sizeof(Hash),
+                encoded.data() + pendingRing.commitmentOffset,
+                bufferSize - sizeof(Hash));
+
+            EllipticCurveScalar h;
+
+            hash_to_scalar(buffer.data(), bufferSize, h);
+
+            sc_sub(
+                reinterpret_cast<unsigned char *>(&h),
+                reinterpret_cast<unsigned char *>(&h),
+                reinterpret_cast<const unsigned char *>(&pendingRing.sum));
+
+            if (sc_isnonzero(reinterpret_cast<unsigned char *>(&h)) != 0)
+            {
+                invalidRings.push_back(pendingRing.ringIndex);
+            }
+        }
+
+        std::sort(invalidRings.begin(), invalidRings.end());
+
+        return invalidRings.empty();
+    }
+
+    size_t RingSignatureBatch::size() const
+    {
+        return m_rings.size();
+    }
+
+    void RingSignatureBatch::clear()
+    {
+        m_rings.clear();
+    }
+
     void crypto_ops::generateViewFromSpend(const Crypto::SecretKey &spend, Crypto::SecretKey &viewSecret)
     {
         /* If we don't need the pub key */
@@ -154,6 +154,47 @@ namespace Crypto
             Crypto::PublicKey &viewPublic);
     };
 
+    /* Collects ring signatures so they can be verified together. The work shared
+     * between rings - decompressing and hashing ring members which appear in more
+     * than one ring, and the field inversions needed to encode every commitment -
+     * is only done once per batch. Each ring still gets its own result, so an
+     * invalid ring can be identified without verifying the others again.
+     */
+    class RingSignatureBatch
+    {
+      public:
+        void addRing(
+            const Hash &prefixHash,
+            const KeyImage &keyImage,
+            const std::vector<PublicKey> &publicKeys,
+            const std::vector<Signature> &signatures);
+
+        /* Returns true if every ring in the batch is valid */
+        bool verify() const;
+
+        /* As above, also filling invalidRings with the indexes, in the order
+         * they were added, of the rings which failed */
+        bool verify(std::vector<size_t> &invalidRings) const;
+
+        size_t size() const;
+
+        void clear();
+
+      private:
+        struct Ring
+        {
+            Hash prefixHash;
+
+            KeyImage keyImage;
+
+            std::vector<PublicKey> publicKeys;
+
+            std::vector<Signature> signatures;
+        };
+
+        std::vector<Ring> m_rings;
+    };
+
     /* Generate a new key pair
      */
     inline void generate_keys(PublicKey &pub, SecretKey &sec)
@@ -0,0 +1,211 @@
+// Copyright (c) 2018-2024, The DeroGold Developers
+//
+// Please see the included LICENSE file for more information.
+
+#include "BlockInfoColumn.h"
+
+#include <algorithm>
+#include <common/FileSystemShim.h>
+
+namespace
+{
+    /* Room for this many more blocks is kept in the files, so they rarely
+       have to grow. Growing copies a file and maps the copy. */
+    const uint64_t RESERVED_BLOCKS = 1000000;
+
+    /* Opening grows the files only once less room than this is left, so
+       restarting the daemon doesn't grow them every time */
+    const uint64_t MIN_RESERVED_BLOCKS_ON_OPEN = RESERVED_BLOCKS / 10;
+
+    template<class T> void reserveFileRoom(Common::FileMappedVector<T> &file, uint64_t minimumRoom)
+    {
+        if (file.capacity() - file.size() < minimumRoom)
+        {
+            file.reserve(file.size() + RESERVED_BLOCKS);
+        }
+    }
+} // namespace
+
+namespace CryptoNote
+{
+    void BlockInfoColumn::open(const std::string &directory)
+    {
+        fs::create_directories(directory);
+
+        openFile(m_blockHashes, directory + "/BlockHashes.bin");
+        openFile(m_timestamps, directory + "/Timestamps.bin");
+        openFile(m_cumulativeDifficulties, directory + "/CumulativeDifficulties.bin");
+        openFile(m_alreadyGeneratedCoins, directory + "/GeneratedCoins.bin");
+        openFile(m_alreadyGeneratedTransactions, directory + "/GeneratedTransactions.bin");
+        openFile(m_blockSizes, directory + "/BlockSizes.bin");
+
+        /* The files are written separately, so after a crash some of them
+           may have more blocks than the others */
+        truncate(static_cast<uint32_t>(std::min({
+            m_blockHashes.size(),
+            m_timestamps.size(),
+            m_cumulativeDifficulties.size(),
+            m_alreadyGeneratedCoins.size(),
+            m_alreadyGeneratedTransactions.size(),
+            m_blockSizes.size()})));
+
+        reserveRoom(MIN_RESERVED_BLOCKS_ON_OPEN);
+    }
+
+    template<class T> void BlockInfoColumn::openFile(Common::FileMappedVector<T> &file, const std::string &path)
+    {
+        file.open(path);
+
+        /* Syncing every push would cost more than the database write */
+        file.setAutoFlush(false);
+    }
+
+    void BlockInfoColumn::close()
+    {
+        m_blockHashes.close();
+        m_timestamps.close();
+        m_cumulativeDifficulties.close();
+        m_alreadyGeneratedCoins.close();
+        m_alreadyGeneratedTransactions.close();
+        m_blockSizes.close();
+    }
+
+    uint32_t BlockInfoColumn::size() const
+    {
+        return static_cast<uint32_t>(m_blockHashes.size());
+    }
+
+    CachedBlockInfo BlockInfoColumn::get(uint32_t blockIndex) const
+    {
+        assert(blockIndex < size());
+
+        CachedBlockInfo blockInfo;
+
+        blockInfo.blockHash = m_blockHashes[blockIndex];
+        blockInfo.timestamp = m_timestamps[blockIndex];
+        blockInfo.cumulativeDifficulty = m_cumulativeDifficulties[blockIndex];
+        blockInfo.alreadyGeneratedCoins = m_alreadyGeneratedCoins[blockIndex];
+        blockInfo.alreadyGeneratedTransactions = m_alreadyGeneratedTransactions[blockIndex];
+        blockInfo.blockSize = m_blockSizes[blockIndex];
+
+        return blockInfo;
+    }
+
+    const Crypto::Hash &BlockInfoColumn::blockHash(uint32_t blockIndex) const
+    {
+        assert(blockIndex < size());
+
+        return m_blockHashes[blockIndex];
+    }
+
+    Common::ArrayView<uint64_t> BlockInfoColumn::timestamps() const
+    {
+        return {m_timestamps.data(), m_timestamps.size()};
+    }
+
+    Common::ArrayView<uint64_t> BlockInfoColumn::cumulativeDifficulties() const
+    {
+        return {m_cumulativeDifficulties.data(), m_cumulativeDifficulties.size()};
+    }
+
+    Common::ArrayView<uint64_t> BlockInfoColumn::alreadyGeneratedCoins() const
+    {
+        return {m_alreadyGeneratedCoins.data(), m_alreadyGeneratedCoins.size()};
+    }
+
+    Common::ArrayView<uint64_t> BlockInfoColumn::alreadyGeneratedTransactions() const
+    {
+        return {m_alreadyGeneratedTransactions.data(), m_alreadyGeneratedTransactions.size()};
+    }
+
+    Common::ArrayView<uint32_t> BlockInfoColumn::blockSizes() const
+    {
+        return {m_blockSizes.data(), m_blockSizes.size()};
+    }
+
+    void BlockInfoColumn::reserve(uint32_t size)
+    {
+        m_blockHashes.reserve(size);
+        m_timestamps.reserve(size);
+        m_cumulativeDifficulties.reserve(size);
+        m_alreadyGeneratedCoins.reserve(size);
+        m_alreadyGeneratedTransactions.reserve(size);
+        m_blockSizes.reserve(size);
+    }
+
+    void BlockInfoColumn::reserveRoom(uint64_t minimumRoom)
+    {
+        reserveFileRoom(m_blockHashes, minimumRoom);
+        reserveFileRoom(m_timestamps, minimumRoom);
+        reserveFileRoom(m_cumulativeDifficulties, minimumRoom);
+        reserveFileRoom(m_alreadyGeneratedCoins, minimumRoom);
+        reserveFileRoom(m_alreadyGeneratedTransactions, minimumRoom);
+        reserveFileRoom(m_blockSizes, minimumRoom);
+    }
+
+    void BlockInfoColumn::push(const CachedBlockInfo &blockInfo)
+    {
+        reserveRoom(1);
+
+        m_blockHashes.push_back(blockInfo.blockHash);
+        m_timestamps.push_back(blockInfo.timestamp);
+        m_cumulativeDifficulties.push_back(blockInfo.cumulativeDifficulty);
+        m_alreadyGeneratedCoins.push_back(blockInfo.alreadyGeneratedCoins);
+        m_alreadyGeneratedTransactions.push_back(blockInfo.alreadyGeneratedTransactions);
+        m_blockSizes.push_back(blockInfo.blockSize);
+    }
+
+    void BlockInfoColumn::truncate(uint32_t size)
+    {
+        /* pop_back() just moves the end, unlike erase(), which rewrites the file */
+        while (m_blockHashes.size() > size)
+        {
+            m_blockHashes.pop_back();
+        }
+
+        while (m_timestamps.size() > size)
+        {
+            m_timestamps.pop_back();
+        }
+
+        while (m_cumulativeDifficulties.size() > size)
+        {
+            m_cumulativeDifficulties.pop_back();
+        }
+
+        while (m_alreadyGeneratedCoins.size() > size)
+        {
+            m_alreadyGeneratedCoins.pop_back();
+        }
+
+        while (m_alreadyGeneratedTransactions.size() > size)
+        {
+            m_alreadyGeneratedTransactions.pop_back();
+        }
+
+        while (m_blockSizes.size() > size)
+        {
+            m_blockSizes.pop_back();
+        }
+    }
+
+    void BlockInfoColumn::clear()
+    {
+        m_blockHashes.clear();
+        m_timestamps.clear();
+        m_cumulativeDifficulties.clear();
+        m_alreadyGeneratedCoins.clear();
+        m_alreadyGeneratedTransactions.clear();
+        m_blockSizes.clear();
+    }
+
+    void BlockInfoColumn::flush()
+    {
+        m_blockHashes.flush();
+        m_timestamps.flush();
+        m_cumulativeDifficulties.flush();
+        m_alreadyGeneratedCoins.flush();
+        m_alreadyGeneratedTransactions.flush();
+        m_blockSizes.flush();
+    }
+} // namespace CryptoNote
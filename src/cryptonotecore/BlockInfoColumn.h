@@ -0,0 +1,82 @@
+// Copyright (c) 2018-2024, The DeroGold Developers
+//
+// Please see the included LICENSE file for more information.
+
+#pragma once
+
+#include <common/ArrayView.h>
+#include <common/FileMappedVector.h>
+#include <cryptonotecore/IBlockchainCache.h>
+#include <string>
+
+namespace CryptoNote
+{
+    /* The CachedBlockInfo of every block on the main chain, stored as one
+       memory mapped file per field, so any block can be looked up without
+       going to the database, and ranges of a single field (like the
+       timestamps for the difficulty) are contiguous.
+
+       The files are a cache of what is in the database. They are not synced
+       on every push, so the owner has to check them against the database
+       when opening them.
+
+       The references and views returned point into the mapped files. Only
+       reserve() and push() can move them, when the files have to grow, so
+       those must not run while anything reads the column. push() grows the
+       files in big steps, so that's rare. */
+    class BlockInfoColumn
+    {
+      public:
+        /* Opens the files in the directory, creating them if needed */
+        void open(const std::string &directory);
+
+        void close();
+
+        /* Amount of blocks stored */
+        uint32_t size() const;
+
+        CachedBlockInfo get(uint32_t blockIndex) const;
+
+        const Crypto::Hash &blockHash(uint32_t blockIndex) const;
+
+        Common::ArrayView<uint64_t> timestamps() const;
+
+        Common::ArrayView<uint64_t> cumulativeDifficulties() const;
+
+        Common::ArrayView<uint64_t> alreadyGeneratedCoins() const;
+
+        Common::ArrayView<uint64_t> alreadyGeneratedTransactions() const;
+
+        Common::ArrayView<uint32_t> blockSizes() const;
+
+        void reserve(uint32_t size);
+
+        void push(const CachedBlockInfo &blockInfo);
+
+        /* Removes blocks from the end, so size() blocks are left */
+        void truncate(uint32_t size);
+
+        void clear();
+
+        /* Writes the files to disk */
+        void flush();
+
+      private:
+        template<class T> void openFile(Common::FileMappedVector<T> &file, const std::string &path);
+
+        /* Grows each file with less than minimumRoom blocks of room left */
+        void reserveRoom(uint64_t minimumRoom);
+
+        Common::FileMappedVector<Crypto::Hash> m_blockHashes;
+
+        Common::FileMappedVector<uint64_t> m_timestamps;
+
+        Common::FileMappedVector<uint64_t> m_cumulativeDifficulties;
+
+        Common::FileMappedVector<uint64_t> m_alreadyGeneratedCoins;
+
+        Common::FileMappedVector<uint64_t> m_alreadyGeneratedTransactions;
+
+        Common::FileMappedVector<uint32_t> m_blockSizes;
+    };
+} // namespace CryptoNote
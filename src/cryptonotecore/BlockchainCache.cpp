@@ -7,6 +7,7 @@
 
 #include "BlockchainCache.h"
 
+#include "BlockchainUtils.h"
 #include "TransactionValidatiorState.h"
 #include "common/CryptoNoteTools.h"
 #include "common/ShuffleGenerator.h"
@@ -127,7 +128,8 @@ namespace CryptoNote
         currency(currency),
         logger(logger_, "BlockchainCache"),
         parent(parent),
-        storage(new BlockchainStorage(100))
+        storage(new BlockchainStorage(100)),
+        blockSizesWindow(currency.rewardBlocksWindow())
     {
         if (parent == nullptr)
         {
@@ -260,6 +262,12 @@ namespace CryptoNote
 
         storage->pushBlock(std::move(rawBlock));
 
+        if (blockSizesWindowIndex == blockIndex - 1)
+        {
+            blockSizesWindow.push(blockSize);
+            blockSizesWindowIndex = blockIndex;
+        }
+
         logger(Logging::DEBUGGING) << "Block " << cachedBlock.getBlockHash() << " successfully pushed";
     }
 
@@ -332,6 +340,9 @@ namespace CryptoNote
         newCache->children = children;
         children = {newCache.get()};
 
+        blockSizesWindowIndex = boost::none;
+        nextBlockDifficulty = boost::none;
+
         logger(Logging::DEBUGGING) << "Split successfully completed";
 
         return newCache;
@@ -356,6 +367,9 @@ namespace CryptoNote
         newCache->children = children;
         children = {newCache.get()};
 
+        blockSizesWindowIndex = boost::none;
+        nextBlockDifficulty = boost::none;
+
         logger(Logging::DEBUGGING) << "Split successfully completed";
     }
 
@@ -829,6 +843,33 @@ namespace CryptoNote
         return blocks;
     }
 
+    std::vector<WalletTypes::WalletBlockInfo>
+        BlockchainCache::getWalletBlockInfos(const uint64_t startHeight, const uint64_t endHeight) const
+    {
+        if (endHeight <= startIndex)
+        {
+            return parent->getWalletBlockInfos(startHeight, endHeight);
+        }
+
+        std::vector<WalletTypes::WalletBlockInfo> walletBlocks;
+
+        if (startHeight < startIndex)
+        {
+            walletBlocks = parent->getWalletBlockInfos(startHeight, startIndex);
+        }
+
+        /* Segments only hold a few blocks, so they don't store the records */
+        auto segmentBlocks = Utils::getWalletBlockInfos(
+            getBlocksByHeight(std::max(startHeight, static_cast<uint64_t>(startIndex)), endHeight), *this);
+
+        walletBlocks.insert(
+            walletBlocks.end(),
+            std::make_move_iterator(segmentBlocks.begin()),
+            std::make_move_iterator(segmentBlocks.end()));
+
+        return walletBlocks;
+    }
+
     std::unordered_map<Crypto::Hash, std::vector<uint64_t>>
         BlockchainCache::getGlobalIndexes(const std::vector<Crypto::Hash> transactionHashes) const
     {
@@ -1382,6 +1423,33 @@ namespace CryptoNote
         return getLastUnits(count, blockIndex, useGenesis, [](const CachedBlockInfo &cb) { return cb.blockSize; });
     }
 
+    uint64_t BlockchainCache::getLastBlocksSizesMedian(uint32_t blockIndex) const
+    {
+        assert(blockIndex <= getTopBlockIndex());
+
+        if (blockIndex != getTopBlockIndex())
+        {
+            auto sizes = getLastBlocksSizes(currency.rewardBlocksWindow(), blockIndex, UseGenesis {true});
+            return Common::medianValue(sizes);
+        }
+
+        std::scoped_lock lock(lazyStateMutex);
+
+        if (blockSizesWindowIndex != blockIndex)
+        {
+            blockSizesWindow.clear();
+
+            for (const uint64_t size : getLastBlocksSizes(currency.rewardBlocksWindow(), blockIndex, UseGenesis {true}))
+            {
+                blockSizesWindow.push(size);
+            }
+
+            blockSizesWindowIndex = blockIndex;
+        }
+
+        return blockSizesWindow.median();
+    }
+
     uint64_t BlockchainCache::getDifficultyForNextBlock() const
     {
         return getDifficultyForNextBlock(getTopBlockIndex());
@@ -1390,11 +1458,30 @@ namespace CryptoNote
     uint64_t BlockchainCache::getDifficultyForNextBlock(uint32_t blockIndex) const
     {
         assert(blockIndex <= getTopBlockIndex());
+
+        {
+            std::scoped_lock lock(lazyStateMutex);
+
+            if (nextBlockDifficulty && nextBlockDifficulty->first == blockIndex)
+            {
+                return nextBlockDifficulty->second;
+            }
+        }
+
         uint8_t nextBlockMajorVersion = getBlockMajorVersionForHeight(blockIndex+1);
         auto timestamps = getLastTimestamps(CryptoNote::parameters::DIFFICULTY_BLOCKS_COUNT, blockIndex, skipGenesisBlock);
         auto commulativeDifficulties =
             getLastCumulativeDifficulties(CryptoNote::parameters::DIFFICULTY_BLOCKS_COUNT, blockIndex, skipGenesisBlock);
-        return currency.getNextDifficulty(nextBlockMajorVersion, blockIndex, std::move(timestamps), std::move(commulativeDifficulties));
+        const uint64_t difficulty =
+            currency.getNextDifficulty(nextBlockMajorVersion, blockIndex, timestamps, commulativeDifficulties);
+
+        if (blockIndex == getTopBlockIndex())
+        {
+            std::scoped_lock lock(lazyStateMutex);
+            nextBlockDifficulty = std::make_pair(blockIndex, difficulty);
+        }
+
+        return difficulty;
     }
 
     uint64_t BlockchainCache::getCurrentCumulativeDifficulty() const
@@ -9,6 +9,7 @@
 #include "BlockchainStorage.h"
 #include "Currency.h"
 #include "IBlockchainCache.h"
+#include "common/Math.h"
 #include "common/StringView.h"
 #include "cryptonotecore/UpgradeManager.h"
 
@@ -20,6 +21,7 @@
 #include <boost/multi_index/random_access_index.hpp>
 #include <boost/multi_index_container.hpp>
 #include <map>
+#include <mutex>
 #include <unordered_map>
 #include <vector>
 
@@ -167,6 +169,8 @@ namespace CryptoNote
 
         std::vector<uint64_t> getLastBlocksSizes(size_t count, uint32_t blockIndex, UseGenesis) const override;
 
+        uint64_t getLastBlocksSizesMedian(uint32_t blockIndex) const override;
+
         std::vector<uint64_t>
             getLastCumulativeDifficulties(size_t count, uint32_t blockIndex, UseGenesis) const override;
 
@@ -269,6 +273,9 @@ namespace CryptoNote
         virtual std::vector<RawBlock>
             getNonEmptyBlocks(const uint64_t startHeight, const size_t blockCount) const override;
 
+        virtual std::vector<WalletTypes::WalletBlockInfo>
+            getWalletBlockInfos(const uint64_t startHeight, const uint64_t endHeight) const override;
+
       private:
         struct BlockIndexTag
         {
@@ -380,6 +387,18 @@ namespace CryptoNote
 
         std::vector<IBlockchainCache *> children;
 
+        /* The sizes of the last rewardBlocksWindow() blocks up to
+           blockSizesWindowIndex, slid along as blocks are pushed */
+        mutable Common::MedianWindow<uint64_t> blockSizesWindow;
+
+        mutable boost::optional<uint32_t> blockSizesWindowIndex;
+
+        /* The difficulty for the block after the first block index */
+        mutable boost::optional<std::pair<uint32_t, uint64_t>> nextBlockDifficulty;
+
+        /* Const methods fill in the two above, from any thread */
+        mutable std::mutex lazyStateMutex;
+
         void serialize(ISerializer &s);
 
         void addSpentKeyImage(const Crypto::KeyImage &keyImage, uint32_t blockIndex);
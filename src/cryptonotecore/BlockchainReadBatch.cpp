@@ -13,7 +13,7 @@
 
 using namespace CryptoNote;
 
-BlockchainReadBatch::BlockchainReadBatch() {}
+BlockchainReadBatch::BlockchainReadBatch(const DB::Format format): format(format) {}
 
 BlockchainReadBatch::~BlockchainReadBatch() {}
 
@@ -93,6 +93,16 @@ BlockchainReadBatch &BlockchainReadBatch::requestRawBlocks(uint64_t startHeight,
     return *this;
 }
 
+BlockchainReadBatch &BlockchainReadBatch::requestWalletBlocks(uint64_t startHeight, uint64_t endHeight)
+{
+    for (uint64_t i = startHeight; i < endHeight; i++)
+    {
+        state.walletBlocks.emplace(i, WalletTypes::WalletBlockInfo());
+    }
+
+    return *this;
+}
+
 BlockchainReadBatch &BlockchainReadBatch::requestLastBlockIndex()
 {
     state.lastBlockIndex.second = true;
@@ -111,6 +121,12 @@ BlockchainReadBatch &BlockchainReadBatch::requestKeyOutputAmountsCount()
     return *this;
 }
 
+BlockchainReadBatch &BlockchainReadBatch::requestKeyOutputAmount(uint32_t amountIndex)
+{
+    state.keyOutputAmounts[amountIndex];
+    return *this;
+}
+
 BlockchainReadBatch &BlockchainReadBatch::requestTransactionCountByPaymentId(const Crypto::Hash &paymentId)
 {
     state.transactionCountsByPaymentIds.emplace(paymentId, 0);
@@ -162,42 +178,86 @@ std::vector<std::string> BlockchainReadBatch::getRawKeys() const
     std::vector<std::string> rawKeys;
     rawKeys.reserve(state.size());
 
-    DB::serializeKeys(rawKeys, DB::BLOCK_INDEX_TO_KEY_IMAGE_PREFIX, state.spentKeyImagesByBlock);
-    DB::serializeKeys(rawKeys, DB::KEY_IMAGE_TO_BLOCK_INDEX_PREFIX, state.blockIndexesBySpentKeyImages);
-    DB::serializeKeys(rawKeys, DB::TRANSACTION_HASH_TO_TRANSACTION_INFO_PREFIX, state.cachedTransactions);
-    DB::serializeKeys(rawKeys, DB::BLOCK_INDEX_TO_TX_HASHES_PREFIX, state.transactionHashesByBlocks);
-    DB::serializeKeys(rawKeys, DB::BLOCK_INDEX_TO_BLOCK_INFO_PREFIX, state.cachedBlocks);
-    DB::serializeKeys(rawKeys, DB::BLOCK_HASH_TO_BLOCK_INDEX_PREFIX, state.blockIndexesByBlockHashes);
-    DB::serializeKeys(rawKeys, DB::KEY_OUTPUT_AMOUNT_PREFIX, state.keyOutputGlobalIndexesCountForAmounts);
-    DB::serializeKeys(rawKeys, DB::KEY_OUTPUT_AMOUNT_PREFIX, state.keyOutputGlobalIndexesForAmounts);
-    DB::serializeKeys(rawKeys, DB::BLOCK_INDEX_TO_RAW_BLOCK_PREFIX, state.rawBlocks);
-    DB::serializeKeys(rawKeys, DB::CLOSEST_TIMESTAMP_BLOCK_INDEX_PREFIX, state.closestTimestampBlockIndex);
-    DB::serializeKeys(rawKeys, DB::KEY_OUTPUT_AMOUNTS_COUNT_PREFIX, state.keyOutputAmounts);
-    DB::serializeKeys(rawKeys, DB::PAYMENT_ID_TO_TX_HASH_PREFIX, state.transactionCountsByPaymentIds);
-    DB::serializeKeys(rawKeys, DB::PAYMENT_ID_TO_TX_HASH_PREFIX, state.transactionHashesByPaymentIds);
-    DB::serializeKeys(rawKeys, DB::TIMESTAMP_TO_BLOCKHASHES_PREFIX, state.blockHashesByTimestamp);
-    DB::serializeKeys(rawKeys, DB::KEY_OUTPUT_KEY_PREFIX, state.keyOutputKeys);
+    DB::serializeKeys(format, rawKeys, DB::BLOCK_INDEX_TO_KEY_IMAGE_PREFIX, state.spentKeyImagesByBlock);
+    DB::serializeKeys(format, rawKeys, DB::KEY_IMAGE_TO_BLOCK_INDEX_PREFIX, state.blockIndexesBySpentKeyImages);
+    DB::serializeKeys(format, rawKeys, DB::TRANSACTION_HASH_TO_TRANSACTION_INFO_PREFIX, state.cachedTransactions);
+    DB::serializeKeys(format, rawKeys, DB::BLOCK_INDEX_TO_TX_HASHES_PREFIX, state.transactionHashesByBlocks);
+    DB::serializeKeys(format, rawKeys, DB::BLOCK_INDEX_TO_BLOCK_INFO_PREFIX, state.cachedBlocks);
+    DB::serializeKeys(format, rawKeys, DB::BLOCK_HASH_TO_BLOCK_INDEX_PREFIX, state.blockIndexesByBlockHashes);
+    DB::serializeKeys(format, rawKeys, DB::KEY_OUTPUT_AMOUNT_PREFIX, state.keyOutputGlobalIndexesCountForAmounts);
+    DB::serializeKeys(format, rawKeys, DB::KEY_OUTPUT_AMOUNT_PREFIX, state.keyOutputGlobalIndexesForAmounts);
+    DB::serializeKeys(format, rawKeys, DB::BLOCK_INDEX_TO_RAW_BLOCK_PREFIX, state.rawBlocks);
+    DB::serializeKeys(format, rawKeys, DB::BLOCK_INDEX_TO_WALLET_BLOCK_PREFIX, state.walletBlocks);
+    DB::serializeKeys(format, rawKeys, DB::CLOSEST_TIMESTAMP_BLOCK_INDEX_PREFIX, state.closestTimestampBlockIndex);
+    DB::serializeKeys(format, rawKeys, DB::KEY_OUTPUT_AMOUNTS_COUNT_PREFIX, state.keyOutputAmounts);
+    DB::serializeKeys(format, rawKeys, DB::PAYMENT_ID_TO_TX_HASH_PREFIX, state.transactionCountsByPaymentIds);
+    DB::serializeKeys(format, rawKeys, DB::PAYMENT_ID_TO_TX_HASH_PREFIX, state.transactionHashesByPaymentIds);
+    DB::serializeKeys(format, rawKeys, DB::TIMESTAMP_TO_BLOCKHASHES_PREFIX, state.blockHashesByTimestamp);
+    DB::serializeKeys(format, rawKeys, DB::KEY_OUTPUT_KEY_PREFIX, state.keyOutputKeys);
 
     if (state.lastBlockIndex.second)
     {
-        rawKeys.emplace_back(DB::serializeKey(DB::BLOCK_INDEX_TO_BLOCK_HASH_PREFIX, DB::LAST_BLOCK_INDEX_KEY));
+        rawKeys.emplace_back(DB::serializeKey(format, DB::BLOCK_INDEX_TO_BLOCK_HASH_PREFIX, DB::LAST_BLOCK_INDEX_KEY));
     }
 
     if (state.keyOutputAmountsCount.second)
     {
-        rawKeys.emplace_back(DB::serializeKey(DB::KEY_OUTPUT_AMOUNTS_COUNT_PREFIX, DB::KEY_OUTPUT_AMOUNTS_COUNT_KEY));
+        rawKeys.emplace_back(DB::serializeKey(format, DB::KEY_OUTPUT_AMOUNTS_COUNT_PREFIX, DB::KEY_OUTPUT_AMOUNTS_COUNT_KEY));
     }
 
     if (state.transactionsCount.second)
     {
         rawKeys.emplace_back(
-            DB::serializeKey(DB::TRANSACTION_HASH_TO_TRANSACTION_INFO_PREFIX, DB::TRANSACTIONS_COUNT_KEY));
+            DB::serializeKey(format, DB::TRANSACTION_HASH_TO_TRANSACTION_INFO_PREFIX, DB::TRANSACTIONS_COUNT_KEY));
     }
 
     assert(!rawKeys.empty());
     return rawKeys;
 }
 
+std::vector<std::string> BlockchainReadBatch::getRawKeyColumnFamilies() const
+{
+    std::vector<std::string> columnFamilies;
+    columnFamilies.reserve(state.size());
+
+    /* Must match the order of getRawKeys() */
+    DB::appendColumnFamilies(columnFamilies, DB::BLOCK_INDEX_TO_KEY_IMAGE_PREFIX, state.spentKeyImagesByBlock);
+    DB::appendColumnFamilies(columnFamilies, DB::KEY_IMAGE_TO_BLOCK_INDEX_PREFIX, state.blockIndexesBySpentKeyImages);
+    DB::appendColumnFamilies(columnFamilies, DB::TRANSACTION_HASH_TO_TRANSACTION_INFO_PREFIX, state.cachedTransactions);
+    DB::appendColumnFamilies(columnFamilies, DB::BLOCK_INDEX_TO_TX_HASHES_PREFIX, state.transactionHashesByBlocks);
+    DB::appendColumnFamilies(columnFamilies, DB::BLOCK_INDEX_TO_BLOCK_INFO_PREFIX, state.cachedBlocks);
+    DB::appendColumnFamilies(columnFamilies, DB::BLOCK_HASH_TO_BLOCK_INDEX_PREFIX, state.blockIndexesByBlockHashes);
+    DB::appendColumnFamilies(
+        columnFamilies, DB::KEY_OUTPUT_AMOUNT_PREFIX, state.keyOutputGlobalIndexesCountForAmounts);
+    DB::appendColumnFamilies(columnFamilies, DB::KEY_OUTPUT_AMOUNT_PREFIX, state.keyOutputGlobalIndexesForAmounts);
+    DB::appendColumnFamilies(columnFamilies, DB::BLOCK_INDEX_TO_RAW_BLOCK_PREFIX, state.rawBlocks);
+    DB::appendColumnFamilies(columnFamilies, DB::BLOCK_INDEX_TO_WALLET_BLOCK_PREFIX, state.walletBlocks);
+    DB::appendColumnFamilies(
+        columnFamilies, DB::CLOSEST_TIMESTAMP_BLOCK_INDEX_PREFIX, state.closestTimestampBlockIndex);
+    DB::appendColumnFamilies(columnFamilies, DB::KEY_OUTPUT_AMOUNTS_COUNT_PREFIX, state.keyOutputAmounts);
+    DB::appendColumnFamilies(columnFamilies, DB::PAYMENT_ID_TO_TX_HASH_PREFIX, state.transactionCountsByPaymentIds);
+    DB::appendColumnFamilies(columnFamilies, DB::PAYMENT_ID_TO_TX_HASH_PREFIX, state.transactionHashesByPaymentIds);
+    DB::appendColumnFamilies(columnFamilies, DB::TIMESTAMP_TO_BLOCKHASHES_PREFIX, state.blockHashesByTimestamp);
+    DB::appendColumnFamilies(columnFamilies, DB::KEY_OUTPUT_KEY_PREFIX, state.keyOutputKeys);
+
+    if (state.lastBlockIndex.second)
+    {
+        columnFamilies.emplace_back(DB::columnFamily(DB::BLOCK_INDEX_TO_BLOCK_HASH_PREFIX));
+    }
+
+    if (state.keyOutputAmountsCount.second)
+    {
+        columnFamilies.emplace_back(DB::columnFamily(DB::KEY_OUTPUT_AMOUNTS_COUNT_PREFIX));
+    }
+
+    if (state.transactionsCount.second)
+    {
+        columnFamilies.emplace_back(DB::columnFamily(DB::TRANSACTION_HASH_TO_TRANSACTION_INFO_PREFIX));
+    }
+
+    return columnFamilies;
+}
+
 BlockchainReadResult::BlockchainReadResult(BlockchainReadState _state): state(std::move(_state)) {}
 
 BlockchainReadResult::~BlockchainReadResult() {}
@@ -251,6 +311,11 @@ const std::unordered_map<uint32_t, RawBlock> &BlockchainReadResult::getRawBlocks
     return state.rawBlocks;
 }
 
+const std::unordered_map<uint32_t, WalletTypes::WalletBlockInfo> &BlockchainReadResult::getWalletBlocks() const
+{
+    return state.walletBlocks;
+}
+
 const std::pair<uint32_t, bool> &BlockchainReadResult::getLastBlockIndex() const
 {
     return state.lastBlockIndex;
@@ -266,6 +331,11 @@ uint32_t BlockchainReadResult::getKeyOutputAmountsCount() const
     return state.keyOutputAmountsCount.first;
 }
 
+const std::unordered_map<uint32_t, IBlockchainCache::Amount> &BlockchainReadResult::getKeyOutputAmounts() const
+{
+    return state.keyOutputAmounts;
+}
+
 const std::unordered_map<Crypto::Hash, uint32_t> &BlockchainReadResult::getTransactionCountByPaymentIds() const
 {
     return state.transactionCountsByPaymentIds;
@@ -292,32 +362,35 @@ const KeyOutputKeyResult &BlockchainReadResult::getKeyOutputInfo() const
     return state.keyOutputKeys;
 }
 
-void BlockchainReadBatch::submitRawResult(const std::vector<std::string> &values, const std::vector<bool> &resultStates)
+void BlockchainReadBatch::submitRawResult(
+    const std::vector<std::string_view> &values,
+    const std::vector<bool> &resultStates)
 {
     assert(state.size() == values.size());
     assert(values.size() == resultStates.size());
     auto range = boost::combine(values, resultStates);
     auto iter = range.begin();
 
-    DB::deserializeValues(state.spentKeyImagesByBlock, iter, DB::BLOCK_INDEX_TO_KEY_IMAGE_PREFIX);
-    DB::deserializeValues(state.blockIndexesBySpentKeyImages, iter, DB::KEY_IMAGE_TO_BLOCK_INDEX_PREFIX);
-    DB::deserializeValues(state.cachedTransactions, iter, DB::TRANSACTION_HASH_TO_TRANSACTION_INFO_PREFIX);
-    DB::deserializeValues(state.transactionHashesByBlocks, iter, DB::BLOCK_INDEX_TO_TX_HASHES_PREFIX);
-    DB::deserializeValues(state.cachedBlocks, iter, DB::BLOCK_INDEX_TO_BLOCK_INFO_PREFIX);
-    DB::deserializeValues(state.blockIndexesByBlockHashes, iter, DB::BLOCK_HASH_TO_BLOCK_INDEX_PREFIX);
-    DB::deserializeValues(state.keyOutputGlobalIndexesCountForAmounts, iter, DB::KEY_OUTPUT_AMOUNT_PREFIX);
-    DB::deserializeValues(state.keyOutputGlobalIndexesForAmounts, iter, DB::KEY_OUTPUT_AMOUNT_PREFIX);
-    DB::deserializeValues(state.rawBlocks, iter, DB::BLOCK_INDEX_TO_RAW_BLOCK_PREFIX);
-    DB::deserializeValues(state.closestTimestampBlockIndex, iter, DB::CLOSEST_TIMESTAMP_BLOCK_INDEX_PREFIX);
-    DB::deserializeValues(state.keyOutputAmounts, iter, DB::KEY_OUTPUT_AMOUNTS_COUNT_PREFIX);
-    DB::deserializeValues(state.transactionCountsByPaymentIds, iter, DB::PAYMENT_ID_TO_TX_HASH_PREFIX);
-    DB::deserializeValues(state.transactionHashesByPaymentIds, iter, DB::PAYMENT_ID_TO_TX_HASH_PREFIX);
-    DB::deserializeValues(state.blockHashesByTimestamp, iter, DB::TIMESTAMP_TO_BLOCKHASHES_PREFIX);
-    DB::deserializeValues(state.keyOutputKeys, iter, DB::KEY_OUTPUT_KEY_PREFIX);
-
-    DB::deserializeValue(state.lastBlockIndex, iter, DB::BLOCK_INDEX_TO_BLOCK_HASH_PREFIX);
-    DB::deserializeValue(state.keyOutputAmountsCount, iter, DB::KEY_OUTPUT_AMOUNTS_COUNT_PREFIX);
-    DB::deserializeValue(state.transactionsCount, iter, DB::TRANSACTION_HASH_TO_TRANSACTION_INFO_PREFIX);
+    DB::deserializeValues(format, state.spentKeyImagesByBlock, iter, DB::BLOCK_INDEX_TO_KEY_IMAGE_PREFIX);
+    DB::deserializeValues(format, state.blockIndexesBySpentKeyImages, iter, DB::KEY_IMAGE_TO_BLOCK_INDEX_PREFIX);
+    DB::deserializeValues(format, state.cachedTransactions, iter, DB::TRANSACTION_HASH_TO_TRANSACTION_INFO_PREFIX);
+    DB::deserializeValues(format, state.transactionHashesByBlocks, iter, DB::BLOCK_INDEX_TO_TX_HASHES_PREFIX);
+    DB::deserializeValues(format, state.cachedBlocks, iter, DB::BLOCK_INDEX_TO_BLOCK_INFO_PREFIX);
+    DB::deserializeValues(format, state.blockIndexesByBlockHashes, iter, DB::BLOCK_HASH_TO_BLOCK_INDEX_PREFIX);
+    DB::deserializeValues(format, state.keyOutputGlobalIndexesCountForAmounts, iter, DB::KEY_OUTPUT_AMOUNT_PREFIX);
+    DB::deserializeValues(format, state.keyOutputGlobalIndexesForAmounts, iter, DB::KEY_OUTPUT_AMOUNT_PREFIX);
+    DB::deserializeValues(format, state.rawBlocks, iter, DB::BLOCK_INDEX_TO_RAW_BLOCK_PREFIX);
+    DB::deserializeValues(format, state.walletBlocks, iter, DB::BLOCK_INDEX_TO_WALLET_BLOCK_PREFIX);
+    DB::deserializeValues(format, state.closestTimestampBlockIndex, iter, DB::CLOSEST_TIMESTAMP_BLOCK_INDEX_PREFIX);
+    DB::deserializeValues(format, state.keyOutputAmounts, iter, DB::KEY_OUTPUT_AMOUNTS_COUNT_PREFIX);
+    DB::deserializeValues(format, state.transactionCountsByPaymentIds, iter, DB::PAYMENT_ID_TO_TX_HASH_PREFIX);
+    DB::deserializeValues(format, state.transactionHashesByPaymentIds, iter, DB::PAYMENT_ID_TO_TX_HASH_PREFIX);
+    DB::deserializeValues(format, state.blockHashesByTimestamp, iter, DB::TIMESTAMP_TO_BLOCKHASHES_PREFIX);
+    DB::deserializeValues(format, state.keyOutputKeys, iter, DB::KEY_OUTPUT_KEY_PREFIX);
+
+    DB::deserializeValue(format, state.lastBlockIndex, iter, DB::BLOCK_INDEX_TO_BLOCK_HASH_PREFIX);
+    DB::deserializeValue(format, state.keyOutputAmountsCount, iter, DB::KEY_OUTPUT_AMOUNTS_COUNT_PREFIX);
+    DB::deserializeValue(format, state.transactionsCount, iter, DB::TRANSACTION_HASH_TO_TRANSACTION_INFO_PREFIX);
 
     assert(iter == range.end());
 
@@ -334,6 +407,7 @@ BlockchainReadState::BlockchainReadState(BlockchainReadState &&state):
     keyOutputGlobalIndexesCountForAmounts(std::move(state.keyOutputGlobalIndexesCountForAmounts)),
     keyOutputGlobalIndexesForAmounts(std::move(state.keyOutputGlobalIndexesForAmounts)),
     rawBlocks(std::move(state.rawBlocks)),
+    walletBlocks(std::move(state.walletBlocks)),
     blockHashesByTimestamp(std::move(state.blockHashesByTimestamp)),
     keyOutputKeys(std::move(state.keyOutputKeys)),
     closestTimestampBlockIndex(std::move(state.closestTimestampBlockIndex)),
@@ -351,7 +425,8 @@ size_t BlockchainReadState::size() const
     return spentKeyImagesByBlock.size() + blockIndexesBySpentKeyImages.size() + cachedTransactions.size()
            + transactionHashesByBlocks.size() + cachedBlocks.size() + blockIndexesByBlockHashes.size()
            + keyOutputGlobalIndexesCountForAmounts.size() + keyOutputGlobalIndexesForAmounts.size() + rawBlocks.size()
-           + closestTimestampBlockIndex.size() + keyOutputAmounts.size() + transactionCountsByPaymentIds.size()
+           + walletBlocks.size() + closestTimestampBlockIndex.size() + keyOutputAmounts.size()
+           + transactionCountsByPaymentIds.size()
            + transactionHashesByPaymentIds.size() + blockHashesByTimestamp.size() + keyOutputKeys.size()
            + (lastBlockIndex.second ? 1 : 0) + (keyOutputAmountsCount.second ? 1 : 0)
            + (transactionsCount.second ? 1 : 0);
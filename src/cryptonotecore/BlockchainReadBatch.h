@@ -8,6 +8,7 @@
 
 #include "BlockchainCache.h"
 #include "CryptoNote.h"
+#include "DBUtils.h"
 #include "DatabaseCacheData.h"
 #include "IReadBatch.h"
 
@@ -68,6 +69,8 @@ namespace CryptoNote
 
         std::unordered_map<uint32_t, RawBlock> rawBlocks;
 
+        std::unordered_map<uint32_t, WalletTypes::WalletBlockInfo> walletBlocks;
+
         std::unordered_map<uint64_t, uint32_t> closestTimestampBlockIndex;
 
         std::unordered_map<uint32_t, IBlockchainCache::Amount> keyOutputAmounts;
@@ -123,12 +126,16 @@ namespace CryptoNote
 
         const std::unordered_map<uint32_t, RawBlock> &getRawBlocks() const;
 
+        const std::unordered_map<uint32_t, WalletTypes::WalletBlockInfo> &getWalletBlocks() const;
+
         const std::pair<uint32_t, bool> &getLastBlockIndex() const;
 
         const std::unordered_map<uint64_t, uint32_t> &getClosestTimestampBlockIndex() const;
 
         uint32_t getKeyOutputAmountsCount() const;
 
+        const std::unordered_map<uint32_t, IBlockchainCache::Amount> &getKeyOutputAmounts() const;
+
         const std::unordered_map<Crypto::Hash, uint32_t> &getTransactionCountByPaymentIds() const;
 
         const std::unordered_map<std::pair<Crypto::Hash, uint32_t>, Crypto::Hash> &
@@ -147,7 +154,7 @@ namespace CryptoNote
     class BlockchainReadBatch : public IReadBatch
     {
       public:
-        BlockchainReadBatch();
+        explicit BlockchainReadBatch(DB::Format format);
 
         ~BlockchainReadBatch();
 
@@ -174,12 +181,16 @@ namespace CryptoNote
 
         BlockchainReadBatch &requestRawBlocks(uint64_t startHeight, uint64_t endHeight);
 
+        BlockchainReadBatch &requestWalletBlocks(uint64_t startHeight, uint64_t endHeight);
+
         BlockchainReadBatch &requestLastBlockIndex();
 
         BlockchainReadBatch &requestClosestTimestampBlockIndex(uint64_t timestamp);
 
         BlockchainReadBatch &requestKeyOutputAmountsCount();
 
+        BlockchainReadBatch &requestKeyOutputAmount(uint32_t amountIndex);
+
         BlockchainReadBatch &requestTransactionCountByPaymentId(const Crypto::Hash &paymentId);
 
         BlockchainReadBatch &
@@ -194,11 +205,15 @@ namespace CryptoNote
 
         std::vector<std::string> getRawKeys() const override;
 
-        void submitRawResult(const std::vector<std::string> &values, const std::vector<bool> &resultStates) override;
+        std::vector<std::string> getRawKeyColumnFamilies() const override;
+
+        void submitRawResult(const std::vector<std::string_view> &values, const std::vector<bool> &resultStates) override;
 
         BlockchainReadResult extractResult();
 
       private:
+        DB::Format format;
+
         bool resultSubmitted = false;
 
         BlockchainReadState state;
@@ -6,6 +6,8 @@
 
 #include "BlockchainUtils.h"
 
+#include <utilities/ParseExtra.h>
+
 namespace CryptoNote
 {
     namespace Utils
@@ -30,5 +32,151 @@ namespace CryptoNote
             return true;
         }
 
+        namespace
+        {
+            void addKeyOutputs(const Transaction &transaction, WalletTypes::RawCoinbaseTransaction &rawTransaction)
+            {
+                rawTransaction.keyOutputs.reserve(transaction.outputs.size());
+
+                for (const auto &output : transaction.outputs)
+                {
+                    WalletTypes::KeyOutput keyOutput;
+
+                    keyOutput.amount = output.amount;
+                    keyOutput.key = boost::get<KeyOutput>(output.target).key;
+
+                    rawTransaction.keyOutputs.push_back(keyOutput);
+                }
+            }
+        } // namespace
+
+        WalletTypes::RawCoinbaseTransaction getRawCoinbaseTransaction(const CachedTransaction &transaction)
+        {
+            const Transaction &t = transaction.getTransaction();
+
+            WalletTypes::RawCoinbaseTransaction rawTransaction;
+
+            rawTransaction.hash = transaction.getTransactionHash();
+            rawTransaction.transactionPublicKey = Utilities::getTransactionPublicKeyFromExtra(t.extra);
+            rawTransaction.unlockTime = t.unlockTime;
+
+            addKeyOutputs(t, rawTransaction);
+
+            return rawTransaction;
+        }
+
+        WalletTypes::RawTransaction getRawTransaction(const CachedTransaction &transaction)
+        {
+            const Transaction &t = transaction.getTransaction();
+
+            WalletTypes::RawTransaction rawTransaction;
+
+            rawTransaction.hash = transaction.getTransactionHash();
+
+            const Utilities::ParsedExtra parsedExtra = Utilities::parseExtra(t.extra);
+
+            /* Used with the private view key to find the outputs */
+            rawTransaction.transactionPublicKey = parsedExtra.transactionPublicKey;
+
+            /* Empty if the transaction has no payment ID */
+            rawTransaction.paymentID = parsedExtra.paymentID;
+
+            rawTransaction.unlockTime = t.unlockTime;
+
+            addKeyOutputs(t, rawTransaction);
+
+            rawTransaction.keyInputs.reserve(t.inputs.size());
+
+            for (const auto &input : t.inputs)
+            {
+                rawTransaction.keyInputs.push_back(boost::get<KeyInput>(input));
+            }
+
+            return rawTransaction;
+        }
+
+        WalletTypes::WalletBlockInfo getWalletBlockInfo(
+            const CachedBlock &block,
+            const CachedTransaction &baseTransaction,
+            const std::vector<CachedTransaction> &transactions)
+        {
+            WalletTypes::WalletBlockInfo walletBlock;
+
+            walletBlock.blockHeight = block.getBlockIndex();
+            walletBlock.blockHash = block.getBlockHash();
+            walletBlock.blockTimestamp = block.getBlock().timestamp;
+
+            walletBlock.coinbaseTransaction = getRawCoinbaseTransaction(baseTransaction);
+
+            walletBlock.transactions.reserve(transactions.size());
+
+            for (const auto &transaction : transactions)
+            {
+                walletBlock.transactions.push_back(getRawTransaction(transaction));
+            }
+
+            return walletBlock;
+        }
+
+        std::vector<WalletTypes::WalletBlockInfo>
+            getWalletBlockInfos(const std::vector<RawBlock> &rawBlocks, const IBlockchainCache &cache)
+        {
+            std::vector<WalletTypes::WalletBlockInfo> walletBlocks;
+            walletBlocks.reserve(rawBlocks.size());
+
+            std::vector<Crypto::Hash> transactionHashes;
+
+            for (const auto &rawBlock : rawBlocks)
+            {
+                BlockTemplate block;
+                fromBinaryArray(block, rawBlock.block);
+
+                std::vector<CachedTransaction> transactions;
+                restoreCachedTransactions(rawBlock.transactions, transactions);
+
+                const CachedBlock cachedBlock(block);
+
+                walletBlocks.push_back(
+                    getWalletBlockInfo(cachedBlock, CachedTransaction(block.baseTransaction), transactions));
+
+                transactionHashes.push_back(walletBlocks.back().coinbaseTransaction->hash);
+
+                for (const auto &transaction : walletBlocks.back().transactions)
+                {
+                    transactionHashes.push_back(transaction.hash);
+                }
+            }
+
+            /* One lookup for every transaction, rather than one per block */
+            const auto globalIndexes = cache.getGlobalIndexes(transactionHashes);
+
+            const auto fillGlobalIndexes = [&globalIndexes](WalletTypes::RawCoinbaseTransaction &transaction)
+            {
+                const auto it = globalIndexes.find(transaction.hash);
+
+                if (it == globalIndexes.end() || it->second.size() != transaction.keyOutputs.size())
+                {
+                    return;
+                }
+
+                for (size_t i = 0; i < transaction.keyOutputs.size(); i++)
+                {
+                    transaction.keyOutputs[i].globalOutputIndex = it->second[i];
+                }
+            };
+
+            for (auto &walletBlock : walletBlocks)
+            {
+                fillGlobalIndexes(*walletBlock.coinbaseTransaction);
+
+                for (auto &transaction : walletBlock.transactions)
+                {
+                    fillGlobalIndexes(transaction);
+                }
+            }
+
+            return walletBlocks;
+        }
+
     } // namespace Utils
 } // namespace CryptoNote
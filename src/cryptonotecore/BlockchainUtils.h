@@ -6,10 +6,13 @@
 
 #pragma once
 
+#include "CachedBlock.h"
 #include "CachedTransaction.h"
 #include "CryptoNote.h"
+#include "IBlockchainCache.h"
 #include "common/CryptoNoteTools.h"
 
+#include <WalletTypes.h>
 #include <vector>
 
 namespace CryptoNote
@@ -20,5 +23,21 @@ namespace CryptoNote
             const std::vector<BinaryArray> &binaryTransactions,
             std::vector<CachedTransaction> &transactions);
 
+        WalletTypes::RawCoinbaseTransaction getRawCoinbaseTransaction(const CachedTransaction &transaction);
+
+        WalletTypes::RawTransaction getRawTransaction(const CachedTransaction &transaction);
+
+        /* The record wallets scan for a block, without the global indexes of
+           the outputs, which are only known once the block is pushed */
+        WalletTypes::WalletBlockInfo getWalletBlockInfo(
+            const CachedBlock &block,
+            const CachedTransaction &baseTransaction,
+            const std::vector<CachedTransaction> &transactions);
+
+        /* Builds the wallet records of blocks stored before the records
+           were, taking the global output indexes from the cache */
+        std::vector<WalletTypes::WalletBlockInfo>
+            getWalletBlockInfos(const std::vector<RawBlock> &rawBlocks, const IBlockchainCache &cache);
+
     } // namespace Utils
 } // namespace CryptoNote
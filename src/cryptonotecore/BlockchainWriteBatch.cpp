@@ -8,44 +8,40 @@
 
 #include "DBUtils.h"
 
-#include <boost/serialization/unordered_set.hpp>
-
 using namespace CryptoNote;
 
+BlockchainWriteBatch::BlockchainWriteBatch(const DB::Format format): format(format) {}
+
+template<class Key, class Value>
+void BlockchainWriteBatch::put(const std::string &keyPrefix, const Key &key, const Value &value)
+{
+    rawDataToInsertWithCF[DB::columnFamily(keyPrefix)].emplace_back(DB::serialize(format, keyPrefix, key, value));
+}
+
+template<class Key> void BlockchainWriteBatch::remove(const std::string &keyPrefix, const Key &key)
+{
+    rawKeysToRemoveWithCF[DB::columnFamily(keyPrefix)].emplace_back(DB::serializeKey(format, keyPrefix, key));
+}
+
 BlockchainWriteBatch &BlockchainWriteBatch::insertSpentKeyImages(
     const uint32_t blockIndex,
     const std::unordered_set<Crypto::KeyImage> &spentKeyImages)
 {
-    rawDataToInsert.reserve(rawDataToInsert.size() + spentKeyImages.size() + 1);
-    rawDataToInsert.emplace_back(DB::serialize(DB::BLOCK_INDEX_TO_KEY_IMAGE_PREFIX, blockIndex, spentKeyImages));
+    put(DB::BLOCK_INDEX_TO_KEY_IMAGE_PREFIX, blockIndex, spentKeyImages);
 
     for (const Crypto::KeyImage &keyImage : spentKeyImages)
     {
-        rawDataToInsert.emplace_back(DB::serialize(DB::KEY_IMAGE_TO_BLOCK_INDEX_PREFIX, keyImage, blockIndex));
+        put(DB::KEY_IMAGE_TO_BLOCK_INDEX_PREFIX, keyImage, blockIndex);
     }
 
-    //rawDataToInsertWithCF[DB::V2::SPENT_KEY_IMAGES_CF].emplace_back(DB::V2::serialize(blockIndex, spentKeyImages));
-
-    //for (const Crypto::KeyImage &keyImage : spentKeyImages)
-    //{
-    //    rawDataToInsertWithCF[DB::V2::SPENT_KEY_IMAGES_CF].emplace_back(DB::V2::serialize(keyImage, blockIndex));
-    //}
-
     return *this;
 }
 
 BlockchainWriteBatch &BlockchainWriteBatch::insertCachedTransaction(const ExtendedTransactionInfo &transaction,
                                                                     const uint64_t totalTxsCount)
 {
-    rawDataToInsert.emplace_back(
-        DB::serialize(DB::TRANSACTION_HASH_TO_TRANSACTION_INFO_PREFIX, transaction.transactionHash, transaction));
-    rawDataToInsert.emplace_back(
-        DB::serialize(DB::TRANSACTION_HASH_TO_TRANSACTION_INFO_PREFIX, DB::TRANSACTIONS_COUNT_KEY, totalTxsCount));
-
-    //rawDataToInsertWithCF[DB::V2::TRANSACTIONS_CF].emplace_back(
-    //    DB::V2::serialize(transaction.transactionHash, transaction));
-    //rawDataToInsertWithCF[DB::V2::TRANSACTIONS_CF].emplace_back(
-    //    DB::V2::serialize(DB::TRANSACTIONS_COUNT_KEY, totalTxsCount));
+    put(DB::TRANSACTION_HASH_TO_TRANSACTION_INFO_PREFIX, transaction.transactionHash, transaction);
+    put(DB::TRANSACTION_HASH_TO_TRANSACTION_INFO_PREFIX, DB::TRANSACTIONS_COUNT_KEY, totalTxsCount);
 
     return *this;
 }
@@ -54,15 +50,8 @@ BlockchainWriteBatch &BlockchainWriteBatch::insertPaymentId(const Crypto::Hash &
                                                             const Crypto::Hash &paymentId,
                                                             const uint32_t totalTxsCountForPaymentId)
 {
-    rawDataToInsert.emplace_back(DB::serialize(DB::PAYMENT_ID_TO_TX_HASH_PREFIX, paymentId, totalTxsCountForPaymentId));
-    rawDataToInsert.emplace_back(DB::serialize(DB::PAYMENT_ID_TO_TX_HASH_PREFIX,
-                                               std::make_pair(paymentId, totalTxsCountForPaymentId - 1),
-                                               transactionHash));
-
-    //rawDataToInsertWithCF[DB::V2::PAYMENT_ID_TXS_CF].emplace_back(
-    //    DB::V2::serialize(paymentId, totalTxsCountForPaymentId));
-    //rawDataToInsertWithCF[DB::V2::PAYMENT_ID_TXS_CF].emplace_back(
-    //    DB::V2::serialize(Common::podToHex(paymentId), totalTxsCountForPaymentId - 1, transactionHash));
+    put(DB::PAYMENT_ID_TO_TX_HASH_PREFIX, paymentId, totalTxsCountForPaymentId);
+    put(DB::PAYMENT_ID_TO_TX_HASH_PREFIX, std::make_pair(paymentId, totalTxsCountForPaymentId - 1), transactionHash);
 
     return *this;
 }
@@ -71,20 +60,10 @@ BlockchainWriteBatch &BlockchainWriteBatch::insertCachedBlock(const CachedBlockI
                                                               const uint32_t blockIndex,
                                                               const std::vector<Crypto::Hash> &blockTxs)
 {
-    rawDataToInsert.emplace_back(DB::serialize(DB::BLOCK_INDEX_TO_BLOCK_INFO_PREFIX, blockIndex, block));
-    rawDataToInsert.emplace_back(DB::serialize(DB::BLOCK_INDEX_TO_TX_HASHES_PREFIX, blockIndex, blockTxs));
-    rawDataToInsert.emplace_back(DB::serialize(DB::BLOCK_HASH_TO_BLOCK_INDEX_PREFIX, block.blockHash, blockIndex));
-    rawDataToInsert.emplace_back(
-        DB::serialize(DB::BLOCK_INDEX_TO_BLOCK_HASH_PREFIX, DB::LAST_BLOCK_INDEX_KEY, blockIndex));
-
-    //rawDataToInsertWithCF[DB::V2::BLOCKS_CF].emplace_back(
-    //    DB::V2::serialize(DB::BLOCK_INDEX_TO_BLOCK_INFO_PREFIX, blockIndex, block));
-    //rawDataToInsertWithCF[DB::V2::BLOCKS_CF].emplace_back(
-    //    DB::V2::serialize(DB::BLOCK_INDEX_TO_TX_HASHES_PREFIX, blockIndex, blockTxs));
-    //rawDataToInsertWithCF[DB::V2::BLOCKS_CF].emplace_back(
-    //    DB::V2::serialize(block.blockHash, blockIndex));
-    //rawDataToInsertWithCF[DB::V2::BLOCKS_CF].emplace_back(
-    //    DB::V2::serialize(DB::LAST_BLOCK_INDEX_KEY, blockIndex));
+    put(DB::BLOCK_INDEX_TO_BLOCK_INFO_PREFIX, blockIndex, block);
+    put(DB::BLOCK_INDEX_TO_TX_HASHES_PREFIX, blockIndex, blockTxs);
+    put(DB::BLOCK_HASH_TO_BLOCK_INDEX_PREFIX, block.blockHash, blockIndex);
+    put(DB::BLOCK_INDEX_TO_BLOCK_HASH_PREFIX, DB::LAST_BLOCK_INDEX_KEY, blockIndex);
 
     return *this;
 }
@@ -94,14 +73,12 @@ BlockchainWriteBatch &BlockchainWriteBatch::insertKeyOutputGlobalIndexes(IBlockc
                                                                          const uint32_t totalOutputsCountForAmount)
 {
     assert(totalOutputsCountForAmount >= outputs.size());
-    rawDataToInsert.reserve(rawDataToInsert.size() + outputs.size() + 1);
-    rawDataToInsert.emplace_back(DB::serialize(DB::KEY_OUTPUT_AMOUNT_PREFIX, amount, totalOutputsCountForAmount));
+    put(DB::KEY_OUTPUT_AMOUNT_PREFIX, amount, totalOutputsCountForAmount);
     uint32_t currentOutputId = totalOutputsCountForAmount - static_cast<uint32_t>(outputs.size());
 
     for (const PackedOutIndex &outIndex : outputs)
     {
-        rawDataToInsert.emplace_back(
-            DB::serialize(DB::KEY_OUTPUT_AMOUNT_PREFIX, std::make_pair(amount, currentOutputId++), outIndex));
+        put(DB::KEY_OUTPUT_AMOUNT_PREFIX, std::make_pair(amount, currentOutputId++), outIndex);
     }
 
     return *this;
@@ -109,15 +86,22 @@ BlockchainWriteBatch &BlockchainWriteBatch::insertKeyOutputGlobalIndexes(IBlockc
 
 BlockchainWriteBatch &BlockchainWriteBatch::insertRawBlock(const uint32_t blockIndex, const RawBlock &block)
 {
-    rawDataToInsert.emplace_back(DB::serialize(DB::BLOCK_INDEX_TO_RAW_BLOCK_PREFIX, blockIndex, block));
-    //rawDataToInsertWithCF[DB::V2::RAW_BLOCKS_CF].emplace_back(DB::V2::serialize(blockIndex, block));
+    put(DB::BLOCK_INDEX_TO_RAW_BLOCK_PREFIX, blockIndex, block);
+
+    return *this;
+}
+
+BlockchainWriteBatch &
+    BlockchainWriteBatch::insertWalletBlock(const uint32_t blockIndex, const WalletTypes::WalletBlockInfo &block)
+{
+    put(DB::BLOCK_INDEX_TO_WALLET_BLOCK_PREFIX, blockIndex, block);
 
     return *this;
 }
 
 BlockchainWriteBatch &BlockchainWriteBatch::insertClosestTimestampBlockIndex(uint64_t timestamp, uint32_t blockIndex)
 {
-    rawDataToInsert.emplace_back(DB::serialize(DB::CLOSEST_TIMESTAMP_BLOCK_INDEX_PREFIX, timestamp, blockIndex));
+    put(DB::CLOSEST_TIMESTAMP_BLOCK_INDEX_PREFIX, timestamp, blockIndex);
     return *this;
 }
 
@@ -125,15 +109,12 @@ BlockchainWriteBatch &BlockchainWriteBatch::insertKeyOutputAmounts(const std::se
                                                                    uint32_t totalKeyOutputAmountsCount)
 {
     assert(totalKeyOutputAmountsCount >= amounts.size());
-    rawDataToInsert.reserve(rawDataToInsert.size() + amounts.size() + 1);
-    rawDataToInsert.emplace_back(DB::serialize(DB::KEY_OUTPUT_AMOUNTS_COUNT_PREFIX,
-                                               DB::KEY_OUTPUT_AMOUNTS_COUNT_KEY,
-                                               totalKeyOutputAmountsCount));
+    put(DB::KEY_OUTPUT_AMOUNTS_COUNT_PREFIX, DB::KEY_OUTPUT_AMOUNTS_COUNT_KEY, totalKeyOutputAmountsCount);
     uint32_t currentAmountId = totalKeyOutputAmountsCount - static_cast<uint32_t>(amounts.size());
 
     for (const IBlockchainCache::Amount &amount : amounts)
     {
-        rawDataToInsert.emplace_back(DB::serialize(DB::KEY_OUTPUT_AMOUNTS_COUNT_PREFIX, currentAmountId++, amount));
+        put(DB::KEY_OUTPUT_AMOUNTS_COUNT_PREFIX, currentAmountId++, amount);
     }
 
     return *this;
@@ -142,7 +123,7 @@ BlockchainWriteBatch &BlockchainWriteBatch::insertKeyOutputAmounts(const std::se
 BlockchainWriteBatch &BlockchainWriteBatch::insertTimestamp(uint64_t timestamp,
                                                             const std::vector<Crypto::Hash> &blockHashes)
 {
-    rawDataToInsert.emplace_back(DB::serialize(DB::TIMESTAMP_TO_BLOCKHASHES_PREFIX, timestamp, blockHashes));
+    put(DB::TIMESTAMP_TO_BLOCKHASHES_PREFIX, timestamp, blockHashes);
     return *this;
 }
 
@@ -150,20 +131,18 @@ BlockchainWriteBatch &BlockchainWriteBatch::insertKeyOutputInfo(IBlockchainCache
                                                                 IBlockchainCache::GlobalOutputIndex globalIndex,
                                                                 const KeyOutputInfo &outputInfo)
 {
-    rawDataToInsert.emplace_back(
-        DB::serialize(DB::KEY_OUTPUT_KEY_PREFIX, std::make_pair(amount, globalIndex), outputInfo));
+    put(DB::KEY_OUTPUT_KEY_PREFIX, std::make_pair(amount, globalIndex), outputInfo);
     return *this;
 }
 
 BlockchainWriteBatch &BlockchainWriteBatch::removeSpentKeyImages(uint32_t blockIndex,
                                                                  const std::vector<Crypto::KeyImage> &spentKeyImages)
 {
-    rawKeysToRemove.reserve(rawKeysToRemove.size() + spentKeyImages.size() + 1);
-    rawKeysToRemove.emplace_back(DB::serializeKey(DB::BLOCK_INDEX_TO_KEY_IMAGE_PREFIX, blockIndex));
+    remove(DB::BLOCK_INDEX_TO_KEY_IMAGE_PREFIX, blockIndex);
 
     for (const Crypto::KeyImage &keyImage : spentKeyImages)
     {
-        rawKeysToRemove.emplace_back(DB::serializeKey(DB::KEY_IMAGE_TO_BLOCK_INDEX_PREFIX, keyImage));
+        remove(DB::KEY_IMAGE_TO_BLOCK_INDEX_PREFIX, keyImage);
     }
 
     return *this;
@@ -172,28 +151,25 @@ BlockchainWriteBatch &BlockchainWriteBatch::removeSpentKeyImages(uint32_t blockI
 BlockchainWriteBatch &BlockchainWriteBatch::removeCachedTransaction(const Crypto::Hash &transactionHash,
                                                                     uint64_t totalTxsCount)
 {
-    rawKeysToRemove.emplace_back(DB::serializeKey(DB::TRANSACTION_HASH_TO_TRANSACTION_INFO_PREFIX, transactionHash));
-    rawDataToInsert.emplace_back(
-        DB::serialize(DB::TRANSACTION_HASH_TO_TRANSACTION_INFO_PREFIX, DB::TRANSACTIONS_COUNT_KEY, totalTxsCount));
+    remove(DB::TRANSACTION_HASH_TO_TRANSACTION_INFO_PREFIX, transactionHash);
+    put(DB::TRANSACTION_HASH_TO_TRANSACTION_INFO_PREFIX, DB::TRANSACTIONS_COUNT_KEY, totalTxsCount);
     return *this;
 }
 
 BlockchainWriteBatch &BlockchainWriteBatch::removePaymentId(const Crypto::Hash paymentId,
                                                             uint32_t totalTxsCountForPaymentId)
 {
-    rawDataToInsert.emplace_back(DB::serialize(DB::PAYMENT_ID_TO_TX_HASH_PREFIX, paymentId, totalTxsCountForPaymentId));
-    rawKeysToRemove.emplace_back(
-        DB::serializeKey(DB::PAYMENT_ID_TO_TX_HASH_PREFIX, std::make_pair(paymentId, totalTxsCountForPaymentId)));
+    put(DB::PAYMENT_ID_TO_TX_HASH_PREFIX, paymentId, totalTxsCountForPaymentId);
+    remove(DB::PAYMENT_ID_TO_TX_HASH_PREFIX, std::make_pair(paymentId, totalTxsCountForPaymentId));
     return *this;
 }
 
 BlockchainWriteBatch &BlockchainWriteBatch::removeCachedBlock(const Crypto::Hash &blockHash, uint32_t blockIndex)
 {
-    rawKeysToRemove.emplace_back(DB::serializeKey(DB::BLOCK_INDEX_TO_BLOCK_INFO_PREFIX, blockIndex));
-    rawKeysToRemove.emplace_back(DB::serializeKey(DB::BLOCK_INDEX_TO_TX_HASHES_PREFIX, blockIndex));
-    rawKeysToRemove.emplace_back(DB::serializeKey(DB::BLOCK_HASH_TO_BLOCK_INDEX_PREFIX, blockHash));
-    rawDataToInsert.emplace_back(
-        DB::serialize(DB::BLOCK_INDEX_TO_BLOCK_HASH_PREFIX, DB::LAST_BLOCK_INDEX_KEY, blockIndex - 1));
+    remove(DB::BLOCK_INDEX_TO_BLOCK_INFO_PREFIX, blockIndex);
+    remove(DB::BLOCK_INDEX_TO_TX_HASHES_PREFIX, blockIndex);
+    remove(DB::BLOCK_HASH_TO_BLOCK_INDEX_PREFIX, blockHash);
+    put(DB::BLOCK_INDEX_TO_BLOCK_HASH_PREFIX, DB::LAST_BLOCK_INDEX_KEY, blockIndex - 1);
     return *this;
 }
 
@@ -201,49 +177,53 @@ BlockchainWriteBatch &BlockchainWriteBatch::removeKeyOutputGlobalIndexes(IBlockc
                                                                          uint32_t outputsToRemoveCount,
                                                                          uint32_t totalOutputsCountForAmount)
 {
-    rawKeysToRemove.reserve(rawKeysToRemove.size() + outputsToRemoveCount);
-    rawDataToInsert.emplace_back(DB::serialize(DB::KEY_OUTPUT_AMOUNT_PREFIX, amount, totalOutputsCountForAmount));
+    put(DB::KEY_OUTPUT_AMOUNT_PREFIX, amount, totalOutputsCountForAmount);
     for (uint32_t i = 0; i < outputsToRemoveCount; ++i)
     {
-        rawKeysToRemove.emplace_back(
-            DB::serializeKey(DB::KEY_OUTPUT_AMOUNT_PREFIX, std::make_pair(amount, totalOutputsCountForAmount + i)));
+        remove(DB::KEY_OUTPUT_AMOUNT_PREFIX, std::make_pair(amount, totalOutputsCountForAmount + i));
     }
     return *this;
 }
 
 BlockchainWriteBatch &BlockchainWriteBatch::removeRawBlock(uint32_t blockIndex)
 {
-    rawKeysToRemove.emplace_back(DB::serializeKey(DB::BLOCK_INDEX_TO_RAW_BLOCK_PREFIX, blockIndex));
+    remove(DB::BLOCK_INDEX_TO_RAW_BLOCK_PREFIX, blockIndex);
+    return *this;
+}
+
+BlockchainWriteBatch &BlockchainWriteBatch::removeWalletBlock(uint32_t blockIndex)
+{
+    remove(DB::BLOCK_INDEX_TO_WALLET_BLOCK_PREFIX, blockIndex);
     return *this;
 }
 
 BlockchainWriteBatch &BlockchainWriteBatch::removeClosestTimestampBlockIndex(uint64_t timestamp)
 {
-    rawKeysToRemove.emplace_back(DB::serializeKey(DB::CLOSEST_TIMESTAMP_BLOCK_INDEX_PREFIX, timestamp));
+    remove(DB::CLOSEST_TIMESTAMP_BLOCK_INDEX_PREFIX, timestamp);
     return *this;
 }
 
 BlockchainWriteBatch &BlockchainWriteBatch::removeTimestamp(uint64_t timestamp)
 {
-    rawKeysToRemove.emplace_back(DB::serializeKey(DB::TIMESTAMP_TO_BLOCKHASHES_PREFIX, timestamp));
+    remove(DB::TIMESTAMP_TO_BLOCKHASHES_PREFIX, timestamp);
     return *this;
 }
 
 BlockchainWriteBatch &BlockchainWriteBatch::removeKeyOutputInfo(IBlockchainCache::Amount amount,
                                                                 IBlockchainCache::GlobalOutputIndex globalIndex)
 {
-    rawKeysToRemove.emplace_back(DB::serializeKey(DB::KEY_OUTPUT_KEY_PREFIX, std::make_pair(amount, globalIndex)));
+    remove(DB::KEY_OUTPUT_KEY_PREFIX, std::make_pair(amount, globalIndex));
     return *this;
 }
 
 std::vector<std::pair<std::string, std::string>> BlockchainWriteBatch::extractRawDataToInsert()
 {
-    return std::move(rawDataToInsert);
+    return {};
 }
 
 std::vector<std::string> BlockchainWriteBatch::extractRawKeysToRemove()
 {
-    return std::move(rawKeysToRemove);
+    return {};
 }
 
 std::unordered_map<std::string, std::vector<std::pair<std::string, std::string>>> BlockchainWriteBatch::
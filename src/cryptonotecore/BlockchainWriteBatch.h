@@ -8,6 +8,7 @@
 
 #include "BlockchainCache.h"
 #include "CryptoNote.h"
+#include "DBUtils.h"
 #include "DatabaseCacheData.h"
 #include "IWriteBatch.h"
 
@@ -16,6 +17,8 @@ namespace CryptoNote
     class BlockchainWriteBatch final : public IWriteBatch
     {
     public:
+        explicit BlockchainWriteBatch(DB::Format format);
+
         BlockchainWriteBatch &insertSpentKeyImages(uint32_t blockIndex,
                                                    const std::unordered_set<Crypto::KeyImage> &spentKeyImages);
 
@@ -36,6 +39,8 @@ namespace CryptoNote
 
         BlockchainWriteBatch &insertRawBlock(uint32_t blockIndex, const RawBlock &block);
 
+        BlockchainWriteBatch &insertWalletBlock(uint32_t blockIndex, const WalletTypes::WalletBlockInfo &block);
+
         BlockchainWriteBatch &insertClosestTimestampBlockIndex(uint64_t timestamp, uint32_t blockIndex);
 
         BlockchainWriteBatch &insertKeyOutputAmounts(const std::set<IBlockchainCache::Amount> &amounts,
@@ -62,6 +67,8 @@ namespace CryptoNote
 
         BlockchainWriteBatch &removeRawBlock(uint32_t blockIndex);
 
+        BlockchainWriteBatch &removeWalletBlock(uint32_t blockIndex);
+
         BlockchainWriteBatch &removeClosestTimestampBlockIndex(uint64_t timestamp);
 
         BlockchainWriteBatch &removeTimestamp(uint64_t timestamp);
@@ -78,8 +85,13 @@ namespace CryptoNote
         std::unordered_map<std::string, std::vector<std::string>> extractRawKeysToRemoveWithCF() override;
 
     private:
-        std::vector<std::pair<std::string, std::string>> rawDataToInsert;
-        std::vector<std::string> rawKeysToRemove;
+        /* Every table is written to its own column family */
+        template<class Key, class Value>
+        void put(const std::string &keyPrefix, const Key &key, const Value &value);
+
+        template<class Key> void remove(const std::string &keyPrefix, const Key &key);
+
+        DB::Format format;
 
         std::unordered_map<std::string, std::vector<std::pair<std::string, std::string>>> rawDataToInsertWithCF;
         std::unordered_map<std::string, std::vector<std::string>> rawKeysToRemoveWithCF;
@@ -181,9 +181,7 @@ namespace CryptoNote
             uint64_t reward = 0;
             int64_t emissionChange = 0;
             auto alreadyGeneratedCoins = segment.getAlreadyGeneratedCoins(previousBlockIndex);
-            auto lastBlocksSizes =
-                segment.getLastBlocksSizes(currency.rewardBlocksWindow(), previousBlockIndex, addGenesisBlock);
-            auto blocksSizeMedian = Common::medianValue(lastBlocksSizes);
+            auto blocksSizeMedian = segment.getLastBlocksSizesMedian(previousBlockIndex);
             if (!currency.getBlockReward(
                     cachedBlock.getBlock().majorVersion,
                     blocksSizeMedian,
@@ -202,6 +200,14 @@ namespace CryptoNote
 
         const std::chrono::seconds OUTDATED_TRANSACTION_POLLING_INTERVAL = std::chrono::seconds(60);
 
+        /* Block preparation runs alongside the commit, which validates inputs
+           on the transaction validation scheduler, so it only gets half of
+           the threads, and never more than the blocks prepared at once */
+        uint64_t blockPreparationThreadCount(const uint32_t transactionValidationThreads)
+        {
+            return std::clamp<uint64_t>(transactionValidationThreads / 2, 1, BLOCK_VALIDATION_PIPELINE_DEPTH);
+        }
+
     } // namespace
 
     Core::Core(
@@ -210,7 +216,8 @@ namespace CryptoNote
         Checkpoints &&checkpoints,
         System::Dispatcher &dispatcher,
         std::unique_ptr<IBlockchainCacheFactory> &&blockchainCacheFactory,
-        const uint32_t transactionValidationThreads):
+        const uint32_t transactionValidationThreads,
+        const uint64_t walletSyncCacheBlocks):
         currency(currency),
         dispatcher(dispatcher),
         contextGroup(dispatcher),
@@ -219,7 +226,9 @@ namespace CryptoNote
         upgradeManager(new UpgradeManager()),
         blockchainCacheFactory(std::move(blockchainCacheFactory)),
         initialized(false),
-        m_transactionValidationThreadPool(transactionValidationThreads)
+        m_transactionValidationScheduler(transactionValidationThreads),
+        m_blockPreparationScheduler(blockPreparationThreadCount(transactionValidationThreads)),
+        m_walletSyncCache(walletSyncCacheBlocks)
     {
         upgradeManager->addMajorBlockVersion(BLOCK_MAJOR_VERSION_2, currency.upgradeHeight(BLOCK_MAJOR_VERSION_2));
         upgradeManager->addMajorBlockVersion(BLOCK_MAJOR_VERSION_3, currency.upgradeHeight(BLOCK_MAJOR_VERSION_3));
@@ -242,6 +251,11 @@ namespace CryptoNote
         contextGroup.wait();
     }
 
+    void Core::lastKnownBlockHeightUpdated(uint32_t height)
+    {
+        m_walletSyncCache.setNetworkHeight(height);
+    }
+
     bool Core::addMessageQueue(MessageQueue<BlockchainMessage> &messageQueue)
     {
         return queueList.insert(messageQueue);
@@ -254,6 +268,13 @@ namespace CryptoNote
 
     bool Core::notifyObservers(BlockchainMessage &&msg) /* noexcept */
     {
+        {
+            std::scoped_lock lock(m_changeMutex);
+            m_changeId++;
+        }
+
+        m_changeCondition.notify_all();
+
         try
         {
             for (auto &queue : queueList)
@@ -269,6 +290,21 @@ namespace CryptoNote
         }
     }
 
+    uint64_t Core::getChangeId() const
+    {
+        std::scoped_lock lock(m_changeMutex);
+        return m_changeId;
+    }
+
+    uint64_t Core::waitForChange(const uint64_t changeId, const std::chrono::milliseconds timeout) const
+    {
+        std::unique_lock<std::mutex> lock(m_changeMutex);
+
+        m_changeCondition.wait_for(lock, timeout, [this, changeId]() { return m_changeId != changeId; });
+
+        return m_changeId;
+    }
+
     uint32_t Core::getTopBlockIndex() const
     {
         assert(!chainsStorage.empty());
@@ -436,9 +472,17 @@ namespace CryptoNote
                 break;
             }
             auto transactions = alt->getRawTransactions(alt->getTransactionHashes());
-            for (auto &transaction : transactions)
+            for (auto &rawTransaction : transactions)
             {
-                const auto [success, error] = addTransactionToPool(transaction);
+                /* Called while switching chains, with the chain lock held, so
+                   can't go through the public overload, which takes it */
+                Transaction transaction;
+                if (!fromBinaryArray<Transaction>(transaction, rawTransaction))
+                {
+                    continue;
+                }
+
+                const auto [success, error] = addTransactionToPool(CachedTransaction(std::move(transaction)));
                 if (success)
                 {
                     // TODO: send notification
@@ -774,42 +818,66 @@ namespace CryptoNote
                 return true;
             }
 
-            std::vector<RawBlock> rawBlocks;
+            const auto addWalletBlock = [&walletBlocks, skipCoinbaseTransactions](
+                                            const WalletTypes::WalletBlockInfo &walletBlock) {
+                if (skipCoinbaseTransactions && walletBlock.transactions.empty())
+                {
+                    return;
+                }
 
-            if (skipCoinbaseTransactions)
-            {
-                rawBlocks = mainChain->getNonEmptyBlocks(startIndex, actualBlockCount);
-            }
-            else
-            {
-                rawBlocks = mainChain->getBlocksByHeight(startIndex, endIndex);
-            }
+                walletBlocks.push_back(walletBlock);
 
-            for (const auto &rawBlock : rawBlocks)
+                if (skipCoinbaseTransactions)
+                {
+                    walletBlocks.back().coinbaseTransaction.reset();
+                }
+            };
+
+            /* Blocks we need to return */
+            const uint64_t walletBlockCount = skipCoinbaseTransactions ? actualBlockCount : endIndex - startIndex;
+
+            uint64_t index = startIndex;
+
+            /* Take what we can from the cache, until we hit a block that isn't in it */
+            for (; index <= currentIndex && walletBlocks.size() < walletBlockCount; index++)
             {
-                BlockTemplate block;
+                const auto cachedWalletBlock =
+                    m_walletSyncCache.get(index, mainChain->getBlockHash(static_cast<uint32_t>(index)));
 
-                fromBinaryArray(block, rawBlock.block);
+                if (!cachedWalletBlock)
+                {
+                    break;
+                }
 
-                WalletTypes::WalletBlockInfo walletBlock;
+                addWalletBlock(*cachedWalletBlock);
+            }
 
-                CachedBlock cachedBlock(block);
+            while (index <= currentIndex && walletBlocks.size() < walletBlockCount)
+            {
+                /* Empty blocks are skipped without coinbase transactions, so take
+                   twice what we need, to avoid going back for more most times */
+                const uint64_t batchEndIndex = skipCoinbaseTransactions
+                    ? std::min(index + (walletBlockCount - walletBlocks.size()) * 2, currentIndex + 1)
+                    : endIndex;
 
-                walletBlock.blockHeight = cachedBlock.getBlockIndex();
-                walletBlock.blockHash = cachedBlock.getBlockHash();
-                walletBlock.blockTimestamp = block.timestamp;
+                auto storedBlocks = mainChain->getWalletBlockInfos(index, batchEndIndex);
 
-                if (!skipCoinbaseTransactions)
+                if (storedBlocks.empty())
                 {
-                    walletBlock.coinbaseTransaction = getRawCoinbaseTransaction(block.baseTransaction);
+                    break;
                 }
 
-                for (const auto &transaction : rawBlock.transactions)
+                index += storedBlocks.size();
+
+                for (auto &walletBlock : storedBlocks)
                 {
-                    walletBlock.transactions.push_back(getRawTransaction(transaction));
-                }
+                    if (walletBlocks.size() < walletBlockCount)
+                    {
+                        addWalletBlock(walletBlock);
+                    }
 
-                walletBlocks.push_back(walletBlock);
+                    m_walletSyncCache.insert(std::move(walletBlock));
+                }
             }
 
             if (walletBlocks.empty())
@@ -945,69 +1013,12 @@ namespace CryptoNote
 
     WalletTypes::RawCoinbaseTransaction Core::getRawCoinbaseTransaction(const CryptoNote::Transaction &t)
     {
-        WalletTypes::RawCoinbaseTransaction transaction;
-
-        transaction.hash = getBinaryArrayHash(toBinaryArray(t));
-
-        transaction.transactionPublicKey = Utilities::getTransactionPublicKeyFromExtra(t.extra);
-
-        transaction.unlockTime = t.unlockTime;
-
-        /* Fill in the simplified key outputs */
-        for (const auto &output : t.outputs)
-        {
-            WalletTypes::KeyOutput keyOutput;
-
-            keyOutput.amount = output.amount;
-            keyOutput.key = boost::get<CryptoNote::KeyOutput>(output.target).key;
-
-            transaction.keyOutputs.push_back(keyOutput);
-        }
-
-        return transaction;
+        return Utils::getRawCoinbaseTransaction(CachedTransaction(t));
     }
 
     WalletTypes::RawTransaction Core::getRawTransaction(const std::vector<uint8_t> &rawTX)
     {
-        Transaction t;
-
-        /* Convert the binary array to a transaction */
-        fromBinaryArray(t, rawTX);
-
-        WalletTypes::RawTransaction transaction;
-
-        /* Get the transaction hash from the binary array */
-        transaction.hash = getBinaryArrayHash(rawTX);
-
-        Utilities::ParsedExtra parsedExtra = Utilities::parseExtra(t.extra);
-
-        /* Transaction public key, used for decrypting transactions along with
-       private view key */
-        transaction.transactionPublicKey = parsedExtra.transactionPublicKey;
-
-        /* Get the payment ID if it exists (Empty string if it doesn't) */
-        transaction.paymentID = parsedExtra.paymentID;
-
-        transaction.unlockTime = t.unlockTime;
-
-        /* Simplify the outputs */
-        for (const auto &output : t.outputs)
-        {
-            WalletTypes::KeyOutput keyOutput;
-
-            keyOutput.amount = output.amount;
-            keyOutput.key = boost::get<CryptoNote::KeyOutput>(output.target).key;
-
-            transaction.keyOutputs.push_back(keyOutput);
-        }
-
-        /* Simplify the inputs */
-        for (const auto &input : t.inputs)
-        {
-            transaction.keyInputs.push_back(boost::get<CryptoNote::KeyInput>(input));
-        }
-
-        return transaction;
+        return Utils::getRawTransaction(CachedTransaction(rawTX));
     }
 
     std::optional<BinaryArray> Core::getTransaction(const Crypto::Hash &hash) const
@@ -1094,22 +1105,13 @@ namespace CryptoNote
         return difficulties[0];
     }
 
-    // TODO: just use mainChain->getDifficultyForNextBlock() ?
     uint64_t Core::getDifficultyForNextBlock() const
     {
         throwIfNotInitialized();
         IBlockchainCache *mainChain = chainsLeaves[0];
 
-        uint32_t topBlockIndex = mainChain->getTopBlockIndex();
-
-        uint8_t nextBlockMajorVersion = getBlockMajorVersionForHeight(topBlockIndex);
-
-        size_t blocksCount = std::min(static_cast<uint64_t>(topBlockIndex), CryptoNote::parameters::DIFFICULTY_BLOCKS_COUNT);
-
-        auto timestamps = mainChain->getLastTimestamps(blocksCount);
-        auto difficulties = mainChain->getLastCumulativeDifficulties(blocksCount);
-
-        return currency.getNextDifficulty(nextBlockMajorVersion, topBlockIndex, timestamps, difficulties);
+        /* The chain remembers the difficulty for its top block */
+        return mainChain->getDifficultyForNextBlock();
     }
 
     std::vector<Crypto::Hash> Core::findBlockchainSupplement(
@@ -1129,8 +1131,16 @@ namespace CryptoNote
     }
 
     std::error_code Core::addBlock(const CachedBlock &cachedBlock, RawBlock &&rawBlock)
+    {
+        return addBlock(cachedBlock, std::move(rawBlock), nullptr);
+    }
+
+    std::error_code Core::addBlock(const CachedBlock &cachedBlock, RawBlock &&rawBlock, PreparedBlock *preparedBlock)
     {
         throwIfNotInitialized();
+
+        const auto lock = lockChainForWriting();
+
         uint32_t blockIndex = cachedBlock.getBlockIndex();
         Crypto::Hash blockHash = cachedBlock.getBlockHash();
         std::ostringstream os;
@@ -1158,7 +1168,12 @@ namespace CryptoNote
 
         std::vector<CachedTransaction> transactions;
         uint64_t cumulativeSize = 0;
-        if (!extractTransactions(rawBlock.transactions, transactions, cumulativeSize))
+        if (preparedBlock != nullptr && preparedBlock->transactionsExtracted)
+        {
+            transactions = std::move(preparedBlock->transactions);
+            cumulativeSize = preparedBlock->cumulativeSize;
+        }
+        else if (!extractTransactions(rawBlock.transactions, transactions, cumulativeSize))
         {
             logger(Logging::DEBUGGING) << "Couldn't deserialize raw block transactions in block " << blockStr;
             return error::AddBlockErrorCode::DESERIALIZATION_FAILED;
@@ -1243,11 +1258,37 @@ namespace CryptoNote
 
         const uint64_t timestamp = cachedBlock.getBlock().timestamp;
 
-        for (const auto &transaction : transactions)
+        for (size_t i = 0; i < transactions.size(); i++)
         {
+            const auto &transaction = transactions[i];
+
+            const PreparedTransactionChecks *preparedChecks = nullptr;
+
+            /* Only filled in when the block wasn't prepared ahead of time */
+            std::optional<PreparedTransactionChecks> poolChecks;
+
+            if (preparedBlock != nullptr && i < preparedBlock->transactionChecks.size())
+            {
+                preparedChecks = &preparedBlock->transactionChecks[i];
+            }
+            /* Transactions mined from our pool had their signatures verified
+               when they were accepted into it */
+            else if ((poolChecks = transactionPool->tryGetTransactionChecks(transaction.getTransactionHash())))
+            {
+                preparedChecks = &*poolChecks;
+            }
+
             uint64_t fee = 0;
-            auto transactionValidationResult =
-                validateTransaction(transaction, validatorState, cache, m_transactionValidationThreadPool, fee, previousBlockIndex, timestamp, false);
+            auto transactionValidationResult = validateTransaction(
+                transaction,
+                validatorState,
+                cache,
+                m_transactionValidationScheduler,
+                fee,
+                previousBlockIndex,
+                timestamp,
+                false,
+                preparedChecks);
 
             if (transactionValidationResult)
             {
@@ -1272,9 +1313,7 @@ namespace CryptoNote
         uint64_t reward = 0;
         int64_t emissionChange = 0;
         auto alreadyGeneratedCoins = cache->getAlreadyGeneratedCoins(previousBlockIndex);
-        auto lastBlocksSizes =
-            cache->getLastBlocksSizes(currency.rewardBlocksWindow(), previousBlockIndex, addGenesisBlock);
-        auto blocksSizeMedian = Common::medianValue(lastBlocksSizes);
+        auto blocksSizeMedian = cache->getLastBlocksSizesMedian(previousBlockIndex);
 
         if (!currency.getBlockReward(
                 cachedBlock.getBlock().majorVersion,
@@ -1332,6 +1371,18 @@ namespace CryptoNote
                         currentDifficulty,
                         std::move(rawBlock));
 
+                    m_walletSyncCache.removeFrom(cachedBlock.getBlockIndex());
+
+                    /* Wallets will ask for this block as soon as they hear of it */
+                    if (m_walletSyncCache.wants(cachedBlock.getBlockIndex()))
+                    {
+                        for (auto &walletBlock :
+                             cache->getWalletBlockInfos(cachedBlock.getBlockIndex(), cachedBlock.getBlockIndex() + 1))
+                        {
+                            m_walletSyncCache.insert(std::move(walletBlock));
+                        }
+                    }
+
                     updateBlockMedianSize();
 
                     /* Take the current block spent key images and run them
@@ -1371,6 +1422,20 @@ namespace CryptoNote
                         std::swap(chainsLeaves[0], chainsLeaves[endpointIndex]);
                         updateMainChainSet();
 
+                        /* The blocks of the old main chain from the fork point on. The
+                           new main chain may branch off several segments below its
+                           leaf, so find the lowest old segment that isn't shared */
+                        IBlockchainCache *oldSegment = chainsLeaves[endpointIndex];
+                        uint32_t forkIndex = oldSegment->getStartBlockIndex();
+
+                        while (oldSegment != nullptr && mainChainSet.count(oldSegment) == 0)
+                        {
+                            forkIndex = oldSegment->getStartBlockIndex();
+                            oldSegment = oldSegment->getParent();
+                        }
+
+                        m_walletSyncCache.removeFrom(forkIndex);
+
                         updateBlockMedianSize();
 
                         /* Take the current block spent key images and run them
@@ -1581,6 +1646,234 @@ namespace CryptoNote
         return addBlock(cachedBlock, std::move(rawBlock));
     }
 
+    void Core::addBlocks(
+        const std::vector<CachedBlock> &cachedBlocks,
+        std::vector<RawBlock> &&rawBlocks,
+        const std::function<bool(const CachedBlock &, const std::error_code &)> &blockProcessed)
+    {
+        throwIfNotInitialized();
+
+        assert(cachedBlocks.size() == rawBlocks.size());
+
+        std::vector<std::unique_ptr<PreparedBlock>> preparedBlocks;
+        std::vector<std::future<bool>> preparations;
+
+        preparedBlocks.reserve(rawBlocks.size());
+        preparations.reserve(rawBlocks.size());
+
+        for (size_t index = 0; index < rawBlocks.size(); index++)
+        {
+            /* Keep the next few blocks being prepared on the worker threads
+               while this one is committed */
+            while (preparations.size() < rawBlocks.size()
+                   && preparations.size() <= index + BLOCK_VALIDATION_PIPELINE_DEPTH)
+            {
+                const size_t next = preparations.size();
+
+                preparedBlocks.push_back(
+                    std::make_unique<PreparedBlock>(cachedBlocks[next].getBlock(), std::move(rawBlocks[next])));
+
+                PreparedBlock *preparedBlock = preparedBlocks.back().get();
+
+                preparations.push_back(
+                    m_blockPreparationScheduler.submit([this, preparedBlock] { return prepareBlock(*preparedBlock); }));
+            }
+
+            /* A failed preparation just means the work is done again when
+               committing, which reports the actual error */
+            preparations[index].get();
+
+            auto &preparedBlock = *preparedBlocks[index];
+
+            const auto result =
+                addBlock(preparedBlock.cachedBlock, std::move(preparedBlock.rawBlock), &preparedBlock);
+
+            if (!blockProcessed(cachedBlocks[index], result))
+            {
+                break;
+            }
+        }
+
+        /* Don't free blocks which are still being prepared */
+        for (auto &preparation : preparations)
+        {
+            if (preparation.valid())
+            {
+                preparation.wait();
+            }
+        }
+    }
+
+    /* Does the validation work for a block which doesn't depend on the chain
+       state it will be added on top of. Runs on a worker thread, so may only
+       touch the chain with m_chainStateMutex held shared. */
+    bool Core::prepareBlock(PreparedBlock &preparedBlock)
+    {
+        try
+        {
+            const auto &cachedBlock = preparedBlock.cachedBlock;
+
+            const uint32_t blockIndex = cachedBlock.getBlockIndex();
+
+            cachedBlock.getBlockHash();
+
+            const bool inCheckpointZone = checkpoints.isInCheckpointZone(blockIndex);
+
+            /* The long hash is only needed to check the proof of work, which
+               is skipped for checkpointed blocks */
+            if (!inCheckpointZone)
+            {
+                cachedBlock.getBlockLongHash();
+            }
+
+            if (!extractTransactions(
+                    preparedBlock.rawBlock.transactions, preparedBlock.transactions, preparedBlock.cumulativeSize))
+            {
+                preparedBlock.transactions.clear();
+                preparedBlock.cumulativeSize = 0;
+                return false;
+            }
+
+            preparedBlock.transactionsExtracted = true;
+            preparedBlock.transactionChecks.resize(preparedBlock.transactions.size());
+
+            /* Transactions in a block are validated at the height of the previous block */
+            const uint32_t previousBlockIndex = blockIndex - 1;
+
+            for (size_t i = 0; i < preparedBlock.transactions.size(); i++)
+            {
+                const auto &cachedTransaction = preparedBlock.transactions[i];
+
+                auto &checks = preparedBlock.transactionChecks[i];
+
+                /* Already verified when the transaction was accepted into the pool */
+                if (auto poolChecks = transactionPool->tryGetTransactionChecks(cachedTransaction.getTransactionHash()))
+                {
+                    checks = std::move(*poolChecks);
+                    continue;
+                }
+
+                prepareTransactionChecks(cachedTransaction, previousBlockIndex, !inCheckpointZone, checks);
+            }
+
+            return true;
+        }
+        catch (const std::exception &e)
+        {
+            logger(Logging::DEBUGGING) << "Failed to prepare block: " << e.what();
+            return false;
+        }
+    }
+
+    /* Verifies the proof of work and ring signatures of a transaction ahead
+       of its full validation at blockIndex. Reads the ring members with
+       m_chainStateMutex held shared, so must not be called with it held. */
+    void Core::prepareTransactionChecks(
+        const CachedTransaction &cachedTransaction,
+        uint32_t blockIndex,
+        bool verifyRings,
+        PreparedTransactionChecks &checks)
+    {
+        const auto &transaction = cachedTransaction.getTransaction();
+
+        const Crypto::Hash prefixHash = cachedTransaction.getTransactionPrefixHash();
+
+        /* Below the fork height checkTransactionPoW() passes without hashing,
+           so that doesn't count as verified */
+        checks.proofOfWorkVerified = blockIndex >= CryptoNote::parameters::TRANSACTION_POW_HEIGHT
+                                     && ValidateTransaction::checkTransactionPoW(transaction, blockIndex);
+
+        if (!verifyRings)
+        {
+            return;
+        }
+
+        checks.verifiedRings.resize(transaction.inputs.size());
+
+        /* All of the transaction's rings are verified together */
+        Crypto::RingSignatureBatch batch;
+
+        /* Input index and ring members of each ring in the batch */
+        std::vector<std::pair<size_t, std::vector<Crypto::PublicKey>>> batchedInputs;
+
+        for (size_t inputIndex = 0; inputIndex < transaction.inputs.size(); inputIndex++)
+        {
+            const auto &input = transaction.inputs[inputIndex];
+
+            if (input.type() != typeid(KeyInput) || inputIndex >= transaction.signatures.size())
+            {
+                continue;
+            }
+
+            const KeyInput &in = boost::get<KeyInput>(input);
+
+            if (in.outputIndexes.empty())
+            {
+                continue;
+            }
+
+            std::vector<uint32_t> globalIndexes(in.outputIndexes.size());
+
+            globalIndexes[0] = in.outputIndexes[0];
+
+            bool strictlyIncreasing = true;
+
+            /* Convert output indexes from relative to absolute */
+            for (size_t j = 1; j < in.outputIndexes.size(); j++)
+            {
+                strictlyIncreasing &= in.outputIndexes[j] != 0;
+                globalIndexes[j] = globalIndexes[j - 1] + in.outputIndexes[j];
+            }
+
+            /* Malformed, leave it for the full validation to reject */
+            if (!strictlyIncreasing)
+            {
+                continue;
+            }
+
+            std::vector<Crypto::PublicKey> outputKeys;
+
+            ExtractOutputKeysResult result;
+
+            {
+                const auto lock = lockChainForReading();
+
+                /* The outputs may be created by a block which isn't committed yet,
+                   in which case the keys are missing and the input is verified at
+                   commit time instead */
+                result = chainsLeaves[0]->extractKeyOutputKeys(
+                    in.amount, {globalIndexes.data(), globalIndexes.size()}, outputKeys);
+            }
+
+            if (result != ExtractOutputKeysResult::SUCCESS
+                || outputKeys.size() != globalIndexes.size()
+                || outputKeys.size() != transaction.signatures[inputIndex].size())
+            {
+                continue;
+            }
+
+            batch.addRing(prefixHash, in.keyImage, outputKeys, transaction.signatures[inputIndex]);
+            batchedInputs.emplace_back(inputIndex, std::move(outputKeys));
+        }
+
+        std::vector<size_t> invalidRings;
+
+        batch.verify(invalidRings);
+
+        /* Invalid rings are left unverified, and rejected at commit time */
+        for (size_t ring = 0, invalid = 0; ring < batchedInputs.size(); ring++)
+        {
+            if (invalid < invalidRings.size() && invalidRings[invalid] == ring)
+            {
+                invalid++;
+                continue;
+            }
+
+            auto &[inputIndex, outputKeys] = batchedInputs[ring];
+            checks.verifiedRings[inputIndex] = std::move(outputKeys);
+        }
+    }
+
     std::error_code Core::submitBlock(const BinaryArray &rawBlockTemplate)
     {
         throwIfNotInitialized();
@@ -1731,24 +2024,35 @@ namespace CryptoNote
         {
             IBlockchainCache *mainChain = chainsLeaves[0];
 
-            std::vector<Crypto::Hash> transactionHashes;
-
-            for (const auto& rawBlock : mainChain->getBlocksByHeight(startHeight, endHeight))
+            const auto addIndexes = [&indexes](const WalletTypes::RawCoinbaseTransaction &transaction)
             {
-                for (const auto& transaction : rawBlock.transactions)
+                std::vector<uint64_t> transactionIndexes;
+                transactionIndexes.reserve(transaction.keyOutputs.size());
+
+                for (const auto &output : transaction.keyOutputs)
                 {
-                    transactionHashes.push_back(getBinaryArrayHash(transaction));
+                    if (!output.globalOutputIndex)
+                    {
+                        return;
+                    }
+
+                    transactionIndexes.push_back(*output.globalOutputIndex);
                 }
 
-                BlockTemplate block;
+                indexes[transaction.hash] = std::move(transactionIndexes);
+            };
 
-                fromBinaryArray(block, rawBlock.block);
+            /* The wallet records already hold the indexes */
+            for (const auto &walletBlock : mainChain->getWalletBlockInfos(startHeight, endHeight))
+            {
+                addIndexes(*walletBlock.coinbaseTransaction);
 
-                transactionHashes.push_back(getBinaryArrayHash(toBinaryArray(block.baseTransaction)));
+                for (const auto &transaction : walletBlock.transactions)
+                {
+                    addIndexes(transaction);
+                }
             }
 
-            indexes = mainChain->getGlobalIndexes(transactionHashes);
-
             return true;
         }
         catch (std::exception &e)
@@ -1772,20 +2076,129 @@ namespace CryptoNote
         CachedTransaction cachedTransaction(std::move(transaction));
         auto transactionHash = cachedTransaction.getTransactionHash();
 
-        const auto [success, error] = addTransactionToPool(std::move(cachedTransaction));
-        if (!success)
         {
-            return {false, error};
+            /* Validation reads the chain, which blocks from peers may be
+               added to meanwhile */
+            const auto lock = lockChainForReading();
+
+            const auto [success, error] = addTransactionToPool(std::move(cachedTransaction));
+            if (!success)
+            {
+                return {false, error};
+            }
         }
 
         notifyObservers(makeAddTransactionMessage({transactionHash}));
         return {true, ""};
     }
 
-    std::tuple<bool, std::string> Core::addTransactionToPool(CachedTransaction &&cachedTransaction)
+    std::vector<bool> Core::addTransactionsToPool(const std::vector<BinaryArray> &transactions)
+    {
+        throwIfNotInitialized();
+
+        std::vector<bool> added(transactions.size(), false);
+
+        /* Indexes of the transactions worth validating. Duplicates, and
+           transactions another peer already got into the pool, are dropped
+           before any work is done on them. */
+        std::vector<size_t> admitted;
+
+        std::unordered_set<Crypto::Hash> seen;
+
+        for (size_t i = 0; i < transactions.size(); i++)
+        {
+            const Crypto::Hash hash = getBinaryArrayHash(transactions[i]);
+
+            if (seen.insert(hash).second && !transactionPool->checkIfTransactionPresent(hash))
+            {
+                admitted.push_back(i);
+            }
+        }
+
+        if (admitted.empty())
+        {
+            return added;
+        }
+
+        uint32_t topBlockIndex;
+
+        {
+            const auto lock = lockChainForReading();
+            topBlockIndex = getTopBlockIndex();
+        }
+
+        std::vector<std::optional<CachedTransaction>> cachedTransactions(admitted.size());
+
+        std::vector<PreparedTransactionChecks> checks(admitted.size());
+
+        /* The proof of work and signatures don't depend on the rest of the
+           pool, so are checked for every transaction at once. Not done with
+           the chain lock held, as the workers take it to read ring members. */
+        m_blockPreparationScheduler.parallelFor(0, admitted.size(), [&](size_t i) {
+            try
+            {
+                Transaction transaction;
+
+                if (!fromBinaryArray<Transaction>(transaction, transactions[admitted[i]]))
+                {
+                    return true;
+                }
+
+                cachedTransactions[i].emplace(std::move(transaction));
+
+                prepareTransactionChecks(*cachedTransactions[i], topBlockIndex, true, checks[i]);
+            }
+            catch (const std::exception &e)
+            {
+                /* The full validation does the work again, and reports why it fails */
+                logger(Logging::DEBUGGING) << "Failed to prepare transaction: " << e.what();
+            }
+
+            return true;
+        });
+
+        std::vector<Crypto::Hash> addedHashes;
+
+        for (size_t i = 0; i < admitted.size(); i++)
+        {
+            if (!cachedTransactions[i])
+            {
+                logger(Logging::DEBUGGING) << "Couldn't add transaction to pool due to deserialization error";
+                continue;
+            }
+
+            const Crypto::Hash hash = cachedTransactions[i]->getTransactionHash();
+
+            /* The chain must not change while a transaction's key images are
+               checked against it and the pool, but is let go in between, so
+               a big batch doesn't hold up blocks being added */
+            const auto lock = lockChainForReading();
+
+            const auto [success, error] = addTransactionToPool(std::move(*cachedTransactions[i]), &checks[i]);
+
+            if (success)
+            {
+                added[admitted[i]] = true;
+                addedHashes.push_back(hash);
+            }
+        }
+
+        if (!addedHashes.empty())
+        {
+            notifyObservers(makeAddTransactionMessage(std::move(addedHashes)));
+        }
+
+        return added;
+    }
+
+    std::tuple<bool, std::string> Core::addTransactionToPool(
+        CachedTransaction &&cachedTransaction,
+        const PreparedTransactionChecks *preparedChecks)
     {
         TransactionValidatorState validatorState;
 
+        PreparedTransactionChecks verifiedChecks;
+
         auto transactionHash = cachedTransaction.getTransactionHash();
 
         /* If the transaction is already in the pool, then checking it again
@@ -1798,13 +2211,15 @@ namespace CryptoNote
             return {false, "Transaction already exists in pool"};
         }
 
-        const auto [success, error] = isTransactionValidForPool(cachedTransaction, validatorState);
+        const auto [success, error] =
+            isTransactionValidForPool(cachedTransaction, validatorState, verifiedChecks, preparedChecks);
         if (!success)
         {
             return {false, error};
         }
 
-        if (!transactionPool->pushTransaction(std::move(cachedTransaction), std::move(validatorState)))
+        if (!transactionPool->pushTransaction(
+                std::move(cachedTransaction), std::move(validatorState), std::move(verifiedChecks)))
         {
             logger(Logging::DEBUGGING) << "Failed to push transaction " << transactionHash
                                        << " to pool, already exists";
@@ -1817,7 +2232,9 @@ namespace CryptoNote
 
     std::tuple<bool, std::string> Core::isTransactionValidForPool(
         const CachedTransaction &cachedTransaction,
-        TransactionValidatorState &validatorState)
+        TransactionValidatorState &validatorState,
+        PreparedTransactionChecks &verifiedChecks,
+        const PreparedTransactionChecks *preparedChecks)
     {
         const auto transactionHash = cachedTransaction.getTransactionHash();
 
@@ -1833,7 +2250,7 @@ namespace CryptoNote
         const uint64_t lastTimestamp = chainsLeaves[0]->getLastTimestamps(1)[0];
 
         if (auto validationResult =
-                validateTransaction(cachedTransaction, validatorState, chainsLeaves[0], m_transactionValidationThreadPool, fee, getTopBlockIndex(), true, lastTimestamp))
+                validateTransaction(cachedTransaction, validatorState, chainsLeaves[0], m_transactionValidationScheduler, fee, getTopBlockIndex(), true, lastTimestamp, preparedChecks, &verifiedChecks))
         {
             logger(Logging::DEBUGGING) << "Transaction " << transactionHash
                                        << " is not valid. Reason: " << validationResult.message();
@@ -1852,14 +2269,14 @@ namespace CryptoNote
 
     std::tuple<bool, CryptoNote::BinaryArray> Core::getPoolTransaction(const Crypto::Hash &transactionHash) const
     {
-        if (transactionPool->checkIfTransactionPresent(transactionHash))
-        {
-            return {true, transactionPool->getTransaction(transactionHash).getTransactionBinaryArray()};
-        }
-        else
+        /* Copied under the pool lock, the transaction may be removed by
+           another thread as soon as it's released */
+        if (const auto transaction = transactionPool->tryGetTransaction(transactionHash))
         {
-            return {false, BinaryArray()};
+            return {true, transaction->getTransactionBinaryArray()};
         }
+
+        return {false, BinaryArray()};
     }
 
     bool Core::getPoolChanges(
@@ -2222,11 +2639,13 @@ namespace CryptoNote
         const CachedTransaction &cachedTransaction,
         TransactionValidatorState &state,
         IBlockchainCache *cache,
-        Utilities::ThreadPool<bool> &threadPool,
+        Utilities::TaskScheduler &scheduler,
         uint64_t &fee,
         uint32_t blockIndex,
         uint64_t blockTimestamp,
-        const bool isPoolTransaction)
+        const bool isPoolTransaction,
+        const PreparedTransactionChecks *preparedChecks,
+        PreparedTransactionChecks *verifiedChecks)
     {
         ValidateTransaction txValidator(
             cachedTransaction,
@@ -2234,17 +2653,23 @@ namespace CryptoNote
             cache,
             currency,
             checkpoints,
-            threadPool,
+            scheduler,
             blockIndex,
             blockMedianSize,
             blockTimestamp,
-            isPoolTransaction
+            isPoolTransaction,
+            preparedChecks
         );
 
         const auto result = txValidator.validate();
 
         fee = result.fee;
 
+        if (verifiedChecks != nullptr && result.valid)
+        {
+            *verifiedChecks = txValidator.getVerifiedChecks();
+        }
+
         return result.errorCode;
     }
 
@@ -2409,6 +2834,8 @@ namespace CryptoNote
     {
         throwIfNotInitialized();
 
+        const auto lock = lockChainForWriting();
+
         deleteAlternativeChains();
         mergeMainChainSegments();
         chainsLeaves[0]->save();
@@ -2416,6 +2843,8 @@ namespace CryptoNote
 
     void Core::load()
     {
+        const auto lock = lockChainForWriting();
+
         initRootSegment();
 
         start_time = std::time(nullptr);
@@ -2527,7 +2956,7 @@ namespace CryptoNote
         const uint64_t batchSizePerThread = 1000;
         const uint64_t batchSizePerLoop = batchSizePerThread * threadCount;
 
-        Utilities::ThreadPool<std::vector<RawBlock>> threadPool(threadCount);
+        Utilities::TaskScheduler scheduler(threadCount);
 
         ThreadSafeQueue<std::future<std::vector<RawBlock>>> pendingBlocks;
 
@@ -2555,7 +2984,7 @@ namespace CryptoNote
                 /* Fetch a batch of blocks on each thread. Ensure we take the
                  * args we capture by value, not reference here, or the batches
                  * will get all messed up. */
-                pendingBlocks.pushMove(std::move(threadPool.addJob([batchStart, batchEnd, &mainChain] {
+                pendingBlocks.pushMove(std::move(scheduler.submit([batchStart, batchEnd, &mainChain] {
                     return mainChain->getBlocksByHeight(batchStart, batchEnd);
                 })));
             }
@@ -2706,6 +3135,9 @@ namespace CryptoNote
         cumulativeSize += getObjectBinarySize(blockTemplate.baseTransaction);
 
         const TransactionValidatorState spentOutputs = extractSpentOutputs(transactions);
+
+        const auto lock = lockChainForWriting();
+
         const uint64_t currentDifficulty = chainsLeaves[0]->getDifficultyForNextBlock(height - 1);
 
         /* Total fee of transactions in block */
@@ -2861,8 +3293,29 @@ namespace CryptoNote
         return std::string();
     }
 
+    std::shared_lock<std::shared_mutex> Core::lockChainForReading() const
+    {
+        /* Queue behind any writer waiting for the chain */
+        {
+            std::scoped_lock gate(m_chainWriterGate);
+        }
+
+        return std::shared_lock<std::shared_mutex>(m_chainStateMutex);
+    }
+
+    std::unique_lock<std::shared_mutex> Core::lockChainForWriting()
+    {
+        /* Held until the chain is ours, so readers arriving meanwhile wait
+           instead of keeping it shared forever */
+        std::scoped_lock gate(m_chainWriterGate);
+
+        return std::unique_lock<std::shared_mutex>(m_chainStateMutex);
+    }
+
     void Core::rewind(const uint64_t blockIndex)
     {
+        const auto lock = lockChainForWriting();
+
         IBlockchainCache *mainChain = chainsLeaves[0];
 
         if (mainChain->getTopBlockIndex() < blockIndex)
@@ -2885,6 +3338,8 @@ namespace CryptoNote
 
         mainChain->rewind(blockIndex);
 
+        m_walletSyncCache.removeFrom(blockIndex);
+
         logger(Logging::INFO) << "Blockchain rewound to: " << blockIndex << std::endl;
     }
 
@@ -3245,9 +3700,7 @@ namespace CryptoNote
 
         assert(!chainsStorage.empty());
         assert(!chainsLeaves.empty());
-        // FIXME: skip gensis here?
-        auto sizes = chainsLeaves[0]->getLastBlocksSizes(currency.rewardBlocksWindow());
-        uint64_t median = Common::medianValue(sizes);
+        uint64_t median = chainsLeaves[0]->getLastBlocksSizesMedian(chainsLeaves[0]->getTopBlockIndex());
         if (median <= nextBlockGrantedFullRewardZone)
         {
             median = nextBlockGrantedFullRewardZone;
@@ -3269,7 +3722,7 @@ namespace CryptoNote
             nullptr, /* Not used in revalidateAfterHeightChange() */
             currency,
             checkpoints,
-            m_transactionValidationThreadPool,
+            m_transactionValidationScheduler,
             blockHeight,
             blockMedianSize,
             chainsLeaves[0]->getLastTimestamps(1)[0],
@@ -3298,6 +3751,28 @@ namespace CryptoNote
 
         TransactionSpentInputsChecker spentInputsChecker;
 
+        std::scoped_lock lock(m_templateValidationMutex);
+
+        if (block.previousBlockHash != m_templateValidationTopBlockHash)
+        {
+            m_templateValidTransactions.clear();
+            m_templateValidationTopBlockHash = block.previousBlockHash;
+        }
+
+        /* Read before the pool, so if the pool changes while we are reading
+           it the pick isn't reused */
+        const uint64_t changeId = getChangeId();
+
+        if (m_templateTransactions && m_templateTransactions->changeId == changeId
+            && m_templateTransactions->previousBlockHash == block.previousBlockHash)
+        {
+            block.transactionHashes = m_templateTransactions->transactionHashes;
+            transactionsSize = m_templateTransactions->transactionsSize;
+            fee = m_templateTransactions->fee;
+
+            return;
+        }
+
         /* Go get our regular and fusion transactions from the transaction pool */
         auto [regularTransactions, fusionTransactions] = transactionPool->getPoolTransactionsForBlockTemplate();
 
@@ -3312,12 +3787,20 @@ namespace CryptoNote
                     return false;
                 }
 
-                /* Check to validate that the transaction is valid for a block at this height */
-                if (!validateBlockTemplateTransaction(transaction, height))
+                const auto &transactionHash = transaction.getTransactionHash();
+
+                /* Check to validate that the transaction is valid for a block at this height,
+                   unless it was already checked for an earlier template on the same block */
+                if (m_templateValidTransactions.count(transactionHash) == 0)
                 {
-                    transactionPool->removeTransaction(transaction.getTransactionHash());
+                    if (!validateBlockTemplateTransaction(transaction, height))
+                    {
+                        transactionPool->removeTransaction(transactionHash);
 
-                    return false;
+                        return false;
+                    }
+
+                    m_templateValidTransactions.insert(transactionHash);
                 }
 
                 /* Make sure that we have not already spent funds in this same block via
@@ -3364,6 +3847,9 @@ namespace CryptoNote
                                        << " included in block template";
             }
         }
+
+        m_templateTransactions = TemplateTransactions {
+            block.previousBlockHash, changeId, block.transactionHashes, transactionsSize, fee};
     }
 
     void Core::deleteAlternativeChains()
@@ -3569,9 +4055,7 @@ namespace CryptoNote
         blockDetails.sizeMedian = 0;
         if (blockDetails.index > 0)
         {
-            auto lastBlocksSizes =
-                segment->getLastBlocksSizes(currency.rewardBlocksWindow(), blockDetails.index - 1, addGenesisBlock);
-            blockDetails.sizeMedian = Common::medianValue(lastBlocksSizes);
+            blockDetails.sizeMedian = segment->getLastBlocksSizesMedian(blockDetails.index - 1);
             prevBlockGeneratedCoins = segment->getAlreadyGeneratedCoins(blockDetails.index - 1);
         }
 
@@ -3912,10 +4396,9 @@ namespace CryptoNote
         size_t nextBlockGrantedFullRewardZone = currency.blockGrantedFullRewardZoneByBlockVersion(
             upgradeManager->getBlockMajorVersion(mainChain->getTopBlockIndex() + 1));
 
-        auto lastBlockSizes = mainChain->getLastBlocksSizes(currency.rewardBlocksWindow());
-
-        blockMedianSize =
-            std::max(Common::medianValue(lastBlockSizes), static_cast<uint64_t>(nextBlockGrantedFullRewardZone));
+        blockMedianSize = std::max(
+            mainChain->getLastBlocksSizesMedian(mainChain->getTopBlockIndex()),
+            static_cast<uint64_t>(nextBlockGrantedFullRewardZone));
     }
 
     std::time_t Core::getStartTime() const
@@ -21,20 +21,29 @@
 #include "ITransactionPoolCleaner.h"
 #include "IUpgradeManager.h"
 #include "MessageQueue.h"
+#include "PreparedBlock.h"
 #include "TransactionValidatiorState.h"
+#include "WalletSyncCache.h"
 
 #include <WalletTypes.h>
+#include <chrono>
+#include <condition_variable>
+#include <config/Constants.h>
+#include <cryptonoteprotocol/ICryptoNoteProtocolObserver.h>
 #include <ctime>
+#include <functional>
 #include <logging/LoggerMessage.h>
+#include <mutex>
+#include <shared_mutex>
 #include <system/ContextGroup.h>
 #include <unordered_map>
-#include <utilities/ThreadPool.h>
+#include <utilities/TaskScheduler.h>
 #include <utilities/ThreadSafeQueue.h>
 #include <vector>
 
 namespace CryptoNote
 {
-    class Core : public ICore, public ICoreInformation
+    class Core : public ICore, public ICoreInformation, public ICryptoNoteProtocolObserver
     {
       public:
         Core(
@@ -43,10 +52,15 @@ namespace CryptoNote
             Checkpoints &&checkpoints,
             System::Dispatcher &dispatcher,
             std::unique_ptr<IBlockchainCacheFactory> &&blockchainCacheFactory,
-            uint32_t transactionValidationThreads);
+            uint32_t transactionValidationThreads,
+            uint64_t walletSyncCacheBlocks = WALLET_SYNC_CACHE_DEFAULT_BLOCKS);
 
         virtual ~Core();
 
+        /* The wallet sync cache only keeps blocks near the network height,
+           so a syncing node doesn't build entries no wallet will ask for */
+        virtual void lastKnownBlockHeightUpdated(uint32_t height) override;
+
         virtual bool addMessageQueue(MessageQueue<BlockchainMessage> &messageQueue) override;
 
         virtual bool removeMessageQueue(MessageQueue<BlockchainMessage> &messageQueue) override;
@@ -146,6 +160,11 @@ namespace CryptoNote
 
         virtual std::error_code addBlock(RawBlock &&rawBlock) override;
 
+        virtual void addBlocks(
+            const std::vector<CachedBlock> &cachedBlocks,
+            std::vector<RawBlock> &&rawBlocks,
+            const std::function<bool(const CachedBlock &, const std::error_code &)> &blockProcessed) override;
+
         virtual std::error_code submitBlock(const BinaryArray &rawBlockTemplate) override;
 
         virtual bool getTransactionGlobalIndexes(
@@ -165,6 +184,8 @@ namespace CryptoNote
 
         virtual std::tuple<bool, std::string> addTransactionToPool(const BinaryArray &transactionBinaryArray) override;
 
+        virtual std::vector<bool> addTransactionsToPool(const std::vector<BinaryArray> &transactions) override;
+
         virtual std::vector<Crypto::Hash> getPoolTransactionHashes() const override;
 
         virtual std::tuple<bool, BinaryArray> getPoolTransaction(const Crypto::Hash &transactionHash) const override;
@@ -239,6 +260,16 @@ namespace CryptoNote
 
         virtual void rewind(const uint64_t blockIndex) override;
 
+        virtual std::shared_lock<std::shared_mutex> lockChainForReading() const override;
+
+        /* Changes whenever the chain or the pool does, so RPC clients can
+           wait for something new instead of polling */
+        uint64_t getChangeId() const;
+
+        /* Blocks until the change id is not the one given, or the timeout
+           passes. Returns the current change id. */
+        uint64_t waitForChange(uint64_t changeId, std::chrono::milliseconds timeout) const;
+
         CryptoNote::RawBlock getRawBlock(uint32_t blockIndex) const;
 
         CryptoNote::RawBlock getRawBlock(const Crypto::Hash &blockHash) const;
@@ -270,7 +301,39 @@ namespace CryptoNote
 
         std::unique_ptr<IBlockchainCacheFactory> blockchainCacheFactory;
 
-        Utilities::ThreadPool<bool> m_transactionValidationThreadPool;
+        Utilities::TaskScheduler m_transactionValidationScheduler;
+
+        /* Separate from the transaction validation scheduler, as block preparation
+           tasks waiting on the chain lock would otherwise hold up the workers
+           validating the committing block's inputs. Smaller than it, see
+           blockPreparationThreadCount(). */
+        Utilities::TaskScheduler m_blockPreparationScheduler;
+
+        /* Held exclusively while the chain segments are modified, and shared
+           by block preparation jobs reading ring members from the main chain,
+           and by anything holding lockChainForReading().
+
+           chainsLeaves, chainsStorage and mainChainSet are only changed by
+           addBlock() (including switching the main chain), importRawBlock(),
+           rewind(), save() and load(), which all hold it exclusively. */
+        mutable std::shared_mutex m_chainStateMutex;
+
+        /* Held by a writer while it waits for m_chainStateMutex, and passed
+           through by readers before taking it shared. The standard library's
+           shared mutex may let a steady stream of readers starve a writer,
+           which would stall block import behind RPC requests. */
+        mutable std::mutex m_chainWriterGate;
+
+        /* Filled when blocks are added to the main chain, and by wallet sync
+           requests for blocks which aren't in it yet */
+        mutable WalletSyncCache m_walletSyncCache;
+
+        /* Incremented by notifyObservers() */
+        uint64_t m_changeId = 0;
+
+        mutable std::mutex m_changeMutex;
+
+        mutable std::condition_variable m_changeCondition;
 
         bool initialized;
 
@@ -280,6 +343,9 @@ namespace CryptoNote
 
         void throwIfNotInitialized() const;
 
+        /* Takes m_chainStateMutex exclusively, ahead of readers arriving later */
+        std::unique_lock<std::shared_mutex> lockChainForWriting();
+
         bool extractTransactions(
             const std::vector<BinaryArray> &rawTransactions,
             std::vector<CachedTransaction> &transactions,
@@ -289,11 +355,23 @@ namespace CryptoNote
             const CachedTransaction &transaction,
             TransactionValidatorState &state,
             IBlockchainCache *cache,
-            Utilities::ThreadPool<bool> &threadPool,
+            Utilities::TaskScheduler &scheduler,
             uint64_t &fee,
             uint32_t blockIndex,
             uint64_t blockTimestamp,
-            const bool isPoolTransaction);
+            const bool isPoolTransaction,
+            const PreparedTransactionChecks *preparedChecks = nullptr,
+            PreparedTransactionChecks *verifiedChecks = nullptr);
+
+        std::error_code addBlock(const CachedBlock &cachedBlock, RawBlock &&rawBlock, PreparedBlock *preparedBlock);
+
+        bool prepareBlock(PreparedBlock &preparedBlock);
+
+        void prepareTransactionChecks(
+            const CachedTransaction &cachedTransaction,
+            uint32_t blockIndex,
+            bool verifyRings,
+            PreparedTransactionChecks &checks);
 
         uint32_t findBlockchainSupplement(const std::vector<Crypto::Hash> &remoteBlockIds) const;
 
@@ -412,17 +490,54 @@ namespace CryptoNote
 
         void updateBlockMedianSize();
 
-        std::tuple<bool, std::string> addTransactionToPool(CachedTransaction &&cachedTransaction);
+        std::tuple<bool, std::string> addTransactionToPool(
+            CachedTransaction &&cachedTransaction,
+            const PreparedTransactionChecks *preparedChecks = nullptr);
 
         std::tuple<bool, std::string> isTransactionValidForPool(
             const CachedTransaction &cachedTransaction,
-            TransactionValidatorState &validatorState);
+            TransactionValidatorState &validatorState,
+            PreparedTransactionChecks &verifiedChecks,
+            const PreparedTransactionChecks *preparedChecks = nullptr);
 
         void initRootSegment();
 
         void cutSegment(IBlockchainCache &segment, uint32_t startIndex);
         
         std::mutex m_submitBlockMutex;
+
+        /* Pool transactions which passed validateBlockTemplateTransaction() on
+           top of the block below. The checks read the height, median size,
+           last timestamp and spent key images of the chain it ends, so
+           templates built on the same block don't repeat them, and any other
+           top block, including one at the same height after a reorg, starts
+           again. */
+        std::unordered_set<Crypto::Hash> m_templateValidTransactions;
+
+        Crypto::Hash m_templateValidationTopBlockHash = Constants::NULL_HASH;
+
+        /* The transactions picked for the last block template. The pick only
+           depends on the chain and the pool, so it is reused by every
+           template made before either changes, and only the miner
+           transaction is made again for each miner. */
+        struct TemplateTransactions
+        {
+            Crypto::Hash previousBlockHash;
+
+            /* getChangeId() from before the pool was read */
+            uint64_t changeId;
+
+            std::vector<Crypto::Hash> transactionHashes;
+
+            size_t transactionsSize;
+
+            uint64_t fee;
+        };
+
+        std::optional<TemplateTransactions> m_templateTransactions;
+
+        /* Guards the template members above */
+        std::mutex m_templateValidationMutex;
     };
 
 } // namespace CryptoNote
@@ -535,7 +535,7 @@ namespace CryptoNote
         return Common::fromString(strAmount, amount);
     }
 
-    uint64_t Currency::getNextDifficulty(uint8_t version, uint32_t blockIndex, std::vector<uint64_t> timestamps, std::vector<uint64_t> cumulativeDifficulties) const
+    uint64_t Currency::getNextDifficulty(uint8_t version, uint32_t blockIndex, const std::vector<uint64_t> &timestamps, const std::vector<uint64_t> &cumulativeDifficulties) const
     {
         return nextDifficulty(timestamps, cumulativeDifficulties, blockIndex);
     }
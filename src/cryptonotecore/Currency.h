@@ -296,8 +296,8 @@ namespace CryptoNote
         uint64_t getNextDifficulty(
             uint8_t version,
             uint32_t blockIndex,
-            std::vector<uint64_t> timestamps,
-            std::vector<uint64_t> cumulativeDifficulties) const;
+            const std::vector<uint64_t> &timestamps,
+            const std::vector<uint64_t> &cumulativeDifficulties) const;
 
         bool checkProofOfWorkV1(const CachedBlock &block, uint64_t currentDifficulty) const;
 
@@ -6,11 +6,130 @@
 
 #include "DBUtils.h"
 
+#include <algorithm>
+#include <serialization/WalletTypesSerialization.h>
+
 namespace
 {
     const std::string RAW_BLOCK_NAME = "raw_block";
 
     const std::string RAW_TXS_NAME = "raw_txs";
+
+    const std::string NO_COLUMN_FAMILY;
+
+    struct Table
+    {
+        const std::string &keyPrefix;
+
+        const std::string &columnFamily;
+
+        /* The bytes every serialized key of this table starts with */
+        std::string keyStart;
+    };
+
+    std::vector<Table> createTables()
+    {
+        using namespace CryptoNote;
+
+        std::vector<Table> tables {
+            {DB::BLOCK_INDEX_TO_KEY_IMAGE_PREFIX, DB::SPENT_KEY_IMAGES_BY_BLOCK_CF, {}},
+            {DB::BLOCK_INDEX_TO_TX_HASHES_PREFIX, DB::TX_HASHES_BY_BLOCK_CF, {}},
+            {DB::BLOCK_INDEX_TO_RAW_BLOCK_PREFIX, DB::RAW_BLOCKS_CF, {}},
+            {DB::BLOCK_HASH_TO_BLOCK_INDEX_PREFIX, DB::BLOCK_INDEXES_BY_HASH_CF, {}},
+            {DB::BLOCK_INDEX_TO_BLOCK_INFO_PREFIX, DB::CACHED_BLOCKS_CF, {}},
+            {DB::KEY_IMAGE_TO_BLOCK_INDEX_PREFIX, DB::SPENT_KEY_IMAGES_CF, {}},
+            {DB::BLOCK_INDEX_TO_BLOCK_HASH_PREFIX, DB::BLOCK_HASHES_BY_INDEX_CF, {}},
+            {DB::TRANSACTION_HASH_TO_TRANSACTION_INFO_PREFIX, DB::TRANSACTIONS_CF, {}},
+            {DB::KEY_OUTPUT_AMOUNT_PREFIX, DB::KEY_OUTPUT_GLOBAL_INDEXES_CF, {}},
+            {DB::CLOSEST_TIMESTAMP_BLOCK_INDEX_PREFIX, DB::CLOSEST_TIMESTAMP_BLOCK_INDEX_CF, {}},
+            {DB::PAYMENT_ID_TO_TX_HASH_PREFIX, DB::PAYMENT_IDS_CF, {}},
+            {DB::TIMESTAMP_TO_BLOCKHASHES_PREFIX, DB::TIMESTAMPS_CF, {}},
+            {DB::KEY_OUTPUT_AMOUNTS_COUNT_PREFIX, DB::KEY_OUTPUT_AMOUNTS_CF, {}},
+            {DB::KEY_OUTPUT_KEY_PREFIX, DB::KEY_OUTPUTS_CF, {}},
+            {DB::BLOCK_INDEX_TO_WALLET_BLOCK_PREFIX, DB::WALLET_BLOCKS_CF, {}},
+        };
+
+        for (auto &table : tables)
+        {
+            /* Keys are serialized as (prefix, key) pairs, so two keys of
+               different types only have the prefix part in common */
+            const std::string a = DB::serializeKey(table.keyPrefix, uint32_t(0));
+            const std::string b = DB::serializeKey(table.keyPrefix, std::string());
+
+            const auto mismatch = std::mismatch(a.begin(), a.end(), b.begin(), b.end());
+
+            table.keyStart = std::string(a.begin(), mismatch.first);
+        }
+
+        return tables;
+    }
+
+    const std::vector<Table> &tables()
+    {
+        static const std::vector<Table> tables = createTables();
+        return tables;
+    }
+
+    /* The wallet scan record only holds what a wallet needs to find its
+       outputs and spends: the outputs with their global indexes, the
+       payment ID, and the key images and amounts of the inputs. The ring
+       members aren't stored, and are empty when a record is read back. */
+    void serializeScanRecord(WalletTypes::RawCoinbaseTransaction &transaction, CryptoNote::ISerializer &serializer)
+    {
+        CryptoNote::serializeContainer(transaction.keyOutputs, "outputs", serializer);
+        serializer(transaction.hash, "hash");
+        serializer(transaction.transactionPublicKey, "txPublicKey");
+        serializer(transaction.unlockTime, "unlockTime");
+    }
+
+    void serializeScanRecord(WalletTypes::RawTransaction &transaction, CryptoNote::ISerializer &serializer)
+    {
+        serializeScanRecord(static_cast<WalletTypes::RawCoinbaseTransaction &>(transaction), serializer);
+
+        serializer(transaction.paymentID, "paymentID");
+
+        uint64_t inputCount = transaction.keyInputs.size();
+
+        serializer.beginArray(inputCount, "inputs");
+
+        transaction.keyInputs.resize(inputCount);
+
+        for (auto &input : transaction.keyInputs)
+        {
+            serializer(input.keyImage, "keyImage");
+            serializer(input.amount, "amount");
+        }
+
+        serializer.endArray();
+    }
+
+    void serializeScanRecord(WalletTypes::WalletBlockInfo &block, CryptoNote::ISerializer &serializer)
+    {
+        /* Records are only stored with the coinbase transaction */
+        if (serializer.type() == CryptoNote::ISerializer::INPUT)
+        {
+            block.coinbaseTransaction.emplace();
+        }
+
+        serializeScanRecord(*block.coinbaseTransaction, serializer);
+
+        uint64_t transactionCount = block.transactions.size();
+
+        serializer.beginArray(transactionCount, "transactions");
+
+        block.transactions.resize(transactionCount);
+
+        for (auto &transaction : block.transactions)
+        {
+            serializeScanRecord(transaction, serializer);
+        }
+
+        serializer.endArray();
+
+        serializer(block.blockHeight, "blockHeight");
+        serializer(block.blockHash, "blockHash");
+        serializer(block.blockTimestamp, "blockTimestamp");
+    }
 } // namespace
 
 namespace CryptoNote
@@ -19,23 +138,86 @@ namespace CryptoNote
     {
         std::string serialize(const RawBlock &value, const std::string &name)
         {
-            std::stringstream ss;
-            Common::StdOutputStream stream(ss);
+            std::string serialized;
+            Common::StringOutputStream stream(serialized);
             CryptoNote::BinaryOutputStreamSerializer serializer(stream);
 
             serializer(const_cast<RawBlock &>(value).block, RAW_BLOCK_NAME);
             serializer(const_cast<RawBlock &>(value).transactions, RAW_TXS_NAME);
 
-            return ss.str();
+            return serialized;
         }
 
-        void deserialize(const std::string &serialized, RawBlock &value, const std::string &name)
+        void deserialize(const std::string_view serialized, RawBlock &value, const std::string &name)
         {
-            std::stringstream ss(serialized);
-            Common::StdInputStream stream(ss);
+            Common::MemoryInputStream stream(serialized.data(), serialized.size());
             CryptoNote::BinaryInputStreamSerializer serializer(stream);
             serializer(value.block, RAW_BLOCK_NAME);
             serializer(value.transactions, RAW_TXS_NAME);
         }
+
+        std::string serialize(const WalletTypes::WalletBlockInfo &value, const std::string &name)
+        {
+            std::string serialized;
+            Common::StringOutputStream stream(serialized);
+            CryptoNote::BinaryOutputStreamSerializer serializer(stream);
+
+            serializeScanRecord(const_cast<WalletTypes::WalletBlockInfo &>(value), serializer);
+
+            return serialized;
+        }
+
+        void deserialize(
+            const std::string_view serialized,
+            WalletTypes::WalletBlockInfo &value,
+            const std::string &name)
+        {
+            Common::MemoryInputStream stream(serialized.data(), serialized.size());
+            CryptoNote::BinaryInputStreamSerializer serializer(stream);
+            serializeScanRecord(value, serializer);
+        }
+
+        const std::string &columnFamily(const std::string &keyPrefix)
+        {
+            for (const auto &table : tables())
+            {
+                if (table.keyPrefix == keyPrefix)
+                {
+                    return table.columnFamily;
+                }
+            }
+
+            return NO_COLUMN_FAMILY;
+        }
+
+        const std::string &columnFamilyOfKey(const std::string &rawKey)
+        {
+            for (const auto &table : tables())
+            {
+                if (rawKey.compare(0, table.keyStart.size(), table.keyStart) == 0)
+                {
+                    return table.columnFamily;
+                }
+            }
+
+            return NO_COLUMN_FAMILY;
+        }
+
+        const std::vector<std::string> &columnFamilies()
+        {
+            static const std::vector<std::string> names = []
+            {
+                std::vector<std::string> result;
+
+                for (const auto &table : tables())
+                {
+                    result.push_back(table.columnFamily);
+                }
+
+                return result;
+            }();
+
+            return names;
+        }
     } // namespace DB
 } // namespace CryptoNote
@@ -6,19 +6,26 @@
 
 #pragma once
 
+#include "IDataBase.h"
+#include "common/MemoryInputStream.h"
 #include "common/StdInputStream.h"
 #include "common/StdOutputStream.h"
+#include "common/StringOutputStream.h"
 #include "cryptonotecore/CryptoNoteFormatUtils.h"
+#include "serialization/BinaryInputStreamSerializer.h"
+#include "serialization/BinaryOutputStreamSerializer.h"
 #include "serialization/CryptoNoteSerialization.h"
+#include "serialization/KVBinaryCommon.h"
 #include "serialization/KVBinaryInputStreamSerializer.h"
 #include "serialization/KVBinaryOutputStreamSerializer.h"
 #include "serialization/SerializationOverloads.h"
 
-#include <boost/archive/basic_archive.hpp>
-#include <boost/archive/binary_iarchive.hpp>
-#include <boost/archive/binary_oarchive.hpp>
+#include <WalletTypes.h>
 #include <sstream>
 #include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
 
 namespace CryptoNote::DB
 {
@@ -37,193 +44,384 @@ namespace CryptoNote::DB
     const std::string TIMESTAMP_TO_BLOCKHASHES_PREFIX = "g";
     const std::string KEY_OUTPUT_AMOUNTS_COUNT_PREFIX = "h";
     const std::string KEY_OUTPUT_KEY_PREFIX = "j";
+    const std::string BLOCK_INDEX_TO_WALLET_BLOCK_PREFIX = "k";
 
     const std::string LAST_BLOCK_INDEX_KEY = "last_block_index";
     const std::string KEY_OUTPUT_AMOUNTS_COUNT_KEY = "key_amounts_count";
     const std::string TRANSACTIONS_COUNT_KEY = "txs_count";
 
+    /* RocksDB keeps each table in its own column family, so they can be tuned
+       for how they are used. Keys keep their prefix, so the same keys can
+       also share a single keyspace, which is how LevelDB stores them. */
+    const std::string SPENT_KEY_IMAGES_BY_BLOCK_CF = "BlockKeyImages";
+    const std::string TX_HASHES_BY_BLOCK_CF = "BlockTxHashes";
+    const std::string RAW_BLOCKS_CF = "RawBlocks";
+    const std::string BLOCK_INDEXES_BY_HASH_CF = "BlockHashes";
+    const std::string CACHED_BLOCKS_CF = "BlockInfo";
+    const std::string SPENT_KEY_IMAGES_CF = "KeyImages";
+    const std::string BLOCK_HASHES_BY_INDEX_CF = "LastBlockIndex";
+    const std::string TRANSACTIONS_CF = "Transactions";
+    const std::string KEY_OUTPUT_GLOBAL_INDEXES_CF = "OutputIndexes";
+    const std::string CLOSEST_TIMESTAMP_BLOCK_INDEX_CF = "TimestampIndex";
+    const std::string PAYMENT_IDS_CF = "PaymentIds";
+    const std::string TIMESTAMPS_CF = "Timestamps";
+    const std::string KEY_OUTPUT_AMOUNTS_CF = "OutputAmounts";
+    const std::string KEY_OUTPUTS_CF = "OutputKeys";
+    const std::string WALLET_BLOCKS_CF = "WalletBlocks";
+
+    /* The column family of the table with this key prefix */
+    const std::string &columnFamily(const std::string &keyPrefix);
+
+    /* The column family of the table a serialized key belongs to, or an empty
+       string for keys not in any table, such as the scheme version. Used to
+       move databases from the single keyspace layout. */
+    const std::string &columnFamilyOfKey(const std::string &rawKey);
+
+    /* Every table column family, not including the default one */
+    const std::vector<std::string> &columnFamilies();
+
+    namespace KVBinary
+    {
+        /* Writes keys in exactly the layout KVBinaryOutputStreamSerializer
+           gives a (prefix, key) pair, without building a serializer, stream
+           and pair for every key. Values are written as the host stores
+           them, like the serializer does. */
+
+        /* Used to find the size of a key before writing it */
+        struct SizeCounter
+        {
+            void append(const char *, const size_t count)
+            {
+                size += count;
+            }
+
+            size_t size = 0;
+        };
+
+        template<class Output> void appendBytes(Output &output, const void *data, const size_t size)
+        {
+            output.append(static_cast<const char *>(data), size);
+        }
+
+        template<class Output> void appendSize(Output &output, const uint64_t size)
+        {
+            if (size <= 63)
+            {
+                const uint8_t packed = static_cast<uint8_t>((size << 2) | PORTABLE_RAW_SIZE_MARK_BYTE);
+                appendBytes(output, &packed, sizeof(packed));
+            }
+            else if (size <= 16383)
+            {
+                const uint16_t packed = static_cast<uint16_t>((size << 2) | PORTABLE_RAW_SIZE_MARK_WORD);
+                appendBytes(output, &packed, sizeof(packed));
+            }
+            else
+            {
+                const uint32_t packed = static_cast<uint32_t>((size << 2) | PORTABLE_RAW_SIZE_MARK_DWORD);
+                appendBytes(output, &packed, sizeof(packed));
+            }
+        }
+
+        template<class Output> void appendName(Output &output, const std::string_view name)
+        {
+            const uint8_t size = static_cast<uint8_t>(name.size());
+            appendBytes(output, &size, sizeof(size));
+            appendBytes(output, name.data(), name.size());
+        }
+
+        template<class Output> void appendType(Output &output, const uint8_t type)
+        {
+            appendBytes(output, &type, sizeof(type));
+        }
+
+        template<class Output> void appendValue(Output &output, const uint32_t value)
+        {
+            appendType(output, BIN_KV_SERIALIZE_TYPE_UINT32);
+            appendBytes(output, &value, sizeof(value));
+        }
+
+        template<class Output> void appendValue(Output &output, const uint64_t value)
+        {
+            appendType(output, BIN_KV_SERIALIZE_TYPE_UINT64);
+            appendBytes(output, &value, sizeof(value));
+        }
+
+        template<class Output> void appendBinary(Output &output, const void *data, const size_t size)
+        {
+            appendType(output, BIN_KV_SERIALIZE_TYPE_STRING);
+            appendSize(output, size);
+            appendBytes(output, data, size);
+        }
+
+        template<class Output> void appendValue(Output &output, const std::string &value)
+        {
+            appendBinary(output, value.data(), value.size());
+        }
+
+        template<class Output> void appendValue(Output &output, const Crypto::Hash &value)
+        {
+            appendBinary(output, value.data, sizeof(value.data));
+        }
+
+        template<class Output> void appendValue(Output &output, const Crypto::KeyImage &value)
+        {
+            appendBinary(output, value.data, sizeof(value.data));
+        }
+
+        template<class Output, class First, class Second>
+        void appendValue(Output &output, const std::pair<First, Second> &value)
+        {
+            appendType(output, BIN_KV_SERIALIZE_TYPE_OBJECT);
+            appendSize(output, 2);
+            appendName(output, "first");
+            appendValue(output, value.first);
+            appendName(output, "second");
+            appendValue(output, value.second);
+        }
+
+        template<class Output, class Key> void appendKey(Output &output, const std::string &keyPrefix, const Key &key)
+        {
+            const KVBinaryStorageBlockHeader header {
+                PORTABLE_STORAGE_SIGNATUREA, PORTABLE_STORAGE_SIGNATUREB, PORTABLE_STORAGE_FORMAT_VER};
+
+            appendBytes(output, &header, sizeof(header));
+
+            /* The root object holds the pair, named after the prefix */
+            appendSize(output, 1);
+            appendName(output, keyPrefix);
+
+            appendType(output, BIN_KV_SERIALIZE_TYPE_OBJECT);
+            appendSize(output, 2);
+            appendName(output, "first");
+            appendValue(output, keyPrefix);
+            appendName(output, "second");
+            appendValue(output, key);
+        }
+    } // namespace KVBinary
+
     template<class Value> std::string serialize(const Value &value, const std::string &name)
     {
         CryptoNote::KVBinaryOutputStreamSerializer serializer;
-        std::stringstream ss;
-        Common::StdOutputStream stream(ss);
+        std::string serialized;
+        Common::StringOutputStream stream(serialized);
 
         serializer(const_cast<Value &>(value), name);
         serializer.dump(stream);
 
-        return ss.str();
+        return serialized;
     }
 
     std::string serialize(const RawBlock &value, const std::string &name);
 
-    template<class Key, class Value>
-    std::pair<std::string, std::string> serialize(const std::string &keyPrefix, const Key &key, const Value &value)
+    /* The wallet scan record of a block. Always binary, like raw blocks -
+       the KV binary field names would take more space than the outputs.
+       Only the parts wallets scan are stored: no ring members or payment IDs */
+    std::string serialize(const WalletTypes::WalletBlockInfo &value, const std::string &name);
+
+    template<class Key> std::string serializeKey(const std::string &keyPrefix, const Key &key)
     {
-        return {DB::serialize(std::make_pair(keyPrefix, key), keyPrefix), DB::serialize(value, keyPrefix)};
+        KVBinary::SizeCounter counter;
+        KVBinary::appendKey(counter, keyPrefix, key);
+
+        std::string rawKey;
+        rawKey.reserve(counter.size);
+
+        KVBinary::appendKey(rawKey, keyPrefix, key);
+
+        return rawKey;
     }
 
-    template<class Key> std::string serializeKey(const std::string &keyPrefix, const Key &key)
+    template<class Key, class Value>
+    std::pair<std::string, std::string> serialize(const std::string &keyPrefix, const Key &key, const Value &value)
     {
-        return DB::serialize(std::make_pair(keyPrefix, key), keyPrefix);
+        return {DB::serializeKey(keyPrefix, key), DB::serialize(value, keyPrefix)};
     }
 
-    template<class Value> void deserialize(const std::string &serialized, Value &value, const std::string &name)
+    /* Reads straight from the buffer the DB returned */
+    template<class Value> void deserialize(const std::string_view serialized, Value &value, const std::string &name)
     {
-        std::stringstream ss(serialized);
-        Common::StdInputStream stream(ss);
+        Common::MemoryInputStream stream(serialized.data(), serialized.size());
         CryptoNote::KVBinaryInputStreamSerializer serializer(stream);
         serializer(value, name);
     }
 
-    void deserialize(const std::string &serialized, RawBlock &value, const std::string &name);
+    void deserialize(std::string_view serialized, RawBlock &value, const std::string &name);
+
+    void deserialize(std::string_view serialized, WalletTypes::WalletBlockInfo &value, const std::string &name);
 
     template<class Key, class Value>
-    void serializeKeys(std::vector<std::string> &rawKeys,
-                       const std::string keyPrefix,
-                       const std::unordered_map<Key, Value> &map)
+    void appendColumnFamilies(std::vector<std::string> &columnFamilies,
+                              const std::string &keyPrefix,
+                              const std::unordered_map<Key, Value> &map)
     {
-        for (const std::pair<Key, Value> &kv : map)
-        {
-            rawKeys.emplace_back(DB::serializeKey(keyPrefix, kv.first));
-        }
+        columnFamilies.insert(columnFamilies.end(), map.size(), DB::columnFamily(keyPrefix));
     }
 
-    template<class Key, class Value, class Iterator>
-    void deserializeValues(std::unordered_map<Key, Value> &map, Iterator &serializedValuesIter, const std::string &name)
+    /* How keys and values are stored. A DB is written in one format for its
+       whole life, and the scheme version records which. */
+    enum class Format
     {
-        for (auto iter = map.begin(); iter != map.end(); ++serializedValuesIter)
-        {
-            if (boost::get<1>(*serializedValuesIter))
-            {
-                DB::deserialize(boost::get<0>(*serializedValuesIter), iter->second, name);
-                ++iter;
-            }
-            else
-            {
-                iter = map.erase(iter);
-            }
-        }
+        /* Keys and values as KV binary objects, with the field names */
+        KVBinary,
+
+        /* Fixed layout keys - the prefix followed by big endian integers and
+           raw hashes - and values in the plain binary format. Selected with
+           --db-use-experimental-serializer. */
+        Compact
+    };
+
+    inline Format formatOf(const IDataBase &database)
+    {
+        return database.getConfig().useExperimentalSerializer ? Format::Compact : Format::KVBinary;
     }
 
-    template<class Value, class Iterator>
-    void deserializeValue(std::pair<Value, bool> &pair, Iterator &serializedValuesIter, const std::string &name)
+    namespace Compact
     {
-        if (pair.second)
+        /* Big endian, so keys sort in numeric order */
+        template<class Integer>
+        std::enable_if_t<std::is_integral_v<Integer>> appendKey(std::string &rawKey, const Integer value)
         {
-            if (boost::get<1>(*serializedValuesIter))
+            for (size_t i = sizeof(Integer); i > 0; i--)
             {
-                DB::deserialize(boost::get<0>(*serializedValuesIter), pair.first, name);
+                rawKey.push_back(static_cast<char>(value >> ((i - 1) * 8)));
             }
-            else
-            {
-                pair = {Value {}, false};
-            }
-            ++serializedValuesIter;
         }
-    }
 
-    namespace V2
-    {
-        const std::string RAW_BLOCKS_CF = "RawBlocks";
-        const std::string SPENT_KEY_IMAGES_CF = "SpentKeyImages";
-        const std::string PAYMENT_ID_TXS_CF = "PaymentIdTxs";
-        const std::string TRANSACTIONS_CF = "Transactions";
-        const std::string BLOCKS_CF = "Blocks";
+        inline void appendKey(std::string &rawKey, const Crypto::Hash &hash)
+        {
+            rawKey.append(reinterpret_cast<const char *>(hash.data), sizeof(hash.data));
+        }
+
+        inline void appendKey(std::string &rawKey, const Crypto::KeyImage &keyImage)
+        {
+            rawKey.append(reinterpret_cast<const char *>(keyImage.data), sizeof(keyImage.data));
+        }
 
-        constexpr uint32_t SERIALIZATION_FLAGS =
-            boost::archive::archive_flags::no_header | boost::archive::archive_flags::no_tracking;
+        /* The named keys, such as LAST_BLOCK_INDEX_KEY. They differ in length
+           from every other key in their table, so can't collide. */
+        inline void appendKey(std::string &rawKey, const std::string &name)
+        {
+            rawKey.append(name);
+        }
 
-        template<class Key> std::string serializeKey(const Key &key)
+        template<class First, class Second>
+        void appendKey(std::string &rawKey, const std::pair<First, Second> &pair)
         {
-            std::stringstream ss;
-            ss << key;
-            return ss.str();
+            appendKey(rawKey, pair.first);
+            appendKey(rawKey, pair.second);
         }
 
         template<class Key> std::string serializeKey(const std::string &keyPrefix, const Key &key)
         {
-            std::stringstream ss;
-            ss << keyPrefix << "_" << key;
-            return ss.str();
+            std::string rawKey;
+            rawKey.reserve(keyPrefix.size() + sizeof(Key));
+            rawKey.append(keyPrefix);
+
+            appendKey(rawKey, key);
+
+            return rawKey;
         }
 
         template<class Value> std::string serializeValue(const Value &value)
         {
-            std::stringstream ss;
+            std::string rawValue;
+            Common::StringOutputStream stream(rawValue);
+            CryptoNote::BinaryOutputStreamSerializer serializer(stream);
 
-            {
-                boost::archive::binary_oarchive o {ss, SERIALIZATION_FLAGS};
-                o << value;
-            }
+            serializer(const_cast<Value &>(value), "");
 
-            return ss.str();
+            return rawValue;
         }
 
-        template<class Value> void deserializeValue(const std::string &data, Value &value)
+        template<class Value> void deserializeValue(const std::string_view rawValue, Value &value)
         {
-            std::stringstream ss;
-            ss << data;
+            Common::MemoryInputStream stream(rawValue.data(), rawValue.size());
+            CryptoNote::BinaryInputStreamSerializer serializer(stream);
 
-            boost::archive::binary_iarchive i {ss, SERIALIZATION_FLAGS};
-            i >> value;
+            serializer(value, "");
         }
+    } // namespace Compact
 
-        template<class Key, class Value>
-        std::pair<std::string, std::string> serialize(const Key &key, const Value &value)
+    template<class Key> std::string serializeKey(const Format format, const std::string &keyPrefix, const Key &key)
+    {
+        return format == Format::Compact ? Compact::serializeKey(keyPrefix, key) : DB::serializeKey(keyPrefix, key);
+    }
+
+    template<class Key, class Value>
+    std::pair<std::string, std::string>
+        serialize(const Format format, const std::string &keyPrefix, const Key &key, const Value &value)
+    {
+        if (format == Format::Compact)
         {
-            return std::make_pair(V2::serializeKey(key), V2::serializeValue(value));
+            return {Compact::serializeKey(keyPrefix, key), Compact::serializeValue(value)};
         }
 
-        template<class Key, class Value>
-        std::pair<std::string, std::string> serialize(const std::string &keyPrefix, const Key &key, const Value &value)
+        return DB::serialize(keyPrefix, key, value);
+    }
+
+    template<class Value>
+    void deserialize(const Format format, const std::string_view serialized, Value &value, const std::string &name)
+    {
+        if (format == Format::Compact)
+        {
+            Compact::deserializeValue(serialized, value);
+        }
+        else
         {
-            return std::make_pair(V2::serializeKey(keyPrefix, key), V2::serializeValue(value));
+            DB::deserialize(serialized, value, name);
         }
+    }
 
-        template<class Key, class Value>
-        void serializeKeys(std::vector<std::string> &rawKeys,
-                           const std::string keyPrefix,
-                           const std::unordered_map<Key, Value> &map)
+    template<class Key, class Value>
+    void serializeKeys(const Format format,
+                       std::vector<std::string> &rawKeys,
+                       const std::string &keyPrefix,
+                       const std::unordered_map<Key, Value> &map)
+    {
+        for (const std::pair<Key, Value> &kv : map)
         {
-            for (const std::pair<Key, Value> &kv : map)
-            {
-                rawKeys.emplace_back(V2::serializeKey(keyPrefix, kv.first));
-            }
+            rawKeys.emplace_back(DB::serializeKey(format, keyPrefix, kv.first));
         }
+    }
 
-        template<class Key, class Value, class Iterator>
-        void deserializeValues(std::unordered_map<Key, Value> &map, Iterator &serializedValuesIter)
+    template<class Key, class Value, class Iterator>
+    void deserializeValues(const Format format,
+                           std::unordered_map<Key, Value> &map,
+                           Iterator &serializedValuesIter,
+                           const std::string &name)
+    {
+        for (auto iter = map.begin(); iter != map.end(); ++serializedValuesIter)
         {
-            for (auto iter = map.begin(); iter != map.end(); ++serializedValuesIter)
+            if (boost::get<1>(*serializedValuesIter))
             {
-                if (boost::get<1>(*serializedValuesIter))
-                {
-                    V2::deserializeValue(boost::get<0>(*serializedValuesIter), iter->second);
-                    ++iter;
-                }
-                else
-                {
-                    iter = map.erase(iter);
-                }
+                DB::deserialize(format, boost::get<0>(*serializedValuesIter), iter->second, name);
+                ++iter;
+            }
+            else
+            {
+                iter = map.erase(iter);
             }
         }
+    }
 
-        template<class Value, class Iterator>
-        void deserializeValue(std::pair<Value, bool> &pair, Iterator &serializedValuesIter)
+    template<class Value, class Iterator>
+    void deserializeValue(const Format format,
+                          std::pair<Value, bool> &pair,
+                          Iterator &serializedValuesIter,
+                          const std::string &name)
+    {
+        if (pair.second)
         {
-            if (pair.second)
+            if (boost::get<1>(*serializedValuesIter))
             {
-                if (boost::get<1>(*serializedValuesIter))
-                {
-                    V2::deserializeValue(boost::get<0>(*serializedValuesIter), pair.first);
-                }
-                else
-                {
-                    pair = {Value {}, false};
-                }
-                ++serializedValuesIter;
+                DB::deserialize(format, boost::get<0>(*serializedValuesIter), pair.first, name);
             }
+            else
+            {
+                pair = {Value {}, false};
+            }
+            ++serializedValuesIter;
         }
-    } // namespace V2
+    }
 } // namespace CryptoNote::DB
 
@@ -14,9 +14,13 @@
 #include <common/TransactionExtra.h>
 #include <cryptonotecore/BlockchainStorage.h>
 #include <cryptonotecore/CryptoNoteBasicImpl.h>
+#include <algorithm>
+#include <charconv>
+#include <chrono>
 #include <cryptonotecore/DatabaseBlockchainCache.h>
 #include <cstdlib>
 #include <ctime>
+#include <utilities/TaskScheduler.h>
 
 namespace CryptoNote
 {
@@ -26,12 +30,30 @@ namespace CryptoNote
 
         const CachedBlockInfo NULL_CACHED_BLOCK_INFO {Constants::NULL_HASH, 0, 0, 0, 0, 0};
 
+        void setGlobalIndexes(WalletTypes::RawCoinbaseTransaction &transaction, const std::vector<uint32_t> &globalIndexes)
+        {
+            /* A record with the wrong global indexes would make wallets spend
+               outputs they don't own, so never write one */
+            if (globalIndexes.size() != transaction.keyOutputs.size())
+            {
+                throw std::runtime_error(
+                    "Transaction " + Common::podToHex(transaction.hash) + " has "
+                    + std::to_string(transaction.keyOutputs.size()) + " outputs, but "
+                    + std::to_string(globalIndexes.size()) + " global indexes");
+            }
+
+            for (size_t i = 0; i < transaction.keyOutputs.size(); i++)
+            {
+                transaction.keyOutputs[i].globalOutputIndex = globalIndexes[i];
+            }
+        }
+
         bool requestPackedOutputs(IBlockchainCache::Amount amount,
                                   Common::ArrayView<uint32_t> globalIndexes,
                                   IDataBase &database,
                                   std::vector<PackedOutIndex> &result)
         {
-            BlockchainReadBatch readBatch;
+            BlockchainReadBatch readBatch(DB::formatOf(database));
             result.reserve(result.size() + globalIndexes.getSize());
 
             for (auto globalIndex : globalIndexes)
@@ -66,7 +88,7 @@ namespace CryptoNote
                                                             IDataBase &database,
                                                             std::vector<Crypto::Hash> &transactionHashes)
         {
-            BlockchainReadBatch readHashesBatch;
+            BlockchainReadBatch readHashesBatch(DB::formatOf(database));
 
             std::set<uint32_t> blockIndexes;
             std::for_each(packedOuts.begin(),
@@ -111,7 +133,7 @@ namespace CryptoNote
         {
             result.reserve(result.size() + transactionHashes.size());
 
-            BlockchainReadBatch transactionsBatch;
+            BlockchainReadBatch transactionsBatch(DB::formatOf(database));
             std::for_each(transactionHashes.begin(),
                           transactionHashes.end(),
                           [&transactionsBatch](const Crypto::Hash &hash)
@@ -154,7 +176,7 @@ namespace CryptoNote
         {
             result.reserve(result.size() + transactionHashes.size());
 
-            BlockchainReadBatch transactionsBatch;
+            BlockchainReadBatch transactionsBatch(DB::formatOf(database));
             std::for_each(transactionHashes.begin(),
                           transactionHashes.end(),
                           [&transactionsBatch](const Crypto::Hash &hash)
@@ -212,7 +234,7 @@ namespace CryptoNote
         {
             std::pair<boost::optional<uint32_t>, bool> result = {{}, false};
 
-            BlockchainReadBatch readBatch;
+            BlockchainReadBatch readBatch(DB::formatOf(database));
             readBatch.requestClosestTimestampBlockIndex(timestamp);
             auto dbResult = database.read(readBatch);
             if (dbResult)
@@ -232,7 +254,7 @@ namespace CryptoNote
 
         bool requestRawBlock(IDataBase &database, uint32_t blockIndex, RawBlock &block)
         {
-            auto batch = BlockchainReadBatch().requestRawBlock(blockIndex);
+            auto batch = BlockchainReadBatch(DB::formatOf(database)).requestRawBlock(blockIndex);
 
             auto error = database.read(batch);
             if (error)
@@ -279,7 +301,7 @@ namespace CryptoNote
 
         size_t requestPaymentIdTransactionsCount(IDataBase &database, const Crypto::Hash &paymentId)
         {
-            auto batch = BlockchainReadBatch().requestTransactionCountByPaymentId(paymentId);
+            auto batch = BlockchainReadBatch(DB::formatOf(database)).requestTransactionCountByPaymentId(paymentId);
             auto error = database.read(batch);
 
             if (error)
@@ -322,7 +344,7 @@ namespace CryptoNote
 
         uint32_t requestKeyOutputGlobalIndexesCountForAmount(IBlockchainCache::Amount amount, IDataBase &database)
         {
-            auto batch = BlockchainReadBatch().requestKeyOutputGlobalIndexesCountForAmount(amount);
+            auto batch = BlockchainReadBatch(DB::formatOf(database)).requestKeyOutputGlobalIndexesCountForAmount(amount);
             auto dbError = database.read(batch);
             if (dbError)
             {
@@ -404,7 +426,7 @@ namespace CryptoNote
                                          uint32_t globalOutputIndex,
                                          IDataBase &database)
         {
-            BlockchainReadBatch batch;
+            BlockchainReadBatch batch(DB::formatOf(database));
             auto dbError = database.read(batch.requestKeyOutputGlobalIndexForAmount(amount, globalOutputIndex));
             if (dbError)
             {
@@ -463,15 +485,52 @@ namespace CryptoNote
             }
         }
 
-        void cutTail(std::deque<CachedBlockInfo> &cache, size_t count)
+        /* The block info and key output files are synced every this many
+           blocks, and when blocks are removed, so only the blocks pushed
+           since can be lost */
+        const uint32_t BLOCK_INFO_FLUSH_INTERVAL = 1000;
+
+        bool sameBlockInfo(const CachedBlockInfo &a, const CachedBlockInfo &b)
+        {
+            return a.blockHash == b.blockHash && a.timestamp == b.timestamp
+                   && a.cumulativeDifficulty == b.cumulativeDifficulty
+                   && a.alreadyGeneratedCoins == b.alreadyGeneratedCoins
+                   && a.alreadyGeneratedTransactions == b.alreadyGeneratedTransactions
+                   && a.blockSize == b.blockSize;
+        }
+
+        KeyOutputColumn::Entry keyOutputEntry(const KeyOutputInfo &info, const PackedOutIndex &packedOut)
+        {
+            return {info.publicKey, info.unlockTime, packedOut.blockIndex};
+        }
+
+        /* The index of the first of the last count blocks up to blockIndex */
+        uint32_t lastUnitsStartIndex(size_t count, uint32_t blockIndex, UseGenesis useGenesis)
+        {
+            uint32_t startIndex = blockIndex + 1 - static_cast<uint32_t>(std::min<size_t>(blockIndex + 1, count));
+
+            if (startIndex == 0 && !useGenesis)
+            {
+                startIndex = 1;
+            }
+
+            return startIndex;
+        }
+
+        template<class T>
+        std::vector<uint64_t>
+            lastUnits(Common::ArrayView<T> column, size_t count, uint32_t blockIndex, UseGenesis useGenesis)
         {
-            if (count >= cache.size())
+            assert(blockIndex < column.getSize());
+
+            const uint32_t startIndex = lastUnitsStartIndex(count, blockIndex, useGenesis);
+
+            if (startIndex > blockIndex)
             {
-                cache.clear();
-                return;
+                return {};
             }
 
-            cache.erase(std::next(cache.begin(), cache.size() - count), cache.end());
+            return std::vector<uint64_t>(column.getData() + startIndex, column.getData() + blockIndex + 1);
         }
 
         const std::string DB_VERSION_KEY = "db_scheme_version";
@@ -486,7 +545,7 @@ namespace CryptoNote
                 return {DB_VERSION_KEY};
             }
 
-            virtual void submitRawResult(const std::vector<std::string> &values,
+            virtual void submitRawResult(const std::vector<std::string_view> &values,
                                          const std::vector<bool> &resultStates) override
             {
                 assert(values.size() == 1);
@@ -497,7 +556,19 @@ namespace CryptoNote
                     return;
                 }
 
-                version = static_cast<uint32_t>(std::atoi(values[0].c_str()));
+                const char *begin = values[0].data();
+                const char *end = begin + values[0].size();
+
+                uint32_t parsed = 0;
+
+                if (const auto [parsedEnd, error] = std::from_chars(begin, end, parsed);
+                    error != std::errc() || parsedEnd != end)
+                {
+                    invalidVersion = std::string(values[0]);
+                    return;
+                }
+
+                version = parsed;
             }
 
             boost::optional<uint32_t> getDbSchemeVersion()
@@ -505,10 +576,37 @@ namespace CryptoNote
                 return version;
             }
 
+            /* The stored version, if it isn't a number */
+            boost::optional<std::string> getInvalidDbSchemeVersion()
+            {
+                return invalidVersion;
+            }
+
         private:
             boost::optional<uint32_t> version;
+
+            boost::optional<std::string> invalidVersion;
         };
 
+        boost::optional<uint32_t> readDbSchemeVersion(IDataBase &database, const Logging::LoggerRef &logger)
+        {
+            DatabaseVersionReadBatch readBatch;
+            auto ec = database.read(readBatch);
+            if (ec)
+            {
+                throw std::system_error(ec);
+            }
+
+            if (const auto invalidVersion = readBatch.getInvalidDbSchemeVersion())
+            {
+                logger(Logging::ERROR) << "DB scheme version \"" << *invalidVersion
+                                       << "\" is not a number. The DB is corrupted, please delete it to resync.";
+                throw std::runtime_error("DB scheme version is corrupted");
+            }
+
+            return readBatch.getDbSchemeVersion();
+        }
+
         class DatabaseVersionWriteBatch : public IWriteBatch
         {
         public:
@@ -533,6 +631,18 @@ namespace CryptoNote
 
         const uint32_t CURRENT_DB_SCHEME_VERSION = 2;
 
+        /* DBs using the compact format have their own range of versions, above
+           any KV binary version, so software without it refuses to open them */
+        const uint32_t MIN_COMPACT_DB_SCHEME_VERSION = 1000;
+
+        const uint32_t CURRENT_COMPACT_DB_SCHEME_VERSION = 1000;
+
+        uint32_t currentDBSchemeVersion(const IDataBase &database)
+        {
+            return DB::formatOf(database) == DB::Format::Compact ? CURRENT_COMPACT_DB_SCHEME_VERSION
+                                                                 : CURRENT_DB_SCHEME_VERSION;
+        }
+
     } // namespace
 
     struct DatabaseBlockchainCache::ExtendedPushedBlockInfo
@@ -544,25 +654,23 @@ namespace CryptoNote
     DatabaseBlockchainCache::DatabaseBlockchainCache(const Currency &curr,
                                                      IDataBase &dataBase,
                                                      IBlockchainCacheFactory &blockchainCacheFactory,
-                                                     std::shared_ptr<Logging::ILogger> _logger) :
+                                                     std::shared_ptr<Logging::ILogger> _logger,
+                                                     SpentKeyImageIndex::Mode spentKeyImageIndexMode,
+                                                     bool storeWalletScanRecords) :
         currency(curr),
         database(dataBase),
         blockchainCacheFactory(blockchainCacheFactory),
-        logger(std::move(_logger), "DatabaseBlockchainCache")
+        logger(std::move(_logger), "DatabaseBlockchainCache"),
+        blockSizesWindow(curr.rewardBlocksWindow()),
+        spentKeyImageIndex(spentKeyImageIndexMode),
+        storeWalletScanRecords(storeWalletScanRecords)
     {
-        DatabaseVersionReadBatch readBatch;
-        auto ec = database.read(readBatch);
-        if (ec)
-        {
-            throw std::system_error(ec);
-        }
-
-        auto version = readBatch.getDbSchemeVersion();
+        auto version = readDbSchemeVersion(database, logger);
         if (!version)
         {
-            logger(Logging::DEBUGGING) << "DB scheme version not found, writing: " << CURRENT_DB_SCHEME_VERSION;
+            logger(Logging::DEBUGGING) << "DB scheme version not found, writing: " << currentDBSchemeVersion(database);
 
-            DatabaseVersionWriteBatch writeBatch(CURRENT_DB_SCHEME_VERSION);
+            DatabaseVersionWriteBatch writeBatch(currentDBSchemeVersion(database));
             auto writeError = database.write(writeBatch);
             if (writeError)
             {
@@ -574,41 +682,392 @@ namespace CryptoNote
             logger(Logging::DEBUGGING) << "Current db scheme version: " << *version;
         }
 
+        blockInfoColumn.open(database.getConfig().dataDir + "/BlockInfo");
+        keyOutputColumn.open(database.getConfig().dataDir + "/KeyOutputs");
+
         if (getTopBlockIndex() == 0)
         {
             logger(Logging::DEBUGGING) << "top block index is null, add genesis block";
+            blockInfoColumn.clear();
+            keyOutputColumn.clear();
             addGenesisBlock(CachedBlock(currency.genesisBlock()));
         }
+        else
+        {
+            loadBlockInfoColumn();
+            loadKeyOutputColumn();
+            loadSpentKeyImageIndex();
+        }
     }
 
-    bool DatabaseBlockchainCache::checkDBSchemeVersion(IDataBase &database, std::shared_ptr<Logging::ILogger> _logger)
+    void DatabaseBlockchainCache::loadBlockInfoColumn()
     {
-        Logging::LoggerRef logger(_logger, "DatabaseBlockchainCache");
+        const uint32_t blockCount = getTopBlockIndex() + 1;
+
+        if (blockInfoColumn.size() > blockCount)
+        {
+            blockInfoColumn.truncate(blockCount);
+        }
+
+        /* The last blocks pushed before a crash may not have made it to disk.
+           Check them against the database, a flush interval at a time from
+           the end, and reload from the first one that doesn't match. Once
+           the first block of an interval matches, the blocks before it do
+           too, since each block hash commits to the previous block. If it
+           doesn't, the files may be older than the last flush, so keep
+           going back. */
+        while (blockInfoColumn.size() > 0)
+        {
+            const uint32_t checkTo = blockInfoColumn.size();
+            const uint32_t checkFrom = checkTo - std::min(checkTo, BLOCK_INFO_FLUSH_INTERVAL);
+
+            BlockchainReadBatch readBatch(DB::formatOf(database));
+
+            for (uint32_t blockIndex = checkFrom; blockIndex < checkTo; blockIndex++)
+            {
+                readBatch.requestCachedBlock(blockIndex);
+            }
+
+            const auto result = readDatabase(readBatch);
+
+            uint32_t firstMismatch = checkTo;
+
+            for (uint32_t blockIndex = checkFrom; blockIndex < checkTo; blockIndex++)
+            {
+                if (!sameBlockInfo(blockInfoColumn.get(blockIndex), result.getCachedBlocks().at(blockIndex)))
+                {
+                    firstMismatch = blockIndex;
+                    break;
+                }
+            }
+
+            blockInfoColumn.truncate(firstMismatch);
+
+            if (firstMismatch != checkFrom)
+            {
+                break;
+            }
+        }
+
+        if (blockInfoColumn.size() == blockCount)
+        {
+            return;
+        }
+
+        logger(Logging::INFO) << "Loading block info for " << blockCount - blockInfoColumn.size() << " blocks...";
+
+        const auto startTime = std::chrono::steady_clock::now();
+
+        blockInfoColumn.reserve(blockCount);
+
+        const uint32_t blocksPerRead = 1000;
+
+        /* Bounds the memory used for blocks read but not yet stored */
+        const uint32_t readsPerRound = 256;
+
+        while (blockInfoColumn.size() < blockCount)
+        {
+            const uint32_t roundStart = blockInfoColumn.size();
+
+            const uint32_t reads =
+                std::min(readsPerRound, (blockCount - roundStart + blocksPerRead - 1) / blocksPerRead);
+
+            std::vector<std::vector<CachedBlockInfo>> results(reads);
+
+            Utilities::TaskScheduler::shared().parallelFor(0, reads, [&](const size_t read) {
+                const uint32_t startIndex = roundStart + static_cast<uint32_t>(read) * blocksPerRead;
+                const uint32_t endIndex = std::min(startIndex + blocksPerRead, blockCount);
+
+                BlockchainReadBatch readBatch(DB::formatOf(database));
+
+                for (uint32_t blockIndex = startIndex; blockIndex < endIndex; blockIndex++)
+                {
+                    readBatch.requestCachedBlock(blockIndex);
+                }
+
+                const auto ec = database.readThreadSafe(readBatch);
+
+                if (ec)
+                {
+                    logger(Logging::ERROR) << "Failed to load block info: " << ec.message();
+                    throw std::system_error(ec);
+                }
+
+                const auto result = readBatch.extractResult();
+
+                results[read].reserve(endIndex - startIndex);
+
+                for (uint32_t blockIndex = startIndex; blockIndex < endIndex; blockIndex++)
+                {
+                    results[read].push_back(result.getCachedBlocks().at(blockIndex));
+                }
+
+                return true;
+            });
+
+            for (const auto &blockInfos : results)
+            {
+                for (const auto &blockInfo : blockInfos)
+                {
+                    blockInfoColumn.push(blockInfo);
+                }
+            }
+        }
+
+        blockInfoColumn.flush();
+
+        const auto elapsed =
+            std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now() - startTime);
+
+        logger(Logging::INFO) << "Loaded block info in " << elapsed.count() << " seconds";
+    }
+
+    void DatabaseBlockchainCache::loadKeyOutputColumn()
+    {
+        const uint32_t topBlockIndex = getTopBlockIndex();
+
+        /* The files are only known to be good up to the block they were last
+           flushed at. If that block isn't in the chain any more, something
+           went wrong between the database and the files, so start over. */
+        const auto flushedBlock = keyOutputColumn.flushedBlock();
+
+        if (!flushedBlock || flushedBlock->first > topBlockIndex
+            || blockInfoColumn.blockHash(flushedBlock->first) != flushedBlock->second)
+        {
+            keyOutputColumn.clear();
+        }
+
+        const uint32_t amountsCount =
+            readDatabase(BlockchainReadBatch(DB::formatOf(database)).requestKeyOutputAmountsCount())
+                .getKeyOutputAmountsCount();
+
+        if (amountsCount == 0)
+        {
+            keyOutputColumn.clear();
+            keyOutputColumn.flush(topBlockIndex, blockInfoColumn.blockHash(topBlockIndex));
+            return;
+        }
+
+        BlockchainReadBatch amountsBatch(DB::formatOf(database));
+
+        for (uint32_t amountIndex = 0; amountIndex < amountsCount; amountIndex++)
+        {
+            amountsBatch.requestKeyOutputAmount(amountIndex);
+        }
+
+        BlockchainReadBatch countsBatch(DB::formatOf(database));
+
+        for (const auto &[amountIndex, amount] : readDatabase(amountsBatch).getKeyOutputAmounts())
+        {
+            countsBatch.requestKeyOutputGlobalIndexesCountForAmount(amount);
+        }
+
+        const auto outputsCounts = readDatabase(countsBatch).getKeyOutputGlobalIndexesCountForAmounts();
+
+        /* Drop anything the database doesn't have */
+        for (const auto amount : keyOutputColumn.amounts())
+        {
+            const auto it = outputsCounts.find(amount);
+
+            keyOutputColumn.truncate(amount, it != outputsCounts.end() ? it->second : 0);
+        }
+
+        struct Read
+        {
+            Amount amount;
+
+            uint32_t startIndex;
+
+            uint32_t endIndex;
+        };
+
+        const uint32_t outputsPerRead = 1000;
+
+        std::vector<Read> reads;
+
+        uint64_t missingCount = 0;
+
+        for (const auto &[amount, outputsCount] : outputsCounts)
+        {
+            const uint32_t storedCount = keyOutputColumn.size(amount);
+
+            if (storedCount == outputsCount)
+            {
+                continue;
+            }
+
+            keyOutputColumn.reserve(amount, outputsCount);
+
+            for (uint32_t startIndex = storedCount; startIndex < outputsCount; startIndex += outputsPerRead)
+            {
+                reads.push_back({amount, startIndex, std::min(startIndex + outputsPerRead, outputsCount)});
+            }
+
+            missingCount += outputsCount - storedCount;
+        }
+
+        if (reads.empty())
+        {
+            keyOutputColumn.flush(topBlockIndex, blockInfoColumn.blockHash(topBlockIndex));
+            return;
+        }
+
+        logger(Logging::INFO) << "Loading " << missingCount << " key outputs...";
+
+        const auto startTime = std::chrono::steady_clock::now();
+
+        /* Bounds the memory used for outputs read but not yet stored */
+        const size_t readsPerRound = 256;
+
+        for (size_t roundStart = 0; roundStart < reads.size(); roundStart += readsPerRound)
+        {
+            const size_t roundEnd = std::min(roundStart + readsPerRound, reads.size());
+
+            std::vector<std::vector<KeyOutputColumn::Entry>> results(roundEnd - roundStart);
+
+            Utilities::TaskScheduler::shared().parallelFor(roundStart, roundEnd, [&](const size_t readIndex) {
+                const auto &read = reads[readIndex];
+
+                BlockchainReadBatch readBatch(DB::formatOf(database));
+
+                for (uint32_t globalIndex = read.startIndex; globalIndex < read.endIndex; globalIndex++)
+                {
+                    readBatch.requestKeyOutputInfo(read.amount, globalIndex);
+                    readBatch.requestKeyOutputGlobalIndexForAmount(read.amount, globalIndex);
+                }
+
+                const auto ec = database.readThreadSafe(readBatch);
+
+                if (ec)
+                {
+                    logger(Logging::ERROR) << "Failed to load key outputs: " << ec.message();
+                    throw std::system_error(ec);
+                }
+
+                const auto result = readBatch.extractResult();
+
+                auto &entries = results[readIndex - roundStart];
+
+                entries.reserve(read.endIndex - read.startIndex);
+
+                for (uint32_t globalIndex = read.startIndex; globalIndex < read.endIndex; globalIndex++)
+                {
+                    const auto key = std::make_pair(read.amount, globalIndex);
+
+                    entries.push_back(keyOutputEntry(
+                        result.getKeyOutputInfo().at(key), result.getKeyOutputGlobalIndexesForAmounts().at(key)));
+                }
+
+                return true;
+            });
+
+            /* The reads of an amount are in order, so pushing them in order
+               keeps the outputs at their global index */
+            for (size_t readIndex = roundStart; readIndex < roundEnd; readIndex++)
+            {
+                for (const auto &entry : results[readIndex - roundStart])
+                {
+                    keyOutputColumn.push(reads[readIndex].amount, entry);
+                }
+            }
+        }
+
+        keyOutputColumn.flush(topBlockIndex, blockInfoColumn.blockHash(topBlockIndex));
+
+        const auto elapsed =
+            std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now() - startTime);
+
+        logger(Logging::INFO) << "Loaded key outputs in " << elapsed.count() << " seconds";
+    }
+
+    void DatabaseBlockchainCache::loadSpentKeyImageIndex()
+    {
+        if (spentKeyImageIndex.mode() == SpentKeyImageIndex::Mode::None)
+        {
+            return;
+        }
+
+        logger(Logging::INFO) << "Loading spent key images...";
+
+        const auto startTime = std::chrono::steady_clock::now();
+
+        const uint32_t topIndex = getTopBlockIndex();
+
+        const uint32_t blocksPerRead = 1000;
+
+        /* The index is lock striped, so the reads can fill it in parallel */
+        Utilities::TaskScheduler::shared().parallelFor(0, topIndex / blocksPerRead + 1, [&](const size_t read) {
+            const uint32_t startIndex = static_cast<uint32_t>(read) * blocksPerRead;
+            const uint32_t endIndex = std::min(startIndex + blocksPerRead - 1, topIndex);
+
+            BlockchainReadBatch readBatch(DB::formatOf(database));
+
+            for (uint32_t blockIndex = startIndex; blockIndex <= endIndex; blockIndex++)
+            {
+                readBatch.requestSpentKeyImagesByBlock(blockIndex);
+            }
+
+            const auto ec = database.readThreadSafe(readBatch);
+
+            if (ec)
+            {
+                logger(Logging::ERROR) << "Failed to load spent key images: " << ec.message();
+                throw std::system_error(ec);
+            }
+
+            for (const auto &[blockIndex, keyImages] : readBatch.extractResult().getSpentKeyImagesByBlock())
+            {
+                spentKeyImageIndex.insert(keyImages, blockIndex);
+            }
+
+            return true;
+        });
+
+        const auto elapsed =
+            std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now() - startTime);
 
-        DatabaseVersionReadBatch readBatch;
-        auto ec = database.read(readBatch);
-        if (ec)
+        logger(Logging::INFO) << "Loaded " << spentKeyImageIndex.size() << " spent key images in "
+                              << elapsed.count() << " seconds";
+
+        if (!spentKeyImageIndex.complete())
         {
-            throw std::system_error(ec);
+            logger(Logging::WARNING) << "Not every spent key image fit in memory, the rest are looked up in the "
+                                     << "database. Consider --db-key-image-index=filter.";
         }
+    }
+
+    bool DatabaseBlockchainCache::checkDBSchemeVersion(IDataBase &database, std::shared_ptr<Logging::ILogger> _logger)
+    {
+        Logging::LoggerRef logger(_logger, "DatabaseBlockchainCache");
 
-        auto version = readBatch.getDbSchemeVersion();
+        const bool compact = DB::formatOf(database) == DB::Format::Compact;
+        const uint32_t expectedVersion = currentDBSchemeVersion(database);
+
+        auto version = readDbSchemeVersion(database, logger);
         if (!version)
         {
             // DB scheme version not found. Looks like it was just created.
             return true;
         }
-        else if (*version < CURRENT_DB_SCHEME_VERSION)
+        else if ((*version >= MIN_COMPACT_DB_SCHEME_VERSION) != compact)
+        {
+            // Don't destroy the DB just because the option was changed
+            logger(Logging::ERROR) << "DB was created " << (compact ? "without" : "with")
+                                   << " --db-use-experimental-serializer. Please start with the same setting, "
+                                   << "or delete the DB to resync it.";
+            throw std::runtime_error("DB serializer does not match");
+        }
+        else if (*version < expectedVersion)
         {
             logger(Logging::WARNING) << "DB scheme version is less than expected. Expected version "
-                                     << CURRENT_DB_SCHEME_VERSION << ". Actual version " << *version
+                                     << expectedVersion << ". Actual version " << *version
                                      << ". DB will be destroyed and recreated from blocks.bin file.";
             return false;
         }
-        else if (*version > CURRENT_DB_SCHEME_VERSION)
+        else if (*version > expectedVersion)
         {
             logger(Logging::ERROR) << "DB scheme version is greater than expected. Expected version "
-                                   << CURRENT_DB_SCHEME_VERSION << ". Actual version " << *version
+                                   << expectedVersion << ". Actual version " << *version
                                    << ". Please update your software.";
             throw std::runtime_error("DB scheme version is greater than expected");
         }
@@ -621,8 +1080,6 @@ namespace CryptoNote
     void DatabaseBlockchainCache::deleteClosestTimestampBlockIndex(BlockchainWriteBatch &writeBatch,
                                                                    uint32_t splitBlockIndex)
     {
-        auto batch = BlockchainReadBatch().requestCachedBlock(splitBlockIndex);
-        auto blockResult = readDatabase(batch);
         auto timestamp = getCachedBlockInfo(splitBlockIndex).timestamp;
 
         auto midnight = roundToMidnight(timestamp);
@@ -644,7 +1101,7 @@ namespace CryptoNote
             midnight += ONE_DAY_SECONDS;
         }
 
-        BlockchainReadBatch midnightBatch;
+        BlockchainReadBatch midnightBatch(DB::formatOf(database));
         while (readDatabase(midnightBatch.requestClosestTimestampBlockIndex(midnight))
                    .getClosestTimestampBlockIndex()
                    .count(midnight))
@@ -671,7 +1128,7 @@ namespace CryptoNote
         using DeleteBlockInfo = std::tuple<uint32_t, Crypto::Hash, TransactionValidatorState, uint64_t>;
         std::vector<DeleteBlockInfo> deletingBlocks;
 
-        BlockchainWriteBatch writeBatch;
+        BlockchainWriteBatch writeBatch(DB::formatOf(database));
         auto currentTop = getTopBlockIndex();
         for (uint32_t blockIndex = splitBlockIndex; blockIndex <= currentTop; ++blockIndex)
         {
@@ -691,7 +1148,7 @@ namespace CryptoNote
             auto &validatorState = std::get<2>(*it);
             uint64_t timestamp = std::get<3>(*it);
 
-            writeBatch.removeCachedBlock(blockHash, blockIndex).removeRawBlock(blockIndex);
+            writeBatch.removeCachedBlock(blockHash, blockIndex).removeRawBlock(blockIndex).removeWalletBlock(blockIndex);
             requestDeleteSpentOutputs(writeBatch, blockIndex, validatorState);
             requestRemoveTimestamp(writeBatch, timestamp, blockHash);
         }
@@ -727,15 +1184,21 @@ namespace CryptoNote
             throw std::runtime_error(err.message());
         }
 
-        cutTail(unitsCache, currentTop + 1 - splitBlockIndex);
+        for (const auto &deletingBlock : deletingBlocks)
+        {
+            spentKeyImageIndex.remove(std::get<2>(deletingBlock).spentKeyImages);
+        }
+
+        blockInfoColumn.truncate(splitBlockIndex);
+        blockInfoColumn.flush();
+
+        keyOutputColumn.truncateBlocks(splitBlockIndex);
+        keyOutputColumn.flush(splitBlockIndex - 1, blockInfoColumn.blockHash(splitBlockIndex - 1));
 
         children.push_back(cache.get());
         logger(Logging::TRACE) << "Delete successfull";
 
-        // invalidate top block index and hash
-        topBlockIndex = boost::none;
-        topBlockHash = boost::none;
-        transactionsCount = boost::none;
+        invalidateLazyState();
 
         logger(Logging::DEBUGGING) << "split completed";
         // return new cache
@@ -751,6 +1214,14 @@ namespace CryptoNote
             logger(Logging::TRACE) << "DatabaseBlockchainCache::rewind height=" << std::to_string(height)
                                    << " calling database.recreate()";
             database.recreate();
+            spentKeyImageIndex.clear();
+            blockInfoColumn.clear();
+            keyOutputColumn.clear();
+
+            std::scoped_lock lock(lazyStateMutex);
+            blockSizesWindowIndex = boost::none;
+            nextBlockDifficulty = boost::none;
+            unlockedOutputsCounts.clear();
             return;
         }
 
@@ -759,7 +1230,7 @@ namespace CryptoNote
         using DeleteBlockInfo = std::tuple<uint32_t, Crypto::Hash, TransactionValidatorState, uint64_t>;
         std::vector<DeleteBlockInfo> deletingBlocks;
 
-        BlockchainWriteBatch writeBatch;
+        BlockchainWriteBatch writeBatch(DB::formatOf(database));
         auto currentTop = getTopBlockIndex();
 
         if (height >= currentTop)
@@ -784,7 +1255,7 @@ namespace CryptoNote
 
         for (const auto &hash : blockHashes)
         {
-            writeBatch.removeCachedBlock(hash, blockIndex).removeRawBlock(blockIndex);
+            writeBatch.removeCachedBlock(hash, blockIndex).removeRawBlock(blockIndex).removeWalletBlock(blockIndex);
             blockIndex++;
             logger(Logging::DEBUGGING) << "Scheduling deletion of block " << blockIndex;
         }
@@ -796,7 +1267,7 @@ namespace CryptoNote
             auto &validatorState = std::get<2>(*it);
             uint64_t timestamp = std::get<3>(*it);
 
-            writeBatch.removeCachedBlock(blockHash, blockIndex).removeRawBlock(blockIndex);
+            writeBatch.removeCachedBlock(blockHash, blockIndex).removeRawBlock(blockIndex).removeWalletBlock(blockIndex);
             requestDeleteSpentOutputs(writeBatch, blockIndex, validatorState);
             requestRemoveTimestamp(writeBatch, timestamp, blockHash);
         }
@@ -866,15 +1337,24 @@ namespace CryptoNote
             throw std::runtime_error(err.message());
         }
 
+        for (const auto &deletingBlock : deletingBlocks)
+        {
+            spentKeyImageIndex.remove(std::get<2>(deletingBlock).spentKeyImages);
+        }
+
         /* Remove cached blocks */
-        cutTail(unitsCache, currentTop + 1 - height);
+        blockInfoColumn.truncate(static_cast<uint32_t>(height));
+        blockInfoColumn.flush();
+
+        const auto newTopBlockIndex = static_cast<uint32_t>(height - 1);
+
+        keyOutputColumn.truncateBlocks(newTopBlockIndex + 1);
+        keyOutputColumn.flush(newTopBlockIndex, blockInfoColumn.blockHash(newTopBlockIndex));
+
         children.push_back(cache.get());
         logger(Logging::TRACE) << "Delete successful";
 
-        // invalidate top block index and hash
-        topBlockIndex = boost::none;
-        topBlockHash = boost::none;
-        transactionsCount = boost::none;
+        invalidateLazyState();
     }
 
     // returns hash of pushed block
@@ -911,7 +1391,7 @@ namespace CryptoNote
     {
         logger(Logging::DEBUGGING) << "Requesting transaction hashes starting from block index " << splitBlockIndex;
 
-        BlockchainReadBatch readBatch;
+        BlockchainReadBatch readBatch(DB::formatOf(database));
         for (uint32_t blockIndex = splitBlockIndex; blockIndex <= getTopBlockIndex(); ++blockIndex)
         {
             readBatch.requestTransactionHashesByBlock(blockIndex);
@@ -938,6 +1418,8 @@ namespace CryptoNote
         {
             assert(getCachedTransactionsCount() > 0);
             writeBatch.removeCachedTransaction(hash, getCachedTransactionsCount() - 1);
+
+            std::scoped_lock lock(lazyStateMutex);
             transactionsCount = *transactionsCount - 1;
         }
     }
@@ -998,7 +1480,7 @@ namespace CryptoNote
             return;
         }
 
-        BlockchainReadBatch readBatch;
+        BlockchainReadBatch readBatch(DB::formatOf(database));
         for (auto kv : boundaries)
         {
             readBatch.requestKeyOutputGlobalIndexesCountForAmount(kv.first);
@@ -1037,7 +1519,7 @@ namespace CryptoNote
                                                          uint64_t timestamp,
                                                          const Crypto::Hash &blockHash)
     {
-        auto readBatch = BlockchainReadBatch().requestBlockHashesByTimestamp(timestamp);
+        auto readBatch = BlockchainReadBatch(DB::formatOf(database)).requestBlockHashesByTimestamp(timestamp);
         auto result = readDatabase(readBatch);
 
         if (result.getBlockHashesByTimestamp().count(timestamp) == 0)
@@ -1061,10 +1543,11 @@ namespace CryptoNote
         }
     }
 
-    void DatabaseBlockchainCache::pushTransaction(const CachedTransaction &cachedTransaction,
+    std::vector<uint32_t> DatabaseBlockchainCache::pushTransaction(const CachedTransaction &cachedTransaction,
                                                   uint32_t blockIndex,
                                                   uint16_t transactionBlockIndex,
-                                                  BlockchainWriteBatch &batch)
+                                                  BlockchainWriteBatch &batch,
+                                                  std::vector<std::pair<Amount, KeyOutputColumn::Entry>> &keyOutputs)
     {
         logger(Logging::DEBUGGING) << "push transaction with hash " << cachedTransaction.getTransactionHash();
         const auto &tx = cachedTransaction.getTransaction();
@@ -1115,6 +1598,8 @@ namespace CryptoNote
                 outputInfo.outputIndex = poi.outputIndex;
 
                 batch.insertKeyOutputInfo(output.amount, globalIndex, outputInfo);
+
+                keyOutputs.push_back({output.amount, {outputInfo.publicKey, outputInfo.unlockTime, blockIndex}});
             }
         }
 
@@ -1138,9 +1623,16 @@ namespace CryptoNote
         }
 
         batch.insertCachedTransaction(transactionCacheInfo, getCachedTransactionsCount() + 1);
-        transactionsCount = *transactionsCount + 1;
+
+        {
+            std::scoped_lock lock(lazyStateMutex);
+            transactionsCount = *transactionsCount + 1;
+        }
+
         logger(Logging::DEBUGGING) << "push transaction with hash " << cachedTransaction.getTransactionHash()
                                    << " finished";
+
+        return transactionCacheInfo.globalIndexes;
     }
 
     uint32_t DatabaseBlockchainCache::updateKeyOutputCount(Amount amount, int32_t diff) const
@@ -1151,7 +1643,7 @@ namespace CryptoNote
             logger(Logging::TRACE) << "updateKeyOutputCount: failed to found key for amount " << std::to_string(amount)
                                    << ", request database";
 
-            BlockchainReadBatch batch;
+            BlockchainReadBatch batch(DB::formatOf(database));
             auto result = readDatabase(batch.requestKeyOutputGlobalIndexesCountForAmount(amount));
             auto found = result.getKeyOutputGlobalIndexesCountForAmounts().find(amount);
             auto val = found != result.getKeyOutputGlobalIndexesCountForAmounts().end() ? found->second : 0;
@@ -1171,7 +1663,7 @@ namespace CryptoNote
         }
         else if (!keyOutputAmountsCount)
         {
-            auto result = readDatabase(BlockchainReadBatch().requestKeyOutputAmountsCount());
+            auto result = readDatabase(BlockchainReadBatch(DB::formatOf(database)).requestKeyOutputAmountsCount());
             keyOutputAmountsCount = result.getKeyOutputAmountsCount();
         }
 
@@ -1184,7 +1676,7 @@ namespace CryptoNote
                                                   const Crypto::Hash &transactionHash,
                                                   const Crypto::Hash &paymentId)
     {
-        BlockchainReadBatch readBatch;
+        BlockchainReadBatch readBatch(DB::formatOf(database));
         uint32_t count = 0;
 
         auto readResult = readDatabase(readBatch.requestTransactionCountByPaymentId(paymentId));
@@ -1202,7 +1694,7 @@ namespace CryptoNote
                                                        uint64_t timestamp,
                                                        const Crypto::Hash &blockHash)
     {
-        BlockchainReadBatch readBatch;
+        BlockchainReadBatch readBatch(DB::formatOf(database));
         readBatch.requestBlockHashesByTimestamp(timestamp);
 
         std::vector<Crypto::Hash> blockHashes;
@@ -1226,11 +1718,10 @@ namespace CryptoNote
                                             uint64_t blockDifficulty,
                                             RawBlock &&rawBlock)
     {
-        BlockchainWriteBatch batch;
+        BlockchainWriteBatch batch(DB::formatOf(database));
         logger(Logging::DEBUGGING) << "push block with hash " << cachedBlock.getBlockHash() << ", and "
                                    << cachedTransactions.size() + 1 << " transactions"; //+1 for base transaction
 
-        // TODO: cache top block difficulty, size, timestamp, coins; use it here
         auto lastBlockInfo = getCachedBlockInfo(getTopBlockIndex());
         auto cumulativeDifficulty = lastBlockInfo.cumulativeDifficulty + blockDifficulty;
         auto alreadyGeneratedCoins = lastBlockInfo.alreadyGeneratedCoins + generatedCoins;
@@ -1256,12 +1747,38 @@ namespace CryptoNote
         batch.insertCachedBlock(blockInfo, getTopBlockIndex() + 1, txHashes);
         batch.insertRawBlock(getTopBlockIndex() + 1, rawBlock);
 
+        std::optional<WalletTypes::WalletBlockInfo> walletBlock;
+
+        if (storeWalletScanRecords)
+        {
+            walletBlock = Utils::getWalletBlockInfo(cachedBlock, cachedBaseTransaction, cachedTransactions);
+        }
+
+        std::vector<std::pair<Amount, KeyOutputColumn::Entry>> keyOutputs;
+
         auto transactionIndex = 0;
-        pushTransaction(cachedBaseTransaction, getTopBlockIndex() + 1, transactionIndex++, batch);
+        auto globalIndexes =
+            pushTransaction(cachedBaseTransaction, getTopBlockIndex() + 1, transactionIndex++, batch, keyOutputs);
 
-        for (const auto &transaction : cachedTransactions)
+        if (walletBlock)
         {
-            pushTransaction(transaction, getTopBlockIndex() + 1, transactionIndex++, batch);
+            setGlobalIndexes(*walletBlock->coinbaseTransaction, globalIndexes);
+        }
+
+        for (size_t i = 0; i < cachedTransactions.size(); i++)
+        {
+            globalIndexes =
+                pushTransaction(cachedTransactions[i], getTopBlockIndex() + 1, transactionIndex++, batch, keyOutputs);
+
+            if (walletBlock)
+            {
+                setGlobalIndexes(walletBlock->transactions[i], globalIndexes);
+            }
+        }
+
+        if (walletBlock)
+        {
+            batch.insertWalletBlock(getTopBlockIndex() + 1, *walletBlock);
         }
 
         auto closestBlockIndexDb =
@@ -1289,17 +1806,49 @@ namespace CryptoNote
             throw std::runtime_error(res.message());
         }
 
-        topBlockIndex = *topBlockIndex + 1;
-        topBlockHash = cachedBlock.getBlockHash();
+        {
+            std::scoped_lock lock(lazyStateMutex);
+
+            topBlockIndex = *topBlockIndex + 1;
+            topBlockHash = cachedBlock.getBlockHash();
+
+            if (blockSizesWindowIndex == *topBlockIndex - 1)
+            {
+                blockSizesWindow.push(blockInfo.blockSize);
+                blockSizesWindowIndex = *topBlockIndex;
+            }
+        }
+
         logger(Logging::DEBUGGING) << "push block " << cachedBlock.getBlockHash() << " completed";
 
-        unitsCache.push_back(blockInfo);
-        if (unitsCache.size() > unitsCacheSize)
+        spentKeyImageIndex.insert(validatorState.spentKeyImages, *topBlockIndex);
+
+        blockInfoColumn.push(blockInfo);
+
+        for (const auto &[amount, keyOutput] : keyOutputs)
+        {
+            keyOutputColumn.push(amount, keyOutput);
+        }
+
+        if (*topBlockIndex % BLOCK_INFO_FLUSH_INTERVAL == 0)
         {
-            unitsCache.pop_front();
+            blockInfoColumn.flush();
+            keyOutputColumn.flush(*topBlockIndex, cachedBlock.getBlockHash());
         }
     }
 
+    void DatabaseBlockchainCache::invalidateLazyState()
+    {
+        std::scoped_lock lock(lazyStateMutex);
+
+        topBlockIndex = boost::none;
+        topBlockHash = boost::none;
+        transactionsCount = boost::none;
+        blockSizesWindowIndex = boost::none;
+        nextBlockDifficulty = boost::none;
+        unlockedOutputsCounts.clear();
+    }
+
     PushedBlockInfo DatabaseBlockchainCache::getPushedBlockInfo(uint32_t blockIndex) const
     {
         return getExtendedPushedBlockInfo(blockIndex).pushedBlockInfo;
@@ -1307,7 +1856,14 @@ namespace CryptoNote
 
     bool DatabaseBlockchainCache::checkIfSpent(const Crypto::KeyImage &keyImage, uint32_t blockIndex) const
     {
-        auto batch = BlockchainReadBatch().requestBlockIndexBySpentKeyImage(keyImage);
+        const auto lookup = spentKeyImageIndex.find(keyImage, blockIndex);
+
+        if (lookup != SpentKeyImageIndex::LookupResult::Unknown)
+        {
+            return lookup == SpentKeyImageIndex::LookupResult::Spent;
+        }
+
+        auto batch = BlockchainReadBatch(DB::formatOf(database)).requestBlockIndexBySpentKeyImage(keyImage);
         auto res = database.readThreadSafe(batch);
 
         if (res)
@@ -1370,6 +1926,27 @@ namespace CryptoNote
         Common::ArrayView<uint32_t> globalIndexes,
         std::vector<Crypto::PublicKey> &publicKeys) const
     {
+        /* Once loaded, the key output column has every output on the chain,
+           so this only goes to the database for bad indexes */
+        if (!globalIndexes.isEmpty()
+            && *std::max_element(globalIndexes.begin(), globalIndexes.end()) < keyOutputColumn.size(amount))
+        {
+            for (const auto globalIndex : globalIndexes)
+            {
+                const auto output = keyOutputColumn.get(amount, globalIndex);
+
+                if (!isTransactionSpendTimeUnlocked(output.unlockTime, blockIndex))
+                {
+                    logger(Logging::DEBUGGING) << "extractKeyOutputKeys: output " << globalIndex << " is locked";
+                    return ExtractOutputKeysResult::OUTPUT_LOCKED;
+                }
+
+                publicKeys.push_back(output.publicKey);
+            }
+
+            return ExtractOutputKeysResult::SUCCESS;
+        }
+
         return extractKeyOutputs(amount,
                                  blockIndex,
                                  globalIndexes,
@@ -1424,9 +2001,11 @@ namespace CryptoNote
 
     uint32_t DatabaseBlockchainCache::getTopBlockIndex() const
     {
+        std::scoped_lock lock(lazyStateMutex);
+
         if (!topBlockIndex)
         {
-            auto batch = BlockchainReadBatch().requestLastBlockIndex();
+            auto batch = BlockchainReadBatch(DB::formatOf(database)).requestLastBlockIndex();
             auto result = database.read(batch);
 
             if (result)
@@ -1462,9 +2041,11 @@ namespace CryptoNote
 
     uint64_t DatabaseBlockchainCache::getCachedTransactionsCount() const
     {
+        std::scoped_lock lock(lazyStateMutex);
+
         if (!transactionsCount)
         {
-            auto batch = BlockchainReadBatch().requestTransactionsCount();
+            auto batch = BlockchainReadBatch(DB::formatOf(database)).requestTransactionsCount();
             auto result = database.read(batch);
 
             if (result)
@@ -1490,11 +2071,13 @@ namespace CryptoNote
 
     const Crypto::Hash &DatabaseBlockchainCache::getTopBlockHash() const
     {
+        const uint32_t topIndex = getTopBlockIndex();
+
+        std::scoped_lock lock(lazyStateMutex);
+
         if (!topBlockHash)
         {
-            auto batch = BlockchainReadBatch().requestCachedBlock(getTopBlockIndex());
-            auto result = readDatabase(batch);
-            topBlockHash = result.getCachedBlocks().at(getTopBlockIndex()).blockHash;
+            topBlockHash = blockInfoColumn.blockHash(topIndex);
         }
         return *topBlockHash;
     }
@@ -1506,7 +2089,7 @@ namespace CryptoNote
 
     bool DatabaseBlockchainCache::hasBlock(const Crypto::Hash &blockHash) const
     {
-        auto batch = BlockchainReadBatch().requestBlockIndexByBlockHash(blockHash);
+        auto batch = BlockchainReadBatch(DB::formatOf(database)).requestBlockIndexByBlockHash(blockHash);
         auto result = database.read(batch);
         return !result && batch.extractResult().getBlockIndexesByBlockHashes().count(blockHash);
     }
@@ -1518,14 +2101,14 @@ namespace CryptoNote
             return getTopBlockIndex();
         }
 
-        auto batch = BlockchainReadBatch().requestBlockIndexByBlockHash(blockHash);
+        auto batch = BlockchainReadBatch(DB::formatOf(database)).requestBlockIndexByBlockHash(blockHash);
         auto result = readDatabase(batch);
         return result.getBlockIndexesByBlockHashes().at(blockHash);
     }
 
     bool DatabaseBlockchainCache::hasTransaction(const Crypto::Hash &transactionHash) const
     {
-        auto batch = BlockchainReadBatch().requestCachedTransaction(transactionHash);
+        auto batch = BlockchainReadBatch(DB::formatOf(database)).requestCachedTransaction(transactionHash);
         auto result = database.read(batch);
         return !result && batch.extractResult().getCachedTransactions().count(transactionHash);
     }
@@ -1539,7 +2122,7 @@ namespace CryptoNote
                                                                      uint32_t blockIndex,
                                                                      UseGenesis useGenesis) const
     {
-        return getLastUnits(count, blockIndex, useGenesis, [](const CachedBlockInfo &inf) { return inf.timestamp; });
+        return lastUnits(blockInfoColumn.timestamps(), count, blockIndex, useGenesis);
     }
 
     std::vector<uint64_t> DatabaseBlockchainCache::getLastBlocksSizes(size_t count) const
@@ -1551,17 +2134,41 @@ namespace CryptoNote
                                                                       uint32_t blockIndex,
                                                                       UseGenesis useGenesis) const
     {
-        return getLastUnits(count, blockIndex, useGenesis, [](const CachedBlockInfo &cb) { return cb.blockSize; });
+        return lastUnits(blockInfoColumn.blockSizes(), count, blockIndex, useGenesis);
+    }
+
+    uint64_t DatabaseBlockchainCache::getLastBlocksSizesMedian(uint32_t blockIndex) const
+    {
+        assert(blockIndex <= getTopBlockIndex());
+
+        if (blockIndex != getTopBlockIndex())
+        {
+            auto sizes = getLastBlocksSizes(currency.rewardBlocksWindow(), blockIndex, UseGenesis {true});
+            return Common::medianValue(sizes);
+        }
+
+        std::scoped_lock lock(lazyStateMutex);
+
+        if (blockSizesWindowIndex != blockIndex)
+        {
+            blockSizesWindow.clear();
+
+            for (const uint64_t size : getLastBlocksSizes(currency.rewardBlocksWindow(), blockIndex, UseGenesis {true}))
+            {
+                blockSizesWindow.push(size);
+            }
+
+            blockSizesWindowIndex = blockIndex;
+        }
+
+        return blockSizesWindow.median();
     }
 
     std::vector<uint64_t> DatabaseBlockchainCache::getLastCumulativeDifficulties(size_t count,
                                                                                  uint32_t blockIndex,
                                                                                  UseGenesis useGenesis) const
     {
-        return getLastUnits(count,
-                            blockIndex,
-                            useGenesis,
-                            [](const CachedBlockInfo &info) { return info.cumulativeDifficulty; });
+        return lastUnits(blockInfoColumn.cumulativeDifficulties(), count, blockIndex, useGenesis);
     }
 
     std::vector<uint64_t> DatabaseBlockchainCache::getLastCumulativeDifficulties(size_t count) const
@@ -1577,16 +2184,34 @@ namespace CryptoNote
     uint64_t DatabaseBlockchainCache::getDifficultyForNextBlock(uint32_t blockIndex) const
     {
         assert(blockIndex <= getTopBlockIndex());
+
+        {
+            std::scoped_lock lock(lazyStateMutex);
+
+            if (nextBlockDifficulty && nextBlockDifficulty->first == blockIndex)
+            {
+                return nextBlockDifficulty->second;
+            }
+        }
+
         uint8_t nextBlockMajorVersion = getBlockMajorVersionForHeight(blockIndex + 1);
         auto timestamps =
             getLastTimestamps(CryptoNote::parameters::DIFFICULTY_BLOCKS_COUNT, blockIndex, UseGenesis {false});
         auto commulativeDifficulties = getLastCumulativeDifficulties(CryptoNote::parameters::DIFFICULTY_BLOCKS_COUNT,
                                                                      blockIndex,
                                                                      UseGenesis {false});
-        return currency.getNextDifficulty(nextBlockMajorVersion,
-                                          blockIndex,
-                                          std::move(timestamps),
-                                          std::move(commulativeDifficulties));
+        const uint64_t difficulty = currency.getNextDifficulty(nextBlockMajorVersion,
+                                                               blockIndex,
+                                                               timestamps,
+                                                               commulativeDifficulties);
+
+        if (blockIndex == getTopBlockIndex())
+        {
+            std::scoped_lock lock(lazyStateMutex);
+            nextBlockDifficulty = std::make_pair(blockIndex, difficulty);
+        }
+
+        return difficulty;
     }
 
     uint64_t DatabaseBlockchainCache::getCurrentCumulativeDifficulty() const
@@ -1597,14 +2222,12 @@ namespace CryptoNote
     uint64_t DatabaseBlockchainCache::getCurrentCumulativeDifficulty(uint32_t blockIndex) const
     {
         assert(blockIndex <= getTopBlockIndex());
-        return getCachedBlockInfo(blockIndex).cumulativeDifficulty;
+        return blockInfoColumn.cumulativeDifficulties()[blockIndex];
     }
 
     CachedBlockInfo DatabaseBlockchainCache::getCachedBlockInfo(uint32_t index) const
     {
-        auto batch = BlockchainReadBatch().requestCachedBlock(index);
-        auto result = readDatabase(batch);
-        return result.getCachedBlocks().at(index);
+        return blockInfoColumn.get(index);
     }
 
     uint64_t DatabaseBlockchainCache::getAlreadyGeneratedCoins() const
@@ -1614,96 +2237,12 @@ namespace CryptoNote
 
     uint64_t DatabaseBlockchainCache::getAlreadyGeneratedCoins(uint32_t blockIndex) const
     {
-        return getCachedBlockInfo(blockIndex).alreadyGeneratedCoins;
+        return blockInfoColumn.alreadyGeneratedCoins()[blockIndex];
     }
 
     uint64_t DatabaseBlockchainCache::getAlreadyGeneratedTransactions(uint32_t blockIndex) const
     {
-        return getCachedBlockInfo(blockIndex).alreadyGeneratedTransactions;
-    }
-
-    std::vector<CachedBlockInfo> DatabaseBlockchainCache::getLastCachedUnits(uint32_t blockIndex,
-                                                                             size_t count,
-                                                                             UseGenesis useGenesis) const
-    {
-        assert(blockIndex <= getTopBlockIndex());
-
-        std::vector<CachedBlockInfo> cachedResult;
-        const uint32_t cacheStartIndex = (getTopBlockIndex() + 1) - static_cast<uint32_t>(unitsCache.size());
-
-        count = std::min(unitsCache.size(), count);
-
-        if (cacheStartIndex > blockIndex || count == 0)
-        {
-            return cachedResult;
-        }
-
-        count = std::min(blockIndex - cacheStartIndex + 1, static_cast<uint32_t>(count));
-        uint32_t offset = static_cast<uint32_t>(blockIndex + 1 - count) - cacheStartIndex;
-
-        assert(offset < unitsCache.size());
-
-        if (!useGenesis && cacheStartIndex == 0 && offset == 0)
-        {
-            ++offset;
-            --count;
-        }
-
-        if (offset >= unitsCache.size() || count == 0)
-        {
-            return cachedResult;
-        }
-
-        cachedResult.reserve(count);
-        for (size_t i = 0; i < count; ++i)
-        {
-            cachedResult.push_back(unitsCache[offset + i]);
-        }
-
-        return cachedResult;
-    }
-
-    std::vector<CachedBlockInfo> DatabaseBlockchainCache::getLastDbUnits(uint32_t blockIndex,
-                                                                         size_t count,
-                                                                         UseGenesis useGenesis) const
-    {
-        uint32_t readFrom = blockIndex + 1 - std::min(blockIndex + 1, static_cast<uint32_t>(count));
-        if (readFrom == 0 && !useGenesis)
-        {
-            readFrom += 1;
-        }
-
-        uint32_t toRead = blockIndex - readFrom + 1;
-        std::vector<CachedBlockInfo> units;
-        units.reserve(toRead);
-
-        const uint32_t step = 200;
-        while (toRead > 0)
-        {
-            auto next = std::min(toRead, step);
-            toRead -= next;
-
-            BlockchainReadBatch batch;
-            for (auto id = readFrom; id < readFrom + next; ++id)
-            {
-                batch.requestCachedBlock(id);
-            }
-
-            readFrom += next;
-
-            auto res = readDatabase(batch);
-
-            std::map<uint32_t, CachedBlockInfo> sortedResult(res.getCachedBlocks().begin(),
-                                                             res.getCachedBlocks().end());
-            for (const auto &kv : sortedResult)
-            {
-                units.push_back(kv.second);
-            }
-            //    std::transform(sortedResult.begin(), sortedResult.end(), std::back_inserter(units),
-            //                   [&](const std::pair<uint32_t, CachedBlockInfo>& cb) { return pred(cb.second); });
-        }
-
-        return units;
+        return blockInfoColumn.alreadyGeneratedTransactions()[blockIndex];
     }
 
     std::vector<uint64_t> DatabaseBlockchainCache::getLastUnits(
@@ -1712,47 +2251,15 @@ namespace CryptoNote
         UseGenesis useGenesis,
         std::function<uint64_t(const CachedBlockInfo &)> pred) const
     {
-        assert(count <= std::numeric_limits<uint32_t>::max());
-
-        auto cachedUnits = getLastCachedUnits(blockIndex, count, useGenesis);
-
-        uint32_t availableUnits = blockIndex;
-        if (useGenesis)
-        {
-            availableUnits += 1;
-        }
-
-        assert(availableUnits >= cachedUnits.size());
-
-        if (availableUnits - cachedUnits.size() == 0)
-        {
-            std::vector<uint64_t> result;
-            result.reserve(cachedUnits.size());
-            for (const auto &unit : cachedUnits)
-            {
-                result.push_back(pred(unit));
-            }
-
-            return result;
-        }
-
-        assert(blockIndex + 1 >= cachedUnits.size());
-        uint32_t dbIndex = blockIndex - static_cast<uint32_t>(cachedUnits.size());
+        assert(blockIndex <= getTopBlockIndex());
 
-        assert(count >= cachedUnits.size());
-        size_t leftCount = count - cachedUnits.size();
+        const uint32_t startIndex = lastUnitsStartIndex(count, blockIndex, useGenesis);
 
-        auto dbUnits = getLastDbUnits(dbIndex, leftCount, useGenesis);
         std::vector<uint64_t> result;
-        result.reserve(dbUnits.size() + cachedUnits.size());
-        for (const auto &unit : dbUnits)
-        {
-            result.push_back(pred(unit));
-        }
 
-        for (const auto &unit : cachedUnits)
+        for (uint32_t index = startIndex; index <= blockIndex; index++)
         {
-            result.push_back(pred(unit));
+            result.push_back(pred(blockInfoColumn.get(index)));
         }
 
         return result;
@@ -1765,9 +2272,7 @@ namespace CryptoNote
             return getTopBlockHash();
         }
 
-        auto batch = BlockchainReadBatch().requestCachedBlock(blockIndex);
-        auto result = readDatabase(batch);
-        return result.getCachedBlocks().at(blockIndex).blockHash;
+        return blockInfoColumn.blockHash(blockIndex);
     }
 
     std::vector<Crypto::Hash> DatabaseBlockchainCache::getBlockHashes(uint32_t startIndex, size_t maxCount) const
@@ -1781,45 +2286,15 @@ namespace CryptoNote
             return {};
         }
 
-        BlockchainReadBatch request;
-        auto index = startIndex;
-        try
-        {
-            while (index != startIndex + count)
-            {
-                request.requestCachedBlock(index++);
-            }
-        }
-        catch (std::exception &e)
-        {
-            logger(Logging::TRACE) << "DatabaseBlockchainCache::getBlockHashes:request.requestCachedBlock: "
-                                   << e.what();
-        }
-
-        auto result = readDatabase(request);
-        logger(Logging::TRACE) << "DatabaseBlockchainCache::getBlockHashes:result.getCachedBlocks().size(): "
-                               << std::to_string(result.getCachedBlocks().size());
-        logger(Logging::TRACE) << "DatabaseBlockchainCache::getBlockHashes:count " << std::to_string(count);
-        if (!result.getCachedBlocks().empty())
-        {
-            assert(result.getCachedBlocks().size() == count);
+        std::vector<Crypto::Hash> hashes;
+        hashes.reserve(count);
 
-            std::vector<Crypto::Hash> hashes;
-            hashes.reserve(count);
-
-            std::map<uint32_t, CachedBlockInfo> sortedResult(result.getCachedBlocks().begin(),
-                                                             result.getCachedBlocks().end());
-
-            std::transform(sortedResult.begin(),
-                           sortedResult.end(),
-                           std::back_inserter(hashes),
-                           [](const std::pair<uint32_t, CachedBlockInfo> &cb) { return cb.second.blockHash; });
-            return hashes;
-        }
-        else
+        for (uint32_t index = startIndex; index < startIndex + count; index++)
         {
-            return {};
+            hashes.push_back(blockInfoColumn.blockHash(index));
         }
+
+        return hashes;
     }
 
     IBlockchainCache *DatabaseBlockchainCache::getParent() const
@@ -1903,7 +2378,7 @@ namespace CryptoNote
     bool DatabaseBlockchainCache::getTransactionGlobalIndexes(const Crypto::Hash &transactionHash,
                                                               std::vector<uint32_t> &globalIndexes) const
     {
-        auto batch = BlockchainReadBatch().requestCachedTransaction(transactionHash);
+        auto batch = BlockchainReadBatch(DB::formatOf(database)).requestCachedTransaction(transactionHash);
         auto result = database.read(batch);
         if (result)
         {
@@ -1931,7 +2406,7 @@ namespace CryptoNote
 
     uint32_t DatabaseBlockchainCache::getBlockIndexContainingTx(const Crypto::Hash &transactionHash) const
     {
-        auto batch = BlockchainReadBatch().requestCachedTransaction(transactionHash);
+        auto batch = BlockchainReadBatch(DB::formatOf(database)).requestCachedTransaction(transactionHash);
         auto result = readDatabase(batch);
         return result.getCachedTransactions().at(transactionHash).blockIndex;
     }
@@ -1967,7 +2442,7 @@ namespace CryptoNote
                                                      std::vector<BinaryArray> &foundTransactions,
                                                      std::vector<Crypto::Hash> &missedTransactions) const
     {
-        BlockchainReadBatch batch;
+        BlockchainReadBatch batch(DB::formatOf(database));
         for (auto &hash : transactions)
         {
             batch.requestCachedTransaction(hash);
@@ -2020,7 +2495,7 @@ namespace CryptoNote
 
     RawBlock DatabaseBlockchainCache::getBlockByIndex(uint32_t index) const
     {
-        auto batch = BlockchainReadBatch().requestRawBlock(index);
+        auto batch = BlockchainReadBatch(DB::formatOf(database)).requestRawBlock(index);
         auto res = readDatabase(batch);
         return std::move(res.getRawBlocks().at(index));
     }
@@ -2040,15 +2515,35 @@ namespace CryptoNote
                                                                          size_t count,
                                                                          uint32_t blockIndex) const
     {
-        auto batch = BlockchainReadBatch().requestKeyOutputGlobalIndexesCountForAmount(amount);
+        auto batch = BlockchainReadBatch(DB::formatOf(database)).requestKeyOutputGlobalIndexesCountForAmount(amount);
         auto result = readDatabase(batch);
         auto outputsCount = result.getKeyOutputGlobalIndexesCountForAmounts();
-        auto outputsToPick = std::min(static_cast<uint32_t>(count), outputsCount[amount]);
+
+        uint32_t uppperBlockIndex = 0;
+
+        /* Only select unlocked outputs. */
+        if (blockIndex >= CryptoNote::parameters::CRYPTONOTE_MINED_MONEY_UNLOCK_WINDOW_V2_HEIGHT
+                              + CryptoNote::parameters::CRYPTONOTE_MINED_MONEY_UNLOCK_WINDOW_V2)
+        {
+            uppperBlockIndex = blockIndex - CryptoNote::parameters::CRYPTONOTE_MINED_MONEY_UNLOCK_WINDOW_V2;
+        }
+        else if (blockIndex >= CryptoNote::parameters::CRYPTONOTE_MINED_MONEY_UNLOCK_WINDOW)
+        {
+            uppperBlockIndex = blockIndex - CryptoNote::parameters::CRYPTONOTE_MINED_MONEY_UNLOCK_WINDOW;
+        }
+
+        /* Every output below this is in an unlocked block, so only the unlock
+           time of the picked ones has to be checked */
+        const uint32_t unlockedOutputsCount = getUnlockedOutputsCount(amount, uppperBlockIndex, outputsCount[amount]);
+
+        auto outputsToPick = std::min(static_cast<uint32_t>(count), unlockedOutputsCount);
 
         std::vector<uint32_t> resultOuts;
         resultOuts.reserve(outputsToPick);
 
-        ShuffleGenerator<uint32_t> generator(outputsCount[amount]);
+        ShuffleGenerator<uint32_t> generator(unlockedOutputsCount);
+
+        const bool inColumn = unlockedOutputsCount <= keyOutputColumn.size(amount);
 
         while (outputsToPick)
         {
@@ -2060,7 +2555,6 @@ namespace CryptoNote
                 for (uint32_t i = 0; i < outputsToPick; ++i, globalIndexes.push_back(generator()))
                 {
                 }
-                // std::generate_n(std::back_inserter(globalIndexes), outputsToPick, generator);
             }
             catch (const SequenceEnded &)
             {
@@ -2068,42 +2562,45 @@ namespace CryptoNote
                 return resultOuts;
             }
 
-            std::vector<PackedOutIndex> outputs;
-            if (extractKeyOtputIndexes(amount,
-                                       Common::ArrayView<uint32_t>(globalIndexes.data(), globalIndexes.size()),
-                                       outputs)
-                != ExtractOutputKeysResult::SUCCESS)
-            {
-                logger(Logging::DEBUGGING) << "getRandomOutsByAmount: failed to extract key output indexes";
-                throw std::runtime_error("Invalid output index"); // TODO: make error code
-            }
+            std::vector<uint64_t> unlockTimes;
+            unlockTimes.reserve(globalIndexes.size());
 
-            std::vector<ExtendedTransactionInfo> transactions;
-            if (!requestExtendedTransactionInfos(outputs, database, transactions))
+            if (inColumn)
             {
-                logger(Logging::TRACE) << "getRandomOutsByAmount: requestExtendedTransactionInfos failed";
-                throw std::runtime_error("Error while requesting transactions"); // TODO: make error code
+                for (const auto globalIndex : globalIndexes)
+                {
+                    unlockTimes.push_back(keyOutputColumn.get(amount, globalIndex).unlockTime);
+                }
             }
+            else
+            {
+                BlockchainReadBatch outputsBatch(DB::formatOf(database));
 
-            assert(globalIndexes.size() == transactions.size());
+                for (const auto globalIndex : globalIndexes)
+                {
+                    outputsBatch.requestKeyOutputInfo(amount, globalIndex);
+                }
 
-            uint32_t uppperBlockIndex = 0;
+                const auto outputsResult = readDatabase(outputsBatch);
+                const auto &outputs = outputsResult.getKeyOutputInfo();
 
-            /* Only select unlocked outputs. */
-            if (blockIndex >= CryptoNote::parameters::CRYPTONOTE_MINED_MONEY_UNLOCK_WINDOW_V2_HEIGHT
-                                  + CryptoNote::parameters::CRYPTONOTE_MINED_MONEY_UNLOCK_WINDOW_V2)
-            {
-                uppperBlockIndex = blockIndex - CryptoNote::parameters::CRYPTONOTE_MINED_MONEY_UNLOCK_WINDOW_V2;
-            }
-            else if (blockIndex >= CryptoNote::parameters::CRYPTONOTE_MINED_MONEY_UNLOCK_WINDOW)
-            {
-                uppperBlockIndex = blockIndex - CryptoNote::parameters::CRYPTONOTE_MINED_MONEY_UNLOCK_WINDOW;
+                for (const auto globalIndex : globalIndexes)
+                {
+                    const auto it = outputs.find(std::make_pair(amount, globalIndex));
+
+                    if (it == outputs.end())
+                    {
+                        logger(Logging::DEBUGGING) << "getRandomOutsByAmount: failed to read key output info";
+                        throw std::runtime_error("Invalid output index"); // TODO: make error code
+                    }
+
+                    unlockTimes.push_back(it->second.unlockTime);
+                }
             }
 
-            for (size_t i = 0; i < transactions.size(); ++i)
+            for (size_t i = 0; i < globalIndexes.size(); i++)
             {
-                if (!isTransactionSpendTimeUnlocked(transactions[i].unlockTime, blockIndex)
-                    || transactions[i].blockIndex > uppperBlockIndex)
+                if (!isTransactionSpendTimeUnlocked(unlockTimes[i], blockIndex))
                 {
                     continue;
                 }
@@ -2116,6 +2613,78 @@ namespace CryptoNote
         return resultOuts;
     }
 
+    uint32_t DatabaseBlockchainCache::getUnlockedOutputsCount(
+        Amount amount,
+        uint32_t upperBlockIndex,
+        uint32_t outputsCount) const
+    {
+        /* The outputs of an amount are numbered in the order they are added to
+           the chain, so the ones in blocks up to upperBlockIndex come first.
+           Binary search for the first one which isn't, starting from the last
+           answer, as only the outputs of the last few blocks are past it. */
+        uint32_t low = 0;
+        uint32_t high = outputsCount;
+
+        {
+            std::scoped_lock lock(lazyStateMutex);
+
+            const auto it = unlockedOutputsCounts.find(amount);
+
+            if (it != unlockedOutputsCounts.end())
+            {
+                const auto [cachedBlockIndex, cachedCount] = it->second;
+
+                if (cachedBlockIndex <= upperBlockIndex)
+                {
+                    low = std::min(cachedCount, outputsCount);
+                }
+                else
+                {
+                    high = std::min(cachedCount, outputsCount);
+                }
+            }
+        }
+
+        while (low < high)
+        {
+            uint32_t middle = low + (high - low) / 2;
+
+            uint32_t outputBlockIndex;
+
+            if (middle < keyOutputColumn.size(amount))
+            {
+                outputBlockIndex = keyOutputColumn.get(amount, middle).blockIndex;
+            }
+            else
+            {
+                std::vector<PackedOutIndex> packedOuts;
+
+                if (!requestPackedOutputs(amount, {&middle, 1}, database, packedOuts))
+                {
+                    logger(Logging::DEBUGGING) << "getUnlockedOutputsCount: failed to extract key output indexes";
+                    throw std::runtime_error("Invalid output index"); // TODO: make error code
+                }
+
+                outputBlockIndex = packedOuts.front().blockIndex;
+            }
+
+            if (outputBlockIndex <= upperBlockIndex)
+            {
+                low = middle + 1;
+            }
+            else
+            {
+                high = middle;
+            }
+        }
+
+        std::scoped_lock lock(lazyStateMutex);
+
+        unlockedOutputsCounts[amount] = {upperBlockIndex, low};
+
+        return low;
+    }
+
     ExtractOutputKeysResult DatabaseBlockchainCache::extractKeyOutputs(
         uint64_t amount,
         uint32_t blockIndex,
@@ -2124,7 +2693,7 @@ namespace CryptoNote
                                               PackedOutIndex index,
                                               uint32_t globalIndex)> callback) const
     {
-        BlockchainReadBatch batch;
+        BlockchainReadBatch batch(DB::formatOf(database));
         for (auto it = globalIndexes.begin(); it != globalIndexes.end(); ++it)
         {
             batch.requestKeyOutputInfo(amount, *it);
@@ -2160,11 +2729,11 @@ namespace CryptoNote
     std::vector<Crypto::Hash> DatabaseBlockchainCache::getTransactionHashesByPaymentId(
         const Crypto::Hash &paymentId) const
     {
-        auto countBatch = BlockchainReadBatch().requestTransactionCountByPaymentId(paymentId);
+        auto countBatch = BlockchainReadBatch(DB::formatOf(database)).requestTransactionCountByPaymentId(paymentId);
         uint32_t transactionsCountByPaymentId =
             readDatabase(countBatch).getTransactionCountByPaymentIds().at(paymentId);
 
-        BlockchainReadBatch transactionBatch;
+        BlockchainReadBatch transactionBatch(DB::formatOf(database));
         for (uint32_t i = 0; i < transactionsCountByPaymentId; ++i)
         {
             transactionBatch.requestTransactionHashByPaymentId(paymentId, i);
@@ -2190,7 +2759,7 @@ namespace CryptoNote
             return blockHashes;
         }
 
-        BlockchainReadBatch batch;
+        BlockchainReadBatch batch(DB::formatOf(database));
         for (uint64_t timestamp = timestampBegin; timestamp < timestampBegin + static_cast<uint64_t>(secondsCount);
              ++timestamp)
         {
@@ -2231,7 +2800,7 @@ namespace CryptoNote
                not taking too many */
             uint64_t endHeight = startHeight + (blockCount * 2);
 
-            auto blockBatch = BlockchainReadBatch().requestRawBlocks(startHeight, endHeight);
+            auto blockBatch = BlockchainReadBatch(DB::formatOf(database)).requestRawBlocks(startHeight, endHeight);
             const auto rawBlocks = readDatabase(blockBatch).getRawBlocks();
 
             while (orderedBlocks.size() < blockCount && height < startHeight + rawBlocks.size())
@@ -2255,7 +2824,7 @@ namespace CryptoNote
     std::vector<RawBlock> DatabaseBlockchainCache::getBlocksByHeight(const uint64_t startHeight,
                                                                      uint64_t endHeight) const
     {
-        auto blockBatch = BlockchainReadBatch().requestRawBlocks(startHeight, endHeight);
+        auto blockBatch = BlockchainReadBatch(DB::formatOf(database)).requestRawBlocks(startHeight, endHeight);
 
         /* Get the info from the DB */
         auto rawBlocks = readDatabase(blockBatch).getRawBlocks();
@@ -2271,10 +2840,86 @@ namespace CryptoNote
         return orderedBlocks;
     }
 
+    std::vector<WalletTypes::WalletBlockInfo>
+        DatabaseBlockchainCache::getWalletBlockInfos(const uint64_t startHeight, uint64_t endHeight) const
+    {
+        endHeight = std::min(endHeight, static_cast<uint64_t>(getBlockCount()));
+
+        if (startHeight >= endHeight)
+        {
+            return {};
+        }
+
+        static const std::unordered_map<uint32_t, WalletTypes::WalletBlockInfo> noStoredBlocks;
+
+        std::optional<BlockchainReadResult> walletResult;
+
+        if (storeWalletScanRecords)
+        {
+            auto walletBatch = BlockchainReadBatch(DB::formatOf(database)).requestWalletBlocks(startHeight, endHeight);
+            walletResult.emplace(readDatabase(walletBatch));
+        }
+
+        const auto &storedBlocks = walletResult ? walletResult->getWalletBlocks() : noStoredBlocks;
+
+        /* Blocks stored before the records were are built from the raw blocks */
+        std::unordered_map<uint64_t, WalletTypes::WalletBlockInfo> builtBlocks;
+
+        if (storedBlocks.size() != endHeight - startHeight)
+        {
+            BlockchainReadBatch rawBatch(DB::formatOf(database));
+
+            std::vector<uint32_t> missingHeights;
+
+            for (uint64_t height = startHeight; height < endHeight; height++)
+            {
+                if (storedBlocks.count(static_cast<uint32_t>(height)) == 0)
+                {
+                    missingHeights.push_back(static_cast<uint32_t>(height));
+                    rawBatch.requestRawBlock(static_cast<uint32_t>(height));
+                }
+            }
+
+            const auto rawResult = readDatabase(rawBatch);
+
+            std::vector<RawBlock> rawBlocks;
+            rawBlocks.reserve(missingHeights.size());
+
+            for (const auto height : missingHeights)
+            {
+                rawBlocks.push_back(rawResult.getRawBlocks().at(height));
+            }
+
+            for (auto &walletBlock : Utils::getWalletBlockInfos(rawBlocks, *this))
+            {
+                builtBlocks.emplace(walletBlock.blockHeight, std::move(walletBlock));
+            }
+        }
+
+        std::vector<WalletTypes::WalletBlockInfo> walletBlocks;
+        walletBlocks.reserve(endHeight - startHeight);
+
+        for (uint64_t height = startHeight; height < endHeight; height++)
+        {
+            const auto it = storedBlocks.find(static_cast<uint32_t>(height));
+
+            if (it != storedBlocks.end())
+            {
+                walletBlocks.push_back(it->second);
+            }
+            else
+            {
+                walletBlocks.push_back(std::move(builtBlocks.at(height)));
+            }
+        }
+
+        return walletBlocks;
+    }
+
     std::unordered_map<Crypto::Hash, std::vector<uint64_t>> DatabaseBlockchainCache::getGlobalIndexes(
         const std::vector<Crypto::Hash> transactionHashes) const
     {
-        auto txBatch = BlockchainReadBatch().requestCachedTransactions(transactionHashes);
+        auto txBatch = BlockchainReadBatch(DB::formatOf(database)).requestCachedTransactions(transactionHashes);
 
         database.read(txBatch);
 
@@ -2295,20 +2940,14 @@ namespace CryptoNote
     {
         assert(blockIndex <= getTopBlockIndex());
 
-        auto batch = BlockchainReadBatch()
+        auto batch = BlockchainReadBatch(DB::formatOf(database))
                          .requestRawBlock(blockIndex)
-                         .requestCachedBlock(blockIndex)
                          .requestSpentKeyImagesByBlock(blockIndex);
 
-        if (blockIndex > 0)
-        {
-            batch.requestCachedBlock(blockIndex - 1);
-        }
-
         auto dbResult = readDatabase(batch);
-        const CachedBlockInfo &blockInfo = dbResult.getCachedBlocks().at(blockIndex);
-        const CachedBlockInfo &previousBlockInfo =
-            blockIndex > 0 ? dbResult.getCachedBlocks().at(blockIndex - 1) : NULL_CACHED_BLOCK_INFO;
+        const CachedBlockInfo blockInfo = getCachedBlockInfo(blockIndex);
+        const CachedBlockInfo previousBlockInfo =
+            blockIndex > 0 ? getCachedBlockInfo(blockIndex - 1) : NULL_CACHED_BLOCK_INFO;
 
         ExtendedPushedBlockInfo extendedInfo;
 
@@ -2374,7 +3013,7 @@ namespace CryptoNote
         uint64_t baseTransactionSize = getObjectBinarySize(genesisBlock.getBlock().baseTransaction);
         assert(baseTransactionSize < std::numeric_limits<uint32_t>::max());
 
-        BlockchainWriteBatch batch;
+        BlockchainWriteBatch batch(DB::formatOf(database));
 
         CachedBlockInfo blockInfo {genesisBlock.getBlockHash(),
                                    genesisBlock.getBlock().timestamp,
@@ -2386,7 +3025,16 @@ namespace CryptoNote
         auto baseTransaction = genesisBlock.getBlock().baseTransaction;
         auto cachedBaseTransaction = CachedTransaction {std::move(baseTransaction)};
 
-        pushTransaction(cachedBaseTransaction, 0, 0, batch);
+        std::vector<std::pair<Amount, KeyOutputColumn::Entry>> keyOutputs;
+
+        const auto globalIndexes = pushTransaction(cachedBaseTransaction, 0, 0, batch, keyOutputs);
+
+        if (storeWalletScanRecords)
+        {
+            auto walletBlock = Utils::getWalletBlockInfo(genesisBlock, cachedBaseTransaction, {});
+            setGlobalIndexes(*walletBlock.coinbaseTransaction, globalIndexes);
+            batch.insertWalletBlock(0, walletBlock);
+        }
 
         batch.insertCachedBlock(blockInfo, 0, {cachedBaseTransaction.getTransactionHash()});
         batch.insertRawBlock(0, {toBinaryArray(genesisBlock.getBlock()), {}});
@@ -2401,7 +3049,14 @@ namespace CryptoNote
 
         topBlockHash = genesisBlock.getBlockHash();
 
-        unitsCache.push_back(blockInfo);
+        blockInfoColumn.push(blockInfo);
+
+        for (const auto &[amount, keyOutput] : keyOutputs)
+        {
+            keyOutputColumn.push(amount, keyOutput);
+        }
+
+        keyOutputColumn.flush(0, genesisBlock.getBlockHash());
     }
 
 } // namespace CryptoNote
@@ -20,14 +20,19 @@
 
 #include "Currency.h"
 #include "IBlockchainCache.h"
+#include "common/Math.h"
 #include "common/StringView.h"
 #include "cryptonotecore/UpgradeManager.h"
 
 #include <IDataBase.h>
+#include <cryptonotecore/BlockInfoColumn.h>
 #include <cryptonotecore/BlockchainReadBatch.h>
 #include <cryptonotecore/BlockchainWriteBatch.h>
 #include <cryptonotecore/DatabaseCacheData.h>
 #include <cryptonotecore/IBlockchainCacheFactory.h>
+#include <cryptonotecore/KeyOutputColumn.h>
+#include <cryptonotecore/SpentKeyImageIndex.h>
+#include <mutex>
 
 namespace CryptoNote
 {
@@ -52,7 +57,9 @@ namespace CryptoNote
             const Currency &currency,
             IDataBase &dataBase,
             IBlockchainCacheFactory &blockchainCacheFactory,
-            std::shared_ptr<Logging::ILogger> logger);
+            std::shared_ptr<Logging::ILogger> logger,
+            SpentKeyImageIndex::Mode spentKeyImageIndexMode = SpentKeyImageIndex::Mode::Full,
+            bool storeWalletScanRecords = false);
 
         static bool checkDBSchemeVersion(IDataBase &dataBase, std::shared_ptr<Logging::ILogger> logger);
 
@@ -125,6 +132,8 @@ namespace CryptoNote
 
         std::vector<uint64_t> getLastBlocksSizes(size_t count, uint32_t blockIndex, UseGenesis) const override;
 
+        uint64_t getLastBlocksSizesMedian(uint32_t blockIndex) const override;
+
         std::vector<uint64_t>
             getLastCumulativeDifficulties(size_t count, uint32_t blockIndex, UseGenesis) const override;
 
@@ -217,6 +226,9 @@ namespace CryptoNote
         virtual std::vector<uint32_t>
             getRandomOutsByAmount(uint64_t amount, size_t count, uint32_t blockIndex) const override;
 
+        /* How many outputs of the amount are in blocks up to upperBlockIndex */
+        uint32_t getUnlockedOutputsCount(Amount amount, uint32_t upperBlockIndex, uint32_t outputsCount) const;
+
         virtual ExtractOutputKeysResult extractKeyOutputs(
             uint64_t amount,
             uint32_t blockIndex,
@@ -236,6 +248,9 @@ namespace CryptoNote
         virtual std::vector<RawBlock>
             getNonEmptyBlocks(const uint64_t startHeight, const size_t blockCount) const override;
 
+        virtual std::vector<WalletTypes::WalletBlockInfo>
+            getWalletBlockInfos(const uint64_t startHeight, const uint64_t endHeight) const override;
+
       private:
         const Currency &currency;
 
@@ -257,9 +272,56 @@ namespace CryptoNote
 
         Logging::LoggerRef logger;
 
-        std::deque<CachedBlockInfo> unitsCache;
+        /* The CachedBlockInfo of every block, so they can be read without
+           going to the database. Loaded on startup, and kept in sync with
+           the database when blocks are pushed or removed. Pushing may remap
+           it, which Core only does with its chain lock held exclusively, so
+           readers must hold the chain lock too. */
+        BlockInfoColumn blockInfoColumn;
+
+        void loadBlockInfoColumn();
+
+        /* The public key, unlock time and block index of every key output,
+           by amount and global index. Loaded on startup, and kept in sync
+           with the database like the block info. */
+        KeyOutputColumn keyOutputColumn;
+
+        void loadKeyOutputColumn();
+
+        /* The sizes of the last rewardBlocksWindow() blocks up to
+           blockSizesWindowIndex, slid along as blocks are pushed */
+        mutable Common::MedianWindow<uint64_t> blockSizesWindow;
+
+        mutable boost::optional<uint32_t> blockSizesWindowIndex;
+
+        /* The difficulty for the block after the first block index, since
+           it is asked for over and over while mining */
+        mutable boost::optional<std::pair<uint32_t, uint64_t>> nextBlockDifficulty;
 
-        const size_t unitsCacheSize = 1000;
+        /* For each amount, how many of its outputs were in blocks up to the
+           block index when last asked */
+        mutable std::unordered_map<Amount, std::pair<uint32_t, uint32_t>> unlockedOutputsCounts;
+
+        /* Guards the members above which are filled in by const methods, as
+           those can be called from many threads at once, and not all of them
+           hold Core's chain lock. So pushing, popping and splitting take it
+           too when they update or reset them. */
+        mutable std::mutex lazyStateMutex;
+
+        /* Forgets the top block and everything filled in from it */
+        void invalidateLazyState();
+
+        /* Answers double spend checks without going to the database. Loaded
+           on startup, and kept in sync with the spent key images in the
+           database when blocks are pushed or removed. */
+        SpentKeyImageIndex spentKeyImageIndex;
+
+        /* Whether a wallet scan record is written for each pushed block, and
+           wallet sync requests served from them. Blocks without a record are
+           built from the raw block. */
+        const bool storeWalletScanRecords;
+
+        void loadSpentKeyImageIndex();
 
         struct ExtendedPushedBlockInfo;
 
@@ -273,11 +335,15 @@ namespace CryptoNote
 
         void addSpentKeyImage(const Crypto::KeyImage &keyImage, uint32_t blockIndex);
 
-        void pushTransaction(
+        /* Returns the global indexes of the outputs. The key outputs are
+           added to keyOutputs, to be pushed to the keyOutputColumn once the
+           batch is written. */
+        std::vector<uint32_t> pushTransaction(
             const CachedTransaction &cachedTransaction,
             uint32_t blockIndex,
             uint16_t transactionBlockIndex,
-            BlockchainWriteBatch &batch);
+            BlockchainWriteBatch &batch,
+            std::vector<std::pair<Amount, KeyOutputColumn::Entry>> &keyOutputs);
 
         uint32_t insertKeyOutputToGlobalIndex(
             uint64_t amount,
@@ -336,9 +402,5 @@ namespace CryptoNote
         uint8_t getBlockMajorVersionForHeight(uint32_t height) const;
 
         uint64_t getCachedTransactionsCount() const;
-
-        std::vector<CachedBlockInfo> getLastCachedUnits(uint32_t blockIndex, size_t count, UseGenesis useGenesis) const;
-
-        std::vector<CachedBlockInfo> getLastDbUnits(uint32_t blockIndex, size_t count, UseGenesis useGenesis) const;
     };
 } // namespace CryptoNote
@@ -13,9 +13,13 @@ namespace CryptoNote
 {
     DatabaseBlockchainCacheFactory::DatabaseBlockchainCacheFactory(
         IDataBase &database,
-        const std::shared_ptr<Logging::ILogger> &logger) :
+        const std::shared_ptr<Logging::ILogger> &logger,
+        SpentKeyImageIndex::Mode spentKeyImageIndexMode,
+        bool storeWalletScanRecords) :
         database(database),
-        logger(logger)
+        logger(logger),
+        spentKeyImageIndexMode(spentKeyImageIndexMode),
+        storeWalletScanRecords(storeWalletScanRecords)
     {
     }
 
@@ -24,7 +28,8 @@ namespace CryptoNote
     std::unique_ptr<IBlockchainCache>
         DatabaseBlockchainCacheFactory::createRootBlockchainCache(const Currency &currency)
     {
-        return std::make_unique<DatabaseBlockchainCache>(currency, database, *this, logger);
+        return std::make_unique<DatabaseBlockchainCache>(
+            currency, database, *this, logger, spentKeyImageIndexMode, storeWalletScanRecords);
     }
 
     std::unique_ptr<IBlockchainCache> DatabaseBlockchainCacheFactory::createBlockchainCache(
@@ -7,6 +7,7 @@
 #pragma once
 
 #include "IBlockchainCacheFactory.h"
+#include "SpentKeyImageIndex.h"
 
 #include <logging/LoggerMessage.h>
 
@@ -17,7 +18,11 @@ namespace CryptoNote
     class DatabaseBlockchainCacheFactory : public IBlockchainCacheFactory
     {
       public:
-        explicit DatabaseBlockchainCacheFactory(IDataBase &database, const std::shared_ptr<Logging::ILogger> &logger);
+        explicit DatabaseBlockchainCacheFactory(
+            IDataBase &database,
+            const std::shared_ptr<Logging::ILogger> &logger,
+            SpentKeyImageIndex::Mode spentKeyImageIndexMode = SpentKeyImageIndex::Mode::Full,
+            bool storeWalletScanRecords = false);
 
         virtual ~DatabaseBlockchainCacheFactory();
 
@@ -30,6 +35,10 @@ namespace CryptoNote
         IDataBase &database;
 
         std::shared_ptr<Logging::ILogger> logger;
+
+        SpentKeyImageIndex::Mode spentKeyImageIndexMode;
+
+        bool storeWalletScanRecords;
     };
 
 } // namespace CryptoNote
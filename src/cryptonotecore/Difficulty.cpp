@@ -13,7 +13,7 @@
 // LWMA-2 difficulty algorithm 
 // Copyright (c) 2017-2018 Zawy, MIT License
 // https://github.com/zawy12/difficulty-algorithms/issues/3
-uint64_t nextDifficulty(std::vector<uint64_t> timestamps, std::vector<uint64_t> cumulativeDifficulties, const uint64_t blockHeight)
+uint64_t nextDifficulty(const std::vector<uint64_t> &timestamps, const std::vector<uint64_t> &cumulativeDifficulties, const uint64_t blockHeight)
 {
     int64_t T = CryptoNote::parameters::DIFFICULTY_TARGET;
 
@@ -7,4 +7,4 @@
 #include <stdint.h>
 #include <vector>
 
-uint64_t nextDifficulty(std::vector<uint64_t> timestamps, std::vector<uint64_t> cumulativeDifficulties, const uint64_t blockHeight);
\ No newline at end of file
+uint64_t nextDifficulty(const std::vector<uint64_t> &timestamps, const std::vector<uint64_t> &cumulativeDifficulties, const uint64_t blockHeight);
\ No newline at end of file
@@ -12,6 +12,7 @@
 #include "cryptonotecore/TransactionValidatiorState.h"
 
 #include <CryptoNote.h>
+#include <WalletTypes.h>
 #include <unordered_map>
 #include <vector>
 
@@ -185,6 +186,10 @@ namespace CryptoNote
 
         virtual std::vector<uint64_t> getLastBlocksSizes(size_t count, uint32_t blockIndex, UseGenesis) const = 0;
 
+        /* Median of the sizes of the last rewardBlocksWindow() blocks up to
+           blockIndex, counting the genesis block */
+        virtual uint64_t getLastBlocksSizesMedian(uint32_t blockIndex) const = 0;
+
         virtual std::vector<uint64_t>
             getLastCumulativeDifficulties(size_t count, uint32_t blockIndex, UseGenesis) const = 0;
 
@@ -273,6 +278,11 @@ namespace CryptoNote
         virtual std::vector<RawBlock> getBlocksByHeight(const uint64_t startHeight, uint64_t endHeight) const = 0;
 
         virtual std::vector<RawBlock> getNonEmptyBlocks(const uint64_t startHeight, const size_t blockCount) const = 0;
+
+        /* The records wallets scan for the blocks from startHeight up to, but
+           not including, endHeight, with the global indexes of the outputs */
+        virtual std::vector<WalletTypes::WalletBlockInfo>
+            getWalletBlockInfos(const uint64_t startHeight, const uint64_t endHeight) const = 0;
     };
 
 } // namespace CryptoNote
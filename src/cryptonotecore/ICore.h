@@ -18,7 +18,9 @@
 #include "MessageQueue.h"
 
 #include <CryptoNote.h>
+#include <functional>
 #include <optional>
+#include <shared_mutex>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
@@ -140,6 +142,19 @@ namespace CryptoNote
 
         virtual std::error_code addBlock(RawBlock &&rawBlock) = 0;
 
+        /*!
+         * \brief addBlocks Adds a contiguous run of blocks, in order. The stateless part of validating
+         *        the upcoming blocks is done on worker threads while the current block is committed.
+         * \param cachedBlocks The blocks to add, must outlive the call
+         * \param rawBlocks The raw blocks, in the same order as cachedBlocks
+         * \param blockProcessed Called with the result of each block once committed. Return false to stop
+         *        adding the remaining blocks.
+         */
+        virtual void addBlocks(
+            const std::vector<CachedBlock> &cachedBlocks,
+            std::vector<RawBlock> &&rawBlocks,
+            const std::function<bool(const CachedBlock &, const std::error_code &)> &blockProcessed) = 0;
+
         virtual std::error_code submitBlock(const BinaryArray &rawBlockTemplate) = 0;
 
         virtual bool getTransactionGlobalIndexes(
@@ -159,8 +174,15 @@ namespace CryptoNote
 
         virtual std::tuple<bool, std::string> addTransactionToPool(const BinaryArray &transactionBinaryArray) = 0;
 
+        /* Adds a batch of transactions, such as those relayed by a peer. The
+           checks which don't depend on the pool are done for all of them in
+           parallel. Returns whether each one was added. */
+        virtual std::vector<bool> addTransactionsToPool(const std::vector<BinaryArray> &transactions) = 0;
+
         virtual std::vector<Crypto::Hash> getPoolTransactionHashes() const = 0;
 
+        /* Safe to call without any lock held, the transaction is looked up
+           and copied in one step */
         virtual std::tuple<bool, CryptoNote::BinaryArray>
             getPoolTransaction(const Crypto::Hash &transactionHash) const = 0;
 
@@ -214,5 +236,13 @@ namespace CryptoNote
             const bool performExpensiveValidation) = 0;
 
         virtual void rewind(const uint64_t blockIndex) = 0;
+
+        /* Stops blocks being added or popped while it is held, so a set of
+           reads all see the same chain. Any number of threads can hold it at
+           once. It must not be held by a thread which adds blocks, or waits
+           on one which does. A block being added waits for every holder, and
+           holds up any new ones, so only hold it while reading the chain,
+           not while serializing or sending the results. */
+        virtual std::shared_lock<std::shared_mutex> lockChainForReading() const = 0;
     };
 } // namespace CryptoNote
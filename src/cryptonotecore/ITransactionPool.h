@@ -7,6 +7,7 @@
 #pragma once
 
 #include "CachedTransaction.h"
+#include "PreparedBlock.h"
 
 namespace CryptoNote
 {
@@ -17,12 +18,18 @@ namespace CryptoNote
       public:
         virtual ~ITransactionPool() {};
 
-        virtual bool pushTransaction(CachedTransaction &&tx, TransactionValidatorState &&transactionState) = 0;
+        virtual bool pushTransaction(
+            CachedTransaction &&tx,
+            TransactionValidatorState &&transactionState,
+            PreparedTransactionChecks &&verifiedChecks) = 0;
 
         virtual const CachedTransaction &getTransaction(const Crypto::Hash &hash) const = 0;
 
         virtual const std::optional<CachedTransaction> tryGetTransaction(const Crypto::Hash &hash) const = 0;
 
+        /* The checks done when the transaction was accepted into the pool */
+        virtual std::optional<PreparedTransactionChecks> tryGetTransactionChecks(const Crypto::Hash &hash) const = 0;
+
         virtual bool removeTransaction(const Crypto::Hash &hash) = 0;
 
         virtual size_t getFusionTransactionCount() const = 0;
@@ -0,0 +1,380 @@
+// Copyright (c) 2018-2024, The DeroGold Developers
+//
+// Please see the included LICENSE file for more information.
+
+#include "KeyOutputColumn.h"
+
+#include <algorithm>
+#include <common/FileSystemShim.h>
+#include <common/StringTools.h>
+#include <fstream>
+
+namespace CryptoNote
+{
+    void KeyOutputColumn::open(const std::string &directory)
+    {
+        std::scoped_lock lock(m_mutex);
+
+        m_directory = directory;
+
+        fs::create_directories(directory);
+
+        loadManifest();
+
+        /* Anything pushed after the last flush may only be partly on disk */
+        for (auto it = m_amounts.begin(); it != m_amounts.end();)
+        {
+            auto &[amount, info] = *it;
+
+            auto &file = this->file(amount);
+
+            if (file.size() < info.size)
+            {
+                /* Shouldn't happen, the flush synced it. Let the owner load
+                   the amount again. */
+                file.clear();
+                info.size = 0;
+            }
+
+            while (file.size() > info.size)
+            {
+                file.pop_back();
+            }
+
+            if (info.size == 0)
+            {
+                m_openFiles.erase(amount);
+                fs::remove(filePath(amount));
+                it = m_amounts.erase(it);
+                continue;
+            }
+
+            info.lastBlockIndex = file.back().blockIndex;
+
+            ++it;
+        }
+    }
+
+    void KeyOutputColumn::loadManifest()
+    {
+        m_amounts.clear();
+        m_flushedBlock.reset();
+
+        std::ifstream manifest(manifestPath());
+
+        std::string blockHashStr;
+        uint32_t blockIndex;
+        Crypto::Hash blockHash;
+
+        if (manifest >> blockIndex >> blockHashStr && Common::podFromHex(blockHashStr, blockHash))
+        {
+            IBlockchainCache::Amount amount;
+            uint32_t size;
+
+            while (manifest >> amount >> size)
+            {
+                m_amounts[amount].size = size;
+            }
+
+            if (manifest.eof())
+            {
+                m_flushedBlock = {blockIndex, blockHash};
+            }
+            else
+            {
+                m_amounts.clear();
+            }
+        }
+
+        /* Without a complete manifest nothing can be trusted */
+        for (const auto &item : fs::directory_iterator(m_directory))
+        {
+            if (item.path().extension() != ".bin")
+            {
+                continue;
+            }
+
+            try
+            {
+                if (m_amounts.count(std::stoull(item.path().stem().string())) != 0)
+                {
+                    continue;
+                }
+            }
+            catch (const std::exception &)
+            {
+                /* Not one of ours */
+                continue;
+            }
+
+            fs::remove(item.path());
+        }
+    }
+
+    Common::FileMappedVector<KeyOutputColumn::Entry> &KeyOutputColumn::file(IBlockchainCache::Amount amount) const
+    {
+        auto it = m_openFiles.find(amount);
+
+        if (it == m_openFiles.end())
+        {
+            if (m_openFiles.size() >= MAX_OPEN_FILES)
+            {
+                const auto leastUsed = std::min_element(
+                    m_openFiles.begin(),
+                    m_openFiles.end(),
+                    [](const auto &a, const auto &b) { return a.second.lastUsed < b.second.lastUsed; });
+
+                /* Synced before it's closed, so a later flush() doesn't
+                   need to open it again */
+                leastUsed->second.file->flush();
+                leastUsed->second.file->close();
+
+                m_openFiles.erase(leastUsed);
+            }
+
+            auto file = std::make_unique<Common::FileMappedVector<Entry>>();
+            file->open(filePath(amount));
+
+            /* Syncing every push would cost more than the database write */
+            file->setAutoFlush(false);
+
+            it = m_openFiles.try_emplace(amount).first;
+            it->second.file = std::move(file);
+        }
+
+        it->second.lastUsed = ++m_useCounter;
+
+        return *it->second.file;
+    }
+
+    std::string KeyOutputColumn::filePath(IBlockchainCache::Amount amount) const
+    {
+        return m_directory + "/" + std::to_string(amount) + ".bin";
+    }
+
+    std::string KeyOutputColumn::manifestPath() const
+    {
+        return m_directory + "/flushed";
+    }
+
+    void KeyOutputColumn::close()
+    {
+        std::scoped_lock lock(m_mutex);
+
+        for (auto &[amount, openFile] : m_openFiles)
+        {
+            openFile.file->close();
+        }
+
+        m_openFiles.clear();
+        m_amounts.clear();
+        m_dirty.clear();
+    }
+
+    std::optional<std::pair<uint32_t, Crypto::Hash>> KeyOutputColumn::flushedBlock() const
+    {
+        std::shared_lock lock(m_mutex);
+
+        return m_flushedBlock;
+    }
+
+    std::vector<IBlockchainCache::Amount> KeyOutputColumn::amounts() const
+    {
+        std::shared_lock lock(m_mutex);
+
+        std::vector<IBlockchainCache::Amount> amounts;
+        amounts.reserve(m_amounts.size());
+
+        for (const auto &[amount, info] : m_amounts)
+        {
+            amounts.push_back(amount);
+        }
+
+        return amounts;
+    }
+
+    uint32_t KeyOutputColumn::size(IBlockchainCache::Amount amount) const
+    {
+        std::shared_lock lock(m_mutex);
+
+        const auto it = m_amounts.find(amount);
+
+        return it != m_amounts.end() ? it->second.size : 0;
+    }
+
+    KeyOutputColumn::Entry KeyOutputColumn::get(IBlockchainCache::Amount amount, uint32_t globalIndex) const
+    {
+        const auto checkInColumn = [&]() {
+            const auto it = m_amounts.find(amount);
+
+            if (it == m_amounts.end() || globalIndex >= it->second.size)
+            {
+                throw std::out_of_range("Key output " + std::to_string(globalIndex) + " of amount "
+                                        + std::to_string(amount) + " is not in the column");
+            }
+        };
+
+        {
+            std::shared_lock lock(m_mutex);
+
+            checkInColumn();
+
+            if (const auto it = m_openFiles.find(amount); it != m_openFiles.end())
+            {
+                it->second.lastUsed = ++m_useCounter;
+
+                return (*it->second.file)[globalIndex];
+            }
+        }
+
+        /* Mapping the file changes m_openFiles, and may unmap another file
+           someone is reading */
+        std::unique_lock lock(m_mutex);
+
+        /* May have been truncated while the lock was let go */
+        checkInColumn();
+
+        return file(amount)[globalIndex];
+    }
+
+    void KeyOutputColumn::reserve(IBlockchainCache::Amount amount, uint32_t size)
+    {
+        std::scoped_lock lock(m_mutex);
+
+        file(amount).reserve(size);
+    }
+
+    void KeyOutputColumn::push(IBlockchainCache::Amount amount, const Entry &entry)
+    {
+        std::scoped_lock lock(m_mutex);
+
+        file(amount).push_back(entry);
+
+        auto &info = m_amounts[amount];
+        info.size++;
+        info.lastBlockIndex = entry.blockIndex;
+
+        m_dirty.insert(amount);
+    }
+
+    template<typename F> void KeyOutputColumn::popWhile(IBlockchainCache::Amount amount, F &&pop)
+    {
+        auto &info = m_amounts.at(amount);
+        auto &file = this->file(amount);
+
+        /* pop_back() just moves the end, unlike erase(), which rewrites the file */
+        while (!file.empty() && pop(file.back(), file.size()))
+        {
+            file.pop_back();
+        }
+
+        info.size = static_cast<uint32_t>(file.size());
+
+        if (!file.empty())
+        {
+            info.lastBlockIndex = file.back().blockIndex;
+        }
+
+        m_dirty.insert(amount);
+    }
+
+    void KeyOutputColumn::truncate(IBlockchainCache::Amount amount, uint32_t size)
+    {
+        std::scoped_lock lock(m_mutex);
+
+        const auto it = m_amounts.find(amount);
+
+        if (it == m_amounts.end() || it->second.size <= size)
+        {
+            return;
+        }
+
+        popWhile(amount, [size](const Entry &, const uint64_t fileSize) { return fileSize > size; });
+    }
+
+    void KeyOutputColumn::truncateBlocks(uint32_t blockIndex)
+    {
+        std::scoped_lock lock(m_mutex);
+
+        /* The outputs of an amount are in chain order, so the ones to remove
+           are all at the end, and only amounts with an output in the removed
+           blocks have to be opened */
+        for (const auto &[amount, info] : m_amounts)
+        {
+            if (info.size != 0 && info.lastBlockIndex >= blockIndex)
+            {
+                popWhile(amount, [blockIndex](const Entry &entry, const uint64_t) {
+                    return entry.blockIndex >= blockIndex;
+                });
+            }
+        }
+    }
+
+    void KeyOutputColumn::clear()
+    {
+        std::scoped_lock lock(m_mutex);
+
+        for (auto &[amount, openFile] : m_openFiles)
+        {
+            openFile.file->close();
+        }
+
+        m_openFiles.clear();
+
+        for (const auto &[amount, info] : m_amounts)
+        {
+            fs::remove(filePath(amount));
+        }
+
+        m_amounts.clear();
+        m_dirty.clear();
+
+        fs::remove(manifestPath());
+        m_flushedBlock.reset();
+    }
+
+    void KeyOutputColumn::flush(uint32_t blockIndex, const Crypto::Hash &blockHash)
+    {
+        std::scoped_lock lock(m_mutex);
+
+        /* Files which were unmapped since were synced then */
+        for (const auto amount : m_dirty)
+        {
+            if (const auto it = m_openFiles.find(amount); it != m_openFiles.end())
+            {
+                it->second.file->flush();
+            }
+        }
+
+        m_dirty.clear();
+
+        /* Replaced in one go, so a crash leaves either the old manifest or
+           the new one */
+        const std::string tmpPath = manifestPath() + ".tmp";
+
+        {
+            std::ofstream manifest(tmpPath, std::ios::trunc);
+
+            manifest << blockIndex << " " << Common::podToHex(blockHash) << "\n";
+
+            for (const auto &[amount, info] : m_amounts)
+            {
+                if (info.size != 0)
+                {
+                    manifest << amount << " " << info.size << "\n";
+                }
+            }
+
+            manifest.flush();
+
+            if (!manifest)
+            {
+                throw std::runtime_error("Failed to write " + tmpPath);
+            }
+        }
+
+        fs::rename(tmpPath, manifestPath());
+
+        m_flushedBlock = {blockIndex, blockHash};
+    }
+} // namespace CryptoNote
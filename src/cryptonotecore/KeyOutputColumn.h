@@ -0,0 +1,136 @@
+// Copyright (c) 2018-2024, The DeroGold Developers
+//
+// Please see the included LICENSE file for more information.
+
+#pragma once
+
+#include <common/FileMappedVector.h>
+#include <cryptonotecore/IBlockchainCache.h>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <shared_mutex>
+#include <string>
+#include <vector>
+
+namespace CryptoNote
+{
+    /* The key outputs on the main chain, stored as one memory mapped file
+       per amount, indexed by the global index of the output. Looking up a
+       ring member is then an array access, instead of going through the
+       packed output index and the transaction in the database.
+
+       There can be thousands of amounts, so the files are only mapped when
+       used, and at most MAX_OPEN_FILES are kept mapped at once.
+
+       Like the BlockInfoColumn, the files are a cache of what is in the
+       database, and are not synced on every push. flush() syncs the files
+       written to since the last flush, then records the size of every
+       amount and the block they are up to. open() drops anything past
+       that, so what is left is known to match the chain up to that block.
+
+       All methods can be called from many threads at once. Lookups in a
+       file which is already mapped only take a shared lock, mapping and
+       unmapping files and writing take it exclusively. Entries are
+       returned by value, as the file they are in may be unmapped as soon
+       as the lock is let go. */
+    class KeyOutputColumn
+    {
+      public:
+        struct Entry
+        {
+            Crypto::PublicKey publicKey;
+
+            uint64_t unlockTime;
+
+            uint32_t blockIndex;
+        };
+
+        /* Opens the directory, creating it if needed. Only the outputs
+           written by the last flush() are kept. */
+        void open(const std::string &directory);
+
+        void close();
+
+        /* The block index and hash given to the last flush(), if the
+           directory had been flushed before it was opened */
+        std::optional<std::pair<uint32_t, Crypto::Hash>> flushedBlock() const;
+
+        std::vector<IBlockchainCache::Amount> amounts() const;
+
+        /* Amount of outputs stored for the amount */
+        uint32_t size(IBlockchainCache::Amount amount) const;
+
+        Entry get(IBlockchainCache::Amount amount, uint32_t globalIndex) const;
+
+        void reserve(IBlockchainCache::Amount amount, uint32_t size);
+
+        void push(IBlockchainCache::Amount amount, const Entry &entry);
+
+        /* Removes outputs of the amount from the end, so size() are left */
+        void truncate(IBlockchainCache::Amount amount, uint32_t size);
+
+        /* Removes the outputs in blocks from blockIndex onwards */
+        void truncateBlocks(uint32_t blockIndex);
+
+        /* Removes every output, and forgets the last flush */
+        void clear();
+
+        /* Writes the files to disk, and records that they hold every key
+           output up to and including the given block */
+        void flush(uint32_t blockIndex, const Crypto::Hash &blockHash);
+
+      private:
+        static constexpr size_t MAX_OPEN_FILES = 128;
+
+        struct AmountInfo
+        {
+            uint32_t size = 0;
+
+            /* Block of the last output, only meaningful when size isn't 0 */
+            uint32_t lastBlockIndex = 0;
+        };
+
+        struct OpenFile
+        {
+            std::unique_ptr<Common::FileMappedVector<Entry>> file;
+
+            /* When the file was last used, to pick which one to unmap.
+               Updated by lookups holding only the shared lock. */
+            std::atomic<uint64_t> lastUsed = 0;
+        };
+
+        /* Maps the file of the amount if needed. The returned reference is
+           valid until the next call. Needs the exclusive lock. */
+        Common::FileMappedVector<Entry> &file(IBlockchainCache::Amount amount) const;
+
+        /* Removes outputs from the end of the amount while pop() is true */
+        template<typename F> void popWhile(IBlockchainCache::Amount amount, F &&pop);
+
+        std::string filePath(IBlockchainCache::Amount amount) const;
+
+        std::string manifestPath() const;
+
+        /* Reads what the last flush() recorded, and removes the files of
+           amounts it doesn't know */
+        void loadManifest();
+
+        std::string m_directory;
+
+        std::map<IBlockchainCache::Amount, AmountInfo> m_amounts;
+
+        mutable std::map<IBlockchainCache::Amount, OpenFile> m_openFiles;
+
+        mutable std::atomic<uint64_t> m_useCounter = 0;
+
+        /* Amounts pushed to or truncated since the last flush */
+        std::set<IBlockchainCache::Amount> m_dirty;
+
+        std::optional<std::pair<uint32_t, Crypto::Hash>> m_flushedBlock;
+
+        mutable std::shared_mutex m_mutex;
+    };
+} // namespace CryptoNote
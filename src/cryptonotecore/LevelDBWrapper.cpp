@@ -133,12 +133,30 @@ std::error_code LevelDBWrapper::write(IWriteBatch &batch, bool sync)
         LevelDBbBatch.Put(leveldb::Slice(kvPair.first), leveldb::Slice(kvPair.second));
     }
 
+    /* LevelDB has no column families, the keys are prefixed by their table
+       so they can all go in the one keyspace */
+    for (const auto &[columnFamily, columnFamilyData] : batch.extractRawDataToInsertWithCF())
+    {
+        for (const std::pair<std::string, std::string> &kvPair : columnFamilyData)
+        {
+            LevelDBbBatch.Put(leveldb::Slice(kvPair.first), leveldb::Slice(kvPair.second));
+        }
+    }
+
     std::vector<std::string> rawKeys(batch.extractRawKeysToRemove());
     for (const std::string &key : rawKeys)
     {
         LevelDBbBatch.Delete(leveldb::Slice(key));
     }
 
+    for (const auto &[columnFamily, columnFamilyKeys] : batch.extractRawKeysToRemoveWithCF())
+    {
+        for (const std::string &key : columnFamilyKeys)
+        {
+            LevelDBbBatch.Delete(leveldb::Slice(key));
+        }
+    }
+
     leveldb::Status status = db->Write(writeOptions, &LevelDBbBatch);
 
     if (!status.ok())
@@ -179,13 +197,11 @@ std::error_code LevelDBWrapper::read(IReadBatch &batch)
             {
                 return make_error_code(CryptoNote::error::DataBaseErrorCodes::INTERNAL_ERROR);
             }
-            values.push_back(tmp_value);
+            values.push_back(std::move(tmp_value));
             resultStates.push_back(s.ok());
         }
 
-        values.reserve(rawKeys.size());
-
-        batch.submitRawResult(values, resultStates);
+        batch.submitRawResult(std::vector<std::string_view>(values.begin(), values.end()), resultStates);
         return std::error_code();
     }
     else
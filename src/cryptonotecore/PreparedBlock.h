@@ -0,0 +1,57 @@
+// Copyright (c) 2018-2024, The DeroGold Developers
+//
+// Please see the included LICENSE file for more information.
+
+#pragma once
+
+#include "CachedBlock.h"
+#include "CachedTransaction.h"
+
+#include <CryptoNote.h>
+#include <crypto/crypto.h>
+#include <vector>
+
+namespace CryptoNote
+{
+    /* The results of the transaction checks which don't depend on chain state,
+       done on a worker thread before the block containing the transaction is
+       committed, or when the transaction was accepted into the pool */
+    struct PreparedTransactionChecks
+    {
+        /* Whether the transaction proof of work was computed and is sufficient */
+        bool proofOfWorkVerified = false;
+
+        /* For each input, the ring members its signatures were verified against.
+           An empty ring means the input was not verified ahead of time. The result
+           is only reused if the exact same keys are extracted at commit time. */
+        std::vector<std::vector<Crypto::PublicKey>> verifiedRings;
+    };
+
+    /* A block queued for addition whose stateless validation work (hashing,
+       transaction deserialization, proof of work, ring signatures) may be done
+       ahead of time while earlier blocks are still being committed */
+    struct PreparedBlock
+    {
+        PreparedBlock(const BlockTemplate &blockTemplate, RawBlock &&rawBlock):
+            cachedBlock(blockTemplate),
+            rawBlock(std::move(rawBlock))
+        {
+        }
+
+        /* Not shared with the caller, so the lazily computed hashes can be
+           filled in from the worker thread */
+        CachedBlock cachedBlock;
+
+        RawBlock rawBlock;
+
+        /* Only valid if transactionsExtracted is set */
+        std::vector<CachedTransaction> transactions;
+
+        uint64_t cumulativeSize = 0;
+
+        bool transactionsExtracted = false;
+
+        /* One entry per transaction in transactions */
+        std::vector<PreparedTransactionChecks> transactionChecks;
+    };
+} // namespace CryptoNote
@@ -14,9 +14,17 @@
 #include <rocksdb/statistics.h>
 #include <rocksdb/table.h>
 #include <rocksdb/utilities/options_util.h>
+#include <algorithm>
 #include <utility>
 #include <thread>
 
+namespace
+{
+    /* Written to the default column family once every table is in its own
+       column family, so later starts don't have to look for entries to move */
+    const std::string COLUMN_FAMILIES_MIGRATED_KEY = "column_families_migrated";
+} // namespace
+
 namespace CryptoNote
 {
     void RocksDBWrapper::init()
@@ -31,9 +39,13 @@ namespace CryptoNote
         logger(Logging::INFO) << "Opening DB in " << dataDir;
 
         rocksdb::DB *dbPtr;
-        const rocksdb::Options dbOptions = getDBOptions(config);
+        rocksdb::DBOptions dbOptions;
+        std::vector<rocksdb::ColumnFamilyDescriptor> columnFamilyDescriptors;
+        getDBOptions(config, dbOptions, columnFamilyDescriptors);
 
-        if (const rocksdb::Status status = rocksdb::DB::Open(dbOptions, dataDir, &dbPtr); status.ok())
+        if (const rocksdb::Status status =
+                rocksdb::DB::Open(dbOptions, dataDir, columnFamilyDescriptors, &columnFamilyHandles, &dbPtr);
+            status.ok())
         {
             logger(Logging::INFO) << "DB opened in " << dataDir;
         }
@@ -49,6 +61,14 @@ namespace CryptoNote
         }
 
         db.reset(dbPtr);
+
+        for (size_t i = 0; i < columnFamilyHandles.size(); i++)
+        {
+            columnFamilies[columnFamilyDescriptors[i].name] = columnFamilyHandles[i];
+        }
+
+        migrateToColumnFamilies();
+
         state.store(INITIALIZED);
     }
 
@@ -60,8 +80,9 @@ namespace CryptoNote
         }
 
         logger(Logging::INFO) << "Closing DB.";
-        db->Flush(rocksdb::FlushOptions());
+        db->Flush(rocksdb::FlushOptions(), columnFamilyHandles);
         db->SyncWAL();
+        closeColumnFamilies();
         db.reset();
         state.store(NOT_INITIALIZED);
     }
@@ -77,9 +98,13 @@ namespace CryptoNote
 
         logger(Logging::WARNING) << "Destroying DB in " << dataDir;
 
-        const rocksdb::Options dbOptions = getDBOptions(config);
+        rocksdb::DBOptions dbOptions;
+        std::vector<rocksdb::ColumnFamilyDescriptor> columnFamilyDescriptors;
+        getDBOptions(config, dbOptions, columnFamilyDescriptors);
+
+        const rocksdb::Options options(dbOptions, columnFamilyDescriptors.front().options);
 
-        if (const rocksdb::Status status = DestroyDB(dataDir, dbOptions); status.ok())
+        if (const rocksdb::Status status = DestroyDB(dataDir, options, columnFamilyDescriptors); status.ok())
         {
             logger(Logging::WARNING) << "DB destroyed in " << dataDir;
         }
@@ -105,11 +130,31 @@ namespace CryptoNote
             rocksdbBatch.Put(rocksdb::Slice(key), rocksdb::Slice(value));
         }
 
+        for (const auto &[columnFamily, columnFamilyData] : batch.extractRawDataToInsertWithCF())
+        {
+            rocksdb::ColumnFamilyHandle *handle = getColumnFamily(columnFamily);
+
+            for (const auto &[key, value] : columnFamilyData)
+            {
+                rocksdbBatch.Put(handle, rocksdb::Slice(key), rocksdb::Slice(value));
+            }
+        }
+
         for (const std::string &key : batch.extractRawKeysToRemove())
         {
             rocksdbBatch.Delete(rocksdb::Slice(key));
         }
 
+        for (const auto &[columnFamily, columnFamilyKeys] : batch.extractRawKeysToRemoveWithCF())
+        {
+            rocksdb::ColumnFamilyHandle *handle = getColumnFamily(columnFamily);
+
+            for (const std::string &key : columnFamilyKeys)
+            {
+                rocksdbBatch.Delete(handle, rocksdb::Slice(key));
+            }
+        }
+
         if (const rocksdb::Status status = db->Write(rocksdb::WriteOptions(), &rocksdbBatch); !status.ok())
         {
             logger(Logging::ERROR) << "Can't write to DB. " << status.ToString();
@@ -134,30 +179,49 @@ namespace CryptoNote
             return make_error_code(error::DataBaseErrorCodes::INTERNAL_ERROR);
         }
 
+        const std::vector rawKeyColumnFamilies(batch.getRawKeyColumnFamilies());
+
         std::vector<rocksdb::Slice> keySlices;
         keySlices.reserve(rawKeys.size());
 
-        for (const std::string &key : rawKeys)
+        std::vector<rocksdb::ColumnFamilyHandle *> keyColumnFamilies;
+        keyColumnFamilies.reserve(rawKeys.size());
+
+        for (size_t i = 0; i < rawKeys.size(); i++)
         {
-            keySlices.emplace_back(key);
+            keySlices.emplace_back(rawKeys[i]);
+            keyColumnFamilies.push_back(
+                rawKeyColumnFamilies.empty() ? db->DefaultColumnFamily() : getColumnFamily(rawKeyColumnFamilies[i]));
         }
 
-        std::vector<std::string> values;
-        values.reserve(rawKeys.size());
+        /* The batched MultiGet pins the values in the block cache where it
+           can, instead of copying each of them into a string */
+        std::vector<rocksdb::PinnableSlice> pinnedValues(rawKeys.size());
+        std::vector<rocksdb::Status> statuses(rawKeys.size());
+
+        db->MultiGet(
+            rocksdb::ReadOptions(),
+            rawKeys.size(),
+            keyColumnFamilies.data(),
+            keySlices.data(),
+            pinnedValues.data(),
+            statuses.data());
 
-        const std::vector<rocksdb::Status> statuses = db->MultiGet(rocksdb::ReadOptions(), keySlices, &values);
+        std::vector<std::string_view> values;
+        values.reserve(rawKeys.size());
 
         std::vector<bool> resultStates;
         resultStates.reserve(rawKeys.size());
 
-        for (const rocksdb::Status &status : statuses)
+        for (size_t i = 0; i < rawKeys.size(); i++)
         {
-            if (!status.ok() && !status.IsNotFound())
+            if (!statuses[i].ok() && !statuses[i].IsNotFound())
             {
                 return make_error_code(error::DataBaseErrorCodes::INTERNAL_ERROR);
             }
 
-            resultStates.push_back(status.ok());
+            values.emplace_back(pinnedValues[i].data(), pinnedValues[i].size());
+            resultStates.push_back(statuses[i].ok());
         }
 
         batch.submitRawResult(values, resultStates);
@@ -172,20 +236,24 @@ namespace CryptoNote
         }
 
         const std::vector rawKeys(batch.getRawKeys());
-        std::vector<std::string> values(rawKeys.size());
+        const std::vector rawKeyColumnFamilies(batch.getRawKeyColumnFamilies());
+        std::vector<rocksdb::PinnableSlice> pinnedValues(rawKeys.size());
+        std::vector<std::string_view> values;
         std::vector<bool> resultStates;
 
-        size_t i = 0;
-
-        for (const std::string &key : rawKeys)
+        for (size_t i = 0; i < rawKeys.size(); i++)
         {
-            const auto status = db->Get(rocksdb::ReadOptions(), rocksdb::Slice(key), &values[i++]);
+            rocksdb::ColumnFamilyHandle *handle =
+                rawKeyColumnFamilies.empty() ? db->DefaultColumnFamily() : getColumnFamily(rawKeyColumnFamilies[i]);
+
+            const auto status = db->Get(rocksdb::ReadOptions(), handle, rocksdb::Slice(rawKeys[i]), &pinnedValues[i]);
 
             if (!status.ok() && !status.IsNotFound())
             {
                 return make_error_code(error::DataBaseErrorCodes::INTERNAL_ERROR);
             }
 
+            values.emplace_back(pinnedValues[i].data(), pinnedValues[i].size());
             resultStates.push_back(status.ok());
         }
 
@@ -207,10 +275,13 @@ namespace CryptoNote
     void RocksDBWrapper::optimize()
     {
         const std::string dbData = getDataDir(config);
-        const rocksdb::Options dbOptions = getDBOptions(config);
+        rocksdb::DBOptions dbOptions;
+        std::vector<rocksdb::ColumnFamilyDescriptor> columnFamilyDescriptors;
+        getDBOptions(config, dbOptions, columnFamilyDescriptors);
+        std::vector<rocksdb::ColumnFamilyHandle *> handles;
         rocksdb::DB *rocksDb;
 
-        if (rocksdb::DB::Open(dbOptions, dbData, &rocksDb).ok())
+        if (rocksdb::DB::Open(dbOptions, dbData, columnFamilyDescriptors, &handles, &rocksDb).ok())
         {
             rocksdb::CompactRangeOptions compactRangeOptions;
             compactRangeOptions.exclusive_manual_compaction = true;
@@ -248,7 +319,11 @@ namespace CryptoNote
                 })
                 .detach();
 
-            rocksDb->CompactRange(compactRangeOptions, nullptr, nullptr);
+            for (rocksdb::ColumnFamilyHandle *handle : handles)
+            {
+                rocksDb->CompactRange(compactRangeOptions, handle, nullptr, nullptr);
+                rocksDb->DestroyColumnFamilyHandle(handle);
+            }
 
             auto waitForCompactOptions = rocksdb::WaitForCompactOptions();
             waitForCompactOptions.flush = true;
@@ -260,9 +335,137 @@ namespace CryptoNote
         }
     }
 
-    rocksdb::Options RocksDBWrapper::getDBOptions(const DataBaseConfig &config)
+    rocksdb::ColumnFamilyHandle *RocksDBWrapper::getColumnFamily(const std::string &name) const
+    {
+        if (name.empty())
+        {
+            return db->DefaultColumnFamily();
+        }
+
+        const auto it = columnFamilies.find(name);
+
+        if (it == columnFamilies.end())
+        {
+            logger(Logging::ERROR) << "DB Error. Unknown column family " << name;
+            throw std::system_error(make_error_code(error::DataBaseErrorCodes::INTERNAL_ERROR));
+        }
+
+        return it->second;
+    }
+
+    void RocksDBWrapper::migrateToColumnFamilies()
+    {
+        std::string migrated;
+
+        if (const rocksdb::Status status =
+                db->Get(rocksdb::ReadOptions(), db->DefaultColumnFamily(), COLUMN_FAMILIES_MIGRATED_KEY, &migrated);
+            status.ok())
+        {
+            return;
+        }
+        else if (!status.IsNotFound())
+        {
+            logger(Logging::ERROR) << "DB Error. Failed to read the column family migration state: "
+                                   << status.ToString();
+            throw std::system_error(make_error_code(error::DataBaseErrorCodes::INTERNAL_ERROR));
+        }
+
+        /* Keep the batches small enough they don't stall the memtables */
+        const size_t maxBatchSize = 16 * 1024 * 1024;
+
+        rocksdb::ReadOptions readOptions;
+        readOptions.fill_cache = false;
+
+        std::unique_ptr<rocksdb::Iterator> it(db->NewIterator(readOptions, db->DefaultColumnFamily()));
+
+        rocksdb::WriteBatch batch;
+
+        uint64_t moved = 0;
+
+        const auto writeBatch = [&]
+        {
+            if (const rocksdb::Status status = db->Write(rocksdb::WriteOptions(), &batch); !status.ok())
+            {
+                logger(Logging::ERROR) << "DB Error. Failed to move tables to column families: " << status.ToString();
+                throw std::system_error(make_error_code(error::DataBaseErrorCodes::INTERNAL_ERROR));
+            }
+
+            batch.Clear();
+        };
+
+        for (it->SeekToFirst(); it->Valid(); it->Next())
+        {
+            /* The scheme version and the like stay in the default column family */
+            const std::string &columnFamily = DB::columnFamilyOfKey(it->key().ToString());
+
+            if (columnFamily.empty())
+            {
+                continue;
+            }
+
+            if (moved == 0)
+            {
+                logger(Logging::INFO) << "Moving DB tables to their own column families. "
+                                      << "This only has to be done once, but may take a long time.";
+                logger(Logging::INFO) << "Please do not close the program abruptly to prevent DB corruption.";
+            }
+
+            /* Both in one batch, so each key is always in exactly one place */
+            batch.Put(getColumnFamily(columnFamily), it->key(), it->value());
+            batch.Delete(db->DefaultColumnFamily(), it->key());
+
+            if (batch.GetDataSize() >= maxBatchSize)
+            {
+                writeBatch();
+            }
+
+            if (++moved % 1000000 == 0)
+            {
+                logger(Logging::INFO) << "Moved " << moved << " DB entries";
+            }
+        }
+
+        if (!it->status().ok())
+        {
+            logger(Logging::ERROR) << "DB Error. Failed to move tables to column families: "
+                                   << it->status().ToString();
+            throw std::system_error(make_error_code(error::DataBaseErrorCodes::INTERNAL_ERROR));
+        }
+
+        it.reset();
+
+        /* Only once everything else has been moved, so an interrupted
+           migration is picked up again */
+        batch.Put(db->DefaultColumnFamily(), COLUMN_FAMILIES_MIGRATED_KEY, "1");
+
+        writeBatch();
+
+        if (moved == 0)
+        {
+            return;
+        }
+
+        /* Drop the tombstones the moved keys left behind */
+        db->CompactRange(rocksdb::CompactRangeOptions(), db->DefaultColumnFamily(), nullptr, nullptr);
+
+        logger(Logging::INFO) << "Moved " << moved << " DB entries to their own column families.";
+    }
+
+    void RocksDBWrapper::closeColumnFamilies()
+    {
+        for (rocksdb::ColumnFamilyHandle *handle : columnFamilyHandles)
+        {
+            db->DestroyColumnFamilyHandle(handle);
+        }
+
+        columnFamilyHandles.clear();
+        columnFamilies.clear();
+    }
+
+    void RocksDBWrapper::getDBOptions(const DataBaseConfig &config,
+                                      rocksdb::DBOptions &dbOptions,
+                                      std::vector<rocksdb::ColumnFamilyDescriptor> &columnFamilies)
     {
-        rocksdb::DBOptions dbOptions;
         dbOptions.create_if_missing = true;
         dbOptions.create_missing_column_families = true;
         dbOptions.info_log_level = rocksdb::InfoLogLevel::INFO_LEVEL;
@@ -272,6 +475,16 @@ namespace CryptoNote
         dbOptions.skip_stats_update_on_db_open = true;
         dbOptions.compaction_readahead_size = 2 * 1024 * 1024;
 
+        // the memtables of all the column families together stay within the write buffer size, flushing the
+        // largest when it is reached
+        dbOptions.db_write_buffer_size = config.writeBufferSize;
+
+        // one block cache for every column family, so the read cache size is the total, and the busiest tables
+        // get the largest share of it
+        const std::shared_ptr<rocksdb::Cache> blockCache = rocksdb::NewLRUCache(config.readCacheSize);
+
+        const auto compressionLevel = config.compressionEnabled ? rocksdb::kZSTD : rocksdb::kNoCompression;
+
         rocksdb::ColumnFamilyOptions cfOptions;
 
         // sets the size of a single memtable. Once memtable exceeds this size, it is marked immutable and a new one is
@@ -298,65 +511,65 @@ namespace CryptoNote
         cfOptions.compaction_style = rocksdb::kCompactionStyleLevel;
         cfOptions.compression_per_level.resize(cfOptions.num_levels);
 
-        const auto compressionLevel = config.compressionEnabled ? rocksdb::kZSTD : rocksdb::kNoCompression;
-
         for (int i = 0; i < cfOptions.num_levels; ++i)
         {
             // don't compress l0 & l1
             cfOptions.compression_per_level[i] = i < 2 ? rocksdb::kNoCompression : compressionLevel;
         }
 
-        rocksdb::BlockBasedTableOptions bbtOptions;
-        bbtOptions.data_block_index_type = rocksdb::BlockBasedTableOptions::kDataBlockBinaryAndHash;
-        bbtOptions.data_block_hash_table_util_ratio = 0.75;
-        bbtOptions.filter_policy.reset(rocksdb::NewBloomFilterPolicy(10));
-        bbtOptions.block_cache = rocksdb::NewLRUCache(config.readCacheSize);
-        bbtOptions.block_size = 32 * 1024;
-
-        cfOptions.table_factory.reset(NewBlockBasedTableFactory(bbtOptions));
         cfOptions.memtable_prefix_bloom_size_ratio = 0.02;
         cfOptions.memtable_whole_key_filtering = true;
 
-        return rocksdb::Options {dbOptions, cfOptions};
-    }
-
-    void RocksDBWrapper::getDBOptions(const DataBaseConfig &config,
-                                      rocksdb::DBOptions &dbOptions,
-                                      std::vector<rocksdb::ColumnFamilyDescriptor> &columnFamilies)
-    {
-        dbOptions.create_if_missing = true;
-        dbOptions.create_missing_column_families = true;
-        dbOptions.info_log_level = rocksdb::InfoLogLevel::INFO_LEVEL;
-        dbOptions.keep_log_file_num = 1;
-        dbOptions.IncreaseParallelism(static_cast<int>(config.backgroundThreadsCount));
-        dbOptions.max_open_files = static_cast<int>(config.maxOpenFiles);
-        dbOptions.skip_stats_update_on_db_open = true;
-        dbOptions.compaction_readahead_size = 2 * 1024 * 1024;
-
-        rocksdb::ColumnFamilyOptions cfOptions;
-        cfOptions.OptimizeLevelStyleCompaction();
-
-        for (int i = 0; i < cfOptions.num_levels; ++i)
-        {
-            cfOptions.compression_per_level[i] = i < 2 ? rocksdb::kNoCompression : rocksdb::kZSTD;
-        }
-
         rocksdb::BlockBasedTableOptions bbtOptions;
         bbtOptions.data_block_index_type = rocksdb::BlockBasedTableOptions::kDataBlockBinaryAndHash;
         bbtOptions.data_block_hash_table_util_ratio = 0.75;
         bbtOptions.filter_policy.reset(rocksdb::NewBloomFilterPolicy(10));
+        bbtOptions.block_cache = blockCache;
         bbtOptions.block_size = 32 * 1024;
+        // keep the index and filter blocks in the shared cache too, so they count towards its size
+        bbtOptions.cache_index_and_filter_blocks = true;
+        bbtOptions.cache_index_and_filter_blocks_with_high_priority = true;
+        bbtOptions.pin_l0_filter_and_index_blocks_in_cache = true;
 
         cfOptions.table_factory.reset(NewBlockBasedTableFactory(bbtOptions));
-        cfOptions.memtable_prefix_bloom_size_ratio = 0.02;
-        cfOptions.memtable_whole_key_filtering = true;
 
-        columnFamilies.emplace_back(DB::V2::RAW_BLOCKS_CF, cfOptions);
-        columnFamilies.emplace_back("SpentKeyImages", cfOptions);
-        columnFamilies.emplace_back("CachedTransactions", cfOptions);
-        columnFamilies.emplace_back("PaymentIds", cfOptions);
-        columnFamilies.emplace_back("CachedBlocks", cfOptions);
-        columnFamilies.emplace_back("KeyOutputGlobalIndexes", cfOptions);
-        columnFamilies.emplace_back("Others", cfOptions);
+        // key images, output keys and hashes are random bytes which don't compress, and are looked up one at a
+        // time - often for keys which don't exist - so use small blocks, and rely on the bloom filters
+        rocksdb::ColumnFamilyOptions pointLookupOptions = cfOptions;
+        rocksdb::BlockBasedTableOptions pointLookupBbtOptions = bbtOptions;
+        pointLookupBbtOptions.block_size = 4 * 1024;
+        pointLookupOptions.table_factory.reset(NewBlockBasedTableFactory(pointLookupBbtOptions));
+        std::fill(
+            pointLookupOptions.compression_per_level.begin(),
+            pointLookupOptions.compression_per_level.end(),
+            rocksdb::kNoCompression);
+
+        // raw blocks and transactions are the bulk of the data, and are written once and rarely read, so compress
+        // every level, in large blocks
+        rocksdb::ColumnFamilyOptions bulkOptions = cfOptions;
+        rocksdb::BlockBasedTableOptions bulkBbtOptions = bbtOptions;
+        bulkBbtOptions.block_size = 64 * 1024;
+        bulkOptions.table_factory.reset(NewBlockBasedTableFactory(bulkBbtOptions));
+        std::fill(bulkOptions.compression_per_level.begin(), bulkOptions.compression_per_level.end(), compressionLevel);
+
+        // must come first
+        columnFamilies.emplace_back(rocksdb::kDefaultColumnFamilyName, cfOptions);
+
+        for (const std::string &name : DB::columnFamilies())
+        {
+            if (name == DB::SPENT_KEY_IMAGES_CF || name == DB::KEY_OUTPUTS_CF
+                || name == DB::KEY_OUTPUT_GLOBAL_INDEXES_CF || name == DB::BLOCK_INDEXES_BY_HASH_CF)
+            {
+                columnFamilies.emplace_back(name, pointLookupOptions);
+            }
+            else if (name == DB::RAW_BLOCKS_CF || name == DB::TRANSACTIONS_CF)
+            {
+                columnFamilies.emplace_back(name, bulkOptions);
+            }
+            else
+            {
+                columnFamilies.emplace_back(name, cfOptions);
+            }
+        }
     }
 } // namespace CryptoNote
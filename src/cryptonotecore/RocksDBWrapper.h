@@ -14,6 +14,8 @@
 #include <logging/LoggerRef.h>
 #include <memory>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 namespace CryptoNote
 {
@@ -32,6 +34,11 @@ namespace CryptoNote
 
         std::unique_ptr<rocksdb::DB> db;
 
+        /* Handles of every column family, have to be destroyed before the DB is closed */
+        std::vector<rocksdb::ColumnFamilyHandle *> columnFamilyHandles;
+
+        std::unordered_map<std::string, rocksdb::ColumnFamilyHandle *> columnFamilies;
+
     public:
         inline static const std::string DB_NAME = "DB";
 
@@ -67,9 +74,22 @@ namespace CryptoNote
         const DataBaseConfig &getConfig() const override { return config; }
 
     private:
-        static rocksdb::Options getDBOptions(const DataBaseConfig &config);
-
-        static void getDBOptions(const DataBaseConfig &config, rocksdb::DBOptions &dbOptions, std::vector<rocksdb::ColumnFamilyDescriptor> &columnFamilies);
+        /* Options for the DB, and for the default column family followed by
+           a column family per table */
+        static void getDBOptions(const DataBaseConfig &config,
+                                 rocksdb::DBOptions &dbOptions,
+                                 std::vector<rocksdb::ColumnFamilyDescriptor> &columnFamilies);
+
+        /* An empty name is the default column family */
+        rocksdb::ColumnFamilyHandle *getColumnFamily(const std::string &name) const;
+
+        /* DBs created before tables had their own column families have every
+           table in the default one. Moves them out, and picks up where it left
+           off if it was interrupted. Records when it's done, so the default
+           column family is only scanned until the first complete run. */
+        void migrateToColumnFamilies();
+
+        void closeColumnFamilies();
 
         static std::string getDataDir(const DataBaseConfig &config)
         {
@@ -0,0 +1,219 @@
+// Copyright (c) 2018-2024, The DeroGold Developers
+//
+// Please see the included LICENSE file for more information.
+
+#include "SpentKeyImageIndex.h"
+
+#include <config/CryptoNoteConfig.h>
+#include <cstring>
+#include <mutex>
+
+namespace CryptoNote
+{
+    SpentKeyImageIndex::SpentKeyImageIndex(Mode mode, uint64_t maxEntries):
+        m_mode(mode),
+        m_maxEntries(maxEntries)
+    {
+        if (m_mode == Mode::Filter)
+        {
+            const uint64_t words = SPENT_KEY_IMAGE_FILTER_SIZE_MB * 1024 * 1024 / sizeof(uint64_t);
+
+            m_filter.reset(new std::atomic<uint64_t>[words]());
+            m_filterBitCount = words * 64;
+        }
+    }
+
+    bool SpentKeyImageIndex::modeFromString(const std::string &str, Mode &mode)
+    {
+        if (str == "none")
+        {
+            mode = Mode::None;
+        }
+        else if (str == "full")
+        {
+            mode = Mode::Full;
+        }
+        else if (str == "filter")
+        {
+            mode = Mode::Filter;
+        }
+        else
+        {
+            return false;
+        }
+
+        return true;
+    }
+
+    SpentKeyImageIndex::Mode SpentKeyImageIndex::mode() const
+    {
+        return m_mode;
+    }
+
+    SpentKeyImageIndex::LookupResult
+        SpentKeyImageIndex::find(const Crypto::KeyImage &keyImage, uint32_t blockIndex) const
+    {
+        if (m_mode == Mode::Full)
+        {
+            const auto &shard = shardFor(keyImage);
+
+            std::shared_lock<std::shared_mutex> lock(shard.mutex);
+
+            const auto it = shard.keyImages.find(keyImage);
+
+            if (it == shard.keyImages.end())
+            {
+                return m_complete ? LookupResult::NotSpent : LookupResult::Unknown;
+            }
+
+            return it->second <= blockIndex ? LookupResult::Spent : LookupResult::NotSpent;
+        }
+
+        if (m_mode == Mode::Filter)
+        {
+            for (const uint64_t bit : filterBits(keyImage))
+            {
+                if ((m_filter[bit / 64].load(std::memory_order_relaxed) & (uint64_t(1) << (bit % 64))) == 0)
+                {
+                    return LookupResult::NotSpent;
+                }
+            }
+        }
+
+        return LookupResult::Unknown;
+    }
+
+    void SpentKeyImageIndex::insert(const std::unordered_set<Crypto::KeyImage> &keyImages, uint32_t blockIndex)
+    {
+        for (const auto &keyImage : keyImages)
+        {
+            insert(keyImage, blockIndex);
+        }
+    }
+
+    void SpentKeyImageIndex::insert(const std::vector<Crypto::KeyImage> &keyImages, uint32_t blockIndex)
+    {
+        for (const auto &keyImage : keyImages)
+        {
+            insert(keyImage, blockIndex);
+        }
+    }
+
+    void SpentKeyImageIndex::insert(const Crypto::KeyImage &keyImage, uint32_t blockIndex)
+    {
+        if (m_mode == Mode::Full)
+        {
+            auto &shard = shardFor(keyImage);
+
+            std::unique_lock<std::shared_mutex> lock(shard.mutex);
+
+            const auto it = shard.keyImages.find(keyImage);
+
+            if (it != shard.keyImages.end())
+            {
+                it->second = blockIndex;
+            }
+            /* Checked per shard, so may go over by a few entries */
+            else if (m_size >= m_maxEntries)
+            {
+                m_complete = false;
+            }
+            else
+            {
+                shard.keyImages.emplace(keyImage, blockIndex);
+                m_size++;
+            }
+        }
+        else if (m_mode == Mode::Filter)
+        {
+            bool added = false;
+
+            for (const uint64_t bit : filterBits(keyImage))
+            {
+                const uint64_t mask = uint64_t(1) << (bit % 64);
+
+                added |= (m_filter[bit / 64].fetch_or(mask, std::memory_order_relaxed) & mask) == 0;
+            }
+
+            if (added)
+            {
+                m_size++;
+            }
+        }
+    }
+
+    void SpentKeyImageIndex::remove(const std::unordered_set<Crypto::KeyImage> &keyImages)
+    {
+        if (m_mode != Mode::Full)
+        {
+            return;
+        }
+
+        for (const auto &keyImage : keyImages)
+        {
+            auto &shard = shardFor(keyImage);
+
+            std::unique_lock<std::shared_mutex> lock(shard.mutex);
+
+            if (shard.keyImages.erase(keyImage) != 0)
+            {
+                m_size--;
+            }
+        }
+    }
+
+    void SpentKeyImageIndex::clear()
+    {
+        for (auto &shard : m_shards)
+        {
+            std::unique_lock<std::shared_mutex> lock(shard.mutex);
+            shard.keyImages.clear();
+        }
+
+        for (uint64_t i = 0; i < m_filterBitCount / 64; i++)
+        {
+            m_filter[i].store(0, std::memory_order_relaxed);
+        }
+
+        m_size = 0;
+        m_complete = true;
+    }
+
+    uint64_t SpentKeyImageIndex::size() const
+    {
+        return m_size;
+    }
+
+    bool SpentKeyImageIndex::complete() const
+    {
+        return m_complete;
+    }
+
+    SpentKeyImageIndex::Shard &SpentKeyImageIndex::shardFor(const Crypto::KeyImage &keyImage)
+    {
+        return m_shards[keyImage.data[0] % SHARD_COUNT];
+    }
+
+    const SpentKeyImageIndex::Shard &SpentKeyImageIndex::shardFor(const Crypto::KeyImage &keyImage) const
+    {
+        return m_shards[keyImage.data[0] % SHARD_COUNT];
+    }
+
+    std::array<uint64_t, SpentKeyImageIndex::FILTER_HASH_COUNT>
+        SpentKeyImageIndex::filterBits(const Crypto::KeyImage &keyImage) const
+    {
+        static_assert(sizeof(keyImage.data) >= FILTER_HASH_COUNT * sizeof(uint64_t));
+
+        std::array<uint64_t, FILTER_HASH_COUNT> bits;
+
+        for (size_t i = 0; i < FILTER_HASH_COUNT; i++)
+        {
+            uint64_t word;
+            std::memcpy(&word, keyImage.data + i * sizeof(uint64_t), sizeof(word));
+
+            bits[i] = word % m_filterBitCount;
+        }
+
+        return bits;
+    }
+} // namespace CryptoNote
@@ -0,0 +1,119 @@
+// Copyright (c) 2018-2024, The DeroGold Developers
+//
+// Please see the included LICENSE file for more information.
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <config/CryptoNoteConfig.h>
+#include <crypto/crypto.h>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace CryptoNote
+{
+    /* In memory index of the key images spent on the main chain, so double
+       spend checks don't have to go to the database. Lookups and updates
+       may be done from multiple threads. */
+    class SpentKeyImageIndex
+    {
+      public:
+        enum class Mode
+        {
+            /* Every lookup goes to the database */
+            None,
+
+            /* Every spent key image and the block it was spent in, up to
+               maxEntries of them. Answers every lookup until it's full,
+               after which lookups of key images it doesn't have go to the
+               database. */
+            Full,
+
+            /* A fixed size probabilistic filter. Answers most lookups for
+               unspent key images, the rest go to the database. */
+            Filter
+        };
+
+        enum class LookupResult
+        {
+            NotSpent,
+            Spent,
+
+            /* Have to ask the database */
+            Unknown
+        };
+
+        explicit SpentKeyImageIndex(Mode mode, uint64_t maxEntries = SPENT_KEY_IMAGE_INDEX_MAX_ENTRIES);
+
+        /* Parses "none", "full" or "filter" */
+        static bool modeFromString(const std::string &str, Mode &mode);
+
+        Mode mode() const;
+
+        /* Whether the key image was spent in a block with an index of at most blockIndex */
+        LookupResult find(const Crypto::KeyImage &keyImage, uint32_t blockIndex) const;
+
+        void insert(const std::unordered_set<Crypto::KeyImage> &keyImages, uint32_t blockIndex);
+
+        void insert(const std::vector<Crypto::KeyImage> &keyImages, uint32_t blockIndex);
+
+        /* Removing from the filter isn't possible, the stale entries just
+           send lookups for those key images to the database */
+        void remove(const std::unordered_set<Crypto::KeyImage> &keyImages);
+
+        void clear();
+
+        /* Amount of key images inserted, less those removed in full mode.
+           In filter mode, key images the filter already seemed to have
+           aren't counted. */
+        uint64_t size() const;
+
+        /* False once a key image didn't fit in full mode */
+        bool complete() const;
+
+      private:
+        static constexpr size_t SHARD_COUNT = 64;
+
+        static constexpr size_t FILTER_HASH_COUNT = 4;
+
+        struct Shard
+        {
+            mutable std::shared_mutex mutex;
+
+            std::unordered_map<Crypto::KeyImage, uint32_t> keyImages;
+        };
+
+        Shard &shardFor(const Crypto::KeyImage &keyImage);
+
+        const Shard &shardFor(const Crypto::KeyImage &keyImage) const;
+
+        void insert(const Crypto::KeyImage &keyImage, uint32_t blockIndex);
+
+        /* The bits of the filter set for this key image. Key images are
+           curve points, so their bytes can be used as the hashes directly. */
+        std::array<uint64_t, FILTER_HASH_COUNT> filterBits(const Crypto::KeyImage &keyImage) const;
+
+        const Mode m_mode;
+
+        const uint64_t m_maxEntries;
+
+        /* Whether every key image inserted in full mode fit. Once one didn't,
+           key images which aren't found may still be spent. */
+        std::atomic<bool> m_complete = true;
+
+        /* Only used in full mode */
+        std::array<Shard, SHARD_COUNT> m_shards;
+
+        /* Only used in filter mode, updated with atomic ors so needs no lock */
+        std::unique_ptr<std::atomic<uint64_t>[]> m_filter;
+
+        uint64_t m_filterBitCount = 0;
+
+        std::atomic<uint64_t> m_size = 0;
+    };
+} // namespace CryptoNote
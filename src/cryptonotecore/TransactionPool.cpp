@@ -132,10 +132,15 @@ namespace CryptoNote
     {
     }
 
-    bool TransactionPool::pushTransaction(CachedTransaction &&transaction, TransactionValidatorState &&transactionState)
+    bool TransactionPool::pushTransaction(
+        CachedTransaction &&transaction,
+        TransactionValidatorState &&transactionState,
+        PreparedTransactionChecks &&verifiedChecks)
     {
         auto pendingTx = PendingTransactionInfo {static_cast<uint64_t>(time(nullptr)), std::move(transaction)};
 
+        pendingTx.verifiedChecks = std::move(verifiedChecks);
+
         Crypto::Hash paymentId;
         if (getPaymentIdFromTxExtra(pendingTx.cachedTransaction.getTransaction().extra, paymentId))
         {
@@ -177,6 +182,20 @@ namespace CryptoNote
         return std::nullopt;
     }
 
+    std::optional<PreparedTransactionChecks> TransactionPool::tryGetTransactionChecks(const Crypto::Hash &hash) const
+    {
+        std::scoped_lock lock(m_transactionsMutex);
+
+        auto it = transactionHashIndex.find(hash);
+
+        if (it != transactionHashIndex.end())
+        {
+            return it->verifiedChecks;
+        }
+
+        return std::nullopt;
+    }
+
     const CachedTransaction &TransactionPool::getTransaction(const Crypto::Hash &hash) const
     {
         std::scoped_lock lock(m_transactionsMutex);
@@ -27,13 +27,17 @@ namespace CryptoNote
       public:
         TransactionPool(std::shared_ptr<Logging::ILogger> logger);
 
-        virtual bool
-            pushTransaction(CachedTransaction &&transaction, TransactionValidatorState &&transactionState) override;
+        virtual bool pushTransaction(
+            CachedTransaction &&transaction,
+            TransactionValidatorState &&transactionState,
+            PreparedTransactionChecks &&verifiedChecks) override;
 
         virtual const CachedTransaction &getTransaction(const Crypto::Hash &hash) const override;
 
         virtual const std::optional<CachedTransaction> tryGetTransaction(const Crypto::Hash &hash) const override;
 
+        virtual std::optional<PreparedTransactionChecks> tryGetTransactionChecks(const Crypto::Hash &hash) const override;
+
         virtual bool removeTransaction(const Crypto::Hash &hash) override;
 
         virtual size_t getFusionTransactionCount() const override;
@@ -68,6 +72,9 @@ namespace CryptoNote
 
             boost::optional<Crypto::Hash> paymentId;
 
+            /* Lets the ring signatures be skipped when the transaction is mined */
+            PreparedTransactionChecks verifiedChecks;
+
             const Crypto::Hash &getTransactionHash() const;
         };
 
@@ -32,10 +32,12 @@ namespace CryptoNote
 
     bool TransactionPoolCleanWrapper::pushTransaction(
         CachedTransaction &&tx,
-        TransactionValidatorState &&transactionState)
+        TransactionValidatorState &&transactionState,
+        PreparedTransactionChecks &&verifiedChecks)
     {
         return !isTransactionRecentlyDeleted(tx.getTransactionHash())
-               && transactionPool->pushTransaction(std::move(tx), std::move(transactionState));
+               && transactionPool->pushTransaction(
+                   std::move(tx), std::move(transactionState), std::move(verifiedChecks));
     }
 
     const CachedTransaction &TransactionPoolCleanWrapper::getTransaction(const Crypto::Hash &hash) const
@@ -48,6 +50,12 @@ namespace CryptoNote
         return transactionPool->tryGetTransaction(hash);
     }
 
+    std::optional<PreparedTransactionChecks>
+        TransactionPoolCleanWrapper::tryGetTransactionChecks(const Crypto::Hash &hash) const
+    {
+        return transactionPool->tryGetTransactionChecks(hash);
+    }
+
     bool TransactionPoolCleanWrapper::removeTransaction(const Crypto::Hash &hash)
     {
         return transactionPool->removeTransaction(hash);
@@ -38,12 +38,17 @@ namespace CryptoNote
 
         virtual ~TransactionPoolCleanWrapper();
 
-        virtual bool pushTransaction(CachedTransaction &&tx, TransactionValidatorState &&transactionState) override;
+        virtual bool pushTransaction(
+            CachedTransaction &&tx,
+            TransactionValidatorState &&transactionState,
+            PreparedTransactionChecks &&verifiedChecks) override;
 
         virtual const CachedTransaction &getTransaction(const Crypto::Hash &hash) const override;
 
         virtual const std::optional<CachedTransaction> tryGetTransaction(const Crypto::Hash &hash) const override;
 
+        virtual std::optional<PreparedTransactionChecks> tryGetTransactionChecks(const Crypto::Hash &hash) const override;
+
         virtual bool removeTransaction(const Crypto::Hash &hash) override;
 
         virtual size_t getFusionTransactionCount() const override;
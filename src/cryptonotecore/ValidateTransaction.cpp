@@ -7,6 +7,7 @@
 //
 // Please see the included LICENSE file for more information.
 
+#include <algorithm>
 #include <config/CryptoNoteConfig.h>
 #include <common/CheckDifficulty.h>
 #include <cryptonotecore/Mixins.h>
@@ -22,23 +23,26 @@ ValidateTransaction::ValidateTransaction(
     CryptoNote::IBlockchainCache *cache,
     const CryptoNote::Currency &currency,
     const CryptoNote::Checkpoints &checkpoints,
-    Utilities::ThreadPool<bool> &threadPool,
+    Utilities::TaskScheduler &scheduler,
     const uint64_t blockHeight,
     const uint64_t blockSizeMedian,
     const uint64_t blockTimestamp,
-    const bool isPoolTransaction):
+    const bool isPoolTransaction,
+    const CryptoNote::PreparedTransactionChecks *preparedChecks):
     m_cachedTransaction(cachedTransaction),
     m_transaction(cachedTransaction.getTransaction()),
     m_validatorState(state),
     m_currency(currency),
     m_checkpoints(checkpoints),
-    m_threadPool(threadPool),
+    m_scheduler(scheduler),
     m_blockchainCache(cache),
     m_blockHeight(blockHeight),
     m_blockSizeMedian(blockSizeMedian),
     m_blockTimestamp(blockTimestamp),
-    m_isPoolTransaction(isPoolTransaction)
+    m_isPoolTransaction(isPoolTransaction),
+    m_preparedChecks(preparedChecks)
 {
+    m_verifiedChecks.verifiedRings.resize(m_transaction.inputs.size());
 }
 
 TransactionValidationResult ValidateTransaction::validate()
@@ -521,21 +525,35 @@ bool ValidateTransaction::validateTransactionMixin()
     return true;
 }
 
-bool ValidateTransaction::validateTransactionPoW()
+bool ValidateTransaction::checkTransactionPoW(const CryptoNote::Transaction &transaction, const uint64_t blockHeight)
 {
-    if (m_blockHeight < CryptoNote::parameters::TRANSACTION_POW_HEIGHT)
+    if (blockHeight < CryptoNote::parameters::TRANSACTION_POW_HEIGHT)
     {
         return true;
     }
 
-    std::vector<uint8_t> data = toBinaryArray(static_cast<CryptoNote::TransactionPrefix>(m_transaction));
+    std::vector<uint8_t> data = toBinaryArray(static_cast<CryptoNote::TransactionPrefix>(transaction));
 
     Crypto::Hash hash;
-    
+
     Crypto::cn_turtle_lite_slow_hash_v2(data.data(), data.size(), hash);
 
-    if (CryptoNote::check_hash(hash, CryptoNote::parameters::TRANSACTION_POW_DIFFICULTY))
+    return CryptoNote::check_hash(hash, CryptoNote::parameters::TRANSACTION_POW_DIFFICULTY);
+}
+
+bool ValidateTransaction::validateTransactionPoW()
+{
+    /* Already computed on a worker thread while the block was being prepared */
+    if (m_preparedChecks != nullptr && m_preparedChecks->proofOfWorkVerified)
+    {
+        m_verifiedChecks.proofOfWorkVerified = true;
+        return true;
+    }
+
+    if (checkTransactionPoW(m_transaction, m_blockHeight))
     {
+        /* Below the fork height the hash isn't computed, so it may still be too weak */
+        m_verifiedChecks.proofOfWorkVerified = m_blockHeight >= CryptoNote::parameters::TRANSACTION_POW_HEIGHT;
         return true;
     }
 
@@ -557,21 +575,33 @@ bool ValidateTransaction::validateTransactionInputsExpensive()
         return true;
     }
 
-    uint64_t inputIndex = 0;
-
-    std::vector<std::future<bool>> validationResult;
-    std::atomic<bool> cancelValidation = false;
     const Crypto::Hash prefixHash = m_cachedTransaction.getTransactionPrefixHash();
 
-    for (const auto &input : m_transaction.inputs)
-    {
-        /* Validate each input on a separate thread in our thread pool */
-        validationResult.push_back(m_threadPool.addJob([inputIndex, &input, &prefixHash, &cancelValidation, this]{
-            const CryptoNote::KeyInput &in = boost::get<CryptoNote::KeyInput>(input);
-            if (cancelValidation)
-            {
-                return false; // fail the validation immediately if cancel requested
-            }
+    const size_t inputCount = m_transaction.inputs.size();
+
+    /* Split the inputs into one contiguous group per core. Each group looks up
+     * its inputs and then verifies their ring signatures as a single batch, so
+     * we keep the parallelism while sharing work between the rings. */
+    const size_t groupCount = std::min<size_t>(
+        inputCount,
+        std::max<size_t>(1, m_scheduler.threadCount())
+    );
+
+    /* Validate the groups in parallel - as soon as one fails, the groups which
+     * haven't started yet are skipped */
+    return m_scheduler.parallelFor(0, groupCount, [groupCount, inputCount, &prefixHash, this](const size_t group) {
+        const size_t groupStart = inputCount * group / groupCount;
+        const size_t groupEnd = inputCount * (group + 1) / groupCount;
+
+        Crypto::RingSignatureBatch batch;
+
+        /* The ring members of each input in the group, recorded once the batch passes */
+        std::vector<std::vector<Crypto::PublicKey>> groupRings(groupEnd - groupStart);
+
+        for (size_t inputIndex = groupStart; inputIndex < groupEnd; inputIndex++)
+        {
+            const CryptoNote::KeyInput &in = boost::get<CryptoNote::KeyInput>(m_transaction.inputs[inputIndex]);
+
             if (m_blockchainCache->checkIfSpent(in.keyImage, m_blockHeight))
             {
                 setTransactionValidationResult(
@@ -610,18 +640,18 @@ bool ValidateTransaction::validateTransactionInputsExpensive()
                 return false;
             }
 
-                if (result == CryptoNote::ExtractOutputKeysResult::OUTPUT_LOCKED)
-                {
-                    setTransactionValidationResult(
-                        CryptoNote::error::TransactionValidationError::INPUT_SPEND_LOCKED_OUT,
-                        "Transaction includes an input which is still locked"
-                    );
+            if (result == CryptoNote::ExtractOutputKeysResult::OUTPUT_LOCKED)
+            {
+                setTransactionValidationResult(
+                    CryptoNote::error::TransactionValidationError::INPUT_SPEND_LOCKED_OUT,
+                    "Transaction includes an input which is still locked"
+                );
 
-                    return false;
-                }
+                return false;
+            }
 
-                if (m_isPoolTransaction || m_blockHeight >= CryptoNote::parameters::TRANSACTION_SIGNATURE_COUNT_VALIDATION_HEIGHT)
-               {
+            if (m_isPoolTransaction || m_blockHeight >= CryptoNote::parameters::TRANSACTION_SIGNATURE_COUNT_VALIDATION_HEIGHT)
+            {
                 if (outputKeys.size() != m_transaction.signatures[inputIndex].size())
                 {
                     setTransactionValidationResult(
@@ -633,38 +663,43 @@ bool ValidateTransaction::validateTransactionInputsExpensive()
                 }
             }
 
-            if (!Crypto::crypto_ops::checkRingSignature(
-                prefixHash,
-                in.keyImage,
-                outputKeys,
-                m_transaction.signatures[inputIndex]))
+            /* The signatures were already verified against these exact ring
+               members while the block was being prepared */
+            const bool alreadyVerified = m_preparedChecks != nullptr
+                && inputIndex < m_preparedChecks->verifiedRings.size()
+                && !m_preparedChecks->verifiedRings[inputIndex].empty()
+                && m_preparedChecks->verifiedRings[inputIndex] == outputKeys;
+
+            if (!alreadyVerified)
             {
-                setTransactionValidationResult(
-                    CryptoNote::error::TransactionValidationError::INPUT_INVALID_SIGNATURES,
-                    "Transaction contains invalid signatures"
-                );
+                batch.addRing(prefixHash, in.keyImage, outputKeys, m_transaction.signatures[inputIndex]);
+            }
 
-            return false;
+            groupRings[inputIndex - groupStart] = std::move(outputKeys);
         }
 
-        return true;
-        }));
-
-        inputIndex++;
-    }
+        if (!batch.verify())
+        {
+            setTransactionValidationResult(
+                CryptoNote::error::TransactionValidationError::INPUT_INVALID_SIGNATURES,
+                "Transaction contains invalid signatures"
+            );
 
-    bool valid = true;
+            return false;
+        }
 
-    for (auto &result : validationResult)
-    {
-        if (!result.get())
+        for (size_t inputIndex = groupStart; inputIndex < groupEnd; inputIndex++)
         {
-            valid = false;
-            cancelValidation = true;
+            m_verifiedChecks.verifiedRings[inputIndex] = std::move(groupRings[inputIndex - groupStart]);
         }
-    }
 
-    return valid;
+        return true;
+    });
+}
+
+const CryptoNote::PreparedTransactionChecks &ValidateTransaction::getVerifiedChecks() const
+{
+    return m_verifiedChecks;
 }
 
 
@@ -16,7 +16,8 @@
 #include <cryptonotecore/Checkpoints.h>
 #include <cryptonotecore/Currency.h>
 #include <cryptonotecore/IBlockchainCache.h>
-#include <utilities/ThreadPool.h>
+#include <cryptonotecore/PreparedBlock.h>
+#include <utilities/TaskScheduler.h>
 
 struct TransactionValidationResult
 {
@@ -48,11 +49,12 @@ class ValidateTransaction
             CryptoNote::IBlockchainCache *cache,
             const CryptoNote::Currency &currency,
             const CryptoNote::Checkpoints &checkpoints,
-            Utilities::ThreadPool<bool> &threadPool,
+            Utilities::TaskScheduler &scheduler,
             uint64_t blockHeight,
             uint64_t blockSizeMedian,
             uint64_t blockTimestamp,
-            bool isPoolTransaction);
+            bool isPoolTransaction,
+            const CryptoNote::PreparedTransactionChecks *preparedChecks = nullptr);
 
         /////////////////////////////
         /* PUBLIC MEMBER FUNCTIONS */
@@ -61,6 +63,13 @@ class ValidateTransaction
 
         TransactionValidationResult revalidateAfterHeightChange();
 
+        static bool checkTransactionPoW(const CryptoNote::Transaction &transaction, uint64_t blockHeight);
+
+        /* The proof of work and ring signatures verified by validate(), which
+           can be passed as the prepared checks when the transaction is
+           validated again, such as when a pool transaction is mined */
+        const CryptoNote::PreparedTransactionChecks &getVerifiedChecks() const;
+
     private:
         //////////////////////////////
         /* PRIVATE MEMBER FUNCTIONS */
@@ -106,12 +115,19 @@ class ValidateTransaction
 
         const bool m_isPoolTransaction;
 
+        /* Results of checks already done while the block was being prepared,
+           may be null */
+        const CryptoNote::PreparedTransactionChecks *m_preparedChecks;
+
+        /* Each input's entry is only written by the group validating it */
+        CryptoNote::PreparedTransactionChecks m_verifiedChecks;
+
         TransactionValidationResult m_validationResult;
 
         uint64_t m_sumOfOutputs = 0;
         uint64_t m_sumOfInputs = 0;
 
-        Utilities::ThreadPool<bool> &m_threadPool;
+        Utilities::TaskScheduler &m_scheduler;
 
         std::mutex m_mutex;
 };
@@ -0,0 +1,84 @@
+// Copyright (c) 2018-2024, The DeroGold Developers
+//
+// Please see the included LICENSE file for more information.
+
+#include "WalletSyncCache.h"
+
+#include <mutex>
+
+namespace CryptoNote
+{
+    WalletSyncCache::WalletSyncCache(uint64_t capacity):
+        m_capacity(capacity)
+    {
+    }
+
+    bool WalletSyncCache::enabled() const
+    {
+        return m_capacity != 0;
+    }
+
+    void WalletSyncCache::setNetworkHeight(uint64_t networkHeight)
+    {
+        m_networkHeight = networkHeight;
+    }
+
+    bool WalletSyncCache::wants(uint64_t blockHeight) const
+    {
+        return enabled() && blockHeight + m_capacity >= m_networkHeight;
+    }
+
+    std::shared_ptr<const WalletTypes::WalletBlockInfo>
+        WalletSyncCache::get(uint64_t blockHeight, const Crypto::Hash &blockHash) const
+    {
+        std::shared_lock<std::shared_mutex> lock(m_mutex);
+
+        const auto it = m_blocks.find(blockHeight);
+
+        if (it == m_blocks.end() || it->second->blockHash != blockHash)
+        {
+            return nullptr;
+        }
+
+        return it->second;
+    }
+
+    void WalletSyncCache::insert(WalletTypes::WalletBlockInfo &&block)
+    {
+        if (!enabled())
+        {
+            return;
+        }
+
+        const uint64_t blockHeight = block.blockHeight;
+
+        std::unique_lock<std::shared_mutex> lock(m_mutex);
+
+        /* Full of more recent blocks, which are the ones most wallets ask for */
+        if (m_blocks.size() >= m_capacity && blockHeight < m_blocks.begin()->first)
+        {
+            return;
+        }
+
+        m_blocks[blockHeight] = std::make_shared<const WalletTypes::WalletBlockInfo>(std::move(block));
+
+        while (m_blocks.size() > m_capacity)
+        {
+            m_blocks.erase(m_blocks.begin());
+        }
+    }
+
+    void WalletSyncCache::removeFrom(uint64_t blockHeight)
+    {
+        std::unique_lock<std::shared_mutex> lock(m_mutex);
+
+        m_blocks.erase(m_blocks.lower_bound(blockHeight), m_blocks.end());
+    }
+
+    void WalletSyncCache::clear()
+    {
+        std::unique_lock<std::shared_mutex> lock(m_mutex);
+
+        m_blocks.clear();
+    }
+} // namespace CryptoNote
@@ -0,0 +1,58 @@
+// Copyright (c) 2018-2024, The DeroGold Developers
+//
+// Please see the included LICENSE file for more information.
+
+#pragma once
+
+#include <WalletTypes.h>
+#include <atomic>
+#include <crypto/crypto.h>
+#include <map>
+#include <memory>
+#include <shared_mutex>
+
+namespace CryptoNote
+{
+    /* The wallet sync data of the most recent blocks on the main chain, ready
+       to be sent to wallets without reading and parsing the blocks again.
+       Entries are checked against the hash of the block on the main chain
+       when looked up, so a stale entry left after a reorg is never returned.
+       May be used from multiple threads. */
+    class WalletSyncCache
+    {
+      public:
+        /* Keeps the blocks with the highest capacity heights, 0 disables the cache */
+        explicit WalletSyncCache(uint64_t capacity);
+
+        bool enabled() const;
+
+        /* The height of the network, from our peers, or 0 if it isn't known */
+        void setNetworkHeight(uint64_t networkHeight);
+
+        /* Whether a newly added main chain block is worth caching: it is
+           within the capacity of the network height, so isn't evicted by
+           the blocks after it before wallets get to it */
+        bool wants(uint64_t blockHeight) const;
+
+        /* The cached block at the height, or null if it isn't cached or is a
+           different block than the one given */
+        std::shared_ptr<const WalletTypes::WalletBlockInfo> get(uint64_t blockHeight, const Crypto::Hash &blockHash) const;
+
+        /* The block must include its coinbase transaction */
+        void insert(WalletTypes::WalletBlockInfo &&block);
+
+        /* Removes the blocks at the height and above */
+        void removeFrom(uint64_t blockHeight);
+
+        void clear();
+
+      private:
+        const uint64_t m_capacity;
+
+        std::atomic<uint64_t> m_networkHeight {0};
+
+        mutable std::shared_mutex m_mutex;
+
+        std::map<uint64_t, std::shared_ptr<const WalletTypes::WalletBlockInfo>> m_blocks;
+    };
+} // namespace CryptoNote
@@ -0,0 +1,272 @@
+// Copyright (c) 2018-2024, The DeroGold Developers
+//
+// Please see the included LICENSE file for more information.
+
+#include "BlockDownloadScheduler.h"
+
+#include <algorithm>
+#include <config/CryptoNoteConfig.h>
+
+namespace CryptoNote
+{
+    bool BlockDownloadScheduler::addHashes(
+        const boost::uuids::uuid &peer,
+        uint32_t startHeight,
+        const std::vector<Crypto::Hash> &hashes)
+    {
+        auto &state = m_peers[peer];
+
+        state.chainRequested = false;
+        state.chainStart.reset();
+        state.forked = false;
+
+        if (m_windows.empty())
+        {
+            m_startHeight = startHeight;
+        }
+
+        /* The peer has everything before the hashes it sent */
+        state.knownHeight = std::max(state.knownHeight, startHeight);
+
+        uint32_t height = startHeight;
+
+        for (const auto &hash : hashes)
+        {
+            /* The ones below m_startHeight are already being validated */
+            const bool differs =
+                height >= m_startHeight && height < endHeight() && m_hashes[height - m_startHeight] != hash;
+
+            /* Or they don't follow on from the scheduled ones */
+            if (differs || height > endHeight())
+            {
+                state.forked = true;
+                return false;
+            }
+
+            if (height == endHeight())
+            {
+                append(hash);
+            }
+
+            height++;
+
+            state.knownHeight = std::max(state.knownHeight, height);
+        }
+
+        return true;
+    }
+
+    void BlockDownloadScheduler::append(const Crypto::Hash &hash)
+    {
+        /* Only windows nobody was asked for yet can grow */
+        if (m_windows.empty() || m_windows.back().peer || m_windows.back().blocks
+            || m_windows.back().count >= BLOCKS_SYNCHRONIZING_DEFAULT_COUNT)
+        {
+            auto &window = m_windows.emplace_back();
+            window.startHeight = endHeight();
+            window.count = 0;
+        }
+
+        m_windows.back().count++;
+        m_hashes.push_back(hash);
+    }
+
+    std::optional<std::vector<Crypto::Hash>>
+        BlockDownloadScheduler::assign(const boost::uuids::uuid &peer, Clock::time_point now)
+    {
+        auto &state = m_peers[peer];
+
+        if (state.requests.size() >= BLOCK_DOWNLOAD_WINDOWS_PER_PEER)
+        {
+            return std::nullopt;
+        }
+
+        const auto timeout = std::chrono::seconds(BLOCK_DOWNLOAD_WINDOW_TIMEOUT_SECONDS);
+
+        /* Only the first few windows are handed out, so a slow peer holding
+           up the next one to validate doesn't leave the rest piling up */
+        const size_t windowCount = std::min<size_t>(m_windows.size(), BLOCK_DOWNLOAD_MAX_WINDOWS);
+
+        for (size_t i = 0; i < windowCount; i++)
+        {
+            auto &window = m_windows[i];
+
+            if (window.startHeight + window.count > state.knownHeight)
+            {
+                break;
+            }
+
+            if (window.blocks)
+            {
+                continue;
+            }
+
+            if (window.peer && (*window.peer == peer || now - window.requestTime < timeout))
+            {
+                continue;
+            }
+
+            window.peer = peer;
+            window.requestTime = now;
+
+            const auto begin = m_hashes.begin() + (window.startHeight - m_startHeight);
+
+            state.requests.push_back({window.startHeight, {begin, begin + window.count}});
+
+            return state.requests.back().hashes;
+        }
+
+        return std::nullopt;
+    }
+
+    bool BlockDownloadScheduler::addBlocks(const boost::uuids::uuid &peer, std::unique_ptr<Blocks> blocks)
+    {
+        const auto it = m_peers.find(peer);
+
+        if (it == m_peers.end() || it->second.requests.empty())
+        {
+            return false;
+        }
+
+        const Request request = std::move(it->second.requests.front());
+
+        it->second.requests.pop_front();
+
+        const auto &cachedBlocks = blocks->cachedBlocks;
+
+        if (cachedBlocks.size() != request.hashes.size()
+            || !std::equal(
+                cachedBlocks.begin(),
+                cachedBlocks.end(),
+                request.hashes.begin(),
+                [](const CachedBlock &block, const Crypto::Hash &hash) { return block.getBlockHash() == hash; }))
+        {
+            return false;
+        }
+
+        /* The window may have been answered by another peer, or dropped */
+        const auto window = std::find_if(m_windows.begin(), m_windows.end(), [&](const Window &window) {
+            return window.startHeight == request.startHeight;
+        });
+
+        if (window == m_windows.end() || window->blocks || window->count != request.hashes.size()
+            || !std::equal(
+                request.hashes.begin(), request.hashes.end(), m_hashes.begin() + (window->startHeight - m_startHeight)))
+        {
+            return true;
+        }
+
+        window->source = peer;
+        window->blocks = std::move(blocks);
+
+        return true;
+    }
+
+    std::optional<BlockDownloadScheduler::ReadyWindow> BlockDownloadScheduler::takeReady()
+    {
+        if (m_windows.empty() || !m_windows.front().blocks)
+        {
+            return std::nullopt;
+        }
+
+        auto &window = m_windows.front();
+
+        ReadyWindow ready {window.startHeight, window.source, std::move(window.blocks)};
+
+        m_hashes.erase(m_hashes.begin(), m_hashes.begin() + window.count);
+        m_startHeight += window.count;
+
+        m_windows.pop_front();
+
+        return ready;
+    }
+
+    void BlockDownloadScheduler::removePeer(const boost::uuids::uuid &peer)
+    {
+        m_peers.erase(peer);
+
+        for (auto &window : m_windows)
+        {
+            if (window.peer == peer && !window.blocks)
+            {
+                window.peer.reset();
+            }
+        }
+    }
+
+    void BlockDownloadScheduler::clear()
+    {
+        m_hashes.clear();
+        m_windows.clear();
+
+        for (auto &[id, peer] : m_peers)
+        {
+            peer.knownHeight = 0;
+            peer.forked = false;
+        }
+    }
+
+    bool BlockDownloadScheduler::empty() const
+    {
+        return m_windows.empty();
+    }
+
+    bool BlockDownloadScheduler::isBusy(const boost::uuids::uuid &peer) const
+    {
+        const auto it = m_peers.find(peer);
+
+        return it != m_peers.end() && (it->second.chainRequested || !it->second.requests.empty());
+    }
+
+    bool BlockDownloadScheduler::needsHashes(const boost::uuids::uuid &peer, uint32_t remoteHeight) const
+    {
+        const auto it = m_peers.find(peer);
+
+        if (it == m_peers.end())
+        {
+            return true;
+        }
+
+        if (it->second.forked || it->second.knownHeight >= remoteHeight)
+        {
+            return false;
+        }
+
+        /* Either the peer hasn't told us it has the scheduled blocks yet, or
+           we're running out of windows to hand out */
+        return it->second.knownHeight < endHeight()
+               || m_hashes.size() < BLOCK_DOWNLOAD_MAX_WINDOWS * BLOCKS_SYNCHRONIZING_DEFAULT_COUNT;
+    }
+
+    void BlockDownloadScheduler::setChainRequested(
+        const boost::uuids::uuid &peer,
+        const std::optional<Crypto::Hash> &startHash)
+    {
+        auto &state = m_peers[peer];
+
+        state.chainRequested = true;
+        state.chainStart = startHash;
+    }
+
+    bool BlockDownloadScheduler::isChainStart(const boost::uuids::uuid &peer, const Crypto::Hash &hash) const
+    {
+        const auto it = m_peers.find(peer);
+
+        return it != m_peers.end() && it->second.chainStart == hash;
+    }
+
+    std::optional<Crypto::Hash> BlockDownloadScheduler::lastHash() const
+    {
+        if (m_hashes.empty())
+        {
+            return std::nullopt;
+        }
+
+        return m_hashes.back();
+    }
+
+    uint32_t BlockDownloadScheduler::endHeight() const
+    {
+        return m_startHeight + static_cast<uint32_t>(m_hashes.size());
+    }
+} // namespace CryptoNote
@@ -0,0 +1,154 @@
+// Copyright (c) 2018-2024, The DeroGold Developers
+//
+// Please see the included LICENSE file for more information.
+
+#pragma once
+
+#include <CryptoNote.h>
+#include <boost/uuid/uuid.hpp>
+#include <chrono>
+#include <cryptonotecore/CachedBlock.h>
+#include <deque>
+#include <map>
+#include <memory>
+#include <optional>
+#include <vector>
+
+namespace CryptoNote
+{
+    /* Splits the block hashes we still need while syncing into windows,
+       hands them out to all the peers which have them, and gives back the
+       downloaded windows in chain order, however they arrive.
+
+       Peers are identified by their connection id. Only used from the
+       dispatcher thread, so there is no locking. */
+    class BlockDownloadScheduler
+    {
+      public:
+        using Clock = std::chrono::steady_clock;
+
+        struct Blocks
+        {
+            std::vector<RawBlock> rawBlocks;
+
+            /* The cached blocks refer to these, so it must not be resized
+               once they are made */
+            std::vector<BlockTemplate> blockTemplates;
+
+            std::vector<CachedBlock> cachedBlocks;
+        };
+
+        struct ReadyWindow
+        {
+            uint32_t startHeight;
+
+            /* The peer the blocks came from */
+            boost::uuids::uuid source;
+
+            std::unique_ptr<Blocks> blocks;
+        };
+
+        /* Adds the hashes a peer sent in a chain entry, the first of which
+           is at startHeight. Returns false if they don't match the ones
+           already scheduled, in which case the peer is on another chain,
+           and is only asked for the windows before where they differ. */
+        bool addHashes(
+            const boost::uuids::uuid &peer,
+            uint32_t startHeight,
+            const std::vector<Crypto::Hash> &hashes);
+
+        /* Gives the peer the first window it has which isn't requested yet,
+           or which another peer hasn't answered in time, if it doesn't have
+           too many requests in flight already */
+        std::optional<std::vector<Crypto::Hash>> assign(const boost::uuids::uuid &peer, Clock::time_point now);
+
+        /* Takes the answer to the oldest request made to the peer. Returns
+           false if it isn't the blocks that were asked for. */
+        bool addBlocks(const boost::uuids::uuid &peer, std::unique_ptr<Blocks> blocks);
+
+        /* Removes the first window, if it is downloaded */
+        std::optional<ReadyWindow> takeReady();
+
+        void removePeer(const boost::uuids::uuid &peer);
+
+        /* Drops every window, for when the scheduled blocks turn out to be
+           bad. Answers to requests already made are still accepted, and
+           thrown away. */
+        void clear();
+
+        bool empty() const;
+
+        /* Whether there are requests to the peer in flight */
+        bool isBusy(const boost::uuids::uuid &peer) const;
+
+        /* Whether we want more hashes to schedule from the peer */
+        bool needsHashes(const boost::uuids::uuid &peer, uint32_t remoteHeight) const;
+
+        /* The peer was asked for hashes, carrying on from startHash if one
+           of the scheduled hashes was given */
+        void setChainRequested(const boost::uuids::uuid &peer, const std::optional<Crypto::Hash> &startHash);
+
+        /* Whether the peer's chain entry can start from the hash, as it's
+           the scheduled hash the peer was asked to carry on from. The hash
+           may have been validated or dropped since it was asked for. */
+        bool isChainStart(const boost::uuids::uuid &peer, const Crypto::Hash &hash) const;
+
+        /* The last scheduled hash, which the next chain entry can start from */
+        std::optional<Crypto::Hash> lastHash() const;
+
+      private:
+        struct Window
+        {
+            uint32_t startHeight;
+
+            uint32_t count;
+
+            /* Who it was last requested from, and when */
+            std::optional<boost::uuids::uuid> peer;
+
+            Clock::time_point requestTime;
+
+            boost::uuids::uuid source;
+
+            std::unique_ptr<Blocks> blocks;
+        };
+
+        struct Request
+        {
+            uint32_t startHeight;
+
+            std::vector<Crypto::Hash> hashes;
+        };
+
+        struct Peer
+        {
+            /* Every scheduled block below this height is on the peer's chain */
+            uint32_t knownHeight = 0;
+
+            /* The peer's chain differs from the scheduled one */
+            bool forked = false;
+
+            bool chainRequested = false;
+
+            /* The scheduled hash the chain was requested from */
+            std::optional<Crypto::Hash> chainStart;
+
+            /* The requests in flight, oldest first */
+            std::deque<Request> requests;
+        };
+
+        uint32_t endHeight() const;
+
+        void append(const Crypto::Hash &hash);
+
+        /* The height of m_hashes.front() */
+        uint32_t m_startHeight = 0;
+
+        std::deque<Crypto::Hash> m_hashes;
+
+        /* Covering m_hashes, in order */
+        std::deque<Window> m_windows;
+
+        std::map<boost::uuids::uuid, Peer> m_peers;
+    };
+} // namespace CryptoNote
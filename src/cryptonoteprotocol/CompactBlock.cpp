@@ -0,0 +1,231 @@
+// Copyright (c) 2018-2024, The DeroGold Developers
+//
+// Please see the included LICENSE file for more information.
+
+#include "CompactBlock.h"
+
+#include "common/CryptoNoteTools.h"
+#include "cryptonotecore/CachedBlock.h"
+
+#include <config/CryptoNoteConfig.h>
+#include <cstring>
+#include <unordered_map>
+
+namespace CryptoNote
+{
+    namespace CompactBlock
+    {
+        uint64_t shortTransactionId(uint64_t salt, const Crypto::Hash &transactionHash)
+        {
+            uint8_t data[sizeof(salt) + sizeof(transactionHash.data)];
+            std::memcpy(data, &salt, sizeof(salt));
+            std::memcpy(data + sizeof(salt), transactionHash.data, sizeof(transactionHash.data));
+
+            const Crypto::Hash hash = Crypto::cn_fast_hash(data, sizeof(data));
+
+            uint64_t id = 0;
+            std::memcpy(&id, hash.data, COMPACT_BLOCK_SHORT_ID_SIZE);
+            return id;
+        }
+
+        std::optional<Relay> makeRelay(const RawBlockLegacy &block, uint64_t salt, uint32_t currentHeight, uint32_t hop)
+        {
+            BlockTemplate blockTemplate;
+
+            if (!fromBinaryArray(blockTemplate, block.blockTemplate)
+                || blockTemplate.transactionHashes.size() != block.transactions.size()
+                || blockTemplate.transactionHashes.size() > COMPACT_BLOCK_MAX_TRANSACTIONS)
+            {
+                return std::nullopt;
+            }
+
+            Relay relay;
+
+            relay.request.blockHash = CachedBlock(blockTemplate).getBlockHash();
+            relay.request.salt = salt;
+            relay.request.current_blockchain_height = currentHeight;
+            relay.request.hop = hop;
+
+            relay.transactionHashes = std::move(blockTemplate.transactionHashes);
+            blockTemplate.transactionHashes.clear();
+
+            if (!toBinaryArray(blockTemplate, relay.request.blockTemplate))
+            {
+                return std::nullopt;
+            }
+
+            for (const auto &hash : relay.transactionHashes)
+            {
+                const uint64_t id = shortTransactionId(salt, hash);
+                const auto idBytes = reinterpret_cast<const uint8_t *>(&id);
+                relay.shortIds.insert(relay.shortIds.end(), idBytes, idBytes + COMPACT_BLOCK_SHORT_ID_SIZE);
+            }
+
+            return relay;
+        }
+
+        NOTIFY_NEW_COMPACT_BLOCK_request makePeerBlock(
+            const Relay &relay,
+            const std::vector<BinaryArray> &transactions,
+            const std::function<bool(const Crypto::Hash &)> &isNew)
+        {
+            NOTIFY_NEW_COMPACT_BLOCK_request request = relay.request;
+
+            for (size_t i = 0; i < relay.transactionHashes.size(); i++)
+            {
+                if (isNew(relay.transactionHashes[i]))
+                {
+                    request.prefilledIndexes.push_back(static_cast<uint32_t>(i));
+                    request.prefilledTransactions.push_back(transactions[i]);
+                }
+                else
+                {
+                    const auto id = relay.shortIds.begin() + i * COMPACT_BLOCK_SHORT_ID_SIZE;
+                    request.shortIds.insert(request.shortIds.end(), id, id + COMPACT_BLOCK_SHORT_ID_SIZE);
+                }
+            }
+
+            return request;
+        }
+
+        bool parse(const NOTIFY_NEW_COMPACT_BLOCK_request &request, BlockTemplate &blockTemplate)
+        {
+            const size_t transactionCount =
+                request.prefilledIndexes.size() + request.shortIds.size() / COMPACT_BLOCK_SHORT_ID_SIZE;
+
+            if (request.shortIds.size() % COMPACT_BLOCK_SHORT_ID_SIZE != 0
+                || request.prefilledIndexes.size() != request.prefilledTransactions.size()
+                || transactionCount > COMPACT_BLOCK_MAX_TRANSACTIONS)
+            {
+                return false;
+            }
+
+            /* In ascending order, so each one is in the block once */
+            for (size_t i = 0; i < request.prefilledIndexes.size(); i++)
+            {
+                if (request.prefilledIndexes[i] >= transactionCount
+                    || (i != 0 && request.prefilledIndexes[i - 1] >= request.prefilledIndexes[i]))
+                {
+                    return false;
+                }
+            }
+
+            return fromBinaryArray(blockTemplate, request.blockTemplate) && blockTemplate.transactionHashes.empty();
+        }
+
+        PendingCompactBlock rebuild(
+            NOTIFY_NEW_COMPACT_BLOCK_request &&request,
+            BlockTemplate &&blockTemplate,
+            const std::vector<Crypto::Hash> &poolHashes,
+            const std::function<std::optional<BinaryArray>(const Crypto::Hash &)> &getPoolTransaction)
+        {
+            /* The short id of every pool transaction, and nothing for an id
+               shared by two of them */
+            std::unordered_map<uint64_t, std::optional<Crypto::Hash>> poolIds;
+
+            for (const auto &hash : poolHashes)
+            {
+                const auto [it, inserted] = poolIds.emplace(shortTransactionId(request.salt, hash), hash);
+
+                if (!inserted)
+                {
+                    it->second = std::nullopt;
+                }
+            }
+
+            PendingCompactBlock block;
+            block.blockTemplate = std::move(blockTemplate);
+
+            const size_t transactionCount =
+                request.prefilledIndexes.size() + request.shortIds.size() / COMPACT_BLOCK_SHORT_ID_SIZE;
+
+            block.transactions.resize(transactionCount);
+
+            for (size_t i = 0, prefilled = 0, shortId = 0; i < transactionCount; i++)
+            {
+                if (prefilled < request.prefilledIndexes.size() && request.prefilledIndexes[prefilled] == i)
+                {
+                    block.transactions[i] = std::move(request.prefilledTransactions[prefilled++]);
+                    continue;
+                }
+
+                uint64_t id = 0;
+                std::memcpy(
+                    &id,
+                    request.shortIds.data() + shortId++ * COMPACT_BLOCK_SHORT_ID_SIZE,
+                    COMPACT_BLOCK_SHORT_ID_SIZE);
+
+                const auto it = poolIds.find(id);
+
+                if (it != poolIds.end() && it->second)
+                {
+                    /* May have been mined or dropped since the hashes were got */
+                    if (auto transaction = getPoolTransaction(*it->second))
+                    {
+                        block.transactions[i] = std::move(*transaction);
+                        block.poolIndexes.push_back(static_cast<uint32_t>(i));
+                        continue;
+                    }
+                }
+
+                block.missingIndexes.push_back(static_cast<uint32_t>(i));
+            }
+
+            request.prefilledTransactions.clear();
+            block.request = std::move(request);
+
+            return block;
+        }
+
+        bool addMissingTransactions(PendingCompactBlock &block, std::vector<BinaryArray> &&transactions)
+        {
+            if (transactions.size() != block.missingIndexes.size())
+            {
+                return false;
+            }
+
+            for (size_t i = 0; i < transactions.size(); i++)
+            {
+                block.transactions[block.missingIndexes[i]] = std::move(transactions[i]);
+            }
+
+            block.missingIndexes.clear();
+
+            return true;
+        }
+
+        CheckResult check(PendingCompactBlock &block)
+        {
+            auto &transactionHashes = block.blockTemplate.transactionHashes;
+
+            transactionHashes.clear();
+            transactionHashes.reserve(block.transactions.size());
+
+            for (const auto &transaction : block.transactions)
+            {
+                transactionHashes.push_back(getBinaryArrayHash(transaction));
+            }
+
+            if (CachedBlock(block.blockTemplate).getBlockHash() == block.request.blockHash)
+            {
+                return CheckResult::Valid;
+            }
+
+            /* Nothing came from the pool, so it's all what the peer sent */
+            if (block.poolIndexes.empty())
+            {
+                return CheckResult::Invalid;
+            }
+
+            for (const auto index : block.poolIndexes)
+            {
+                block.transactions[index].clear();
+            }
+
+            block.missingIndexes = std::move(block.poolIndexes);
+            block.poolIndexes.clear();
+
+            return CheckResult::Collision;
+        }
+    } // namespace CompactBlock
+} // namespace CryptoNote
@@ -0,0 +1,83 @@
+// Copyright (c) 2018-2024, The DeroGold Developers
+//
+// Please see the included LICENSE file for more information.
+
+#pragma once
+
+#include "cryptonoteprotocol/CryptoNoteProtocolDefinitions.h"
+#include "p2p/PendingCompactBlock.h"
+
+#include <functional>
+#include <optional>
+#include <vector>
+
+namespace CryptoNote
+{
+    /* Building the compact blocks relayed to peers, and rebuilding the ones
+       they relay to us. The protocol handler deals with the connections, the
+       pool and the chain around these. */
+    namespace CompactBlock
+    {
+        /* The first COMPACT_BLOCK_SHORT_ID_SIZE bytes of the hash of the salt
+           and the transaction hash */
+        uint64_t shortTransactionId(uint64_t salt, const Crypto::Hash &transactionHash);
+
+        /* The parts of a compact block which are the same for every peer */
+        struct Relay
+        {
+            /* Without any prefilled transactions or short ids */
+            NOTIFY_NEW_COMPACT_BLOCK_request request;
+
+            std::vector<Crypto::Hash> transactionHashes;
+
+            /* The short id of each transaction, in block order */
+            BinaryArray shortIds;
+        };
+
+        /* Returns nothing if the block can't be sent as a compact block */
+        std::optional<Relay> makeRelay(const RawBlockLegacy &block, uint64_t salt, uint32_t currentHeight, uint32_t hop);
+
+        /* The compact block for one peer. The transactions isNew() returns
+           true for are sent whole, as the peer likely doesn't have them. */
+        NOTIFY_NEW_COMPACT_BLOCK_request makePeerBlock(
+            const Relay &relay,
+            const std::vector<BinaryArray> &transactions,
+            const std::function<bool(const Crypto::Hash &)> &isNew);
+
+        /* Checks the prefilled transactions and short ids add up, and parses
+           the block template */
+        bool parse(const NOTIFY_NEW_COMPACT_BLOCK_request &request, BlockTemplate &blockTemplate);
+
+        /* Puts the prefilled transactions and the ones found in the pool by
+           their short id in place. The rest are left in missingIndexes. A
+           short id shared by two pool transactions counts as missing, as it
+           can't tell them apart. getPoolTransaction must look up and copy a
+           transaction in one step, as the pool may have changed since
+           poolHashes was taken, and returns nothing if it's gone. */
+        PendingCompactBlock rebuild(
+            NOTIFY_NEW_COMPACT_BLOCK_request &&request,
+            BlockTemplate &&blockTemplate,
+            const std::vector<Crypto::Hash> &poolHashes,
+            const std::function<std::optional<BinaryArray>(const Crypto::Hash &)> &getPoolTransaction);
+
+        /* Puts the transactions which were asked for in place. Returns false
+           if there aren't as many as were asked for. */
+        bool addMissingTransactions(PendingCompactBlock &block, std::vector<BinaryArray> &&transactions);
+
+        enum class CheckResult
+        {
+            Valid,
+
+            /* A pool transaction had the same short id as one in the block */
+            Collision,
+
+            /* The peer sent a bad block */
+            Invalid
+        };
+
+        /* Sets the transaction hashes of the rebuilt block and checks them
+           against the block hash. On a collision, every transaction taken
+           from the pool is moved to missingIndexes, to be asked for. */
+        CheckResult check(PendingCompactBlock &block);
+    } // namespace CompactBlock
+} // namespace CryptoNote
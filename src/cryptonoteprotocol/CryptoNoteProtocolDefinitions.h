@@ -207,4 +207,125 @@ namespace CryptoNote
         const static int ID = BC_COMMANDS_POOL_BASE + 10;
         typedef NOTIFY_MISSING_TXS_request request;
     };
+
+    /************************************************************************/
+    /*                                                                      */
+    /************************************************************************/
+    /* Announces transactions which were added to the pool, to peers at
+       P2P_TRANSACTION_ANNOUNCE_VERSION or above */
+    struct NOTIFY_NEW_TRANSACTION_HASHES_request
+    {
+        std::vector<Crypto::Hash> txs;
+
+        void serialize(ISerializer &s)
+        {
+            serializeAsBinary(txs, "txs", s);
+        }
+    };
+
+    struct NOTIFY_NEW_TRANSACTION_HASHES
+    {
+        const static int ID = BC_COMMANDS_POOL_BASE + 11;
+        typedef NOTIFY_NEW_TRANSACTION_HASHES_request request;
+    };
+
+    /* Asks for the announced transactions we don't have */
+    struct NOTIFY_REQUEST_TRANSACTIONS_request
+    {
+        std::vector<Crypto::Hash> txs;
+
+        void serialize(ISerializer &s)
+        {
+            serializeAsBinary(txs, "txs", s);
+        }
+    };
+
+    struct NOTIFY_REQUEST_TRANSACTIONS
+    {
+        const static int ID = BC_COMMANDS_POOL_BASE + 12;
+        typedef NOTIFY_REQUEST_TRANSACTIONS_request request;
+    };
+
+    /* The requested transactions which are still in the pool. Separate from
+       NOTIFY_NEW_TRANSACTIONS, which is also the answer to NOTIFY_MISSING_TXS. */
+    struct NOTIFY_RESPONSE_TRANSACTIONS
+    {
+        const static int ID = BC_COMMANDS_POOL_BASE + 13;
+        typedef NOTIFY_NEW_TRANSACTIONS_request request;
+    };
+
+    /************************************************************************/
+    /*                                                                      */
+    /************************************************************************/
+    /* A new block for peers at P2P_COMPACT_BLOCKS_VERSION or above, which
+       refers to the transactions the peer likely has in its pool by short
+       ids, so it can be rebuilt without them being sent */
+    struct NOTIFY_NEW_COMPACT_BLOCK_request
+    {
+        /* The block, with its transaction hashes left out */
+        BinaryArray blockTemplate;
+
+        /* The hash of the whole block, to check it was rebuilt correctly */
+        Crypto::Hash blockHash;
+
+        /* Hashed into the short ids, so two transactions whose ids collide
+           in one block don't collide in the next */
+        uint64_t salt;
+
+        /* The indexes in the block of the transactions which are sent whole,
+           as the peer likely doesn't have them, in ascending order */
+        std::vector<uint32_t> prefilledIndexes;
+
+        std::vector<BinaryArray> prefilledTransactions;
+
+        /* COMPACT_BLOCK_SHORT_ID_SIZE bytes for each of the other
+           transactions, in block order */
+        BinaryArray shortIds;
+
+        uint32_t current_blockchain_height;
+
+        uint32_t hop;
+    };
+
+    struct NOTIFY_NEW_COMPACT_BLOCK
+    {
+        const static int ID = BC_COMMANDS_POOL_BASE + 14;
+        typedef NOTIFY_NEW_COMPACT_BLOCK_request request;
+    };
+
+    /* Asks for the transactions of a compact block which couldn't be found
+       in the pool */
+    struct NOTIFY_REQUEST_COMPACT_BLOCK_TRANSACTIONS_request
+    {
+        Crypto::Hash blockHash;
+
+        /* Indexes in the block, in ascending order */
+        std::vector<uint32_t> indexes;
+
+        void serialize(ISerializer &s)
+        {
+            s(blockHash, "blockHash");
+            serializeAsBinary(indexes, "indexes", s);
+        }
+    };
+
+    struct NOTIFY_REQUEST_COMPACT_BLOCK_TRANSACTIONS
+    {
+        const static int ID = BC_COMMANDS_POOL_BASE + 15;
+        typedef NOTIFY_REQUEST_COMPACT_BLOCK_TRANSACTIONS_request request;
+    };
+
+    struct NOTIFY_RESPONSE_COMPACT_BLOCK_TRANSACTIONS_request
+    {
+        Crypto::Hash blockHash;
+
+        /* In the order they were asked for */
+        std::vector<BinaryArray> txs;
+    };
+
+    struct NOTIFY_RESPONSE_COMPACT_BLOCK_TRANSACTIONS
+    {
+        const static int ID = BC_COMMANDS_POOL_BASE + 16;
+        typedef NOTIFY_RESPONSE_COMPACT_BLOCK_TRANSACTIONS_request request;
+    };
 } // namespace CryptoNote
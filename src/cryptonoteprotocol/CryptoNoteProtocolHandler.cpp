@@ -11,17 +11,25 @@
 #include "cryptonotecore/CryptoNoteBasicImpl.h"
 #include "cryptonotecore/CryptoNoteFormatUtils.h"
 #include "cryptonotecore/Currency.h"
+#include "cryptonoteprotocol/CompactBlock.h"
 #include "p2p/LevinProtocol.h"
 
+#include <algorithm>
 #include <boost/uuid/uuid_io.hpp>
 #include <chrono>
+#include <common/ScopeExit.h>
 #include <config/Ascii.h>
 #include <config/CryptoNoteConfig.h>
 #include <config/WalletConfig.h>
+#include <crypto/random.h>
 #include <future>
+#include <list>
+#include <map>
+#include <set>
 #include <utility>
 #include <serialization/SerializationTools.h>
 #include <system/Dispatcher.h>
+#include <system/RemoteContext.h>
 #include <utilities/FormatTools.h>
 
 using namespace Logging;
@@ -171,6 +179,68 @@ namespace CryptoNote
         serializeAsBinary(request.missing_txs, "missing_txs", s);
     }
 
+    // blobs are sent as strings, like in the older messages
+    static inline void serializeBlob(BinaryArray &blob, Common::StringView name, ISerializer &s)
+    {
+        std::string value;
+
+        if (s.type() == ISerializer::INPUT)
+        {
+            s(value, name);
+            blob.assign(value.begin(), value.end());
+        }
+        else
+        {
+            value.assign(blob.begin(), blob.end());
+            s(value, name);
+        }
+    }
+
+    static inline void serializeBlobs(std::vector<BinaryArray> &blobs, Common::StringView name, ISerializer &s)
+    {
+        std::vector<std::string> values;
+
+        if (s.type() == ISerializer::INPUT)
+        {
+            s(values, name);
+            blobs.reserve(values.size());
+
+            for (const auto &value : values)
+            {
+                blobs.emplace_back(value.begin(), value.end());
+            }
+        }
+        else
+        {
+            values.reserve(blobs.size());
+
+            for (const auto &blob : blobs)
+            {
+                values.emplace_back(blob.begin(), blob.end());
+            }
+
+            s(values, name);
+        }
+    }
+
+    static inline void serialize(NOTIFY_NEW_COMPACT_BLOCK_request &request, ISerializer &s)
+    {
+        serializeBlob(request.blockTemplate, "blockTemplate", s);
+        s(request.blockHash, "blockHash");
+        s(request.salt, "salt");
+        serializeAsBinary(request.prefilledIndexes, "prefilledIndexes", s);
+        serializeBlobs(request.prefilledTransactions, "prefilledTransactions", s);
+        serializeBlob(request.shortIds, "shortIds", s);
+        s(request.current_blockchain_height, "current_blockchain_height");
+        s(request.hop, "hop");
+    }
+
+    static inline void serialize(NOTIFY_RESPONSE_COMPACT_BLOCK_TRANSACTIONS_request &request, ISerializer &s)
+    {
+        s(request.blockHash, "blockHash");
+        serializeBlobs(request.txs, "txs", s);
+    }
+
     CryptoNoteProtocolHandler::CryptoNoteProtocolHandler(
         const Currency &currency,
         System::Dispatcher &dispatcher,
@@ -186,6 +256,7 @@ namespace CryptoNote
         m_observedHeight(0),
         m_blockchainHeight(0),
         m_peersCount(0),
+        m_processingBlocks(false),
         logger(std::move(log), "protocol")
     {
         if (!m_p2p)
@@ -215,11 +286,16 @@ namespace CryptoNote
 
     void CryptoNoteProtocolHandler::onConnectionClosed(CryptoNoteConnectionContext &context)
     {
+        /* Its downloads are handed to other peers on the next requestBlocks() */
+        m_downloadScheduler.removePeer(context.m_connection_id);
+
+        const uint32_t currentHeight = get_current_blockchain_height();
+
         bool updated = false;
         {
             std::lock_guard<std::mutex> lock(m_observedHeightMutex);
             uint64_t prevHeight = m_observedHeight;
-            recalculateMaxObservedHeight(context);
+            recalculateMaxObservedHeight(context, currentHeight);
             if (prevHeight != m_observedHeight)
             {
                 updated = true;
@@ -250,20 +326,46 @@ namespace CryptoNote
 
         if (context.m_state == CryptoNoteConnectionContext::state_synchronizing)
         {
-            assert(context.m_needed_objects.empty());
-            assert(context.m_requested_objects.empty());
+            requestChain(context);
+        }
 
-            NOTIFY_REQUEST_CHAIN::request r = boost::value_initialized<NOTIFY_REQUEST_CHAIN::request>();
+        return true;
+    }
+
+    void CryptoNoteProtocolHandler::requestChain(CryptoNoteConnectionContext &context)
+    {
+        NOTIFY_REQUEST_CHAIN::request r = boost::value_initialized<NOTIFY_REQUEST_CHAIN::request>();
+
+        {
+            const auto chainLock = m_core.lockChainForReading();
             r.block_ids = m_core.buildSparseChain();
-            logger(Logging::TRACE) << context << "-->>NOTIFY_REQUEST_CHAIN: m_block_ids.size()=" << r.block_ids.size();
-            post_notify<NOTIFY_REQUEST_CHAIN>(*m_p2p, r, context);
         }
 
-        return true;
+        /* Carry on from the blocks already scheduled for download, if the
+           peer has them, instead of getting their hashes again */
+        const auto lastHash = m_downloadScheduler.lastHash();
+
+        if (lastHash)
+        {
+            r.block_ids.insert(r.block_ids.begin(), *lastHash);
+        }
+
+        m_downloadScheduler.setChainRequested(context.m_connection_id, lastHash);
+
+        logger(Logging::TRACE) << context << "-->>NOTIFY_REQUEST_CHAIN: m_block_ids.size()=" << r.block_ids.size();
+        post_notify<NOTIFY_REQUEST_CHAIN>(*m_p2p, r, context);
+    }
+
+    void CryptoNoteProtocolHandler::onIdle()
+    {
+        requestBlocks();
+        sendTransactionAnnouncements();
     }
 
     CoreStatistics CryptoNoteProtocolHandler::getStatistics()
     {
+        const auto chainLock = m_core.lockChainForReading();
+
         return m_core.getCoreStatistics();
     }
 
@@ -294,6 +396,8 @@ namespace CryptoNote
 
     uint32_t CryptoNoteProtocolHandler::get_current_blockchain_height()
     {
+        const auto chainLock = m_core.lockChainForReading();
+
         return m_core.getTopBlockIndex() + 1;
     }
 
@@ -307,10 +411,17 @@ namespace CryptoNote
             return true;
         }
 
+        bool haveTopBlock;
+
+        {
+            const auto chainLock = m_core.lockChainForReading();
+            haveTopBlock = m_core.hasBlock(hshd.top_id);
+        }
+
         if (context.m_state == CryptoNoteConnectionContext::state_synchronizing)
         {
         }
-        else if (m_core.hasBlock(hshd.top_id))
+        else if (haveTopBlock)
         {
             if (is_initial)
             {
@@ -412,6 +523,8 @@ namespace CryptoNote
 
     bool CryptoNoteProtocolHandler::get_payload_sync_data(CORE_SYNC_DATA &hshd)
     {
+        const auto chainLock = m_core.lockChainForReading();
+
         hshd.top_id = m_core.getTopBlockHash();
         hshd.current_height = m_core.getTopBlockIndex() + 1;
         return true;
@@ -464,6 +577,12 @@ namespace CryptoNote
             HANDLE_NOTIFY(NOTIFY_REQUEST_TX_POOL, handleRequestTxPool)
             HANDLE_NOTIFY(NOTIFY_NEW_LITE_BLOCK, handle_notify_new_lite_block)
             HANDLE_NOTIFY(NOTIFY_MISSING_TXS, handle_notify_missing_txs)
+            HANDLE_NOTIFY(NOTIFY_NEW_TRANSACTION_HASHES, handle_notify_new_transaction_hashes)
+            HANDLE_NOTIFY(NOTIFY_REQUEST_TRANSACTIONS, handle_request_transactions)
+            HANDLE_NOTIFY(NOTIFY_RESPONSE_TRANSACTIONS, handle_response_transactions)
+            HANDLE_NOTIFY(NOTIFY_NEW_COMPACT_BLOCK, handle_notify_new_compact_block)
+            HANDLE_NOTIFY(NOTIFY_REQUEST_COMPACT_BLOCK_TRANSACTIONS, handle_request_compact_block_transactions)
+            HANDLE_NOTIFY(NOTIFY_RESPONSE_COMPACT_BLOCK_TRANSACTIONS, handle_response_compact_block_transactions)
 
             default:
                 handled = false;
@@ -487,23 +606,26 @@ namespace CryptoNote
             return 1;
         }
 
+        pushRelayedBlock(std::move(arg), context);
+
+        return 1;
+    }
+
+    void CryptoNoteProtocolHandler::pushRelayedBlock(NOTIFY_NEW_BLOCK::request &&arg, CryptoNoteConnectionContext &context)
+    {
         auto result = m_core.addBlock(RawBlock {arg.block.blockTemplate, arg.block.transactions});
         if (result == error::AddBlockErrorCondition::BLOCK_ADDED)
         {
             if (result == error::AddBlockErrorCode::ADDED_TO_ALTERNATIVE_AND_SWITCHED)
             {
                 ++arg.hop;
-                // TODO: Add here announce protocol usage
-                relayBlock(arg);
-                // relay_block(arg, context);
+                relayBlockToPeers(arg, &context.m_connection_id);
                 requestMissingPoolTransactions(context);
             }
             else if (result == error::AddBlockErrorCode::ADDED_TO_MAIN)
             {
                 ++arg.hop;
-                // TODO: Add here announce protocol usage
-                relayBlock(arg);
-                // relay_block(arg, context);
+                relayBlockToPeers(arg, &context.m_connection_id);
             }
             else if (result == error::AddBlockErrorCode::ADDED_TO_ALTERNATIVE)
             {
@@ -517,10 +639,7 @@ namespace CryptoNote
         else if (result == error::AddBlockErrorCondition::BLOCK_REJECTED)
         {
             context.m_state = CryptoNoteConnectionContext::state_synchronizing;
-            NOTIFY_REQUEST_CHAIN::request r = boost::value_initialized<NOTIFY_REQUEST_CHAIN::request>();
-            r.block_ids = m_core.buildSparseChain();
-            logger(Logging::TRACE) << context << "-->>NOTIFY_REQUEST_CHAIN: m_block_ids.size()=" << r.block_ids.size();
-            post_notify<NOTIFY_REQUEST_CHAIN>(*m_p2p, r, context);
+            requestChain(context);
         }
         else
         {
@@ -528,8 +647,6 @@ namespace CryptoNote
                                        << "Block verification failed, dropping connection: " << result.message();
             context.m_state = CryptoNoteConnectionContext::state_shutdown;
         }
-
-        return 1;
     }
 
     int CryptoNoteProtocolHandler::handle_notify_new_transactions(
@@ -553,258 +670,652 @@ namespace CryptoNote
         }
         else
         {
-            const auto it = std::remove_if(arg.txs.begin(), arg.txs.end(), [this, &context](const auto &tx) {
-                const auto [success, error] = this->m_core.addTransactionToPool(tx);
+            addRelayedTransactions(std::move(arg.txs), context);
+        }
+
+        return true;
+    }
+
+    int CryptoNoteProtocolHandler::handle_notify_new_transaction_hashes(
+        int command,
+        NOTIFY_NEW_TRANSACTION_HASHES::request &arg,
+        CryptoNoteConnectionContext &context)
+    {
+        logger(Logging::TRACE) << context << "NOTIFY_NEW_TRANSACTION_HASHES: txs.size() = " << arg.txs.size();
+
+        if (context.m_state != CryptoNoteConnectionContext::state_normal)
+        {
+            return 1;
+        }
+
+        if (arg.txs.size() > TRANSACTION_ANNOUNCE_MAX_COUNT)
+        {
+            arg.txs.resize(TRANSACTION_ANNOUNCE_MAX_COUNT);
+        }
+
+        const auto now = std::chrono::steady_clock::now();
+
+        NOTIFY_REQUEST_TRANSACTIONS::request request;
+
+        {
+            const auto chainLock = m_core.lockChainForReading();
+
+            for (const auto &hash : arg.txs)
+            {
+                context.m_known_transactions.add(hash);
 
-                if (!success)
+                if (m_admittingTransactions.count(hash) != 0 || m_core.hasTransaction(hash))
                 {
-                    this->logger(Logging::DEBUGGING) << context << "Tx verification failed";
+                    continue;
                 }
 
-                /* We return the opposite of success in this lambda */
-                return !success;
-            });
-            if (it != arg.txs.end())
-            {
-                arg.txs.erase(it, arg.txs.end());
-            }
+                /* Only asked for from one of the peers announcing it at a
+                   time. The others are asked in turn if it doesn't arrive. */
+                if (const auto it = m_requestedTransactions.find(hash); it != m_requestedTransactions.end())
+                {
+                    auto &announcers = it->second.announcers;
 
-            if (!arg.txs.empty())
-            {
-                // TODO: add announce usage here
-                relay_post_notify<NOTIFY_NEW_TRANSACTIONS>(*m_p2p, arg, &context.m_connection_id);
+                    if (announcers.size() < TRANSACTION_REQUEST_MAX_ANNOUNCERS
+                        && it->second.peer != context.m_connection_id
+                        && std::find(announcers.begin(), announcers.end(), context.m_connection_id)
+                               == announcers.end())
+                    {
+                        announcers.push_back(context.m_connection_id);
+                    }
+
+                    continue;
+                }
+
+                /* Left for a later announcement, by this peer or another */
+                if (m_requestedTransactions.size() >= TRANSACTION_REQUEST_MAX_TOTAL
+                    || !canRequestTransaction(context.m_connection_id))
+                {
+                    continue;
+                }
+
+                auto &transactionRequest = m_requestedTransactions[hash];
+
+                transactionRequest.requestTime = now;
+                setTransactionRequestPeer(transactionRequest, context.m_connection_id);
+
+                request.txs.push_back(hash);
             }
         }
 
-        return true;
+        if (!request.txs.empty() && !post_notify<NOTIFY_REQUEST_TRANSACTIONS>(*m_p2p, request, context))
+        {
+            logger(Logging::DEBUGGING) << context << "Failed to post notification NOTIFY_REQUEST_TRANSACTIONS";
+        }
+
+        return 1;
     }
 
-    int CryptoNoteProtocolHandler::handle_request_get_objects(
+    int CryptoNoteProtocolHandler::handle_request_transactions(
         int command,
-        NOTIFY_REQUEST_GET_OBJECTS::request &arg,
+        NOTIFY_REQUEST_TRANSACTIONS::request &arg,
         CryptoNoteConnectionContext &context)
     {
-        logger(Logging::TRACE) << context << "NOTIFY_REQUEST_GET_OBJECTS";
-        NOTIFY_RESPONSE_GET_OBJECTS::request rsp;
-        // if (!m_core.handle_get_objects(arg, rsp)) {
-        //  logger(Logging::ERROR) << context << "failed to handle request NOTIFY_REQUEST_GET_OBJECTS, dropping
-        //  connection"; context.m_state = CryptoNoteConnectionContext::state_shutdown;
-        //}
+        logger(Logging::TRACE) << context << "NOTIFY_REQUEST_TRANSACTIONS: txs.size() = " << arg.txs.size();
 
-        rsp.current_blockchain_height = m_core.getTopBlockIndex() + 1;
-        std::vector<RawBlock> rawBlocks;
-        m_core.getBlocks(arg.blocks, rawBlocks, rsp.missed_ids);
-        if (!arg.txs.empty())
+        if (arg.txs.size() > TRANSACTION_ANNOUNCE_MAX_COUNT)
         {
-            logger(Logging::WARNING, Logging::BRIGHT_YELLOW)
-                << context << "NOTIFY_RESPONSE_GET_OBJECTS: request.txs.empty() != true";
+            arg.txs.resize(TRANSACTION_ANNOUNCE_MAX_COUNT);
         }
 
-        rsp.blocks = convertRawBlocksToRawBlocksLegacy(rawBlocks);
+        NOTIFY_RESPONSE_TRANSACTIONS::request response;
+
+        for (const auto &hash : arg.txs)
+        {
+            /* Mined or dropped from the pool since being announced */
+            auto [found, transaction] = m_core.getPoolTransaction(hash);
+
+            if (found)
+            {
+                context.m_known_transactions.add(hash);
+                response.txs.push_back(std::move(transaction));
+            }
+        }
+
+        if (!response.txs.empty() && !post_notify<NOTIFY_RESPONSE_TRANSACTIONS>(*m_p2p, response, context))
+        {
+            logger(Logging::DEBUGGING) << context << "Failed to post notification NOTIFY_RESPONSE_TRANSACTIONS";
+        }
 
-        logger(Logging::TRACE) << context << "-->>NOTIFY_RESPONSE_GET_OBJECTS: blocks.size()=" << rsp.blocks.size()
-                               << ", txs.size()=" << rsp.txs.size()
-                               << ", rsp.m_current_blockchain_height=" << rsp.current_blockchain_height
-                               << ", missed_ids.size()=" << rsp.missed_ids.size();
-        post_notify<NOTIFY_RESPONSE_GET_OBJECTS>(*m_p2p, rsp, context);
         return 1;
     }
 
-    int CryptoNoteProtocolHandler::handle_response_get_objects(
+    int CryptoNoteProtocolHandler::handle_response_transactions(
         int command,
-        NOTIFY_RESPONSE_GET_OBJECTS::request &arg,
+        NOTIFY_RESPONSE_TRANSACTIONS::request &arg,
         CryptoNoteConnectionContext &context)
     {
-        logger(Logging::TRACE) << context << "NOTIFY_RESPONSE_GET_OBJECTS";
+        logger(Logging::TRACE) << context << "NOTIFY_RESPONSE_TRANSACTIONS: txs.size() = " << arg.txs.size();
 
-        if (context.m_last_response_height > arg.current_blockchain_height)
+        if (context.m_state != CryptoNoteConnectionContext::state_normal)
         {
-            logger(Logging::ERROR) << context << "sent wrong NOTIFY_HAVE_OBJECTS: arg.m_current_blockchain_height="
-                                   << arg.current_blockchain_height
-                                   << " < m_last_response_height=" << context.m_last_response_height
-                                   << ", dropping connection";
-            context.m_state = CryptoNoteConnectionContext::state_shutdown;
             return 1;
         }
 
-        updateObservedHeight(arg.current_blockchain_height, context);
-        context.m_remote_blockchain_height = arg.current_blockchain_height;
-        std::vector<BlockTemplate> blockTemplates;
-        std::vector<CachedBlock> cachedBlocks;
-        blockTemplates.resize(arg.blocks.size());
-        cachedBlocks.reserve(arg.blocks.size());
+        addRelayedTransactions(std::move(arg.txs), context);
 
-        std::vector<RawBlock> rawBlocks = convertRawBlocksLegacyToRawBlocks(arg.blocks);
+        return 1;
+    }
 
-        for (size_t index = 0; index < rawBlocks.size(); ++index)
-        {
-            if (!fromBinaryArray(blockTemplates[index], rawBlocks[index].block))
-            {
-                logger(Logging::ERROR) << context << "sent wrong block: failed to parse and validate block: \r\n"
-                                       << toHex(rawBlocks[index].block) << "\r\n dropping connection";
-                context.m_state = CryptoNoteConnectionContext::state_shutdown;
-                return 1;
-            }
+    void CryptoNoteProtocolHandler::addRelayedTransactions(
+        std::vector<BinaryArray> &&relayedTransactions,
+        CryptoNoteConnectionContext &context)
+    {
+        std::vector<BinaryArray> transactions;
 
-            cachedBlocks.emplace_back(blockTemplates[index]);
+        std::vector<Crypto::Hash> hashes;
 
-            if (m_core.hasBlock(cachedBlocks.back().getBlockHash()))
-            {
-                context.m_state = CryptoNoteConnectionContext::state_idle;
-                context.m_needed_objects.clear();
-                context.m_requested_objects.clear();
-                context.m_request_block_rate = 0;
-                context.m_next_request_block_rate = 1;
-                logger(Logging::DEBUGGING) << context << "Connection set to idle state.";
-                return 1;
-            }
+        for (auto &transaction : relayedTransactions)
+        {
+            const Crypto::Hash hash = getBinaryArrayHash(transaction);
+
+            context.m_known_transactions.add(hash);
 
-            auto req_it = context.m_requested_objects.find(cachedBlocks.back().getBlockHash());
-            if (req_it == context.m_requested_objects.end())
+            if (const auto it = m_requestedTransactions.find(hash); it != m_requestedTransactions.end())
             {
-                logger(Logging::ERROR) << context << "sent wrong NOTIFY_RESPONSE_GET_OBJECTS: block with id="
-                                       << Common::podToHex(cachedBlocks.back().getBlockHash())
-                                       << " wasn't requested, dropping connection";
-                context.m_state = CryptoNoteConnectionContext::state_shutdown;
-                return 1;
+                setTransactionRequestPeer(it->second, std::nullopt);
+                m_requestedTransactions.erase(it);
             }
 
-            if (cachedBlocks.back().getBlock().transactionHashes.size() != rawBlocks[index].transactions.size())
+            /* Transactions still being checked for another peer would only
+               be rejected as duplicates once that finishes */
+            if (m_admittingTransactions.insert(hash).second)
             {
-                logger(Logging::ERROR) << context << "sent wrong NOTIFY_RESPONSE_GET_OBJECTS: block with id="
-                                       << Common::podToHex(cachedBlocks.back().getBlockHash())
-                                       << ", transactionHashes.size()="
-                                       << cachedBlocks.back().getBlock().transactionHashes.size()
-                                       << " mismatch with block_complete_entry.m_txs.size()="
-                                       << rawBlocks[index].transactions.size() << ", dropping connection";
-                context.m_state = CryptoNoteConnectionContext::state_shutdown;
-                return 1;
+                hashes.push_back(hash);
+                transactions.push_back(std::move(transaction));
             }
-
-            context.m_requested_objects.erase(req_it);
         }
 
-        if (!context.m_requested_objects.empty())
+        std::vector<bool> added;
+
         {
-            logger(Logging::ERROR, Logging::BRIGHT_RED)
-                << context << "returned not all requested objects (context.m_requested_objects.size()="
-                << context.m_requested_objects.size() << "), dropping connection";
-            context.m_state = CryptoNoteConnectionContext::state_shutdown;
-            return 1;
+            Tools::ScopeExit admitted([this, &hashes] {
+                for (const auto &hash : hashes)
+                {
+                    m_admittingTransactions.erase(hash);
+                }
+            });
+
+            /* Checking the proof of work and signatures takes long enough
+               to hold up every other connection if done on the dispatcher */
+            System::RemoteContext<std::vector<bool>> admission(
+                m_dispatcher, [this, &transactions] { return m_core.addTransactionsToPool(transactions); });
+
+            added = admission.get();
         }
 
+        std::vector<BinaryArray> addedTransactions;
+
+        std::vector<Crypto::Hash> addedHashes;
+
+        for (size_t i = 0; i < transactions.size(); i++)
         {
-            int result = processObjects(context, std::move(rawBlocks), cachedBlocks);
-            if (result != 0)
+            if (added[i])
+            {
+                addedTransactions.push_back(std::move(transactions[i]));
+                addedHashes.push_back(hashes[i]);
+            }
+            else
             {
-                return result;
+                logger(Logging::DEBUGGING) << context << "Tx verification failed";
             }
         }
 
-        logger(DEBUGGING, BRIGHT_GREEN) << "Local blockchain updated, new index = " << m_core.getTopBlockIndex();
-        if (!m_stop && context.m_state == CryptoNoteConnectionContext::state_synchronizing)
+        if (!addedTransactions.empty())
         {
-            adjust_block_rate(context);
-            request_missing_objects(context, true);
+            announceTransactions(addedTransactions, addedHashes);
         }
-
-        return 1;
     }
 
-    int CryptoNoteProtocolHandler::processObjects(
-        CryptoNoteConnectionContext &context,
-        std::vector<RawBlock> &&rawBlocks,
-        const std::vector<CachedBlock> &cachedBlocks)
+    void CryptoNoteProtocolHandler::announceTransactions(
+        const std::vector<BinaryArray> &transactions,
+        const std::vector<Crypto::Hash> &hashes)
     {
-        assert(rawBlocks.size() == cachedBlocks.size());
-        for (size_t index = 0; index < rawBlocks.size(); ++index)
-        {
-            if (m_stop)
+        /* Peers too old for announcements which don't have any of the transactions */
+        std::list<boost::uuids::uuid> floodConnections;
+
+        m_p2p->for_each_connection([&](CryptoNoteConnectionContext &ctx, uint64_t peerId) {
+            if (peerId == 0
+                || (ctx.m_state != CryptoNoteConnectionContext::state_normal
+                    && ctx.m_state != CryptoNoteConnectionContext::state_synchronizing))
             {
-                break;
+                return;
             }
 
-            auto addResult = m_core.addBlock(cachedBlocks[index], std::move(rawBlocks[index]));
-            if (addResult == error::AddBlockErrorCondition::BLOCK_VALIDATION_FAILED
-                || addResult == error::AddBlockErrorCondition::TRANSACTION_VALIDATION_FAILED
-                || addResult == error::AddBlockErrorCondition::DESERIALIZATION_FAILED)
+            if (ctx.version >= P2P_TRANSACTION_ANNOUNCE_VERSION)
             {
-                logger(Logging::DEBUGGING)
-                    << context << "Block verification failed, dropping connection: " << addResult.message();
-                context.m_state = CryptoNoteConnectionContext::state_shutdown;
-                return 1;
+                auto &pending = ctx.m_pending_transaction_announcements;
+
+                /* Bounded, as only so many are sent each interval. Hashes
+                   past that aren't marked as known to the peer, which can
+                   hear of them from its other peers. */
+                for (const auto &hash : hashes)
+                {
+                    if (pending.size() < TRANSACTION_ANNOUNCE_MAX_PENDING && ctx.m_known_transactions.add(hash))
+                    {
+                        pending.push_back(hash);
+                    }
+                }
+
+                return;
             }
-            else if (addResult == error::AddBlockErrorCondition::BLOCK_REJECTED)
+
+            NOTIFY_NEW_TRANSACTIONS::request notification;
+
+            for (size_t i = 0; i < hashes.size(); i++)
             {
-                logger(Logging::INFO) << context
-                                      << "Block received at sync phase was marked as orphaned, dropping connection: "
-                                      << addResult.message();
-                context.m_state = CryptoNoteConnectionContext::state_shutdown;
-                return 1;
+                if (ctx.m_known_transactions.add(hashes[i]))
+                {
+                    notification.txs.push_back(transactions[i]);
+                }
             }
-            else if (addResult == error::AddBlockErrorCode::ALREADY_EXISTS)
+
+            if (notification.txs.size() == transactions.size())
             {
-                logger(Logging::DEBUGGING)
-                    << context << "Block already exists, switching to idle state: " << addResult.message();
-                context.m_state = CryptoNoteConnectionContext::state_idle;
-                context.m_needed_objects.clear();
-                context.m_requested_objects.clear();
-                return 1;
+                floodConnections.push_back(ctx.m_connection_id);
+            }
+            else if (!notification.txs.empty())
+            {
+                post_notify<NOTIFY_NEW_TRANSACTIONS>(*m_p2p, notification, ctx);
             }
+        });
 
-            m_dispatcher.yield();
+        if (!floodConnections.empty())
+        {
+            /* Encoded once for all of them */
+            auto buf = LevinProtocol::encode(NOTIFY_NEW_TRANSACTIONS::request {transactions});
+            m_p2p->externalRelayNotifyToList(NOTIFY_NEW_TRANSACTIONS::ID, buf, floodConnections);
         }
-
-        return 0;
     }
 
-    void CryptoNoteProtocolHandler::adjust_block_rate(CryptoNoteConnectionContext &context)
+    void CryptoNoteProtocolHandler::sendTransactionAnnouncements()
     {
-        const auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - context.m_request_block_start);
-        const auto time_taken_ms = duration.count();
+        const auto now = std::chrono::steady_clock::now();
 
-        if (time_taken_ms == 0) {
-            context.m_request_block_rate = BLOCKS_IDS_SYNCHRONIZING_DEFAULT_COUNT;
-            context.m_next_request_block_rate = BLOCKS_IDS_SYNCHRONIZING_DEFAULT_COUNT;
-        } else {
-            context.m_request_block_rate = static_cast<size_t>((double) context.m_next_request_block_rate / ((double) time_taken_ms / 1000.0));
-            context.m_next_request_block_rate = context.m_request_block_rate;
-        }
+        std::set<boost::uuids::uuid> connections;
 
-        if (context.m_next_request_block_rate < 1) {
-            context.m_next_request_block_rate = 1;
-        } else if (context.m_next_request_block_rate > BLOCKS_IDS_SYNCHRONIZING_DEFAULT_COUNT) {
-            context.m_next_request_block_rate = BLOCKS_IDS_SYNCHRONIZING_DEFAULT_COUNT;
-        }
-    }
+        m_p2p->for_each_connection([&](CryptoNoteConnectionContext &ctx, uint64_t peerId) {
+            if (ctx.m_state == CryptoNoteConnectionContext::state_normal)
+            {
+                connections.insert(ctx.m_connection_id);
+            }
 
-    int CryptoNoteProtocolHandler::doPushLiteBlock(
-        NOTIFY_NEW_LITE_BLOCK::request arg,
-        CryptoNoteConnectionContext &context,
-        const std::vector<BinaryArray>&& missingTxs)
-    {
-        BlockTemplate newBlockTemplate;
-        if (!fromBinaryArray(newBlockTemplate, arg.blockTemplate))
-        { // deserialize blockTemplate
-            logger(Logging::WARNING) << context << "Deserialization of Block Template failed, dropping connection";
-            context.m_state = CryptoNoteConnectionContext::state_shutdown;
-            return 1;
-        }
+            auto &pending = ctx.m_pending_transaction_announcements;
 
-        std::unordered_map<Crypto::Hash, BinaryArray> provided_txs;
-        provided_txs.reserve(missingTxs.size());
-        for (const auto &iMissingTx : missingTxs)
-        {
-            CachedTransaction i_provided_transaction {iMissingTx};
-            provided_txs[getBinaryArrayHash(iMissingTx)] = iMissingTx;
-        }
+            if (pending.empty() || now < ctx.m_next_transaction_announcement)
+            {
+                return;
+            }
 
-        std::vector<BinaryArray> have_txs;
-        std::vector<Crypto::Hash> need_txs;
+            const size_t count = std::min(pending.size(), TRANSACTION_ANNOUNCE_MAX_COUNT);
 
-        if (context.m_pending_lite_block.has_value())
+            NOTIFY_NEW_TRANSACTION_HASHES::request notification;
+            notification.txs.assign(pending.begin(), pending.begin() + count);
+
+            pending.erase(pending.begin(), pending.begin() + count);
+
+            post_notify<NOTIFY_NEW_TRANSACTION_HASHES>(*m_p2p, notification, ctx);
+
+            /* Randomised, so the order peers hear about a transaction in
+               doesn't give away which node it started from */
+            const uint64_t delay = Random::randomValue<uint64_t>(
+                TRANSACTION_ANNOUNCE_INTERVAL_MILLISECONDS / 2, TRANSACTION_ANNOUNCE_INTERVAL_MILLISECONDS * 3 / 2);
+
+            ctx.m_next_transaction_announcement = now + std::chrono::milliseconds(delay);
+        });
+
+        /* Transactions which didn't arrive in time are asked for from the
+           next peer which announced them and is still connected */
+        std::map<boost::uuids::uuid, NOTIFY_REQUEST_TRANSACTIONS::request> requests;
+
+        for (auto it = m_requestedTransactions.begin(); it != m_requestedTransactions.end();)
         {
-            for (const auto &requestedTxHash : context.m_pending_lite_block->missed_transactions)
+            auto &[hash, request] = *it;
+
+            if (now - request.requestTime < std::chrono::seconds(TRANSACTION_REQUEST_TIMEOUT_SECONDS))
+            {
+                ++it;
+                continue;
+            }
+
+            while (!request.announcers.empty() && connections.count(request.announcers.front()) == 0)
+            {
+                request.announcers.pop_front();
+            }
+
+            /* Can be asked for again when next announced */
+            if (request.announcers.empty())
+            {
+                setTransactionRequestPeer(request, std::nullopt);
+                it = m_requestedTransactions.erase(it);
+                continue;
+            }
+
+            const auto next = request.announcers.front();
+
+            /* Otherwise tried again on the next call */
+            if (canRequestTransaction(next) && requests[next].txs.size() < TRANSACTION_ANNOUNCE_MAX_COUNT)
+            {
+                requests[next].txs.push_back(hash);
+
+                request.announcers.pop_front();
+                request.requestTime = now;
+                setTransactionRequestPeer(request, next);
+            }
+
+            ++it;
+        }
+
+        if (requests.empty())
+        {
+            return;
+        }
+
+        m_p2p->for_each_connection([&](CryptoNoteConnectionContext &ctx, uint64_t peerId) {
+            const auto request = requests.find(ctx.m_connection_id);
+
+            if (request != requests.end() && !request->second.txs.empty())
+            {
+                post_notify<NOTIFY_REQUEST_TRANSACTIONS>(*m_p2p, request->second, ctx);
+            }
+        });
+    }
+
+    bool CryptoNoteProtocolHandler::canRequestTransaction(const boost::uuids::uuid &peer) const
+    {
+        const auto it = m_requestedTransactionsPerPeer.find(peer);
+
+        return it == m_requestedTransactionsPerPeer.end() || it->second < TRANSACTION_REQUEST_MAX_PER_PEER;
+    }
+
+    void CryptoNoteProtocolHandler::setTransactionRequestPeer(
+        TransactionRequest &request,
+        const std::optional<boost::uuids::uuid> &peer)
+    {
+        if (request.peer)
+        {
+            const auto it = m_requestedTransactionsPerPeer.find(*request.peer);
+
+            if (it != m_requestedTransactionsPerPeer.end() && --it->second == 0)
+            {
+                m_requestedTransactionsPerPeer.erase(it);
+            }
+        }
+
+        request.peer = peer;
+
+        if (peer)
+        {
+            m_requestedTransactionsPerPeer[*peer]++;
+        }
+    }
+
+    int CryptoNoteProtocolHandler::handle_request_get_objects(
+        int command,
+        NOTIFY_REQUEST_GET_OBJECTS::request &arg,
+        CryptoNoteConnectionContext &context)
+    {
+        logger(Logging::TRACE) << context << "NOTIFY_REQUEST_GET_OBJECTS";
+        NOTIFY_RESPONSE_GET_OBJECTS::request rsp;
+        // if (!m_core.handle_get_objects(arg, rsp)) {
+        //  logger(Logging::ERROR) << context << "failed to handle request NOTIFY_REQUEST_GET_OBJECTS, dropping
+        //  connection"; context.m_state = CryptoNoteConnectionContext::state_shutdown;
+        //}
+
+        std::vector<RawBlock> rawBlocks;
+
+        {
+            /* Blocks submitted over RPC are added from another thread */
+            const auto chainLock = m_core.lockChainForReading();
+
+            rsp.current_blockchain_height = m_core.getTopBlockIndex() + 1;
+            m_core.getBlocks(arg.blocks, rawBlocks, rsp.missed_ids);
+        }
+
+        if (!arg.txs.empty())
+        {
+            logger(Logging::WARNING, Logging::BRIGHT_YELLOW)
+                << context << "NOTIFY_RESPONSE_GET_OBJECTS: request.txs.empty() != true";
+        }
+
+        rsp.blocks = convertRawBlocksToRawBlocksLegacy(rawBlocks);
+
+        logger(Logging::TRACE) << context << "-->>NOTIFY_RESPONSE_GET_OBJECTS: blocks.size()=" << rsp.blocks.size()
+                               << ", txs.size()=" << rsp.txs.size()
+                               << ", rsp.m_current_blockchain_height=" << rsp.current_blockchain_height
+                               << ", missed_ids.size()=" << rsp.missed_ids.size();
+        post_notify<NOTIFY_RESPONSE_GET_OBJECTS>(*m_p2p, rsp, context);
+        return 1;
+    }
+
+    int CryptoNoteProtocolHandler::handle_response_get_objects(
+        int command,
+        NOTIFY_RESPONSE_GET_OBJECTS::request &arg,
+        CryptoNoteConnectionContext &context)
+    {
+        logger(Logging::TRACE) << context << "NOTIFY_RESPONSE_GET_OBJECTS";
+
+        if (context.m_last_response_height > arg.current_blockchain_height)
+        {
+            logger(Logging::ERROR) << context << "sent wrong NOTIFY_HAVE_OBJECTS: arg.m_current_blockchain_height="
+                                   << arg.current_blockchain_height
+                                   << " < m_last_response_height=" << context.m_last_response_height
+                                   << ", dropping connection";
+            context.m_state = CryptoNoteConnectionContext::state_shutdown;
+            return 1;
+        }
+
+        updateObservedHeight(arg.current_blockchain_height, context);
+        context.m_remote_blockchain_height = arg.current_blockchain_height;
+
+        auto blocks = std::make_unique<BlockDownloadScheduler::Blocks>();
+
+        blocks->rawBlocks = convertRawBlocksLegacyToRawBlocks(arg.blocks);
+        blocks->blockTemplates.resize(blocks->rawBlocks.size());
+        blocks->cachedBlocks.reserve(blocks->rawBlocks.size());
+
+        for (size_t index = 0; index < blocks->rawBlocks.size(); ++index)
+        {
+            const auto &rawBlock = blocks->rawBlocks[index];
+
+            if (!fromBinaryArray(blocks->blockTemplates[index], rawBlock.block))
+            {
+                logger(Logging::ERROR) << context << "sent wrong block: failed to parse and validate block: \r\n"
+                                       << toHex(rawBlock.block) << "\r\n dropping connection";
+                context.m_state = CryptoNoteConnectionContext::state_shutdown;
+                return 1;
+            }
+
+            const auto &cachedBlock = blocks->cachedBlocks.emplace_back(blocks->blockTemplates[index]);
+
+            if (cachedBlock.getBlock().transactionHashes.size() != rawBlock.transactions.size())
+            {
+                logger(Logging::ERROR) << context << "sent wrong NOTIFY_RESPONSE_GET_OBJECTS: block with id="
+                                       << Common::podToHex(cachedBlock.getBlockHash())
+                                       << ", transactionHashes.size()="
+                                       << cachedBlock.getBlock().transactionHashes.size()
+                                       << " mismatch with block_complete_entry.m_txs.size()="
+                                       << rawBlock.transactions.size() << ", dropping connection";
+                context.m_state = CryptoNoteConnectionContext::state_shutdown;
+                return 1;
+            }
+        }
+
+        const size_t blockCount = blocks->rawBlocks.size();
+
+        if (!m_downloadScheduler.addBlocks(context.m_connection_id, std::move(blocks)))
+        {
+            logger(Logging::ERROR) << context
+                                   << "sent wrong NOTIFY_RESPONSE_GET_OBJECTS: blocks don't match the ones requested, "
+                                      "dropping connection";
+            context.m_state = CryptoNoteConnectionContext::state_shutdown;
+            return 1;
+        }
+
+        update_block_rate(context, blockCount);
+
+        processReadyBlocks();
+
+        requestBlocks();
+
+        return 1;
+    }
+
+    void CryptoNoteProtocolHandler::processReadyBlocks()
+    {
+        /* Adding blocks yields to the other connections, which may finish
+           downloading more windows. The loop here picks those up, rather
+           than blocks being added from two places at once. */
+        if (m_processingBlocks)
+        {
+            return;
+        }
+
+        m_processingBlocks = true;
+
+        while (!m_stop)
+        {
+            auto window = m_downloadScheduler.takeReady();
+
+            if (!window)
+            {
+                break;
+            }
+
+            if (!processObjects(window->source, std::move(window->blocks->rawBlocks), window->blocks->cachedBlocks))
+            {
+                /* The rest of the windows came from the same chain entries,
+                   so start again from what the peers tell us now */
+                m_downloadScheduler.clear();
+                break;
+            }
+
+            logger(DEBUGGING, BRIGHT_GREEN) << "Local blockchain updated, new height = "
+                                            << get_current_blockchain_height();
+        }
+
+        m_processingBlocks = false;
+    }
+
+    bool CryptoNoteProtocolHandler::processObjects(
+        const boost::uuids::uuid &source,
+        std::vector<RawBlock> &&rawBlocks,
+        const std::vector<CachedBlock> &cachedBlocks)
+    {
+        assert(rawBlocks.size() == cachedBlocks.size());
+
+        if (m_stop)
+        {
+            return true;
+        }
+
+        bool valid = true;
+
+        /* The core validates the upcoming blocks in parallel while each one is
+           committed, we only get called back once a block has been added */
+        m_core.addBlocks(
+            cachedBlocks,
+            std::move(rawBlocks),
+            [this, &source, &valid](const CachedBlock &cachedBlock, const std::error_code &addResult)
+            {
+                if (addResult == error::AddBlockErrorCondition::BLOCK_VALIDATION_FAILED
+                    || addResult == error::AddBlockErrorCondition::TRANSACTION_VALIDATION_FAILED
+                    || addResult == error::AddBlockErrorCondition::DESERIALIZATION_FAILED)
+                {
+                    dropConnection(
+                        source, Logging::DEBUGGING, "Block verification failed: " + addResult.message());
+                    valid = false;
+                    return false;
+                }
+                else if (addResult == error::AddBlockErrorCondition::BLOCK_REJECTED)
+                {
+                    dropConnection(
+                        source,
+                        Logging::INFO,
+                        "Block received at sync phase was marked as orphaned: " + addResult.message());
+                    valid = false;
+                    return false;
+                }
+                else if (addResult == error::AddBlockErrorCode::ALREADY_EXISTS)
+                {
+                    /* Relayed to us while we were downloading it */
+                    logger(Logging::DEBUGGING) << "Block already exists: " << addResult.message();
+                }
+
+                m_dispatcher.yield();
+
+                return !m_stop;
+            });
+
+        return valid;
+    }
+
+    void CryptoNoteProtocolHandler::dropConnection(
+        const boost::uuids::uuid &connectionId,
+        Logging::Level level,
+        const std::string &reason)
+    {
+        m_p2p->for_each_connection([&](CryptoNoteConnectionContext &context, uint64_t peerId) {
+            if (context.m_connection_id == connectionId)
+            {
+                logger(level) << context << reason << ", dropping connection";
+                context.m_state = CryptoNoteConnectionContext::state_shutdown;
+            }
+        });
+    }
+
+    void CryptoNoteProtocolHandler::update_block_rate(CryptoNoteConnectionContext &context, size_t blockCount)
+    {
+        const auto now = std::chrono::high_resolution_clock::now();
+
+        const auto time_taken_ms =
+            std::chrono::duration_cast<std::chrono::milliseconds>(now - context.m_request_block_start).count();
+
+        /* Only shown in the connection list, the download scheduler decides
+           how much to ask each peer for */
+        if (time_taken_ms == 0)
+        {
+            context.m_request_block_rate = blockCount;
+        }
+        else
+        {
+            context.m_request_block_rate = static_cast<size_t>((double) blockCount / ((double) time_taken_ms / 1000.0));
+        }
+
+        context.m_request_block_start = now;
+    }
+
+    int CryptoNoteProtocolHandler::doPushLiteBlock(
+        NOTIFY_NEW_LITE_BLOCK::request arg,
+        CryptoNoteConnectionContext &context,
+        const std::vector<BinaryArray>&& missingTxs)
+    {
+        BlockTemplate newBlockTemplate;
+        if (!fromBinaryArray(newBlockTemplate, arg.blockTemplate))
+        { // deserialize blockTemplate
+            logger(Logging::WARNING) << context << "Deserialization of Block Template failed, dropping connection";
+            context.m_state = CryptoNoteConnectionContext::state_shutdown;
+            return 1;
+        }
+
+        std::unordered_map<Crypto::Hash, BinaryArray> provided_txs;
+        provided_txs.reserve(missingTxs.size());
+        for (const auto &iMissingTx : missingTxs)
+        {
+            CachedTransaction i_provided_transaction {iMissingTx};
+            provided_txs[getBinaryArrayHash(iMissingTx)] = iMissingTx;
+        }
+
+        std::vector<BinaryArray> have_txs;
+        std::vector<Crypto::Hash> need_txs;
+
+        if (context.m_pending_lite_block.has_value())
+        {
+            for (const auto &requestedTxHash : context.m_pending_lite_block->missed_transactions)
             {
                 if (provided_txs.find(requestedTxHash) == provided_txs.end())
                 {
@@ -834,7 +1345,13 @@ namespace CryptoNote
             }
             else
             {
-                const auto transactionBlob = m_core.getTransaction(transactionHash);
+                std::optional<BinaryArray> transactionBlob;
+
+                {
+                    const auto chainLock = m_core.lockChainForReading();
+                    transactionBlob = m_core.getTransaction(transactionHash);
+                }
+
                 if (transactionBlob.has_value())
                 {
                     have_txs.push_back(*transactionBlob);
@@ -856,48 +1373,14 @@ namespace CryptoNote
         if (need_txs.empty())
         {
             context.m_pending_lite_block = std::nullopt;
-            auto result = m_core.addBlock(RawBlock {arg.blockTemplate, have_txs});
-            if (result == error::AddBlockErrorCondition::BLOCK_ADDED)
-            {
-                if (result == error::AddBlockErrorCode::ADDED_TO_ALTERNATIVE_AND_SWITCHED)
-                {
-                    ++arg.hop;
-                    // TODO: Add here announce protocol usage
-                    relay_post_notify<NOTIFY_NEW_LITE_BLOCK>(*m_p2p, arg, &context.m_connection_id);
-                    // relay_block(arg, context);
-                    requestMissingPoolTransactions(context);
-                }
-                else if (result == error::AddBlockErrorCode::ADDED_TO_MAIN)
-                {
-                    ++arg.hop;
-                    // TODO: Add here announce protocol usage
-                    relay_post_notify<NOTIFY_NEW_LITE_BLOCK>(*m_p2p, arg, &context.m_connection_id);
-                    // relay_block(arg, context);
-                }
-                else if (result == error::AddBlockErrorCode::ADDED_TO_ALTERNATIVE)
-                {
-                    logger(Logging::TRACE) << context << "Block added as alternative";
-                }
-                else
-                {
-                    logger(Logging::TRACE) << context << "Block already exists";
-                }
-            }
-            else if (result == error::AddBlockErrorCondition::BLOCK_REJECTED)
-            {
-                context.m_state = CryptoNoteConnectionContext::state_synchronizing;
-                NOTIFY_REQUEST_CHAIN::request r = boost::value_initialized<NOTIFY_REQUEST_CHAIN::request>();
-                r.block_ids = m_core.buildSparseChain();
-                logger(Logging::TRACE) << context
-                                       << "-->>NOTIFY_REQUEST_CHAIN: m_block_ids.size()=" << r.block_ids.size();
-                post_notify<NOTIFY_REQUEST_CHAIN>(*m_p2p, r, context);
-            }
-            else
-            {
-                logger(Logging::DEBUGGING)
-                    << context << "Block verification failed, dropping connection: " << result.message();
-                context.m_state = CryptoNoteConnectionContext::state_shutdown;
-            }
+
+            NOTIFY_NEW_BLOCK::request block;
+            block.block = RawBlockLegacy(arg.blockTemplate, have_txs);
+            block.current_blockchain_height = arg.current_blockchain_height;
+            block.hop = arg.hop;
+
+            /* Relayed on as a compact block to the peers which support it */
+            pushRelayedBlock(std::move(block), context);
         }
         else
         {
@@ -945,7 +1428,14 @@ namespace CryptoNote
             return 1;
         }
 
-        if (arg.block_ids.back() != m_core.getBlockHashByIndex(0))
+        Crypto::Hash genesisBlockHash;
+
+        {
+            const auto chainLock = m_core.lockChainForReading();
+            genesisBlockHash = m_core.getBlockHashByIndex(0);
+        }
+
+        if (arg.block_ids.back() != genesisBlockHash)
         {
             logger(Logging::DEBUGGING)
                 << context << "Failed to handle NOTIFY_REQUEST_CHAIN. block_ids doesn't end with genesis block ID";
@@ -954,8 +1444,13 @@ namespace CryptoNote
         }
 
         NOTIFY_RESPONSE_CHAIN_ENTRY::request r;
-        r.m_block_ids = m_core.findBlockchainSupplement(
-            arg.block_ids, BLOCKS_IDS_SYNCHRONIZING_DEFAULT_COUNT, r.total_height, r.start_height);
+
+        {
+            const auto chainLock = m_core.lockChainForReading();
+
+            r.m_block_ids = m_core.findBlockchainSupplement(
+                arg.block_ids, BLOCKS_IDS_SYNCHRONIZING_DEFAULT_COUNT, r.total_height, r.start_height);
+        }
 
         logger(Logging::TRACE) << context << "-->>NOTIFY_RESPONSE_CHAIN_ENTRY: m_start_height=" << r.start_height
                                << ", m_total_height=" << r.total_height
@@ -964,64 +1459,63 @@ namespace CryptoNote
         return 1;
     }
 
-    bool CryptoNoteProtocolHandler::request_missing_objects(
-        CryptoNoteConnectionContext &context,
-        bool check_having_blocks)
+    void CryptoNoteProtocolHandler::requestBlocks()
     {
-        if (!context.m_needed_objects.empty())
+        if (m_stop)
         {
-            // we know objects that we need, request this objects
-            context.m_request_block_start = std::chrono::high_resolution_clock::now();
+            return;
+        }
 
-            NOTIFY_REQUEST_GET_OBJECTS::request req;
-            size_t count = 0;
-            auto it = context.m_needed_objects.begin();
-            size_t max_to_download = context.m_next_request_block_rate;
+        const auto now = BlockDownloadScheduler::Clock::now();
 
-            while (it != context.m_needed_objects.end() && count < max_to_download)
+        m_p2p->for_each_connection([this, now](CryptoNoteConnectionContext &context, uint64_t peerId) {
+            if (context.m_state != CryptoNoteConnectionContext::state_synchronizing)
             {
-                if (!(check_having_blocks && m_core.hasBlock(*it)))
-                {
-                    req.blocks.push_back(*it);
-                    ++count;
-                    context.m_requested_objects.insert(*it);
-                }
-                it = context.m_needed_objects.erase(it);
+                return;
             }
-            logger(Logging::TRACE) << context << "-->>NOTIFY_REQUEST_GET_OBJECTS: blocks.size()=" << req.blocks.size();
-            post_notify<NOTIFY_REQUEST_GET_OBJECTS>(*m_p2p, req, context);
-        }
-        else if (context.m_last_response_height < context.m_remote_blockchain_height - 1)
-        { // we have to fetch more objects ids, request blockchain entry
 
-            NOTIFY_REQUEST_CHAIN::request r = boost::value_initialized<NOTIFY_REQUEST_CHAIN::request>();
-            r.block_ids = m_core.buildSparseChain();
-            logger(Logging::TRACE) << context << "-->>NOTIFY_REQUEST_CHAIN: m_block_ids.size()=" << r.block_ids.size();
-            post_notify<NOTIFY_REQUEST_CHAIN>(*m_p2p, r, context);
-        }
-        else
-        {
-            if (!(context.m_last_response_height == context.m_remote_blockchain_height - 1
-                  && context.m_needed_objects.empty() && context.m_requested_objects.empty()))
+            const auto &peer = context.m_connection_id;
+
+            if (!m_downloadScheduler.isBusy(peer))
+            {
+                context.m_request_block_start = std::chrono::high_resolution_clock::now();
+            }
+
+            while (const auto hashes = m_downloadScheduler.assign(peer, now))
             {
-                logger(Logging::ERROR, Logging::BRIGHT_RED)
-                    << "request_missing_blocks final condition failed!"
-                    << "\r\nm_last_response_height=" << context.m_last_response_height
-                    << "\r\nm_remote_blockchain_height=" << context.m_remote_blockchain_height
-                    << "\r\nm_needed_objects.size()=" << context.m_needed_objects.size()
-                    << "\r\nm_requested_objects.size()=" << context.m_requested_objects.size() << "\r\non connection ["
-                    << context << "]";
-                return false;
+                NOTIFY_REQUEST_GET_OBJECTS::request req;
+                req.blocks = *hashes;
+                logger(Logging::TRACE) << context
+                                       << "-->>NOTIFY_REQUEST_GET_OBJECTS: blocks.size()=" << req.blocks.size();
+                post_notify<NOTIFY_REQUEST_GET_OBJECTS>(*m_p2p, req, context);
             }
 
-            requestMissingPoolTransactions(context);
+            if (m_downloadScheduler.isBusy(peer))
+            {
+                return;
+            }
 
-            context.m_state = CryptoNoteConnectionContext::state_normal;
-            logger(Logging::INFO, Logging::BRIGHT_GREEN)
-                << context << "Successfully synchronized with the " << CryptoNote::CRYPTONOTE_NAME << " Network.";
-            on_connection_synchronized();
-        }
-        return true;
+            if (m_downloadScheduler.needsHashes(peer, context.m_remote_blockchain_height))
+            {
+                requestChain(context);
+            }
+            else if (get_current_blockchain_height() >= context.m_remote_blockchain_height)
+            {
+                requestMissingPoolTransactions(context);
+
+                context.m_state = CryptoNoteConnectionContext::state_normal;
+                logger(Logging::INFO, Logging::BRIGHT_GREEN)
+                    << context << "Successfully synchronized with the " << CryptoNote::CRYPTONOTE_NAME << " Network.";
+                on_connection_synchronized();
+            }
+            else if (m_downloadScheduler.empty() && !m_processingBlocks)
+            {
+                /* Its chain differs from the one we downloaded. It goes back
+                   to syncing on the next timed sync if it is still ahead. */
+                context.m_state = CryptoNoteConnectionContext::state_idle;
+                logger(Logging::DEBUGGING) << context << "Connection set to idle state.";
+            }
+        });
     }
 
     bool CryptoNoteProtocolHandler::on_connection_synchronized()
@@ -1047,7 +1541,8 @@ namespace CryptoNote
 
             logger(INFO, BRIGHT_GREEN) << asciiArt << ENDL;
 
-            m_observerManager.notify(&ICryptoNoteProtocolObserver::blockchainSynchronized, m_core.getTopBlockIndex());
+            m_observerManager.notify(
+                &ICryptoNoteProtocolObserver::blockchainSynchronized, get_current_blockchain_height() - 1);
         }
         return true;
     }
@@ -1068,7 +1563,13 @@ namespace CryptoNote
             return 1;
         }
 
-        if (!m_core.hasBlock(arg.m_block_ids.front()))
+        /* Released before requesting blocks, which may add them */
+        auto chainLock = m_core.lockChainForReading();
+
+        /* The peer may carry on from the scheduled hash we sent it, even if
+           more hashes were scheduled, or the blocks were validated, since */
+        if (!m_core.hasBlock(arg.m_block_ids.front())
+            && !m_downloadScheduler.isChainStart(context.m_connection_id, arg.m_block_ids.front()))
         {
             logger(Logging::ERROR) << context << "sent m_block_ids starting from unknown id: "
                                    << Common::podToHex(arg.m_block_ids.front()) << " , dropping connection";
@@ -1085,26 +1586,22 @@ namespace CryptoNote
                                    << arg.total_height << "\r\nm_start_height=" << arg.start_height
                                    << "\r\nm_block_ids.size()=" << arg.m_block_ids.size();
             context.m_state = CryptoNoteConnectionContext::state_shutdown;
+            return 1;
         }
 
-        bool allBlocksKnown = true;
-        for (auto &bl_id : arg.m_block_ids)
-        {
-            if (allBlocksKnown)
-            {
-                if (!m_core.hasBlock(bl_id))
-                {
-                    context.m_needed_objects.push_back(bl_id);
-                    allBlocksKnown = false;
-                }
-            }
-            else
-            {
-                context.m_needed_objects.push_back(bl_id);
-            }
-        }
+        const auto firstNeeded = std::find_if(arg.m_block_ids.begin(), arg.m_block_ids.end(), [this](const auto &hash) {
+            return !m_core.hasBlock(hash);
+        });
+
+        chainLock.unlock();
+
+        m_downloadScheduler.addHashes(
+            context.m_connection_id,
+            arg.start_height + static_cast<uint32_t>(firstNeeded - arg.m_block_ids.begin()),
+            {firstNeeded, arg.m_block_ids.end()});
+
+        requestBlocks();
 
-        request_missing_objects(context, false);
         return 1;
     }
 
@@ -1116,7 +1613,12 @@ namespace CryptoNote
         logger(Logging::TRACE) << context << "NOTIFY_REQUEST_TX_POOL: txs.size() = " << arg.txs.size();
         NOTIFY_NEW_TRANSACTIONS::request notification;
         std::vector<Crypto::Hash> deletedTransactions;
-        m_core.getPoolChanges(m_core.getTopBlockHash(), arg.txs, notification.txs, deletedTransactions);
+
+        {
+            const auto chainLock = m_core.lockChainForReading();
+            m_core.getPoolChanges(m_core.getTopBlockHash(), arg.txs, notification.txs, deletedTransactions);
+        }
+
         if (!notification.txs.empty())
         {
             bool ok = post_notify<NOTIFY_NEW_TRANSACTIONS>(*m_p2p, notification, context);
@@ -1157,7 +1659,12 @@ namespace CryptoNote
 
         std::vector<BinaryArray> txs;
         std::vector<Crypto::Hash> missedHashes;
-        m_core.getTransactions(arg.missing_txs, txs, missedHashes);
+
+        {
+            const auto chainLock = m_core.lockChainForReading();
+            m_core.getTransactions(arg.missing_txs, txs, missedHashes);
+        }
+
         if (!missedHashes.empty())
         {
             logger(Logging::DEBUGGING) << "Failed to Handle NOTIFY_MISSING_TXS, Unable to retrieve requested "
@@ -1185,7 +1692,229 @@ namespace CryptoNote
         return 1;
     }
 
+    int CryptoNoteProtocolHandler::handle_notify_new_compact_block(
+        int command,
+        NOTIFY_NEW_COMPACT_BLOCK::request &arg,
+        CryptoNoteConnectionContext &context)
+    {
+        logger(Logging::TRACE) << context << "NOTIFY_NEW_COMPACT_BLOCK (hop " << arg.hop << ")";
+        updateObservedHeight(arg.current_blockchain_height, context);
+        context.m_remote_blockchain_height = arg.current_blockchain_height;
+        if (context.m_state != CryptoNoteConnectionContext::state_normal)
+        {
+            return 1;
+        }
+
+        bool haveBlock;
+
+        {
+            const auto chainLock = m_core.lockChainForReading();
+            haveBlock = m_core.hasBlock(arg.blockHash);
+        }
+
+        if (haveBlock)
+        {
+            logger(Logging::TRACE) << context << "Block already exists";
+            return 1;
+        }
+
+        BlockTemplate blockTemplate;
+
+        if (!CompactBlock::parse(arg, blockTemplate))
+        {
+            logger(Logging::WARNING) << context << "Invalid compact block, dropping connection";
+            context.m_state = CryptoNoteConnectionContext::state_shutdown;
+            return 1;
+        }
+
+        PendingCompactBlock block = CompactBlock::rebuild(
+            std::move(arg),
+            std::move(blockTemplate),
+            m_core.getPoolTransactionHashes(),
+            [this](const Crypto::Hash &hash) -> std::optional<BinaryArray> {
+                /* Copied under the pool lock, so no lock is needed here */
+                auto [found, transaction] = m_core.getPoolTransaction(hash);
+
+                if (!found)
+                {
+                    return std::nullopt;
+                }
+
+                return std::move(transaction);
+            });
+
+        logger(Logging::DEBUGGING) << context << "Compact block rebuilt from the pool, missing "
+                                   << block.missingIndexes.size() << " of " << block.transactions.size()
+                                   << " transactions";
+
+        if (!block.missingIndexes.empty())
+        {
+            requestCompactBlockTransactions(std::move(block), context);
+            return 1;
+        }
+
+        completeCompactBlock(std::move(block), context);
+
+        return 1;
+    }
+
+    int CryptoNoteProtocolHandler::handle_request_compact_block_transactions(
+        int command,
+        NOTIFY_REQUEST_COMPACT_BLOCK_TRANSACTIONS::request &arg,
+        CryptoNoteConnectionContext &context)
+    {
+        logger(Logging::TRACE) << context << "NOTIFY_REQUEST_COMPACT_BLOCK_TRANSACTIONS: indexes.size() = "
+                               << arg.indexes.size();
+
+        std::vector<RawBlock> rawBlocks;
+        std::vector<Crypto::Hash> missedHashes;
+
+        {
+            /* Blocks submitted over RPC are added from another thread */
+            const auto chainLock = m_core.lockChainForReading();
+
+            m_core.getBlocks({arg.blockHash}, rawBlocks, missedHashes);
+        }
+
+        /* Gone from the chain since it was relayed, the peer gets it when syncing */
+        if (rawBlocks.empty())
+        {
+            logger(Logging::DEBUGGING) << context << "Requested compact block transactions of an unknown block";
+            return 1;
+        }
+
+        auto &transactions = rawBlocks.front().transactions;
+
+        NOTIFY_RESPONSE_COMPACT_BLOCK_TRANSACTIONS::request response;
+        response.blockHash = arg.blockHash;
+
+        for (const auto index : arg.indexes)
+        {
+            if (index >= transactions.size())
+            {
+                logger(Logging::DEBUGGING) << context
+                                           << "Requested compact block transaction doesn't exist, dropping connection";
+                context.m_state = CryptoNoteConnectionContext::state_shutdown;
+                return 1;
+            }
+
+            response.txs.push_back(std::move(transactions[index]));
+        }
+
+        if (!post_notify<NOTIFY_RESPONSE_COMPACT_BLOCK_TRANSACTIONS>(*m_p2p, response, context))
+        {
+            logger(Logging::DEBUGGING) << context << "Failed to post notification NOTIFY_RESPONSE_COMPACT_BLOCK_TRANSACTIONS";
+        }
+
+        return 1;
+    }
+
+    int CryptoNoteProtocolHandler::handle_response_compact_block_transactions(
+        int command,
+        NOTIFY_RESPONSE_COMPACT_BLOCK_TRANSACTIONS::request &arg,
+        CryptoNoteConnectionContext &context)
+    {
+        logger(Logging::TRACE) << context << "NOTIFY_RESPONSE_COMPACT_BLOCK_TRANSACTIONS: txs.size() = "
+                               << arg.txs.size();
+
+        /* A newer compact block from the peer replaces the one which was waiting */
+        if (!context.m_pending_compact_block || context.m_pending_compact_block->request.blockHash != arg.blockHash)
+        {
+            logger(Logging::DEBUGGING) << context << "Compact block transactions weren't asked for, ignoring";
+            return 1;
+        }
+
+        PendingCompactBlock block = std::move(*context.m_pending_compact_block);
+        context.m_pending_compact_block = std::nullopt;
+
+        if (!CompactBlock::addMissingTransactions(block, std::move(arg.txs)))
+        {
+            logger(Logging::DEBUGGING) << context
+                                       << "Peer didn't provide the missing compact block transactions, dropping connection";
+            context.m_state = CryptoNoteConnectionContext::state_shutdown;
+            return 1;
+        }
+
+        if (context.m_state == CryptoNoteConnectionContext::state_normal)
+        {
+            completeCompactBlock(std::move(block), context);
+        }
+
+        return 1;
+    }
+
+    void CryptoNoteProtocolHandler::requestCompactBlockTransactions(
+        PendingCompactBlock &&block,
+        CryptoNoteConnectionContext &context)
+    {
+        NOTIFY_REQUEST_COMPACT_BLOCK_TRANSACTIONS::request request;
+        request.blockHash = block.request.blockHash;
+        request.indexes = block.missingIndexes;
+
+        context.m_pending_compact_block = std::move(block);
+
+        if (!post_notify<NOTIFY_REQUEST_COMPACT_BLOCK_TRANSACTIONS>(*m_p2p, request, context))
+        {
+            logger(Logging::DEBUGGING) << context
+                                       << "Compact block is missing transactions but the publisher is not "
+                                          "reachable, dropping connection.";
+            context.m_pending_compact_block = std::nullopt;
+            context.m_state = CryptoNoteConnectionContext::state_shutdown;
+        }
+    }
+
+    void CryptoNoteProtocolHandler::completeCompactBlock(
+        PendingCompactBlock &&block,
+        CryptoNoteConnectionContext &context)
+    {
+        const auto result = CompactBlock::check(block);
+
+        if (result == CompactBlock::CheckResult::Invalid)
+        {
+            logger(Logging::DEBUGGING) << context << "Compact block doesn't match its hash, dropping connection";
+            context.m_state = CryptoNoteConnectionContext::state_shutdown;
+            return;
+        }
+
+        if (result == CompactBlock::CheckResult::Collision)
+        {
+            logger(Logging::DEBUGGING) << context << "Short transaction id collision in compact block, "
+                                       << "asking for " << block.missingIndexes.size() << " transactions";
+
+            requestCompactBlockTransactions(std::move(block), context);
+            return;
+        }
+
+        for (const auto &hash : block.blockTemplate.transactionHashes)
+        {
+            context.m_known_transactions.add(hash);
+        }
+
+        NOTIFY_NEW_BLOCK::request rawBlock;
+
+        if (!toBinaryArray(block.blockTemplate, rawBlock.block.blockTemplate))
+        {
+            logger(Logging::WARNING) << context << "Failed to serialize rebuilt compact block";
+            return;
+        }
+
+        rawBlock.block.transactions = std::move(block.transactions);
+        rawBlock.current_blockchain_height = block.request.current_blockchain_height;
+        rawBlock.hop = block.request.hop;
+
+        pushRelayedBlock(std::move(rawBlock), context);
+    }
+
     void CryptoNoteProtocolHandler::relayBlock(NOTIFY_NEW_BLOCK::request &arg)
+    {
+        /* Called from the RPC threads, and the connections are only touched
+           from the dispatcher */
+        m_dispatcher.remoteSpawn([this, arg] { relayBlockToPeers(arg); });
+    }
+
+    void CryptoNoteProtocolHandler::relayBlockToPeers(
+        const NOTIFY_NEW_BLOCK::request &arg,
+        const boost::uuids::uuid *excludeConnection)
     {
         // generate a lite block request from the received normal block.
         NOTIFY_NEW_LITE_BLOCK::request lite_arg;
@@ -1201,12 +1930,42 @@ namespace CryptoNote
         logger(Logging::DEBUGGING) << "NOTIFY_NEW_BLOCK - MSG_SIZE = " << buf.size();
         logger(Logging::DEBUGGING) << "NOTIFY_NEW_LITE_BLOCK - MSG_SIZE = " << lite_buf.size();
 
+        const auto compact = CompactBlock::makeRelay(
+            arg.block, Random::randomValue<uint64_t>(), arg.current_blockchain_height, arg.hop);
+
         std::list<boost::uuids::uuid> liteBlockConnections, normalBlockConnections;
 
         // sort the peers into their support categories.
-        m_p2p->for_each_connection([this, &liteBlockConnections, &normalBlockConnections](
-                                       const CryptoNoteConnectionContext &ctx, uint64_t peerId) {
-            if (ctx.version >= P2P_LITE_BLOCKS_PROPOGATION_VERSION)
+        m_p2p->for_each_connection([&](CryptoNoteConnectionContext &ctx, uint64_t peerId) {
+            /* The peer we got the block from */
+            if (excludeConnection != nullptr && ctx.m_connection_id == *excludeConnection)
+            {
+                return;
+            }
+
+            if (compact && ctx.version >= P2P_COMPACT_BLOCKS_VERSION)
+            {
+                if (peerId == 0
+                    || (ctx.m_state != CryptoNoteConnectionContext::state_normal
+                        && ctx.m_state != CryptoNoteConnectionContext::state_synchronizing))
+                {
+                    return;
+                }
+
+                /* The transactions the peer isn't known to have are sent whole,
+                   rather than left for it to ask for */
+                auto notification = CompactBlock::makePeerBlock(
+                    *compact, arg.block.transactions, [&ctx](const Crypto::Hash &hash) {
+                        return ctx.m_known_transactions.add(hash);
+                    });
+
+                logger(Logging::DEBUGGING) << ctx << "NOTIFY_NEW_COMPACT_BLOCK - prefilled "
+                                           << notification.prefilledIndexes.size() << " of "
+                                           << compact->transactionHashes.size() << " transactions";
+
+                post_notify<NOTIFY_NEW_COMPACT_BLOCK>(*m_p2p, notification, ctx);
+            }
+            else if (ctx.version >= P2P_LITE_BLOCKS_PROPOGATION_VERSION)
             {
                 logger(Logging::DEBUGGING) << ctx << "Peer supports lite-blocks... adding peer to lite block list";
                 liteBlockConnections.push_back(ctx.m_connection_id);
@@ -1233,8 +1992,19 @@ namespace CryptoNote
 
     void CryptoNoteProtocolHandler::relayTransactions(const std::vector<BinaryArray> &transactions)
     {
-        auto buf = LevinProtocol::encode(NOTIFY_NEW_TRANSACTIONS::request {transactions});
-        m_p2p->externalRelayNotifyToAll(NOTIFY_NEW_TRANSACTIONS::ID, buf, nullptr);
+        /* Called from the RPC threads, and the connections are only touched
+           from the dispatcher */
+        m_dispatcher.remoteSpawn([this, transactions] {
+            std::vector<Crypto::Hash> hashes;
+            hashes.reserve(transactions.size());
+
+            for (const auto &transaction : transactions)
+            {
+                hashes.push_back(getBinaryArrayHash(transaction));
+            }
+
+            announceTransactions(transactions, hashes);
+        });
     }
 
     void CryptoNoteProtocolHandler::requestMissingPoolTransactions(const CryptoNoteConnectionContext &context)
@@ -1258,6 +2028,8 @@ namespace CryptoNote
     void
         CryptoNoteProtocolHandler::updateObservedHeight(uint32_t peerHeight, const CryptoNoteConnectionContext &context)
     {
+        const uint32_t currentHeight = get_current_blockchain_height();
+
         bool updated = false;
         {
             std::lock_guard<std::mutex> lock(m_observedHeightMutex);
@@ -1286,7 +2058,7 @@ namespace CryptoNote
             {
                 // the client switched to alternative chain and had maximum observed height. need to recalculate max
                 // height
-                recalculateMaxObservedHeight(context);
+                recalculateMaxObservedHeight(context, currentHeight);
                 if (m_observedHeight != height)
                 {
                     updated = true;
@@ -1310,7 +2082,9 @@ namespace CryptoNote
         }
     }
 
-    void CryptoNoteProtocolHandler::recalculateMaxObservedHeight(const CryptoNoteConnectionContext &context)
+    void CryptoNoteProtocolHandler::recalculateMaxObservedHeight(
+        const CryptoNoteConnectionContext &context,
+        const uint32_t currentHeight)
     {
         // should be locked outside
         uint32_t peerHeight = 0;
@@ -1321,10 +2095,10 @@ namespace CryptoNote
             }
         });
 
-        m_observedHeight = std::max(peerHeight, m_core.getTopBlockIndex() + 1);
+        m_observedHeight = std::max(peerHeight, currentHeight);
         if (context.m_state == CryptoNoteConnectionContext::state_normal)
         {
-            m_observedHeight = m_core.getTopBlockIndex();
+            m_observedHeight = currentHeight - 1;
         }
     }
 
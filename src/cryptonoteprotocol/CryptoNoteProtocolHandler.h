@@ -8,6 +8,7 @@
 #pragma once
 
 #include "cryptonotecore/ICore.h"
+#include "cryptonoteprotocol/BlockDownloadScheduler.h"
 #include "cryptonoteprotocol/CryptoNoteProtocolDefinitions.h"
 #include "cryptonoteprotocol/CryptoNoteProtocolHandlerCommon.h"
 #include "cryptonoteprotocol/ICryptoNoteProtocolObserver.h"
@@ -17,8 +18,14 @@
 #include "p2p/P2pProtocolDefinitions.h"
 
 #include <atomic>
+#include <chrono>
 #include <common/ObserverManager.h>
+#include <deque>
 #include <logging/LoggerRef.h>
+#include <map>
+#include <optional>
+#include <unordered_map>
+#include <unordered_set>
 
 namespace System
 {
@@ -89,6 +96,9 @@ namespace CryptoNote
 
         void requestMissingPoolTransactions(const CryptoNoteConnectionContext &context);
 
+        /* Called every second, to re-request blocks which peers are slow to send */
+        void onIdle();
+
       private:
         //----------------- commands handlers ----------------------------------------------
         int handle_notify_new_block(int command, NOTIFY_NEW_BLOCK::request &arg, CryptoNoteConnectionContext &context);
@@ -130,32 +140,136 @@ namespace CryptoNote
             NOTIFY_MISSING_TXS::request &arg,
             CryptoNoteConnectionContext &context);
 
+        int handle_notify_new_transaction_hashes(
+            int command,
+            NOTIFY_NEW_TRANSACTION_HASHES::request &arg,
+            CryptoNoteConnectionContext &context);
+
+        int handle_request_transactions(
+            int command,
+            NOTIFY_REQUEST_TRANSACTIONS::request &arg,
+            CryptoNoteConnectionContext &context);
+
+        int handle_response_transactions(
+            int command,
+            NOTIFY_RESPONSE_TRANSACTIONS::request &arg,
+            CryptoNoteConnectionContext &context);
+
+        int handle_notify_new_compact_block(
+            int command,
+            NOTIFY_NEW_COMPACT_BLOCK::request &arg,
+            CryptoNoteConnectionContext &context);
+
+        int handle_request_compact_block_transactions(
+            int command,
+            NOTIFY_REQUEST_COMPACT_BLOCK_TRANSACTIONS::request &arg,
+            CryptoNoteConnectionContext &context);
+
+        int handle_response_compact_block_transactions(
+            int command,
+            NOTIFY_RESPONSE_COMPACT_BLOCK_TRANSACTIONS::request &arg,
+            CryptoNoteConnectionContext &context);
+
         //----------------- i_cryptonote_protocol ----------------------------------
         void relayBlock(NOTIFY_NEW_BLOCK::request &arg) override;
 
         void relayTransactions(const std::vector<BinaryArray> &transactions) override;
 
+        /* Sends the block on as a compact block, lite block or whole block,
+           depending on what each peer supports. The peer it came from, if
+           given, isn't sent it back. */
+        void relayBlockToPeers(
+            const NOTIFY_NEW_BLOCK::request &arg,
+            const boost::uuids::uuid *excludeConnection = nullptr);
+
+        /* Adds a block relayed by a peer to the chain, and relays it on if
+           it was added to the main chain */
+        void pushRelayedBlock(NOTIFY_NEW_BLOCK::request &&arg, CryptoNoteConnectionContext &context);
+
+        /* Asks the peer for the transactions of the compact block it sent
+           which couldn't be found, and keeps the block until they arrive */
+        void requestCompactBlockTransactions(PendingCompactBlock &&block, CryptoNoteConnectionContext &context);
+
+        /* Rebuilds the compact block once all of its transactions are known,
+           and adds it to the chain */
+        void completeCompactBlock(PendingCompactBlock &&block, CryptoNoteConnectionContext &context);
+
         //----------------------------------------------------------------------------------
+        /* Blocks submitted over RPC are added from another thread, so this
+           and the other reads of the chain here hold the chain lock */
         uint32_t get_current_blockchain_height();
 
-        bool request_missing_objects(CryptoNoteConnectionContext &context, bool check_having_blocks);
+        void requestChain(CryptoNoteConnectionContext &context);
+
+        /* Hands out the scheduled block downloads to every syncing peer, and
+           asks for more hashes or finishes syncing with the peers which have
+           nothing left to download */
+        void requestBlocks();
+
+        /* Adds the downloaded blocks which are next in line to the chain */
+        void processReadyBlocks();
+
+        void dropConnection(const boost::uuids::uuid &connectionId, Logging::Level level, const std::string &reason);
 
         bool on_connection_synchronized();
 
         void updateObservedHeight(uint32_t peerHeight, const CryptoNoteConnectionContext &context);
 
-        void recalculateMaxObservedHeight(const CryptoNoteConnectionContext &context);
+        /* Takes the chain height rather than reading it, as it's called with
+           m_observedHeightMutex held, which RPC handlers take while holding
+           the chain lock */
+        void recalculateMaxObservedHeight(const CryptoNoteConnectionContext &context, uint32_t currentHeight);
 
-        int processObjects(
-            CryptoNoteConnectionContext &context,
+        /* Returns false if the blocks are bad, in which case the peer that
+           sent them is dropped */
+        bool processObjects(
+            const boost::uuids::uuid &source,
             std::vector<RawBlock> &&rawBlocks,
             const std::vector<CachedBlock> &cachedBlocks);
 
-        static void adjust_block_rate(CryptoNoteConnectionContext &context);
+        static void update_block_rate(CryptoNoteConnectionContext &context, size_t blockCount);
+
+        /* Adds transactions sent by a peer to the pool, and announces the
+           ones which were added to the other peers */
+        void addRelayedTransactions(
+            std::vector<BinaryArray> &&relayedTransactions,
+            CryptoNoteConnectionContext &context);
+
+        /* Queues the hashes to be announced to the peers which support it,
+           and sends the transactions themselves to the older ones. Skips the
+           peers known to have them already. */
+        void announceTransactions(
+            const std::vector<BinaryArray> &transactions,
+            const std::vector<Crypto::Hash> &hashes);
+
+        /* Sends each peer whose announcement delay has passed its queued
+           hashes, and asks the next announcer for requested transactions
+           which didn't arrive in time */
+        void sendTransactionAnnouncements();
 
         Logging::LoggerRef logger;
 
       private:
+        struct TransactionRequest
+        {
+            /* When it was last asked for */
+            std::chrono::steady_clock::time_point requestTime;
+
+            /* The peer it was last asked for from */
+            std::optional<boost::uuids::uuid> peer;
+
+            /* The other peers which announced it, to ask next, oldest first */
+            std::deque<boost::uuids::uuid> announcers;
+        };
+
+        /* Whether the peer has fewer transactions it was asked for and
+           hasn't sent yet than the limit */
+        bool canRequestTransaction(const boost::uuids::uuid &peer) const;
+
+        /* Records that the transaction is now being asked for from the peer,
+           in place of the one it was asked for from before, if any */
+        void setTransactionRequestPeer(TransactionRequest &request, const std::optional<boost::uuids::uuid> &peer);
+
         int doPushLiteBlock(
             NOTIFY_NEW_LITE_BLOCK::request block,
             CryptoNoteConnectionContext &context,
@@ -186,6 +300,20 @@ namespace CryptoNote
 
         std::atomic<size_t> m_peersCount;
 
+        BlockDownloadScheduler m_downloadScheduler;
+
+        /* Whether processReadyBlocks() is running further up the stack */
+        bool m_processingBlocks;
+
+        /* Relayed transactions being added to the pool on another thread */
+        std::unordered_set<Crypto::Hash> m_admittingTransactions;
+
+        /* Announced transactions asked for from a peer */
+        std::unordered_map<Crypto::Hash, TransactionRequest> m_requestedTransactions;
+
+        /* How many of m_requestedTransactions each peer was asked for */
+        std::map<boost::uuids::uuid, size_t> m_requestedTransactionsPerPeer;
+
         Tools::ObserverManager<ICryptoNoteProtocolObserver> m_observerManager;
     };
 } // namespace CryptoNote
@@ -7,7 +7,14 @@
 #include "CryptoTypes.h"
 #include "common/StringTools.h"
 #include "crypto/crypto.h"
+#include "crypto/random.h"
 
+extern "C"
+{
+#include "crypto/crypto-ops.h"
+}
+
+#include <algorithm>
 #include <assert.h>
 #include <chrono>
 #include <config/CliHeader.h>
@@ -182,6 +189,164 @@ void testHashFunction(
     }
 }
 
+void expect(bool condition, const std::string &description)
+{
+    if (!condition)
+    {
+        std::cout << "Failed: " << description << "\nTerminating.";
+
+        exit(1);
+    }
+}
+
+/* Encoding points together, with one shared inversion, must give the same
+   bytes as encoding them one at a time */
+void testBatchToBytes()
+{
+    const size_t count = 64;
+
+    std::vector<ge_p2> points(count);
+
+    for (auto &point : points)
+    {
+        uint8_t scalar[32];
+
+        Random::randomBytes(sizeof(scalar), scalar);
+        sc_reduce32(scalar);
+
+        ge_p3 base;
+        ge_scalarmult_base(&base, scalar);
+
+        /* Multiplying again leaves Z != 1, so the inversion matters */
+        ge_scalarmult(&point, scalar, &base);
+    }
+
+    std::vector<uint8_t> batched(32 * count);
+    std::vector<fe> scratch(count);
+
+    ge_p2_batch_tobytes(batched.data(), points.data(), count, scratch.data());
+
+    for (size_t i = 0; i < count; i++)
+    {
+        uint8_t single[32];
+        ge_tobytes(single, &points[i]);
+
+        expect(std::equal(single, single + 32, batched.begin() + 32 * i), "ge_p2_batch_tobytes matches ge_tobytes");
+    }
+
+    std::cout << "ge_p2_batch_tobytes: OK" << std::endl;
+}
+
+struct TestRing
+{
+    Hash prefixHash;
+
+    KeyImage keyImage;
+
+    std::vector<PublicKey> publicKeys;
+
+    std::vector<Signature> signatures;
+};
+
+/* Makes count signed rings of different sizes. The rings share some of
+   their members, like inputs spending outputs of the same amount do. */
+std::vector<TestRing> makeRings(const size_t count)
+{
+    std::vector<PublicKey> decoys(8);
+
+    for (auto &decoy : decoys)
+    {
+        SecretKey ignored;
+        generate_keys(decoy, ignored);
+    }
+
+    std::vector<TestRing> rings(count);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        auto &ring = rings[i];
+
+        Random::randomBytes(sizeof(ring.prefixHash.data), ring.prefixHash.data);
+
+        PublicKey publicKey;
+        SecretKey secretKey;
+        generate_keys(publicKey, secretKey);
+        generate_key_image(publicKey, secretKey, ring.keyImage);
+
+        const size_t ringSize = 1 + i % 5;
+        const size_t realOutput = i % ringSize;
+
+        for (size_t j = 0; j < ringSize; j++)
+        {
+            ring.publicKeys.push_back(j == realOutput ? publicKey : decoys[(i + j) % decoys.size()]);
+        }
+
+        bool success;
+
+        std::tie(success, ring.signatures) = crypto_ops::generateRingSignatures(
+            ring.prefixHash, ring.keyImage, ring.publicKeys, secretKey, realOutput);
+
+        expect(success, "generateRingSignatures succeeds");
+    }
+
+    return rings;
+}
+
+/* Verifies the rings in a batch, and checks the batch rejects exactly
+   the rings which checkRingSignature rejects */
+void checkBatch(const std::vector<TestRing> &rings, const std::vector<size_t> &expectedInvalid)
+{
+    RingSignatureBatch batch;
+
+    std::vector<size_t> invalid;
+
+    for (size_t i = 0; i < rings.size(); i++)
+    {
+        const auto &ring = rings[i];
+
+        batch.addRing(ring.prefixHash, ring.keyImage, ring.publicKeys, ring.signatures);
+
+        if (!crypto_ops::checkRingSignature(ring.prefixHash, ring.keyImage, ring.publicKeys, ring.signatures))
+        {
+            invalid.push_back(i);
+        }
+    }
+
+    expect(invalid == expectedInvalid, "checkRingSignature rejects the corrupted rings");
+
+    std::vector<size_t> invalidRings;
+
+    expect(batch.verify(invalidRings) == expectedInvalid.empty(), "RingSignatureBatch::verify result");
+    expect(invalidRings == expectedInvalid, "RingSignatureBatch reports the corrupted rings");
+    expect(batch.verify() == expectedInvalid.empty(), "RingSignatureBatch::verify without indexes");
+}
+
+void testRingSignatureBatch()
+{
+    const auto rings = makeRings(20);
+
+    checkBatch(rings, {});
+
+    /* A single corrupted signature */
+    auto corrupted = rings;
+    corrupted[7].signatures[0].data[3] ^= 1;
+
+    checkBatch(corrupted, {7});
+
+    /* Valid rings mixed with rings broken in each of the ways a signature
+       can fail */
+    auto mixed = rings;
+
+    mixed[0].prefixHash.data[0] ^= 1;
+    std::swap(mixed[4].keyImage, mixed[5].keyImage);
+    mixed[13].signatures.back().data[40] ^= 0x80;
+    mixed[19].publicKeys.front() = mixed[18].publicKeys.front();
+
+    checkBatch(mixed, {0, 4, 5, 13, 19});
+
+    std::cout << "RingSignatureBatch: OK" << std::endl;
+}
+
 /* Bit of hackery so we can get the variable name of the passed in function.
    This way we can print the test we are currently performing. */
 #define BENCHMARK(hashFunction, iterations) benchmark(hashFunction, #hashFunction, iterations)
@@ -391,6 +556,11 @@ int main(int argc, char **argv)
             TEST_HASH_FUNCTION_WITH_HEIGHT(cn_soft_shell_slow_hash_v2, CN_SOFT_SHELL_V2[height / 512], height);
         }
 
+        std::cout << std::endl;
+
+        testBatchToBytes();
+        testRingSignatureBatch();
+
         if (o_benchmark)
         {
             std::cout << "\nPerformance Tests: Please wait, this may take a while depending on your system...\n\n";
@@ -308,6 +308,13 @@ int main(int argc, char *argv[])
                            config.seedNodes,
                            config.p2pResetPeerstate);
 
+        SpentKeyImageIndex::Mode keyImageIndexMode;
+
+        if (!SpentKeyImageIndex::modeFromString(config.dbKeyImageIndex, keyImageIndexMode))
+        {
+            throw std::runtime_error("Invalid value for db-key-image-index: " + config.dbKeyImageIndex);
+        }
+
         DataBaseConfig dbConfig(config.dataDirectory,
                                 config.dbThreads,
                                 config.dbMaxOpenFiles,
@@ -362,8 +369,10 @@ int main(int argc, char *argv[])
             std::move(checkpoints),
             dispatcher,
             std::unique_ptr<IBlockchainCacheFactory>(
-                std::make_unique<DatabaseBlockchainCacheFactory>(*database, logger.getLogger())),
-            config.transactionValidationThreads);
+                std::make_unique<DatabaseBlockchainCacheFactory>(
+                    *database, logger.getLogger(), keyImageIndexMode, config.dbWalletScanRecords)),
+            config.transactionValidationThreads,
+            config.walletSyncCacheBlocks);
 
         ccore->load();
 
@@ -455,6 +464,8 @@ int main(int argc, char *argv[])
         const auto cprotocol =
             std::make_shared<CryptoNote::CryptoNoteProtocolHandler>(currency, dispatcher, *ccore, nullptr, logManager);
 
+        cprotocol->addObserver(ccore.get());
+
         const auto p2psrv = std::make_shared<CryptoNote::NodeServer>(dispatcher, *cprotocol, logManager);
 
         RpcMode rpcMode = RpcMode::Default;
@@ -534,6 +545,7 @@ int main(int argc, char *argv[])
         p2psrv->deinit();
 
         cprotocol->set_p2p_endpoint(nullptr);
+        cprotocol->removeObserver(ccore.get());
         ccore->save();
     }
     catch (const std::exception &e)
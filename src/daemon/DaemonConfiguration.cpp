@@ -70,7 +70,8 @@ namespace DaemonConfig
             ("enable-cors", "Adds header 'Access-Control-Allow-Origin' to the RPC responses using the <domain>. Uses the value specified as the domain. Use * for all.", cxxopts::value<std::string>(config.enableCors), "<domain>")
             ("enable-trtl-rpc", "Enable the turtlecoin RPC API", cxxopts::value<bool>(config.enableTrtlRpc))
             ("fee-address", "Sets the convenience charge <address> for light wallets that use the daemon", cxxopts::value<std::string>(config.feeAddress), "<address>")
-            ("fee-amount", "Sets the convenience charge amount for light wallets that use the daemon", cxxopts::value<int>(config.feeAmount));
+            ("fee-amount", "Sets the convenience charge amount for light wallets that use the daemon", cxxopts::value<int>(config.feeAmount))
+            ("wallet-sync-cache-blocks", "Number of recent blocks kept ready to send to syncing wallets, 0 to disable", cxxopts::value<uint64_t>(config.walletSyncCacheBlocks), "#");
 
         options.add_options("Network")
             ("allow-local-ip", "Allow the local IP to be added to the peer list", cxxopts::value<bool>(config.localIp))
@@ -112,7 +113,9 @@ namespace DaemonConfig
             ("db-write-buffer-size", "Size of the database write buffer in megabytes (MB) " + writeBuffer, cxxopts::value<int>())
             ("db-max-file-size", "Max file size of database files in megabytes (MB) (LevelDB only)", cxxopts::value<int>()->default_value(std::to_string(CryptoNote::LEVELDB_MAX_FILE_SIZE_MB)))
             ("db-optimize", "Optimize database and close", cxxopts::value<bool>(config.dbOptimize))
-            ("db-use-experimental-serializer", "Use experimental serializer to store the blockchain data.", cxxopts::value<bool>(config.dbUseExperimentalSerializer));
+            ("db-use-experimental-serializer", "Store the blockchain data in a compact binary format. Only applies to a new DB.", cxxopts::value<bool>(config.dbUseExperimentalSerializer))
+            ("db-key-image-index", "Index spent key images in memory: full, filter (uses less memory, falls back to the database) or none", cxxopts::value<std::string>(config.dbKeyImageIndex)->default_value(config.dbKeyImageIndex), "<mode>")
+            ("db-wallet-scan-records", "Store a compact record of each block to serve syncing wallets from, instead of building it from the block each time", cxxopts::value<bool>(config.dbWalletScanRecords)->default_value(config.dbWalletScanRecords ? "true" : "false"));
 
         options.add_options("Syncing")
             ("transaction-validation-threads", "Number of threads to use to validate a transaction's inputs in parallel.", cxxopts::value<uint32_t>(config.transactionValidationThreads));
@@ -274,6 +277,11 @@ namespace DaemonConfig
             config.feeAmount = j["fee-amount"].GetInt();
         }
 
+        if (j.HasMember("wallet-sync-cache-blocks"))
+        {
+            config.walletSyncCacheBlocks = j["wallet-sync-cache-blocks"].GetUint64();
+        }
+
         // Network Options
 
         if (j.HasMember("allow-local-ip"))
@@ -413,6 +421,16 @@ namespace DaemonConfig
             config.dbUseExperimentalSerializer = j["db-use-experimental-serializer"].GetBool();
         }
 
+        if (j.HasMember("db-key-image-index"))
+        {
+            config.dbKeyImageIndex = j["db-key-image-index"].GetString();
+        }
+
+        if (j.HasMember("db-wallet-scan-records"))
+        {
+            config.dbWalletScanRecords = j["db-wallet-scan-records"].GetBool();
+        }
+
         // Syncing Options
 
         if (j.HasMember("transaction-validation-threads"))
@@ -441,6 +459,7 @@ namespace DaemonConfig
         j.AddMember("enable-trtl-api", config.enableTrtlRpc, alloc);
         j.AddMember("fee-address", config.feeAddress, alloc);
         j.AddMember("fee-amount", config.feeAmount, alloc);
+        j.AddMember("wallet-sync-cache-blocks", config.walletSyncCacheBlocks, alloc);
 
         j.AddMember("allow-local-ip", config.localIp, alloc);
         j.AddMember("hide-my-port", config.hideMyPort, alloc);
@@ -495,6 +514,8 @@ namespace DaemonConfig
         j.AddMember("db-write-buffer-size", config.dbWriteBufferSizeMB, alloc);
         j.AddMember("db-max-file-size", config.dbMaxFileSizeMB, alloc);
         j.AddMember("db-use-experimental-serializer", config.dbUseExperimentalSerializer, alloc);
+        j.AddMember("db-key-image-index", config.dbKeyImageIndex, alloc);
+        j.AddMember("db-wallet-scan-records", config.dbWalletScanRecords, alloc);
 
         j.AddMember("transaction-validation-threads", config.transactionValidationThreads, alloc);
 
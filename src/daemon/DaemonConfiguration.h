@@ -47,6 +47,7 @@ namespace DaemonConfig
         bool enableTrtlRpc = false;
         std::string feeAddress;
         int feeAmount = 0;
+        uint64_t walletSyncCacheBlocks = CryptoNote::WALLET_SYNC_CACHE_DEFAULT_BLOCKS;
 
         bool localIp = false;
         bool hideMyPort = false;
@@ -71,6 +72,8 @@ namespace DaemonConfig
         uint64_t dbMaxFileSizeMB = CryptoNote::LEVELDB_MAX_FILE_SIZE_MB;
         bool dbOptimize = false;
         bool dbUseExperimentalSerializer = false;
+        std::string dbKeyImageIndex = "full";
+        bool dbWalletScanRecords = false;
 
         uint32_t transactionValidationThreads = std::thread::hardware_concurrency();
 
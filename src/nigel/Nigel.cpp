@@ -13,6 +13,8 @@
 #include <cryptonotecore/Core.h>
 #include <CryptoNote.h>
 #include <errors/ValidateParameters.h>
+#include <serialization/SerializationTools.h>
+#include <serialization/WalletTypesSerialization.h>
 #include <utilities/Utilities.h>
 #include <version.h>
 
@@ -95,6 +97,7 @@ void Nigel::swapNode(const std::string daemonHost, const uint16_t daemonPort, co
     m_nodeFeeAddress = "";
     m_nodeFeeAmount = 0;
     m_useRawBlocks = true;
+    m_useBinarySync = true;
 
     m_daemonHost = daemonHost;
     m_daemonPort = daemonPort;
@@ -133,6 +136,19 @@ std::tuple<bool, std::vector<WalletTypes::WalletBlockInfo>, std::optional<Wallet
               {"blockCount", m_blockCount.load()},
               {"skipCoinbaseTransactions", skipCoinbaseTransactions}};
 
+    /* /getrawblocks is tried first, the binary endpoint takes the place
+       of /getwalletsyncdata for daemons without it */
+    if (!m_useRawBlocks && m_useBinarySync)
+    {
+        return getWalletSyncDataBinary(
+            j,
+            blockHashCheckpoints,
+            startHeight,
+            startTimestamp,
+            skipCoinbaseTransactions
+        );
+    }
+
     const std::string endpoint = m_useRawBlocks ? "/getrawblocks" : "/getwalletsyncdata";
 
     Logger::logger.log(
@@ -143,7 +159,7 @@ std::tuple<bool, std::vector<WalletTypes::WalletBlockInfo>, std::optional<Wallet
 
     const auto res = m_nodeClient->Post(endpoint, m_requestHeaders, j.dump(), "application/json");
 
-    /* Daemon doesn't support /getrawblocks, fall back to /getwalletsyncdata */
+    /* Daemon doesn't support /getrawblocks, fall back to the wallet sync endpoints */
     if (res && res->status == 404 && m_useRawBlocks)
     {
         m_useRawBlocks = false;
@@ -219,6 +235,83 @@ std::tuple<bool, std::vector<WalletTypes::WalletBlockInfo>, std::optional<Wallet
     return { false, {}, std::nullopt };
 }
 
+std::tuple<bool, std::vector<WalletTypes::WalletBlockInfo>, std::optional<WalletTypes::TopBlock>>
+    Nigel::getWalletSyncDataBinary(
+        const nlohmann::json &request,
+        const std::vector<Crypto::Hash> blockHashCheckpoints,
+        const uint64_t startHeight,
+        const uint64_t startTimestamp,
+        const bool skipCoinbaseTransactions)
+{
+    Logger::logger.log(
+        "Sending /getwalletsyncdata/binary request to daemon: " + request.dump(),
+        Logger::TRACE,
+        { Logger::SYNC, Logger::DAEMON }
+    );
+
+    const auto res = m_nodeClient->Post("/getwalletsyncdata/binary", m_requestHeaders, request.dump(), "application/json");
+
+    /* Daemon doesn't support the binary format, fall back to /getwalletsyncdata */
+    if (res && res->status == 404)
+    {
+        m_useBinarySync = false;
+
+        return getWalletSyncData(
+            blockHashCheckpoints,
+            startHeight,
+            startTimestamp,
+            skipCoinbaseTransactions
+        );
+    }
+
+    if (!res || res->status != 200)
+    {
+        std::stringstream stream;
+
+        stream << "Failed to fetch blocks from daemon - ";
+
+        if (res)
+        {
+            stream << "got status code " << res->status;
+        }
+        else
+        {
+            stream << "failed to open socket or timed out.";
+        }
+
+        Logger::logger.log(stream.str(), Logger::INFO, { Logger::SYNC, Logger::DAEMON });
+
+        return { false, {}, std::nullopt };
+    }
+
+    WalletTypes::WalletSyncData syncData;
+
+    if (!CryptoNote::fromBinaryArray(syncData, std::vector<uint8_t>(res->body.begin(), res->body.end())))
+    {
+        Logger::logger.log(
+            "Failed to fetch blocks from daemon - could not deserialize the response",
+            Logger::INFO,
+            { Logger::SYNC, Logger::DAEMON }
+        );
+
+        return { false, {}, std::nullopt };
+    }
+
+    Logger::logger.log(
+        "Got " + std::to_string(syncData.blocks.size()) + " blocks from daemon",
+        Logger::TRACE,
+        { Logger::SYNC, Logger::DAEMON }
+    );
+
+    /* Same as the JSON response, the top block is only used once we're synced */
+    if (!syncData.synced)
+    {
+        syncData.topBlock.reset();
+    }
+
+    return { true, std::move(syncData.blocks), syncData.topBlock };
+}
+
 void Nigel::stop()
 {
     m_shouldStop = true;
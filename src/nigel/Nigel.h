@@ -95,6 +95,14 @@ class Nigel
 
     bool getFeeInfo();
 
+    std::tuple<bool, std::vector<WalletTypes::WalletBlockInfo>, std::optional<WalletTypes::TopBlock>>
+        getWalletSyncDataBinary(
+            const nlohmann::json &request,
+            const std::vector<Crypto::Hash> blockHashCheckpoints,
+            const uint64_t startHeight,
+            const uint64_t startTimestamp,
+            const bool skipCoinbaseTransactions);
+
     template<typename F>
     auto tryParseJSONResponse(
         const httplib::Result &res,
@@ -233,4 +241,8 @@ class Nigel
 
     /* Whether we should use /getrawblocks instead of /getwalletsyncdata */
     bool m_useRawBlocks = true;
+
+    /* Whether we should use the binary /getwalletsyncdata/binary instead
+       of /getwalletsyncdata, when /getrawblocks isn't supported */
+    bool m_useBinarySync = true;
 };
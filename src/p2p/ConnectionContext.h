@@ -7,7 +7,10 @@
 #pragma once
 
 #include "common/StringTools.h"
+#include "config/CryptoNoteConfig.h"
 #include "crypto/hash.h"
+#include "p2p/KnownInventory.h"
+#include "p2p/PendingCompactBlock.h"
 #include "p2p/PendingLiteBlock.h"
 
 #include <boost/uuid/uuid.hpp>
@@ -16,6 +19,7 @@
 #include <optional>
 #include <ostream>
 #include <unordered_set>
+#include <vector>
 
 namespace CryptoNote
 {
@@ -30,7 +34,6 @@ namespace CryptoNote
 
         std::chrono::high_resolution_clock::time_point m_request_block_start;
         size_t m_request_block_rate = 0;
-        size_t m_next_request_block_rate = 1;
 
         enum state
         {
@@ -45,10 +48,17 @@ namespace CryptoNote
 
         state m_state = state_before_handshake;
         std::optional<PendingLiteBlock> m_pending_lite_block;
-        std::list<Crypto::Hash> m_needed_objects;
-        std::unordered_set<Crypto::Hash> m_requested_objects;
+        std::optional<PendingCompactBlock> m_pending_compact_block;
         uint32_t m_remote_blockchain_height = 0;
         uint32_t m_last_response_height = 0;
+
+        /* Transactions which aren't announced to the peer, as it has them */
+        KnownInventory m_known_transactions {P2P_KNOWN_TRANSACTIONS_LIMIT};
+
+        /* Transaction hashes waiting to be announced to the peer in the next batch */
+        std::vector<Crypto::Hash> m_pending_transaction_announcements;
+
+        std::chrono::steady_clock::time_point m_next_transaction_announcement;
     };
 
     inline std::string get_protocol_state_string(CryptoNoteConnectionContext::state s)
@@ -0,0 +1,33 @@
+// Copyright (c) 2018-2024, The DeroGold Developers
+//
+// Please see the included LICENSE file for more information.
+
+#include "KnownInventory.h"
+
+namespace CryptoNote
+{
+    KnownInventory::KnownInventory(size_t limit): m_limit(limit) {}
+
+    bool KnownInventory::contains(const Crypto::Hash &hash) const
+    {
+        return m_current.count(hash) != 0 || m_previous.count(hash) != 0;
+    }
+
+    bool KnownInventory::add(const Crypto::Hash &hash)
+    {
+        if (contains(hash))
+        {
+            return false;
+        }
+
+        m_current.insert(hash);
+
+        if (m_current.size() >= m_limit / 2)
+        {
+            m_previous = std::move(m_current);
+            m_current.clear();
+        }
+
+        return true;
+    }
+} // namespace CryptoNote
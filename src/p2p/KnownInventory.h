@@ -0,0 +1,36 @@
+// Copyright (c) 2018-2024, The DeroGold Developers
+//
+// Please see the included LICENSE file for more information.
+
+#pragma once
+
+#include <crypto/hash.h>
+#include <unordered_set>
+
+namespace CryptoNote
+{
+    /* The hashes a peer is known to have, because it sent or announced them
+       to us, or we sent or announced them to it, so they aren't announced to
+       it again.
+
+       Bounded, by forgetting the older half of the hashes once the limit is
+       reached. A forgotten hash may be announced twice, which is harmless. */
+    class KnownInventory
+    {
+      public:
+        explicit KnownInventory(size_t limit);
+
+        bool contains(const Crypto::Hash &hash) const;
+
+        /* Returns false if the hash was already known */
+        bool add(const Crypto::Hash &hash);
+
+      private:
+        size_t m_limit;
+
+        std::unordered_set<Crypto::Hash> m_current;
+
+        /* The hashes added before m_current was last started over */
+        std::unordered_set<Crypto::Hash> m_previous;
+    };
+} // namespace CryptoNote
@@ -44,6 +44,11 @@ bool LevinProtocol::Command::needReply() const
 LevinProtocol::LevinProtocol(System::TcpConnection &connection): m_conn(connection) {}
 
 void LevinProtocol::sendMessage(uint32_t command, const BinaryArray &out, bool needResponse)
+{
+    sendFrame(encodeMessage(command, out, needResponse));
+}
+
+BinaryArray LevinProtocol::encodeMessage(uint32_t command, const BinaryArray &out, bool needResponse)
 {
     bucket_head2 head = {0};
     head.m_signature = LEVIN_SIGNATURE;
@@ -53,15 +58,15 @@ void LevinProtocol::sendMessage(uint32_t command, const BinaryArray &out, bool n
     head.m_protocol_version = LEVIN_PROTOCOL_VER_1;
     head.m_flags = LEVIN_PACKET_REQUEST;
 
-    // write header and body in one operation
-    BinaryArray writeBuffer;
-    writeBuffer.reserve(sizeof(head) + out.size());
+    // header and body in one buffer, so they are written in one operation
+    BinaryArray frame;
+    frame.reserve(sizeof(head) + out.size());
 
-    Common::VectorOutputStream stream(writeBuffer);
+    Common::VectorOutputStream stream(frame);
     stream.writeSome(&head, sizeof(head));
     stream.writeSome(out.data(), out.size());
 
-    writeStrict(writeBuffer.data(), writeBuffer.size());
+    return frame;
 }
 
 bool LevinProtocol::readCommand(Command &cmd)
@@ -103,6 +108,11 @@ bool LevinProtocol::readCommand(Command &cmd)
 }
 
 void LevinProtocol::sendReply(uint32_t command, const BinaryArray &out, int32_t returnCode)
+{
+    sendFrame(encodeReply(command, out, returnCode));
+}
+
+BinaryArray LevinProtocol::encodeReply(uint32_t command, const BinaryArray &out, int32_t returnCode)
 {
     bucket_head2 head = {0};
     head.m_signature = LEVIN_SIGNATURE;
@@ -113,14 +123,19 @@ void LevinProtocol::sendReply(uint32_t command, const BinaryArray &out, int32_t
     head.m_flags = LEVIN_PACKET_RESPONSE;
     head.m_return_code = returnCode;
 
-    BinaryArray writeBuffer;
-    writeBuffer.reserve(sizeof(head) + out.size());
+    BinaryArray frame;
+    frame.reserve(sizeof(head) + out.size());
 
-    Common::VectorOutputStream stream(writeBuffer);
+    Common::VectorOutputStream stream(frame);
     stream.writeSome(&head, sizeof(head));
     stream.writeSome(out.data(), out.size());
 
-    writeStrict(writeBuffer.data(), writeBuffer.size());
+    return frame;
+}
+
+void LevinProtocol::sendFrame(const BinaryArray &frame)
+{
+    writeStrict(frame.data(), frame.size());
 }
 
 void LevinProtocol::writeStrict(const uint8_t *ptr, size_t size)
@@ -79,6 +79,14 @@ namespace CryptoNote
 
         void sendReply(uint32_t command, const BinaryArray &out, int32_t returnCode);
 
+        /* Writes a message already encoded by encodeMessage() or encodeReply() */
+        void sendFrame(const BinaryArray &frame);
+
+        /* The header followed by the body, as sent on the wire */
+        static BinaryArray encodeMessage(uint32_t command, const BinaryArray &out, bool needResponse);
+
+        static BinaryArray encodeReply(uint32_t command, const BinaryArray &out, int32_t returnCode);
+
         template<typename T> static bool decode(const BinaryArray &buf, T &value)
         {
             try
@@ -160,6 +160,44 @@ namespace CryptoNote
     } // namespace
 
 
+    //-----------------------------------------------------------------------------------
+    // P2pMessage implementation
+    //-----------------------------------------------------------------------------------
+
+    P2pMessage::P2pMessage(Type type, uint32_t command, const BinaryArray &buffer, int32_t returnCode):
+        P2pMessage(type, command, encodeFrame(type, command, buffer, returnCode), returnCode)
+    {
+    }
+
+    P2pMessage::P2pMessage(
+        Type type,
+        uint32_t command,
+        std::shared_ptr<const BinaryArray> frame,
+        int32_t returnCode):
+        type(type),
+        command(command),
+        frame(std::move(frame)),
+        returnCode(returnCode)
+    {
+    }
+
+    std::shared_ptr<const BinaryArray>
+        P2pMessage::encodeFrame(Type type, uint32_t command, const BinaryArray &buffer, int32_t returnCode)
+    {
+        switch (type)
+        {
+            case COMMAND:
+                return std::make_shared<const BinaryArray>(LevinProtocol::encodeMessage(command, buffer, true));
+            case NOTIFY:
+                return std::make_shared<const BinaryArray>(LevinProtocol::encodeMessage(command, buffer, false));
+            case REPLY:
+                return std::make_shared<const BinaryArray>(LevinProtocol::encodeReply(command, buffer, returnCode));
+            default:
+                assert(false);
+                return nullptr;
+        }
+    }
+
     //-----------------------------------------------------------------------------------
     // P2pConnectionContext implementation
     //-----------------------------------------------------------------------------------
@@ -393,8 +431,17 @@ namespace CryptoNote
         const BinaryArray &data_buff,
         const boost::uuids::uuid *excludeConnection)
     {
-        m_dispatcher.remoteSpawn([this, command, data_buff, excludeConnection] {
-            relay_notify_to_all(command, data_buff, excludeConnection);
+        /* Encoded once here, rather than copied into the lambda and then again
+           for every connection */
+        auto frame = P2pMessage::encodeFrame(P2pMessage::NOTIFY, command, data_buff);
+
+        boost::uuids::uuid excludeId =
+            excludeConnection ? *excludeConnection : boost::value_initialized<boost::uuids::uuid>();
+
+        m_dispatcher.remoteSpawn([this, command, frame, excludeId] {
+            relayFrame(command, frame, [&excludeId](const P2pConnectionContext &conn) {
+                return conn.m_connection_id != excludeId;
+            });
         });
     }
 
@@ -404,17 +451,11 @@ namespace CryptoNote
         const BinaryArray &data_buff,
         const std::list<boost::uuids::uuid> relayList)
     {
-        m_dispatcher.remoteSpawn([this, command, data_buff, relayList] {
-            forEachConnection([&](P2pConnectionContext &conn) {
-                if (std::find(relayList.begin(), relayList.end(), conn.m_connection_id) != relayList.end())
-                {
-                    if (conn.peerId
-                        && (conn.m_state == CryptoNoteConnectionContext::state_normal
-                            || conn.m_state == CryptoNoteConnectionContext::state_synchronizing))
-                    {
-                        conn.pushMessage(P2pMessage(P2pMessage::NOTIFY, command, data_buff));
-                    }
-                }
+        auto frame = P2pMessage::encodeFrame(P2pMessage::NOTIFY, command, data_buff);
+
+        m_dispatcher.remoteSpawn([this, command, frame, relayList] {
+            relayFrame(command, frame, [&relayList](const P2pConnectionContext &conn) {
+                return std::find(relayList.begin(), relayList.end(), conn.m_connection_id) != relayList.end();
             });
         });
     }
@@ -1096,6 +1137,7 @@ namespace CryptoNote
         {
             m_connections_maker_interval.call([this] { return connections_maker(); });
             m_peerlist_store_interval.call([this] { return store_config(); });
+            m_payload_handler.onIdle();
         }
         catch (std::exception &e)
         {
@@ -1275,12 +1317,25 @@ namespace CryptoNote
         boost::uuids::uuid excludeId =
             excludeConnection ? *excludeConnection : boost::value_initialized<boost::uuids::uuid>();
 
+        relayFrame(
+            command,
+            P2pMessage::encodeFrame(P2pMessage::NOTIFY, command, data_buff),
+            [&excludeId](const P2pConnectionContext &conn) { return conn.m_connection_id != excludeId; });
+    }
+
+    //-----------------------------------------------------------------------------------
+    void NodeServer::relayFrame(
+        uint32_t command,
+        const std::shared_ptr<const BinaryArray> &frame,
+        std::function<bool(const P2pConnectionContext &)> filter)
+    {
         forEachConnection([&](P2pConnectionContext &conn) {
-            if (conn.peerId && conn.m_connection_id != excludeId
+            if (conn.peerId
                 && (conn.m_state == CryptoNoteConnectionContext::state_normal
-                    || conn.m_state == CryptoNoteConnectionContext::state_synchronizing))
+                    || conn.m_state == CryptoNoteConnectionContext::state_synchronizing)
+                && filter(conn))
             {
-                conn.pushMessage(P2pMessage(P2pMessage::NOTIFY, command, data_buff));
+                conn.pushMessage(P2pMessage(P2pMessage::NOTIFY, command, frame));
             }
         });
     }
@@ -1762,20 +1817,7 @@ namespace CryptoNote
                 for (const auto &msg : msgs)
                 {
                     logger(DEBUGGING) << ctx << "msg " << msg.type << ':' << msg.command;
-                    switch (msg.type)
-                    {
-                        case P2pMessage::COMMAND:
-                            proto.sendMessage(msg.command, msg.buffer, true);
-                            break;
-                        case P2pMessage::NOTIFY:
-                            proto.sendMessage(msg.command, msg.buffer, false);
-                            break;
-                        case P2pMessage::REPLY:
-                            proto.sendReply(msg.command, msg.buffer, msg.returnCode);
-                            break;
-                        default:
-                            assert(false);
-                    }
+                    proto.sendFrame(*msg.frame);
                 }
             }
         }
@@ -20,6 +20,7 @@
 #include <boost/functional/hash.hpp>
 #include <boost/uuid/uuid.hpp>
 #include <functional>
+#include <memory>
 #include <system/Context.h>
 #include <system/ContextGroup.h>
 #include <system/Dispatcher.h>
@@ -50,32 +51,28 @@ namespace CryptoNote
             NOTIFY
         };
 
-        P2pMessage(Type type, uint32_t command, BinaryArray buffer, int32_t returnCode = 0):
-            type(type),
-            command(command),
-            buffer(std::move(buffer)),
-            returnCode(returnCode)
-        {
-        }
+        /* Encodes the Levin frame of the message */
+        P2pMessage(Type type, uint32_t command, const BinaryArray &buffer, int32_t returnCode = 0);
 
-        P2pMessage(P2pMessage &&msg):
-            type(msg.type),
-            command(msg.command),
-            buffer(msg.buffer),
-            returnCode(msg.returnCode)
-        {
-        }
+        /* Takes a frame made by encodeFrame(), which can be shared by all the
+           connections the same message is relayed to */
+        P2pMessage(Type type, uint32_t command, std::shared_ptr<const BinaryArray> frame, int32_t returnCode = 0);
+
+        static std::shared_ptr<const BinaryArray>
+            encodeFrame(Type type, uint32_t command, const BinaryArray &buffer, int32_t returnCode = 0);
 
-        size_t size()
+        size_t size() const
         {
-            return buffer.size();
+            return frame->size();
         }
 
         Type type;
 
         uint32_t command;
 
-        const BinaryArray buffer;
+        /* The Levin header followed by the body, ready to be written to the
+           socket. Never modified once made. */
+        std::shared_ptr<const BinaryArray> frame;
 
         int32_t returnCode;
     };
@@ -245,6 +242,13 @@ namespace CryptoNote
 
         void on_connection_close(P2pConnectionContext &context);
 
+        /* Queues the same encoded notification on every connection in normal
+           or synchronizing state which passes the filter */
+        void relayFrame(
+            uint32_t command,
+            const std::shared_ptr<const BinaryArray> &frame,
+            std::function<bool(const P2pConnectionContext &)> filter);
+
         //----------------- i_p2p_endpoint -------------------------------------------------------------
         virtual void relay_notify_to_all(
             int command,
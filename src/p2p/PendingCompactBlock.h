@@ -0,0 +1,31 @@
+// Copyright (c) 2018-2024, The DeroGold Developers
+//
+// Please see the included LICENSE file for more information.
+
+#pragma once
+
+#include "cryptonoteprotocol/CryptoNoteProtocolDefinitions.h"
+
+#include <vector>
+
+namespace CryptoNote
+{
+    /* A compact block some of whose transactions were asked for from the
+       peer which sent it */
+    struct PendingCompactBlock
+    {
+        NOTIFY_NEW_COMPACT_BLOCK_request request;
+
+        BlockTemplate blockTemplate;
+
+        /* Every transaction of the block, in order, empty where still missing */
+        std::vector<BinaryArray> transactions;
+
+        /* Indexes of the empty transactions, in the order they were asked for */
+        std::vector<uint32_t> missingIndexes;
+
+        /* Indexes of the transactions which were found in our pool by their
+           short id, which are asked for if the rebuilt block is wrong */
+        std::vector<uint32_t> poolIndexes;
+    };
+} // namespace CryptoNote
@@ -13,14 +13,25 @@
 
 #include <config/Constants.h>
 #include <common/CryptoNoteTools.h>
+#include <common/ScopeExit.h>
 #include <errors/ValidateParameters.h>
 #include <logger/Logger.h>
 #include <serialization/SerializationTools.h>
+#include <serialization/WalletTypesSerialization.h>
 #include <utilities/Addresses.h>
 #include <utilities/ColouredMsg.h>
 #include <utilities/FormatTools.h>
 #include <utilities/ParseExtra.h>
 
+namespace
+{
+    /* Thrown by a streamed response's flush once the client has gone, so the
+       writer stops producing a response nobody will read */
+    struct ClientDisconnected
+    {
+    };
+} // namespace
+
 RpcServer::RpcServer(
     const uint16_t bindPort,
     const std::string rpcBindIp,
@@ -60,9 +71,14 @@ RpcServer::RpcServer(
     const bool syncRequired = true;
     const bool syncNotRequired = false;
 
+    /* Bind a handler to this instance */
+    const auto bind = [this](const auto function) -> Handler {
+        return std::bind(function, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3);
+    };
+
     /* Route the request through our middleware function, before forwarding
        to the specified function */
-    const auto router = [this](const auto function, const RpcMode routePermissions, const bool isBodyRequired, const bool syncRequired) {
+    const auto router = [this, bind](const auto function, const RpcMode routePermissions, const bool isBodyRequired, const bool syncRequired) {
         return [=](const httplib::Request &req, httplib::Response &res) {
             /* Pass the inputted function with the arguments passed through
                to middleware */
@@ -72,76 +88,28 @@ RpcServer::RpcServer(
                 routePermissions,
                 isBodyRequired,
                 syncRequired,
-                std::bind(function, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3)
+                bind(function)
             );
         };
     };
 
-    const auto jsonRpc = [this, router, bodyRequired, bodyNotRequired, syncRequired, syncNotRequired](const auto &req, auto &res) {
-        const auto body = getJsonBody(req, res, true);
-
-        if (!body)
-        {
-            return;
-        }
-
-        if (!hasMember(*body, "method"))
-        {
-            failRequest(400, "Missing JSON parameter: 'method'", res);
-            return;
-        }
-
-        const auto method = getStringFromJSON(*body, "method");
-
-        if (method == "getblocktemplate")
-        {
-            router(&RpcServer::getBlockTemplateJsonRpc, RpcMode::Default, bodyRequired, syncRequired)(req, res);
-        }
-        else if (method == "submitblock")
-        {
-            router(&RpcServer::submitBlockJsonRpc, RpcMode::Default, bodyRequired, syncRequired)(req, res);
-        }
-        else if (method == "getblockcount")
-        {
-            router(&RpcServer::getBlockCountJsonRpc, RpcMode::Default, bodyNotRequired, syncNotRequired)(req, res);
-        }
-        else if (method == "getlastblockheader")
-        {
-            router(&RpcServer::getLastBlockHeaderJsonRpc, RpcMode::Default, bodyNotRequired, syncNotRequired)(req, res);
-        }
-        else if (method == "getblockheaderbyhash")
-        {
-            router(&RpcServer::getBlockHeaderByHashJsonRpc, RpcMode::Default, bodyRequired, syncNotRequired)(req, res);
-        }
-        else if (method == "getblockheaderbyheight")
-        {
-            router(&RpcServer::getBlockHeaderByHeightJsonRpc, RpcMode::Default, bodyRequired, syncNotRequired)(req, res);
-        }
-        else if (method == "f_blocks_list_json")
-        {
-            router(&RpcServer::getBlocksByHeightJsonRpc, RpcMode::BlockExplorerEnabled, bodyRequired, syncNotRequired)(req, res);
-        }
-        else if (method == "f_block_json")
-        {
-            router(
-                &RpcServer::getBlockDetailsByHashJsonRpc, RpcMode::BlockExplorerEnabled, bodyRequired, syncNotRequired)(req, res);
-        }
-        else if (method == "f_transaction_json")
-        {
-            router(
-                &RpcServer::getTransactionDetailsByHashJsonRpc, RpcMode::BlockExplorerEnabled, bodyRequired, syncNotRequired)(req, res);
-        }
-        else if (method == "f_on_transactions_pool_json")
-        {
-            router(
-                &RpcServer::getTransactionsInPoolJsonRpc, RpcMode::BlockExplorerEnabled, bodyNotRequired, syncNotRequired)(req, res);
-        }
-        else
-        {
-            res.status = 404;
-        }
+    m_jsonRpcMethods = {
+        {"getblocktemplate", {bind(&RpcServer::getBlockTemplateJsonRpc), RpcMode::Default, syncRequired}},
+        {"getlastblockheader", {bind(&RpcServer::getLastBlockHeaderJsonRpc), RpcMode::Default, syncNotRequired}},
+        {"submitblock", {bind(&RpcServer::submitBlockJsonRpc), RpcMode::Default, syncRequired}},
+        {"getblockcount", {bind(&RpcServer::getBlockCountJsonRpc), RpcMode::Default, syncNotRequired}},
+        {"getblockheaderbyhash", {bind(&RpcServer::getBlockHeaderByHashJsonRpc), RpcMode::Default, syncNotRequired}},
+        {"getblockheaderbyheight", {bind(&RpcServer::getBlockHeaderByHeightJsonRpc), RpcMode::Default, syncNotRequired}},
+        {"f_blocks_list_json", {bind(&RpcServer::getBlocksByHeightJsonRpc), RpcMode::BlockExplorerEnabled, syncNotRequired}},
+        {"f_block_json", {bind(&RpcServer::getBlockDetailsByHashJsonRpc), RpcMode::BlockExplorerEnabled, syncNotRequired}},
+        {"f_transaction_json", {bind(&RpcServer::getTransactionDetailsByHashJsonRpc), RpcMode::BlockExplorerEnabled, syncNotRequired}},
+        {"f_on_transactions_pool_json", {bind(&RpcServer::getTransactionsInPoolJsonRpc), RpcMode::BlockExplorerEnabled, syncNotRequired}},
     };
 
+    /* The body is only parsed once, by the middleware. Each method in it
+       then gets its own permission and sync checks in runHandler */
+    const auto jsonRpc = router(&RpcServer::jsonRpc, RpcMode::Default, bodyRequired, syncNotRequired);
+
     if (m_useTrtlApi)
     {
         m_server
@@ -159,6 +127,8 @@ RpcServer::RpcServer(
             /* /block/headers/{height} */
             .Get("/block/headers/(\\d+)", router(&RpcServer::getBlocksByHeightTrtlApi, RpcMode::BlockExplorerEnabled, bodyNotRequired, syncNotRequired))
             .Get("/block/last", router(&RpcServer::getLastBlockHeaderTrtlApi, RpcMode::Default, bodyNotRequired, syncNotRequired))
+            /* /block/last/{hash}, waits for a block other than {hash} to be on top */
+            .Get("/block/last/([a-fA-F0-9]{64})", router(&RpcServer::getLastBlockHeaderTrtlApi, RpcMode::Default, bodyNotRequired, syncNotRequired))
             .Post("/block/template", router(&RpcServer::getBlockTemplateTrtlApi, RpcMode::Default, bodyRequired, syncNotRequired))
 
             .Get("/fee", router(&RpcServer::feeTrtlApi, RpcMode::Default, bodyNotRequired, syncNotRequired))
@@ -198,6 +168,7 @@ RpcServer::RpcServer(
             .Post("/sendrawtransaction", router(&RpcServer::sendTransaction, RpcMode::Default, bodyRequired, syncRequired))
             .Post("/getrandom_outs", router(&RpcServer::getRandomOuts, RpcMode::Default, bodyRequired, syncNotRequired))
             .Post("/getwalletsyncdata", router(&RpcServer::getWalletSyncData, RpcMode::Default, bodyRequired, syncNotRequired))
+            .Post("/getwalletsyncdata/binary", router(&RpcServer::getWalletSyncDataBinary, RpcMode::Default, bodyRequired, syncNotRequired))
             .Post("/get_global_indexes_for_range", router(&RpcServer::getGlobalIndexes, RpcMode::Default, bodyRequired, syncNotRequired))
             .Post("/queryblockslite", router(&RpcServer::queryBlocksLite, RpcMode::Default, bodyRequired, syncNotRequired))
             .Post("/get_transactions_status", router(&RpcServer::getTransactionsStatus, RpcMode::Default, bodyRequired, syncNotRequired))
@@ -235,6 +206,8 @@ void RpcServer::listen()
 
 void RpcServer::stop()
 {
+    m_stopping = true;
+
     m_server.stop();
 
     if (m_serverThread.joinable())
@@ -304,10 +277,7 @@ void RpcServer::middleware(
     const RpcMode routePermissions,
     const bool bodyRequired,
     const bool syncRequired,
-    const std::function<std::tuple<Error, uint16_t>(
-        const httplib::Request &req,
-        httplib::Response &res,
-        const rapidjson::Document &body)>& handler)
+    const Handler &handler)
 {
     Logger::logger.log(
         "[" + req.get_header_value("REMOTE_ADDR") + "] Incoming " + req.method + " request: " + req.path + ", User-Agent: " + req.get_header_value("User-Agent"),
@@ -329,6 +299,17 @@ void RpcServer::middleware(
         return;
     }
 
+    runHandler(req, res, routePermissions, syncRequired, *jsonBody, handler);
+}
+
+void RpcServer::runHandler(
+    const httplib::Request &req,
+    httplib::Response &res,
+    const RpcMode routePermissions,
+    const bool syncRequired,
+    const rapidjson::Document &body,
+    const Handler &handler)
+{
     /* If this route requires higher permissions than we have enabled, then
      * reject the request */
     if (routePermissions > m_rpcMode)
@@ -358,7 +339,7 @@ void RpcServer::middleware(
         return;
     }
 
-    const uint64_t height = m_core->getTopBlockIndex() + 1;
+    const uint64_t height = getTopBlockIndex() + 1;
     const uint64_t networkHeight = std::max(1u, m_syncManager->getBlockchainHeight());
 
     const bool areSynced = m_p2p->get_payload_object().isSynchronized() && height >= networkHeight;
@@ -380,7 +361,7 @@ void RpcServer::middleware(
 
     try
     {
-        const auto [error, statusCode] = handler(req, res, *jsonBody);
+        const auto [error, statusCode] = handler(req, res, body);
 
         if (error)
         {
@@ -499,6 +480,71 @@ void RpcServer::failRequest(const Error& error, httplib::Response &res)
     writer.EndObject();
 }
 
+void RpcServer::streamJsonResponse(
+    httplib::Response &res,
+    std::function<void(
+        rapidjson::Writer<rapidjson::StringBuffer> &writer,
+        const std::function<void()> &flush)> write)
+{
+    res.headers.erase("Content-Type");
+
+    res.set_chunked_content_provider(
+        "application/json",
+        [write = std::move(write)](const size_t offset, httplib::DataSink &sink)
+        {
+            rapidjson::StringBuffer sb;
+            rapidjson::Writer<rapidjson::StringBuffer> writer(sb);
+
+            /* The writer only appends to the buffer, so it can be emptied
+               part way through a document */
+            const auto send = [&]()
+            {
+                const bool connected = sb.GetSize() == 0 || sink.write(sb.GetString(), sb.GetSize());
+
+                sb.Clear();
+
+                if (!connected)
+                {
+                    throw ClientDisconnected();
+                }
+            };
+
+            const std::function<void()> flush = [&]()
+            {
+                if (sb.GetSize() >= CryptoNote::RPC_STREAM_CHUNK_SIZE)
+                {
+                    send();
+                }
+            };
+
+            try
+            {
+                write(writer, flush);
+
+                send();
+            }
+            catch (const ClientDisconnected &)
+            {
+                return false;
+            }
+            catch (const std::exception &e)
+            {
+                /* The status has already been sent, all we can do is drop the connection */
+                Logger::logger.log(
+                    "Caught unexpected exception while streaming response: " + std::string(e.what()),
+                    Logger::FATAL,
+                    { Logger::DAEMON_RPC }
+                );
+
+                return false;
+            }
+
+            sink.done();
+
+            return true;
+        });
+}
+
 void RpcServer::failJsonRpcRequest(const int64_t errorCode, const std::string& errorMessage, httplib::Response &res)
 {
     rapidjson::StringBuffer sb;
@@ -526,14 +572,213 @@ void RpcServer::failJsonRpcRequest(const int64_t errorCode, const std::string& e
     res.status = 200;
 }
 
-uint64_t RpcServer::calculateTotalFeeAmount(const std::vector<Crypto::Hash> &transactionHashes)
+std::tuple<Error, uint16_t> RpcServer::jsonRpc(
+    const httplib::Request &req,
+    httplib::Response &res,
+    const rapidjson::Document &body)
 {
-    uint64_t totalFeeAmount = 0;
+    if (!body.IsArray())
+    {
+        if (!hasMember(body, "method"))
+        {
+            failRequest(400, "Missing JSON parameter: 'method'", res);
+            return {SUCCESS, 400};
+        }
 
-    std::vector<std::vector<uint8_t>> transactions;
-    std::vector<Crypto::Hash> ignore;
+        const auto method = m_jsonRpcMethods.find(getStringFromJSON(body, "method"));
+
+        if (method == m_jsonRpcMethods.end())
+        {
+            return {SUCCESS, 404};
+        }
 
-    m_core->getTransactions(transactionHashes, transactions, ignore);
+        const auto &[handler, permissions, syncRequired] = method->second;
+
+        runHandler(req, res, permissions, syncRequired, body, handler);
+
+        setJsonRpcId(body, res);
+
+        return {SUCCESS, static_cast<uint16_t>(res.status)};
+    }
+
+    /* A batch gets a batch of responses, with the errors for each request in
+       the array, as the JSON-RPC 2.0 spec asks */
+    if (body.Empty())
+    {
+        failJsonRpcRequest(-32600, "Invalid Request", res);
+        return {SUCCESS, 200};
+    }
+
+    /* Each request in a batch runs in turn on this worker, so a large batch
+       would tie it up for as long as many separate requests would */
+    if (body.Size() > CryptoNote::RPC_MAX_JSON_RPC_BATCH_SIZE)
+    {
+        failJsonRpcRequest(
+            -32600,
+            "Invalid Request: batches can contain at most "
+                + std::to_string(CryptoNote::RPC_MAX_JSON_RPC_BATCH_SIZE) + " requests",
+            res);
+
+        return {SUCCESS, 200};
+    }
+
+    std::string responses = "[";
+
+    for (const auto &element : body.GetArray())
+    {
+        httplib::Response response;
+
+        /* The handlers take a whole document */
+        rapidjson::Document request;
+        request.CopyFrom(element, request.GetAllocator());
+
+        if (!request.IsObject() || !hasMember(request, "method") || !request["method"].IsString())
+        {
+            failJsonRpcRequest(-32600, "Invalid Request", response);
+        }
+        else if (const auto method = m_jsonRpcMethods.find(request["method"].GetString());
+                 method == m_jsonRpcMethods.end())
+        {
+            failJsonRpcRequest(-32601, "Method not found", response);
+        }
+        else
+        {
+            const auto &[handler, permissions, syncRequired] = method->second;
+
+            runHandler(req, response, permissions, syncRequired, request, handler);
+        }
+
+        if (response.body.empty())
+        {
+            failJsonRpcRequest(-32603, "Internal error", response);
+        }
+
+        setJsonRpcId(request, response);
+
+        if (responses.size() > 1)
+        {
+            responses += ",";
+        }
+
+        responses += response.body;
+    }
+
+    responses += "]";
+
+    res.body = std::move(responses);
+
+    return {SUCCESS, 200};
+}
+
+void RpcServer::setJsonRpcId(const rapidjson::Value &request, httplib::Response &res) const
+{
+    if (!request.IsObject() || !hasMember(request, "id") || res.body.size() < 2 || res.body.front() != '{')
+    {
+        return;
+    }
+
+    rapidjson::StringBuffer sb;
+    rapidjson::Writer writer(sb);
+
+    request["id"].Accept(writer);
+
+    /* Every response is an object, so the id can go straight after the
+       opening brace without parsing the response again */
+    const std::string separator = res.body[1] == '}' ? "" : ",";
+
+    res.body.insert(1, "\"id\":" + std::string(sb.GetString()) + separator);
+}
+
+void RpcServer::longPoll(const std::function<bool(uint64_t changeId)> &changed)
+{
+    /* Too many waiting already, answer now as if the wait had timed out */
+    if (m_longPolls.fetch_add(1) >= CryptoNote::RPC_MAX_LONG_POLLS)
+    {
+        m_longPolls--;
+        return;
+    }
+
+    Tools::ScopeExit release([this] { m_longPolls--; });
+
+    const auto deadline =
+        std::chrono::steady_clock::now() + std::chrono::seconds(CryptoNote::RPC_LONG_POLL_TIMEOUT_SECONDS);
+
+    uint64_t changeId = m_core->getChangeId();
+
+    while (!changed(changeId) && !m_stopping)
+    {
+        const auto now = std::chrono::steady_clock::now();
+
+        if (now >= deadline)
+        {
+            return;
+        }
+
+        /* Wake up every second to see if the server is stopping, since
+           nothing wakes us when it does */
+        const auto timeout = std::min<std::chrono::milliseconds>(
+            std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now), std::chrono::seconds(1));
+
+        changeId = m_core->waitForChange(changeId, timeout);
+    }
+}
+
+void RpcServer::waitForNewTopBlock(const Crypto::Hash &knownTopBlockHash)
+{
+    longPoll([this, &knownTopBlockHash](const uint64_t)
+    {
+        const auto chainLock = m_core->lockChainForReading();
+
+        return m_core->getTopBlockHash() != knownTopBlockHash;
+    });
+}
+
+uint32_t RpcServer::getTopBlockIndex() const
+{
+    const auto chainLock = m_core->lockChainForReading();
+
+    return m_core->getTopBlockIndex();
+}
+
+RpcServer::WalletSyncRequest RpcServer::parseWalletSyncRequest(const rapidjson::Document &body)
+{
+    WalletSyncRequest request;
+
+    if (hasMember(body, "blockHashCheckpoints"))
+    {
+        for (const auto &jsonHash : getArrayFromJSON(body, "blockHashCheckpoints"))
+        {
+            std::string hashStr = jsonHash.GetString();
+
+            Crypto::Hash hash;
+            Common::podFromHex(hashStr, hash);
+
+            request.blockHashCheckpoints.push_back(hash);
+        }
+    }
+
+    request.startHeight = hasMember(body, "startHeight")
+        ? getUint64FromJSON(body, "startHeight")
+        : 0;
+
+    request.startTimestamp = hasMember(body, "startTimestamp")
+        ? getUint64FromJSON(body, "startTimestamp")
+        : 0;
+
+    request.blockCount = hasMember(body, "blockCount")
+        ? getUint64FromJSON(body, "blockCount")
+        : 100;
+
+    request.skipCoinbaseTransactions = hasMember(body, "skipCoinbaseTransactions")
+        ? getBoolFromJSON(body, "skipCoinbaseTransactions")
+        : false;
+
+    return request;
+}
+
+uint64_t RpcServer::calculateTotalFeeAmount(const std::vector<std::vector<uint8_t>> &transactions)
+{
+    uint64_t totalFeeAmount = 0;
 
     for (const std::vector<uint8_t>& rawTX : transactions)
     {
@@ -574,19 +819,35 @@ void RpcServer::generateBlockHeader(
     rapidjson::Writer<rapidjson::StringBuffer> &writer,
     const bool headerOnly)
 {
-    CryptoNote::BlockTemplate block = m_core->getBlockByHash(blockHash);
+    CryptoNote::BlockTemplate block;
+    CryptoNote::BlockDetails extraDetails;
+    uint32_t topHeight;
+    uint64_t difficulty;
+    std::vector<std::vector<uint8_t>> transactions;
+
+    /* Everything is read from the core up front, so the chain isn't held
+       locked while the header is written */
+    {
+        const auto chainLock = m_core->lockChainForReading();
+
+        block = m_core->getBlockByHash(blockHash);
+        extraDetails = m_core->getBlockDetails(blockHash);
+        topHeight = m_core->getTopBlockIndex();
+        difficulty = m_core->getBlockDifficulty(CryptoNote::CachedBlock(block).getBlockIndex());
+
+        std::vector<Crypto::Hash> ignore;
+        m_core->getTransactions(block.transactionHashes, transactions, ignore);
+    }
+
     CryptoNote::CachedBlock cachedBlock(block);
 
-    const auto topHeight = m_core->getTopBlockIndex();
     const auto height = cachedBlock.getBlockIndex();
 
     const auto outputs = block.baseTransaction.outputs;
 
-    const auto extraDetails = m_core->getBlockDetails(blockHash);
-
     const uint64_t reward = std::accumulate(
         outputs.begin(), outputs.end(), 0ull, [](const auto acc, const auto out) { return acc + out.amount; });
-    const uint64_t totalFeeAmount = calculateTotalFeeAmount(block.transactionHashes);
+    const uint64_t totalFeeAmount = calculateTotalFeeAmount(transactions);
 
     writer.StartObject();
     {
@@ -603,7 +864,7 @@ void RpcServer::generateBlockHeader(
         writer.Uint64(topHeight - height);
 
         writer.Key("difficulty");
-        writer.Uint64(m_core->getBlockDifficulty(height));
+        writer.Uint64(difficulty);
 
         writer.Key("hash");
         blockHash.toJSON(writer);
@@ -680,10 +941,6 @@ void RpcServer::generateBlockHeader(
                 }
                 writer.EndObject();
 
-                std::vector<std::vector<uint8_t>> transactions;
-                std::vector<Crypto::Hash> ignore;
-                m_core->getTransactions(block.transactionHashes, transactions, ignore);
-
                 for (const std::vector<uint8_t> &rawTX : transactions)
                 {
                     writer.StartObject();
@@ -890,7 +1147,7 @@ std::tuple<Error, uint16_t> RpcServer::getBlockHeaderByHeightTrtlApi(
     rapidjson::Writer writer(sb);
 
     uint64_t height = 0;
-    const auto topHeight = m_core->getTopBlockIndex();
+    const auto topHeight = getTopBlockIndex();
 
     try
     {
@@ -914,7 +1171,12 @@ std::tuple<Error, uint16_t> RpcServer::getBlockHeaderByHeightTrtlApi(
 
     try
     {
-        const auto hash = m_core->getBlockHashByIndex(height);
+        Crypto::Hash hash;
+
+        {
+            const auto chainLock = m_core->lockChainForReading();
+            hash = m_core->getBlockHashByIndex(height);
+        }
 
         generateBlockHeader(hash, writer);
 
@@ -946,7 +1208,14 @@ std::tuple<Error, uint16_t> RpcServer::getRawBlockByHashTrtlApi(
 
     try
     {
-        m_core->getRawBlock(hash).toJSON(writer);
+        CryptoNote::RawBlock rawBlock;
+
+        {
+            const auto chainLock = m_core->lockChainForReading();
+            rawBlock = m_core->getRawBlock(hash);
+        }
+
+        rawBlock.toJSON(writer);
 
         res.body = sb.GetString();
 
@@ -969,7 +1238,7 @@ std::tuple<Error, uint16_t> RpcServer::getRawBlockByHeightTrtlApi(
     const std::string heightStr = req.matches[1];
 
     uint32_t height = 0;
-    const auto topHeight = m_core->getTopBlockIndex();
+    const auto topHeight = getTopBlockIndex();
 
     try
     {
@@ -991,7 +1260,14 @@ std::tuple<Error, uint16_t> RpcServer::getRawBlockByHeightTrtlApi(
 
     try
     {
-        m_core->getRawBlock(height).toJSON(writer);
+        CryptoNote::RawBlock rawBlock;
+
+        {
+            const auto chainLock = m_core->lockChainForReading();
+            rawBlock = m_core->getRawBlock(height);
+        }
+
+        rawBlock.toJSON(writer);
 
         res.body = sb.GetString();
 
@@ -1011,7 +1287,7 @@ std::tuple<Error, uint16_t> RpcServer::getBlockCountTrtlApi(
     rapidjson::StringBuffer sb;
     rapidjson::Writer writer(sb);
 
-    writer.Uint64(m_core->getTopBlockIndex() + 1);
+    writer.Uint64(getTopBlockIndex() + 1);
 
     res.body = sb.GetString();
 
@@ -1023,13 +1299,10 @@ std::tuple<Error, uint16_t> RpcServer::getBlocksByHeightTrtlApi(
     httplib::Response &res,
     const rapidjson::Document &body)
 {
-    rapidjson::StringBuffer sb;
-    rapidjson::Writer writer(sb);
-
     const std::string heightStr = req.matches[1];
     uint64_t height;
 
-    const auto topHeight = m_core->getTopBlockIndex();
+    const auto topHeight = getTopBlockIndex();
 
     try
     {
@@ -1054,20 +1327,36 @@ std::tuple<Error, uint16_t> RpcServer::getBlocksByHeightTrtlApi(
 
     const uint64_t startHeight = height < MAX_BLOCKS_COUNT ? 0 : height - MAX_BLOCKS_COUNT;
 
-    writer.StartArray();
+    streamJsonResponse(res, [this, height, startHeight](auto &writer, const auto &flush)
     {
-        /* Loop through the blocks in descending order and throw their resulting
-         * headers into the array for the response */
-        for (uint64_t i = height; i >= startHeight && i <= height; i--)
+        std::vector<Crypto::Hash> hashes;
+
         {
-            const auto hash = m_core->getBlockHashByIndex(i);
+            const auto chainLock = m_core->lockChainForReading();
+
+            /* Blocks may have been popped since the height was checked */
+            const uint64_t topHeight = std::min<uint64_t>(height, m_core->getTopBlockIndex());
 
-            generateBlockHeader(hash, writer);
+            /* The blocks in descending order */
+            for (uint64_t i = topHeight; i >= startHeight && i <= topHeight; i--)
+            {
+                hashes.push_back(m_core->getBlockHashByIndex(i));
+            }
         }
-    }
-    writer.EndArray();
 
-    res.body = sb.GetString();
+        writer.StartArray();
+        {
+            /* Throw the resulting headers into the array for the response.
+               Each one locks the chain only while it reads the block. */
+            for (const auto &hash : hashes)
+            {
+                generateBlockHeader(hash, writer);
+
+                flush();
+            }
+        }
+        writer.EndArray();
+    });
 
     return {SUCCESS, 200};
 }
@@ -1080,10 +1369,22 @@ std::tuple<Error, uint16_t> RpcServer::getLastBlockHeaderTrtlApi(
     rapidjson::StringBuffer sb;
     rapidjson::Writer writer(sb);
 
+    if (req.matches.size() > 1)
+    {
+        Crypto::Hash knownTopBlockHash;
+        Common::podFromHex(req.matches[1], knownTopBlockHash);
+
+        waitForNewTopBlock(knownTopBlockHash);
+    }
+
     try
     {
-        const auto height = m_core->getTopBlockIndex();
-        const auto hash = m_core->getBlockHashByIndex(height);
+        Crypto::Hash hash;
+
+        {
+            const auto chainLock = m_core->lockChainForReading();
+            hash = m_core->getBlockHashByIndex(m_core->getTopBlockIndex());
+        }
 
         generateBlockHeader(hash, writer);
 
@@ -1127,7 +1428,7 @@ std::tuple<Error, uint16_t>
     writer.StartObject();
     {
         writer.Key("height");
-        writer.Uint64(m_core->getTopBlockIndex() + 1);
+        writer.Uint64(getTopBlockIndex() + 1);
 
         writer.Key("networkHeight");
         writer.Uint64(std::max(1u, m_syncManager->getBlockchainHeight()));
@@ -1174,9 +1475,14 @@ std::tuple<Error, uint16_t> RpcServer::getGlobalIndexesTrtlApi(
     }
 
     std::unordered_map<Crypto::Hash, std::vector<uint64_t>> indexes;
+    bool success;
 
-    // This is now inclusive
-    const bool success = m_core->getGlobalIndexesForRange(startHeight, endHeight + 1, indexes);
+    {
+        const auto chainLock = m_core->lockChainForReading();
+
+        // This is now inclusive
+        success = m_core->getGlobalIndexesForRange(startHeight, endHeight + 1, indexes);
+    }
 
     if (!success)
     {
@@ -1217,10 +1523,23 @@ std::tuple<Error, uint16_t> RpcServer::infoTrtlApi(
     httplib::Response &res,
     const rapidjson::Document &body)
 {
-    const uint64_t height = m_core->getTopBlockIndex() + 1;
+    uint64_t height;
+    CryptoNote::BlockDetails blockDetails;
+    uint64_t difficulty;
+    uint64_t alternativeBlockCount;
+    uint64_t transactionCount;
+
+    {
+        const auto chainLock = m_core->lockChainForReading();
+
+        height = m_core->getTopBlockIndex() + 1;
+        blockDetails = m_core->getBlockDetails(height - 1);
+        difficulty = m_core->getDifficultyForNextBlock();
+        alternativeBlockCount = m_core->getAlternativeBlockCount();
+        transactionCount = m_core->getBlockchainTransactionCount();
+    }
+
     const uint64_t networkHeight = std::max(1u, m_syncManager->getBlockchainHeight());
-    const auto blockDetails = m_core->getBlockDetails(height - 1);
-    const uint64_t difficulty = m_core->getDifficultyForNextBlock();
 
     rapidjson::StringBuffer sb;
     rapidjson::Writer writer(sb);
@@ -1231,7 +1550,7 @@ std::tuple<Error, uint16_t> RpcServer::infoTrtlApi(
         const uint64_t outgoing_connections_count = m_p2p->get_outgoing_connections_count();
 
         writer.Key("alternateBlockCount");
-        writer.Uint64(m_core->getAlternativeBlockCount());
+        writer.Uint64(alternativeBlockCount);
 
         writer.Key("difficulty");
         writer.Uint64(difficulty);
@@ -1283,7 +1602,7 @@ std::tuple<Error, uint16_t> RpcServer::infoTrtlApi(
 
         writer.Key("transactionsSize");
         /* Transaction count without coinbase transactions - one per block, so subtract height */
-        writer.Uint64(m_core->getBlockchainTransactionCount() - height);
+        writer.Uint64(transactionCount - height);
 
         writer.Key("upgradeHeights");
         writer.StartArray();
@@ -1371,24 +1690,30 @@ std::tuple<Error, uint16_t> RpcServer::getTransactionDetailsByHashTrtlApi(
         return {Error(API_INVALID_ARGUMENT), 400};
     }
 
-    std::vector<Crypto::Hash> ignore;
     std::vector<std::vector<uint8_t>> rawTXs;
-    std::vector hashes {hash};
-
-    m_core->getTransactions(hashes, rawTXs, ignore);
+    CryptoNote::TransactionDetails txDetails;
+    Crypto::Hash blockHash;
 
-    /* If we did not get exactly one transaction back then it's as if
-     * we didn't get any transactions at all */
-    if (rawTXs.size() != 1)
     {
-        return {Error(API_HASH_NOT_FOUND), 404};
+        const auto chainLock = m_core->lockChainForReading();
+
+        std::vector<Crypto::Hash> ignore;
+        std::vector hashes {hash};
+
+        m_core->getTransactions(hashes, rawTXs, ignore);
+
+        /* If we did not get exactly one transaction back then it's as if
+         * we didn't get any transactions at all */
+        if (rawTXs.size() != 1)
+        {
+            return {Error(API_HASH_NOT_FOUND), 404};
+        }
+
+        txDetails = m_core->getTransactionDetails(hash);
+        blockHash = m_core->getBlockHashByIndex(txDetails.blockIndex);
     }
 
     CryptoNote::Transaction transaction;
-    CryptoNote::TransactionDetails txDetails = m_core->getTransactionDetails(hash);
-
-    const uint64_t blockHeight = txDetails.blockIndex;
-    const auto blockHash = m_core->getBlockHashByIndex(blockHeight);
 
     fromBinaryArray(transaction, rawTXs[0]);
 
@@ -1454,7 +1779,12 @@ std::tuple<Error, uint16_t> RpcServer::getRawTransactionByHashTrtlApi(
         return {Error(API_INVALID_ARGUMENT), 400};
     }
 
-    const auto transaction = m_core->getTransaction(hash);
+    std::optional<CryptoNote::BinaryArray> transaction;
+
+    {
+        const auto chainLock = m_core->lockChainForReading();
+        transaction = m_core->getTransaction(hash);
+    }
 
     if (!transaction.has_value())
     {
@@ -1473,56 +1803,66 @@ std::tuple<Error, uint16_t> RpcServer::getTransactionsInPoolTrtlApi(
     httplib::Response &res,
     const rapidjson::Document &body)
 {
-    rapidjson::StringBuffer sb;
-    rapidjson::Writer writer(sb);
-
-    writer.StartArray();
+    /* Only the hashes are copied up front, each transaction is read as it
+       is written, skipping any that have left the pool since */
+    streamJsonResponse(res, [this, hashes = m_core->getPoolTransactionHashes()](auto &writer, const auto &flush)
     {
-        for (const auto &tx : m_core->getPoolTransactions())
+        writer.StartArray();
         {
-            writer.StartObject();
+            for (const auto &hash : hashes)
+            {
+                const auto [found, rawTransaction] = m_core->getPoolTransaction(hash);
+
+                CryptoNote::Transaction tx;
 
-            const uint64_t outputAmount = std::accumulate(
-                tx.outputs.begin(),
-                tx.outputs.end(),
-                0ull,
-                [](const auto acc, const auto out) { return acc + out.amount; });
-
-            const uint64_t inputAmount = std::accumulate(
-                tx.inputs.begin(),
-                tx.inputs.end(),
-                0ull,
-                [](const auto acc, const auto in)
+                if (!found || !CryptoNote::fromBinaryArray(tx, rawTransaction))
                 {
-                    if (in.type() == typeid(CryptoNote::KeyInput))
+                    continue;
+                }
+
+                writer.StartObject();
+
+                const uint64_t outputAmount = std::accumulate(
+                    tx.outputs.begin(),
+                    tx.outputs.end(),
+                    0ull,
+                    [](const auto acc, const auto out) { return acc + out.amount; });
+
+                const uint64_t inputAmount = std::accumulate(
+                    tx.inputs.begin(),
+                    tx.inputs.end(),
+                    0ull,
+                    [](const auto acc, const auto in)
                     {
-                        return acc + boost::get<CryptoNote::KeyInput>(in).amount;
-                    }
+                        if (in.type() == typeid(CryptoNote::KeyInput))
+                        {
+                            return acc + boost::get<CryptoNote::KeyInput>(in).amount;
+                        }
 
-                    return acc;
-                });
+                        return acc;
+                    });
 
-            const uint64_t fee = inputAmount - outputAmount;
+                const uint64_t fee = inputAmount - outputAmount;
 
-            writer.Key("amountOut");
-            writer.Uint64(outputAmount);
+                writer.Key("amountOut");
+                writer.Uint64(outputAmount);
 
-            writer.Key("fee");
-            writer.Uint64(fee);
+                writer.Key("fee");
+                writer.Uint64(fee);
 
-            writer.Key("hash");
-            const auto txHash = getObjectHash(tx);
-            txHash.toJSON(writer);
+                writer.Key("hash");
+                hash.toJSON(writer);
 
-            writer.Key("size");
-            writer.Uint64(getObjectBinarySize(tx));
+                writer.Key("size");
+                writer.Uint64(rawTransaction.size());
 
-            writer.EndObject();
-        }
-    }
-    writer.EndArray();
+                writer.EndObject();
 
-    res.body = sb.GetString();
+                flush();
+            }
+        }
+        writer.EndArray();
+    });
 
     return {SUCCESS, 200};
 }
@@ -1553,10 +1893,23 @@ std::tuple<Error, uint16_t> RpcServer::getRawTransactionsInPoolTrtlApi(
 
 std::tuple<Error, uint16_t> RpcServer::info(const httplib::Request &req, httplib::Response &res, const rapidjson::Document &body)
 {
-    const uint64_t height = m_core->getTopBlockIndex() + 1;
+    uint64_t height;
+    CryptoNote::BlockDetails blockDetails;
+    uint64_t difficulty;
+    uint64_t alternativeBlockCount;
+    uint64_t transactionCount;
+
+    {
+        const auto chainLock = m_core->lockChainForReading();
+
+        height = m_core->getTopBlockIndex() + 1;
+        blockDetails = m_core->getBlockDetails(height - 1);
+        difficulty = m_core->getDifficultyForNextBlock();
+        alternativeBlockCount = m_core->getAlternativeBlockCount();
+        transactionCount = m_core->getBlockchainTransactionCount();
+    }
+
     const uint64_t networkHeight = std::max(1u, m_syncManager->getBlockchainHeight());
-    const auto blockDetails = m_core->getBlockDetails(height - 1);
-    const uint64_t difficulty = m_core->getDifficultyForNextBlock();
 
     rapidjson::StringBuffer sb;
     rapidjson::Writer<rapidjson::StringBuffer> writer(sb);
@@ -1571,13 +1924,13 @@ std::tuple<Error, uint16_t> RpcServer::info(const httplib::Request &req, httplib
 
     writer.Key("tx_count");
     /* Transaction count without coinbase transactions - one per block, so subtract height */
-    writer.Uint64(m_core->getBlockchainTransactionCount() - height);
+    writer.Uint64(transactionCount - height);
 
     writer.Key("tx_pool_size");
     writer.Uint64(m_core->getPoolTransactionCount());
 
     writer.Key("alt_blocks_count");
-    writer.Uint64(m_core->getAlternativeBlockCount());
+    writer.Uint64(alternativeBlockCount);
 
     uint64_t total_conn = m_p2p->get_connections_count();
     uint64_t outgoing_connections_count = m_p2p->get_outgoing_connections_count();
@@ -1680,7 +2033,7 @@ std::tuple<Error, uint16_t> RpcServer::height(
     writer.StartObject();
 
     writer.Key("height");
-    writer.Uint64(m_core->getTopBlockIndex() + 1);
+    writer.Uint64(getTopBlockIndex() + 1);
 
     writer.Key("network_height");
     writer.Uint64(std::max(1u, m_syncManager->getBlockchainHeight()));
@@ -1772,9 +2125,14 @@ std::tuple<Error, uint16_t>
         CryptoNote::BlockTemplate blockTemplate;
         CryptoNote::fromBinaryArray(blockTemplate, rawBlob);
 
-        newBlockMessage.block = CryptoNote::RawBlockLegacy(rawBlob, blockTemplate, m_core);
         newBlockMessage.hop = 0;
-        newBlockMessage.current_blockchain_height = m_core->getTopBlockIndex() + 1;
+
+        {
+            const auto chainLock = m_core->lockChainForReading();
+
+            newBlockMessage.block = CryptoNote::RawBlockLegacy(rawBlob, blockTemplate, m_core);
+            newBlockMessage.current_blockchain_height = m_core->getTopBlockIndex() + 1;
+        }
 
         m_syncManager->relayBlock(newBlockMessage);
 
@@ -1815,15 +2173,35 @@ std::tuple<Error, uint16_t> RpcServer::getBlockTemplateTrtlApi(
 
     const auto [publicSpendKey, publicViewKey] = Utilities::addressToKeys(address);
 
+    /* Wait for the template to change from the one the miner has */
+    if (hasMember(body, "longPollId"))
+    {
+        const uint64_t longPollId = getUint64FromJSON(body, "longPollId");
+
+        longPoll([longPollId](const uint64_t changeId) { return changeId != longPollId; });
+    }
+
     CryptoNote::BlockTemplate blockTemplate;
     std::vector<uint8_t> blobReserve;
     blobReserve.resize(reserveSize, 0);
 
+    uint64_t changeId;
     uint64_t difficulty;
     uint32_t height;
 
-    const auto [success, error] =
-        m_core->getBlockTemplate(blockTemplate, publicViewKey, publicSpendKey, blobReserve, difficulty, height);
+    bool success;
+    std::string error;
+
+    {
+        const auto chainLock = m_core->lockChainForReading();
+
+        /* Taken before the template is made, so a change while making it is
+           picked up by the next poll */
+        changeId = m_core->getChangeId();
+
+        std::tie(success, error) =
+            m_core->getBlockTemplate(blockTemplate, publicViewKey, publicSpendKey, blobReserve, difficulty, height);
+    }
 
     if (!success)
     {
@@ -1872,6 +2250,9 @@ std::tuple<Error, uint16_t> RpcServer::getBlockTemplateTrtlApi(
 
         writer.Key("blob");
         writer.String(Common::toHex(blockBlob));
+
+        writer.Key("longPollId");
+        writer.Uint64(changeId);
     }
     writer.EndObject();
 
@@ -1902,8 +2283,15 @@ std::tuple<Error, uint16_t> RpcServer::getRandomOutsTrtlApi(
 
             std::vector<Crypto::PublicKey> publicKeys;
 
-            const auto [success, error] =
-                m_core->getRandomOutputs(amount, static_cast<uint16_t>(numOutputs), globalIndexes, publicKeys);
+            bool success;
+            std::string error;
+
+            {
+                const auto chainLock = m_core->lockChainForReading();
+
+                std::tie(success, error) =
+                    m_core->getRandomOutputs(amount, static_cast<uint16_t>(numOutputs), globalIndexes, publicKeys);
+            }
 
             if (!success)
             {
@@ -1989,14 +2377,20 @@ std::tuple<Error, uint16_t> RpcServer::getWalletSyncDataTrtlApi(
     std::vector<WalletTypes::WalletBlockInfo> walletBlocks;
     std::optional<WalletTypes::TopBlock> topBlockInfo;
 
-    const bool success = m_core->getWalletSyncData(
-        blockHashCheckpoints,
-        startHeight,
-        startTimestamp,
-        blockCount,
-        skipCoinbaseTransactions,
-        walletBlocks,
-        topBlockInfo);
+    bool success;
+
+    {
+        const auto chainLock = m_core->lockChainForReading();
+
+        success = m_core->getWalletSyncData(
+            blockHashCheckpoints,
+            startHeight,
+            startTimestamp,
+            blockCount,
+            skipCoinbaseTransactions,
+            walletBlocks,
+            topBlockInfo);
+    }
 
     if (!success)
     {
@@ -2148,81 +2542,143 @@ std::tuple<Error, uint16_t> RpcServer::getWalletSyncDataTrtlApi(
 std::tuple<Error, uint16_t>
     RpcServer::getRawBlocksTrtlApi(const httplib::Request &req, httplib::Response &res, const rapidjson::Document &body)
 {
-    rapidjson::StringBuffer sb;
-    rapidjson::Writer writer(sb);
+    std::vector<Crypto::Hash> blockHashCheckpoints;
 
-    writer.StartObject();
+    if (hasMember(body, "checkpoints"))
     {
-        std::vector<Crypto::Hash> blockHashCheckpoints;
-
-        if (hasMember(body, "checkpoints"))
+        for (const auto &jsonHash : getArrayFromJSON(body, "checkpoints"))
         {
-            for (const auto &jsonHash : getArrayFromJSON(body, "checkpoints"))
-            {
-                std::string hashStr = jsonHash.GetString();
+            std::string hashStr = jsonHash.GetString();
 
-                Crypto::Hash hash;
-                Common::podFromHex(hashStr, hash);
+            Crypto::Hash hash;
+            Common::podFromHex(hashStr, hash);
 
-                blockHashCheckpoints.push_back(hash);
-            }
+            blockHashCheckpoints.push_back(hash);
         }
+    }
+
+    const uint64_t startHeight = hasMember(body, "height") ? getUint64FromJSON(body, "height") : 0;
+    const uint64_t startTimestamp = hasMember(body, "timestamp") ? getUint64FromJSON(body, "timestamp") : 0;
+    const uint64_t blockCount = hasMember(body, "count") ? getUint64FromJSON(body, "count")
+                                                         : CryptoNote::BLOCKS_SYNCHRONIZING_DEFAULT_COUNT;
+
+    const bool skipCoinbaseTransactions =
+        hasMember(body, "skipCoinbaseTransactions") ? getBoolFromJSON(body, "skipCoinbaseTransactions") : false;
+
+    /* The core caps the count the same way */
+    const uint64_t totalBlocks = blockCount == 0
+                                     ? CryptoNote::BLOCKS_SYNCHRONIZING_DEFAULT_COUNT
+                                     : std::min(blockCount, CryptoNote::BLOCKS_SYNCHRONIZING_DEFAULT_COUNT);
 
-        const uint64_t startHeight = hasMember(body, "height") ? getUint64FromJSON(body, "height") : 0;
-        const uint64_t startTimestamp = hasMember(body, "timestamp") ? getUint64FromJSON(body, "timestamp") : 0;
-        const uint64_t blockCount = hasMember(body, "count") ? getUint64FromJSON(body, "count")
-                                                             : CryptoNote::BLOCKS_SYNCHRONIZING_DEFAULT_COUNT;
+    /* The first chunk is read here, so a failure can still be reported with
+       an error status, and the rest as they are sent */
+    std::vector<CryptoNote::RawBlock> rawBlocks;
+    std::optional<WalletTypes::TopBlock> topBlockInfo;
 
-        const bool skipCoinbaseTransactions =
-            hasMember(body, "skipCoinbaseTransactions") ? getBoolFromJSON(body, "skipCoinbaseTransactions") : false;
+    bool success;
 
-        std::vector<CryptoNote::RawBlock> rawBlocks;
-        std::optional<WalletTypes::TopBlock> topBlockInfo;
+    {
+        const auto chainLock = m_core->lockChainForReading();
 
-        const bool success = m_core->getRawBlocks(
+        success = m_core->getRawBlocks(
             blockHashCheckpoints,
             startHeight,
             startTimestamp,
-            blockCount,
+            std::min(totalBlocks, CryptoNote::RPC_STREAM_BLOCKS_PER_CHUNK),
             skipCoinbaseTransactions,
             rawBlocks,
             topBlockInfo);
+    }
 
-        if (!success)
-        {
-            return {Error(API_INTERNAL_ERROR, "Failed to retrieve raw blocks from underlying storage."), 500};
-        }
+    if (!success)
+    {
+        return {Error(API_INTERNAL_ERROR, "Failed to retrieve raw blocks from underlying storage."), 500};
+    }
 
-        writer.Key("blocks");
-        writer.StartArray();
+    streamJsonResponse(
+        res,
+        [this, rawBlocks = std::move(rawBlocks), topBlockInfo, totalBlocks, skipCoinbaseTransactions](
+            auto &writer, const auto &flush) mutable
         {
-            for (const auto &rawBlock : rawBlocks)
-            {
-                rawBlock.toJSON(writer);
-            }
-        }
-        writer.EndArray();
-
-        writer.Key("synced");
-        writer.Bool(rawBlocks.empty());
+            const bool synced = rawBlocks.empty();
 
-        if (topBlockInfo)
-        {
-            writer.Key("topBlock");
             writer.StartObject();
             {
-                writer.Key("hash");
-                topBlockInfo->hash.toJSON(writer);
+                writer.Key("blocks");
+                writer.StartArray();
+                {
+                    uint64_t remaining = totalBlocks;
 
-                writer.Key("height");
-                writer.Uint64(topBlockInfo->height);
+                    while (!rawBlocks.empty())
+                    {
+                        for (const auto &rawBlock : rawBlocks)
+                        {
+                            rawBlock.toJSON(writer);
+
+                            flush();
+                        }
+
+                        remaining -= std::min<uint64_t>(remaining, rawBlocks.size());
+
+                        if (remaining == 0)
+                        {
+                            break;
+                        }
+
+                        CryptoNote::BlockTemplate lastBlockTemplate;
+                        CryptoNote::fromBinaryArray(lastBlockTemplate, rawBlocks.back().block);
+
+                        const CryptoNote::CachedBlock lastBlock(lastBlockTemplate);
+
+                        rawBlocks.clear();
+
+                        /* Only held while reading the chunk, not while sending it */
+                        const auto chainLock = m_core->lockChainForReading();
+
+                        /* If the last block sent has been popped since, stop here - the
+                           wallet finds the fork from its checkpoints on its next request */
+                        if (m_core->getTopBlockIndex() < lastBlock.getBlockIndex()
+                            || m_core->getBlockHashByIndex(lastBlock.getBlockIndex()) != lastBlock.getBlockHash())
+                        {
+                            break;
+                        }
+
+                        std::optional<WalletTypes::TopBlock> nextTopBlockInfo;
+
+                        if (!m_core->getRawBlocks(
+                                {lastBlock.getBlockHash()},
+                                lastBlock.getBlockIndex() + 1,
+                                0,
+                                std::min(remaining, CryptoNote::RPC_STREAM_BLOCKS_PER_CHUNK),
+                                skipCoinbaseTransactions,
+                                rawBlocks,
+                                nextTopBlockInfo))
+                        {
+                            throw std::runtime_error("Failed to retrieve raw blocks from underlying storage");
+                        }
+                    }
+                }
+                writer.EndArray();
+
+                writer.Key("synced");
+                writer.Bool(synced);
+
+                if (topBlockInfo)
+                {
+                    writer.Key("topBlock");
+                    writer.StartObject();
+                    {
+                        writer.Key("hash");
+                        topBlockInfo->hash.toJSON(writer);
+
+                        writer.Key("height");
+                        writer.Uint64(topBlockInfo->height);
+                    }
+                    writer.EndObject();
+                }
             }
             writer.EndObject();
-        }
-    }
-    writer.EndObject();
-
-    res.body = sb.GetString();
+        });
 
     return {SUCCESS, 200};
 }
@@ -2300,8 +2756,14 @@ std::tuple<Error, uint16_t> RpcServer::getPoolChangesTrtlApi(
     std::vector<CryptoNote::TransactionPrefixInfo> addedTransactions;
     std::vector<Crypto::Hash> deletedTransactions;
 
-    const bool atTopOfChain =
-        m_core->getPoolChangesLite(lastBlockHash, knownHashes, addedTransactions, deletedTransactions);
+    bool atTopOfChain;
+
+    {
+        const auto chainLock = m_core->lockChainForReading();
+
+        atTopOfChain =
+            m_core->getPoolChangesLite(lastBlockHash, knownHashes, addedTransactions, deletedTransactions);
+    }
 
     writer.StartObject();
     {
@@ -2363,8 +2825,14 @@ std::tuple<Error, uint16_t> RpcServer::getTransactionsStatusTrtlApi(
     std::unordered_set<Crypto::Hash> transactionsInBlock;
     std::unordered_set<Crypto::Hash> transactionsUnknown;
 
-    const bool success =
-        m_core->getTransactionsStatus(transactionHashes, transactionsInPool, transactionsInBlock, transactionsUnknown);
+    bool success;
+
+    {
+        const auto chainLock = m_core->lockChainForReading();
+
+        success =
+            m_core->getTransactionsStatus(transactionHashes, transactionsInPool, transactionsInBlock, transactionsUnknown);
+    }
 
     if (!success)
     {
@@ -2515,9 +2983,16 @@ std::tuple<Error, uint16_t> RpcServer::getRandomOuts(
             std::vector<uint32_t> globalIndexes;
             std::vector<Crypto::PublicKey> publicKeys;
 
-            const auto [success, error] = m_core->getRandomOutputs(
-                amount, static_cast<uint16_t>(numOutputs), globalIndexes, publicKeys
-            );
+            bool success;
+            std::string error;
+
+            {
+                const auto chainLock = m_core->lockChainForReading();
+
+                std::tie(success, error) = m_core->getRandomOutputs(
+                    amount, static_cast<uint16_t>(numOutputs), globalIndexes, publicKeys
+                );
+            }
 
             if (!success)
             {
@@ -2585,49 +3060,26 @@ std::tuple<Error, uint16_t> RpcServer::getWalletSyncData(
 
     writer.StartObject();
 
-    std::vector<Crypto::Hash> blockHashCheckpoints;
-
-    if (hasMember(body, "blockHashCheckpoints"))
-    {
-        for (const auto &jsonHash : getArrayFromJSON(body, "blockHashCheckpoints"))
-        {
-            std::string hashStr = jsonHash.GetString();
-
-            Crypto::Hash hash;
-            Common::podFromHex(hashStr, hash);
-
-            blockHashCheckpoints.push_back(hash);
-        }
-    }
-
-    const uint64_t startHeight = hasMember(body, "startHeight")
-        ? getUint64FromJSON(body, "startHeight")
-        : 0;
-
-    const uint64_t startTimestamp = hasMember(body, "startTimestamp")
-        ? getUint64FromJSON(body, "startTimestamp")
-        : 0;
+    std::vector<WalletTypes::WalletBlockInfo> walletBlocks;
+    std::optional<WalletTypes::TopBlock> topBlockInfo;
 
-    const uint64_t blockCount = hasMember(body, "blockCount")
-        ? getUint64FromJSON(body, "blockCount")
-        : 100;
+    const auto request = parseWalletSyncRequest(body);
 
-    const bool skipCoinbaseTransactions = hasMember(body, "skipCoinbaseTransactions")
-        ? getBoolFromJSON(body, "skipCoinbaseTransactions")
-        : false;
+    bool success;
 
-    std::vector<WalletTypes::WalletBlockInfo> walletBlocks;
-    std::optional<WalletTypes::TopBlock> topBlockInfo;
+    {
+        const auto chainLock = m_core->lockChainForReading();
 
-    const bool success = m_core->getWalletSyncData(
-        blockHashCheckpoints,
-        startHeight,
-        startTimestamp,
-        blockCount,
-        skipCoinbaseTransactions,
-        walletBlocks,
-        topBlockInfo
-    );
+        success = m_core->getWalletSyncData(
+            request.blockHashCheckpoints,
+            request.startHeight,
+            request.startTimestamp,
+            request.blockCount,
+            request.skipCoinbaseTransactions,
+            walletBlocks,
+            topBlockInfo
+        );
+    }
 
     if (!success)
     {
@@ -2658,6 +3110,12 @@ std::tuple<Error, uint16_t> RpcServer::getWalletSyncData(
 
                                 writer.Key("amount");
                                 writer.Uint64(output.amount);
+
+                                if (output.globalOutputIndex)
+                                {
+                                    writer.Key("globalIndex");
+                                    writer.Uint64(*output.globalOutputIndex);
+                                }
                             }
                             writer.EndObject();
                         }
@@ -2695,6 +3153,12 @@ std::tuple<Error, uint16_t> RpcServer::getWalletSyncData(
 
                                     writer.Key("amount");
                                     writer.Uint64(output.amount);
+
+                                    if (output.globalOutputIndex)
+                                    {
+                                        writer.Key("globalIndex");
+                                        writer.Uint64(*output.globalOutputIndex);
+                                    }
                                 }
                                 writer.EndObject();
                             }
@@ -2787,6 +3251,49 @@ std::tuple<Error, uint16_t> RpcServer::getWalletSyncData(
     return {SUCCESS, 200};
 }
 
+std::tuple<Error, uint16_t> RpcServer::getWalletSyncDataBinary(
+    const httplib::Request &req,
+    httplib::Response &res,
+    const rapidjson::Document &body)
+{
+    WalletTypes::WalletSyncData syncData;
+
+    const auto request = parseWalletSyncRequest(body);
+
+    bool success;
+
+    {
+        const auto chainLock = m_core->lockChainForReading();
+
+        success = m_core->getWalletSyncData(
+            request.blockHashCheckpoints,
+            request.startHeight,
+            request.startTimestamp,
+            request.blockCount,
+            request.skipCoinbaseTransactions,
+            syncData.blocks,
+            syncData.topBlock
+        );
+    }
+
+    if (!success)
+    {
+        return {SUCCESS, 500};
+    }
+
+    syncData.synced = syncData.blocks.empty();
+
+    const auto binary = CryptoNote::toBinaryArray(syncData);
+
+    /* Replace the JSON content type set by the middleware */
+    res.headers.erase("Content-Type");
+    res.set_header("Content-Type", "application/octet-stream");
+
+    res.body.assign(binary.begin(), binary.end());
+
+    return {SUCCESS, 200};
+}
+
 std::tuple<Error, uint16_t> RpcServer::getGlobalIndexes(
     const httplib::Request &req,
     httplib::Response &res,
@@ -2800,7 +3307,13 @@ std::tuple<Error, uint16_t> RpcServer::getGlobalIndexes(
 
     std::unordered_map<Crypto::Hash, std::vector<uint64_t>> indexes;
 
-    const bool success = m_core->getGlobalIndexesForRange(startHeight, endHeight, indexes);
+    bool success;
+
+    {
+        const auto chainLock = m_core->lockChainForReading();
+
+        success = m_core->getGlobalIndexesForRange(startHeight, endHeight, indexes);
+    }
 
     writer.StartObject();
 
@@ -2892,17 +3405,34 @@ std::tuple<Error, uint16_t> RpcServer::getBlockTemplateJsonRpc(
 
     const auto [publicSpendKey, publicViewKey] = Utilities::addressToKeys(address);
 
+    if (hasMember(params, "longpollid"))
+    {
+        const uint64_t longPollId = getUint64FromJSON(params, "longpollid");
+
+        longPoll([longPollId](const uint64_t changeId) { return changeId != longPollId; });
+    }
+
     CryptoNote::BlockTemplate blockTemplate;
 
     std::vector<uint8_t> blobReserve;
     blobReserve.resize(reserveSize, 0);
 
+    uint64_t changeId;
     uint64_t difficulty;
     uint32_t height;
 
-    const auto [success, error] = m_core->getBlockTemplate(
-        blockTemplate, publicViewKey, publicSpendKey, blobReserve, difficulty, height
-    );
+    bool success;
+    std::string error;
+
+    {
+        const auto chainLock = m_core->lockChainForReading();
+
+        changeId = m_core->getChangeId();
+
+        std::tie(success, error) = m_core->getBlockTemplate(
+            blockTemplate, publicViewKey, publicSpendKey, blobReserve, difficulty, height
+        );
+    }
 
     if (!success)
     {
@@ -2967,6 +3497,9 @@ std::tuple<Error, uint16_t> RpcServer::getBlockTemplateJsonRpc(
         writer.Key("blocktemplate_blob");
         writer.String(Common::toHex(blockBlob));
 
+        writer.Key("longpollid");
+        writer.Uint64(changeId);
+
         writer.Key("status");
         writer.String("OK");
     }
@@ -3035,9 +3568,14 @@ std::tuple<Error, uint16_t> RpcServer::submitBlockJsonRpc(
 
         CryptoNote::BlockTemplate blockTemplate;
         CryptoNote::fromBinaryArray(blockTemplate, rawBlob);
-        newBlockMessage.block = CryptoNote::RawBlockLegacy(rawBlob, blockTemplate, m_core);
         newBlockMessage.hop = 0;
-        newBlockMessage.current_blockchain_height = m_core->getTopBlockIndex() + 1;
+
+        {
+            const auto chainLock = m_core->lockChainForReading();
+
+            newBlockMessage.block = CryptoNote::RawBlockLegacy(rawBlob, blockTemplate, m_core);
+            newBlockMessage.current_blockchain_height = m_core->getTopBlockIndex() + 1;
+        }
 
         m_syncManager->relayBlock(newBlockMessage);
     }
@@ -3082,7 +3620,7 @@ std::tuple<Error, uint16_t> RpcServer::getBlockCountJsonRpc(
         writer.String("OK");
 
         writer.Key("count");
-        writer.Uint64(m_core->getTopBlockIndex() + 1);
+        writer.Uint64(getTopBlockIndex() + 1);
     }
     writer.EndObject();
 
@@ -3101,11 +3639,41 @@ std::tuple<Error, uint16_t> RpcServer::getLastBlockHeaderJsonRpc(
     rapidjson::StringBuffer sb;
     rapidjson::Writer<rapidjson::StringBuffer> writer(sb);
 
-    const auto height = m_core->getTopBlockIndex();
-    const auto hash = m_core->getBlockHashByIndex(height);
-    const auto topBlock = m_core->getBlockByHash(hash);
+    if (hasMember(body, "params"))
+    {
+        const auto params = getObjectFromJSON(body, "params");
+
+        if (hasMember(params, "known_hash"))
+        {
+            Crypto::Hash knownTopBlockHash;
+
+            if (!Common::podFromHex(getStringFromJSON(params, "known_hash"), knownTopBlockHash))
+            {
+                failJsonRpcRequest(-1, "Provided parameter 'known_hash' is not a valid hex string", res);
+                return {SUCCESS, 200};
+            }
+
+            waitForNewTopBlock(knownTopBlockHash);
+        }
+    }
+
+    uint32_t height;
+    Crypto::Hash hash;
+    CryptoNote::BlockTemplate topBlock;
+    CryptoNote::BlockDetails extraDetails;
+    uint64_t difficulty;
+
+    {
+        const auto chainLock = m_core->lockChainForReading();
+
+        height = m_core->getTopBlockIndex();
+        hash = m_core->getBlockHashByIndex(height);
+        topBlock = m_core->getBlockByHash(hash);
+        extraDetails = m_core->getBlockDetails(hash);
+        difficulty = m_core->getBlockDifficulty(height);
+    }
+
     const auto outputs = topBlock.baseTransaction.outputs;
-    const auto extraDetails = m_core->getBlockDetails(hash);
 
     const uint64_t reward = std::accumulate(outputs.begin(), outputs.end(), 0ull,
         [](const auto acc, const auto out) {
@@ -3155,7 +3723,7 @@ std::tuple<Error, uint16_t> RpcServer::getLastBlockHeaderJsonRpc(
             writer.String(Common::podToHex(hash));
 
             writer.Key("difficulty");
-            writer.Uint64(m_core->getBlockDifficulty(height));
+            writer.Uint64(difficulty);
 
             writer.Key("reward");
             writer.Uint64(reward);
@@ -3187,7 +3755,6 @@ std::tuple<Error, uint16_t> RpcServer::getBlockHeaderByHashJsonRpc(
 
     const auto params = getObjectFromJSON(body, "params");
     const auto hashStr = getStringFromJSON(params, "hash");
-    const auto topHeight = m_core->getTopBlockIndex();
 
     Crypto::Hash hash;
 
@@ -3203,12 +3770,32 @@ std::tuple<Error, uint16_t> RpcServer::getBlockHeaderByHashJsonRpc(
     }
 
     CryptoNote::BlockTemplate block;
+    CryptoNote::BlockDetails extraDetails;
+    uint32_t topHeight;
+    uint64_t difficulty;
+    bool found = true;
 
-    try
     {
-        block = m_core->getBlockByHash(hash);
+        const auto chainLock = m_core->lockChainForReading();
+
+        try
+        {
+            block = m_core->getBlockByHash(hash);
+        }
+        catch (const std::runtime_error &)
+        {
+            found = false;
+        }
+
+        if (found)
+        {
+            topHeight = m_core->getTopBlockIndex();
+            extraDetails = m_core->getBlockDetails(hash);
+            difficulty = m_core->getBlockDifficulty(CryptoNote::CachedBlock(block).getBlockIndex());
+        }
     }
-    catch (const std::runtime_error &)
+
+    if (!found)
     {
         failJsonRpcRequest(
             -5,
@@ -3223,7 +3810,6 @@ std::tuple<Error, uint16_t> RpcServer::getBlockHeaderByHashJsonRpc(
 
     const auto height = cachedBlock.getBlockIndex();
     const auto outputs = block.baseTransaction.outputs;
-    const auto extraDetails = m_core->getBlockDetails(hash);
 
     const uint64_t reward = std::accumulate(outputs.begin(), outputs.end(), 0ull,
         [](const auto acc, const auto out) {
@@ -3273,7 +3859,7 @@ std::tuple<Error, uint16_t> RpcServer::getBlockHeaderByHashJsonRpc(
             writer.String(Common::podToHex(hash));
 
             writer.Key("difficulty");
-            writer.Uint64(m_core->getBlockDifficulty(height));
+            writer.Uint64(difficulty);
 
             writer.Key("reward");
             writer.Uint64(reward);
@@ -3305,7 +3891,26 @@ std::tuple<Error, uint16_t> RpcServer::getBlockHeaderByHeightJsonRpc(
 
     const auto params = getObjectFromJSON(body, "params");
     const auto height = getUint64FromJSON(params, "height");
-    const auto topHeight = m_core->getTopBlockIndex();
+
+    uint32_t topHeight;
+    Crypto::Hash hash;
+    CryptoNote::BlockTemplate block;
+    CryptoNote::BlockDetails extraDetails;
+    uint64_t difficulty;
+
+    {
+        const auto chainLock = m_core->lockChainForReading();
+
+        topHeight = m_core->getTopBlockIndex();
+
+        if (height <= topHeight)
+        {
+            hash = m_core->getBlockHashByIndex(height);
+            block = m_core->getBlockByHash(hash);
+            extraDetails = m_core->getBlockDetails(hash);
+            difficulty = m_core->getBlockDifficulty(height);
+        }
+    }
 
     if (height > topHeight)
     {
@@ -3319,11 +3924,7 @@ std::tuple<Error, uint16_t> RpcServer::getBlockHeaderByHeightJsonRpc(
         return {SUCCESS, 200};
     }
 
-    const auto hash = m_core->getBlockHashByIndex(height);
-    const auto block = m_core->getBlockByHash(hash);
-
     const auto outputs = block.baseTransaction.outputs;
-    const auto extraDetails = m_core->getBlockDetails(hash);
 
     const uint64_t reward = std::accumulate(outputs.begin(), outputs.end(), 0ull,
         [](const auto acc, const auto out) {
@@ -3373,7 +3974,7 @@ std::tuple<Error, uint16_t> RpcServer::getBlockHeaderByHeightJsonRpc(
             writer.String(Common::podToHex(hash));
 
             writer.Key("difficulty");
-            writer.Uint64(m_core->getBlockDifficulty(height));
+            writer.Uint64(difficulty);
 
             writer.Key("reward");
             writer.Uint64(reward);
@@ -3405,7 +4006,25 @@ std::tuple<Error, uint16_t> RpcServer::getBlocksByHeightJsonRpc(
 
     const auto params = getObjectFromJSON(body, "params");
     const auto height = getUint64FromJSON(params, "height");
-    const auto topHeight = m_core->getTopBlockIndex();
+
+    const uint64_t MAX_BLOCKS_COUNT = 30;
+    const uint64_t startHeight = height < MAX_BLOCKS_COUNT ? 0 : height - MAX_BLOCKS_COUNT;
+
+    uint32_t topHeight;
+    std::vector<std::tuple<uint64_t, Crypto::Hash, CryptoNote::BlockTemplate, CryptoNote::BlockDetails>> blocks;
+
+    {
+        const auto chainLock = m_core->lockChainForReading();
+
+        topHeight = m_core->getTopBlockIndex();
+
+        for (uint64_t i = height; i >= startHeight && i <= topHeight; i--)
+        {
+            const auto hash = m_core->getBlockHashByIndex(i);
+
+            blocks.emplace_back(i, hash, m_core->getBlockByHash(hash), m_core->getBlockDetails(hash));
+        }
+    }
 
     if (height > topHeight)
     {
@@ -3430,20 +4049,13 @@ std::tuple<Error, uint16_t> RpcServer::getBlocksByHeightJsonRpc(
         writer.Key("status");
         writer.String("OK");
 
-        const uint64_t MAX_BLOCKS_COUNT = 30;
-        const uint64_t startHeight = height < MAX_BLOCKS_COUNT ? 0 : height - MAX_BLOCKS_COUNT;
-
         writer.Key("blocks");
         writer.StartArray();
         {
-            for (uint64_t i = height; i >= startHeight; i--)
+            for (const auto &[i, hash, block, extraDetails] : blocks)
             {
                 writer.StartObject();
 
-                const auto hash = m_core->getBlockHashByIndex(i);
-                const auto block = m_core->getBlockByHash(hash);
-                const auto extraDetails = m_core->getBlockDetails(hash);
-
                 writer.Key("cumul_size");
                 writer.Uint64(extraDetails.blockSize);
 
@@ -3487,9 +4099,9 @@ std::tuple<Error, uint16_t> RpcServer::getBlockDetailsByHashJsonRpc(
 
     const auto params = getObjectFromJSON(body, "params");
     const auto hashStr = getStringFromJSON(params, "hash");
-    const auto topHeight = m_core->getTopBlockIndex();
 
     Crypto::Hash hash;
+    std::optional<uint64_t> requestedHeight;
 
     if (hashStr.length() == 64)
     {
@@ -3509,21 +4121,7 @@ std::tuple<Error, uint16_t> RpcServer::getBlockDetailsByHashJsonRpc(
         /* Hash parameter can be both a hash string, and a number... because cryptonote.. */
         try
         {
-            uint64_t height = std::stoull(hashStr);
-
-            hash = m_core->getBlockHashByIndex(height - 1);
-
-            if (hash == Constants::NULL_HASH)
-            {
-                failJsonRpcRequest(
-                    -2,
-                    "Requested hash for a height that is higher than the current "
-                    "blockchain height! Current height: " + std::to_string(topHeight),
-                    res
-                );
-
-                return {SUCCESS, 200};
-            }
+            requestedHeight = std::stoull(hashStr);
         }
         catch (const std::out_of_range &)
         {
@@ -3547,8 +4145,45 @@ std::tuple<Error, uint16_t> RpcServer::getBlockDetailsByHashJsonRpc(
         }
     }
 
-    const auto block = m_core->getBlockByHash(hash);
-    const auto extraDetails = m_core->getBlockDetails(hash);
+    uint32_t topHeight;
+    CryptoNote::BlockTemplate block;
+    CryptoNote::BlockDetails extraDetails;
+    uint64_t difficulty;
+    std::vector<std::vector<uint8_t>> transactions;
+
+    {
+        const auto chainLock = m_core->lockChainForReading();
+
+        topHeight = m_core->getTopBlockIndex();
+
+        if (requestedHeight)
+        {
+            hash = m_core->getBlockHashByIndex(*requestedHeight - 1);
+        }
+
+        if (hash != Constants::NULL_HASH)
+        {
+            block = m_core->getBlockByHash(hash);
+            extraDetails = m_core->getBlockDetails(hash);
+            difficulty = m_core->getBlockDifficulty(CryptoNote::CachedBlock(block).getBlockIndex());
+
+            std::vector<Crypto::Hash> ignore;
+            m_core->getTransactions(block.transactionHashes, transactions, ignore);
+        }
+    }
+
+    if (hash == Constants::NULL_HASH)
+    {
+        failJsonRpcRequest(
+            -2,
+            "Requested hash for a height that is higher than the current "
+            "blockchain height! Current height: " + std::to_string(topHeight),
+            res
+        );
+
+        return {SUCCESS, 200};
+    }
+
     const auto height = CryptoNote::CachedBlock(block).getBlockIndex();
     const auto outputs = block.baseTransaction.outputs;
 
@@ -3565,11 +4200,6 @@ std::tuple<Error, uint16_t> RpcServer::getBlockDetailsByHashJsonRpc(
         )
     );
 
-    std::vector<Crypto::Hash> ignore;
-    std::vector<std::vector<uint8_t>> transactions;
-
-    m_core->getTransactions(block.transactionHashes, transactions, ignore);
-
     writer.StartObject();
 
     writer.Key("jsonrpc");
@@ -3612,7 +4242,7 @@ std::tuple<Error, uint16_t> RpcServer::getBlockDetailsByHashJsonRpc(
             writer.String(Common::podToHex(hash));
 
             writer.Key("difficulty");
-            writer.Uint64(m_core->getBlockDifficulty(height));
+            writer.Uint64(difficulty);
 
             writer.Key("reward");
             writer.Uint64(reward);
@@ -3755,11 +4385,28 @@ std::tuple<Error, uint16_t> RpcServer::getTransactionDetailsByHashJsonRpc(
         return {SUCCESS, 200};
     }
 
-    std::vector<Crypto::Hash> ignore;
     std::vector<std::vector<uint8_t>> rawTXs;
-    std::vector<Crypto::Hash> hashes { hash };
+    CryptoNote::TransactionDetails txDetails;
+    Crypto::Hash blockHash;
+    CryptoNote::BlockTemplate block;
+    CryptoNote::BlockDetails extraDetails;
+
+    {
+        const auto chainLock = m_core->lockChainForReading();
 
-    m_core->getTransactions(hashes, rawTXs, ignore);
+        std::vector<Crypto::Hash> ignore;
+        std::vector<Crypto::Hash> hashes { hash };
+
+        m_core->getTransactions(hashes, rawTXs, ignore);
+
+        if (rawTXs.size() == 1)
+        {
+            txDetails = m_core->getTransactionDetails(hash);
+            blockHash = m_core->getBlockHashByIndex(txDetails.blockIndex);
+            block = m_core->getBlockByHash(blockHash);
+            extraDetails = m_core->getBlockDetails(blockHash);
+        }
+    }
 
     if (rawTXs.size() != 1)
     {
@@ -3773,12 +4420,8 @@ std::tuple<Error, uint16_t> RpcServer::getTransactionDetailsByHashJsonRpc(
     }
 
     CryptoNote::Transaction transaction;
-    CryptoNote::TransactionDetails txDetails = m_core->getTransactionDetails(hash);
 
     const uint64_t blockHeight = txDetails.blockIndex;
-    const auto blockHash = m_core->getBlockHashByIndex(blockHeight);
-    const auto block = m_core->getBlockByHash(blockHash);
-    const auto extraDetails = m_core->getBlockDetails(blockHash);
 
     fromBinaryArray(transaction, rawTXs[0]);
 
@@ -4061,7 +4704,15 @@ std::tuple<Error, uint16_t> RpcServer::queryBlocksLite(
 
     std::vector<CryptoNote::BlockShortInfo> blocks;
 
-    if (!m_core->queryBlocksLite(knownBlockHashes, timestamp, startHeight, currentHeight, fullOffset, blocks))
+    bool success;
+
+    {
+        const auto chainLock = m_core->lockChainForReading();
+
+        success = m_core->queryBlocksLite(knownBlockHashes, timestamp, startHeight, currentHeight, fullOffset, blocks);
+    }
+
+    if (!success)
     {
         failRequest(500, "Internal error: failed to queryblockslite", res);
         return {SUCCESS, 500};
@@ -4250,9 +4901,15 @@ std::tuple<Error, uint16_t> RpcServer::getTransactionsStatus(
     std::unordered_set<Crypto::Hash> transactionsInBlock;
     std::unordered_set<Crypto::Hash> transactionsUnknown;
 
-    const bool success = m_core->getTransactionsStatus(
-        transactionHashes, transactionsInPool, transactionsInBlock, transactionsUnknown
-    );
+    bool success;
+
+    {
+        const auto chainLock = m_core->lockChainForReading();
+
+        success = m_core->getTransactionsStatus(
+            transactionHashes, transactionsInPool, transactionsInBlock, transactionsUnknown
+        );
+    }
 
     if (!success)
     {
@@ -4336,9 +4993,15 @@ std::tuple<Error, uint16_t> RpcServer::getPoolChanges(
     std::vector<CryptoNote::TransactionPrefixInfo> addedTransactions;
     std::vector<Crypto::Hash> deletedTransactions;
 
-    const bool atTopOfChain = m_core->getPoolChangesLite(
-        lastBlockHash, knownHashes, addedTransactions, deletedTransactions
-    );
+    bool atTopOfChain;
+
+    {
+        const auto chainLock = m_core->lockChainForReading();
+
+        atTopOfChain = m_core->getPoolChangesLite(
+            lastBlockHash, knownHashes, addedTransactions, deletedTransactions
+        );
+    }
 
     writer.StartObject();
 
@@ -4480,9 +5143,6 @@ std::tuple<Error, uint16_t> RpcServer::queryBlocksDetailed(
     httplib::Response &res,
     const rapidjson::Document &body)
 {
-    rapidjson::StringBuffer sb;
-    rapidjson::Writer<rapidjson::StringBuffer> writer(sb);
-
     uint64_t timestamp = 0;
 
     if (hasMember(body, "timestamp"))
@@ -4521,305 +5181,319 @@ std::tuple<Error, uint16_t> RpcServer::queryBlocksDetailed(
 
     std::vector<CryptoNote::BlockDetails> blocks;
 
-    if (!m_core->queryBlocksDetailed(knownBlockHashes, timestamp, startHeight, currentHeight, fullOffset, blocks, blockCount))
+    bool success;
+
+    {
+        const auto chainLock = m_core->lockChainForReading();
+
+        success = m_core->queryBlocksDetailed(knownBlockHashes, timestamp, startHeight, currentHeight, fullOffset, blocks, blockCount);
+    }
+
+    if (!success)
     {
         failRequest(500, "Internal error: failed to queryblockslite", res);
         return {SUCCESS, 500};
     }
 
-    writer.StartObject();
+    streamJsonResponse(
+        res,
+        [blocks = std::move(blocks), fullOffset, currentHeight, startHeight](auto &writer, const auto &flush)
+        {
+            writer.StartObject();
 
-    writer.Key("fullOffset");
-    writer.Uint64(fullOffset);
+            writer.Key("fullOffset");
+            writer.Uint64(fullOffset);
 
-    writer.Key("currentHeight");
-    writer.Uint64(currentHeight);
+            writer.Key("currentHeight");
+            writer.Uint64(currentHeight);
 
-    writer.Key("startHeight");
-    writer.Uint64(startHeight);
+            writer.Key("startHeight");
+            writer.Uint64(startHeight);
 
-    writer.Key("blocks");
-    writer.StartArray();
-    {
-        for (const auto &block : blocks)
-        {
-            writer.StartObject();
+            writer.Key("blocks");
+            writer.StartArray();
             {
-                writer.Key("major_version");
-                writer.Uint64(block.majorVersion);
+                for (const auto &block : blocks)
+                {
+                    writer.StartObject();
+                    {
+                        writer.Key("major_version");
+                        writer.Uint64(block.majorVersion);
 
-                writer.Key("minor_version");
-                writer.Uint64(block.minorVersion);
+                        writer.Key("minor_version");
+                        writer.Uint64(block.minorVersion);
 
-                writer.Key("timestamp");
-                writer.Uint64(block.timestamp);
+                        writer.Key("timestamp");
+                        writer.Uint64(block.timestamp);
 
-                writer.Key("prevBlockHash");
-                writer.String(Common::podToHex(block.prevBlockHash));
+                        writer.Key("prevBlockHash");
+                        writer.String(Common::podToHex(block.prevBlockHash));
 
-                writer.Key("index");
-                writer.Uint64(block.index);
+                        writer.Key("index");
+                        writer.Uint64(block.index);
 
-                writer.Key("hash");
-                writer.String(Common::podToHex(block.hash));
+                        writer.Key("hash");
+                        writer.String(Common::podToHex(block.hash));
 
-                writer.Key("difficulty");
-                writer.Uint64(block.difficulty);
+                        writer.Key("difficulty");
+                        writer.Uint64(block.difficulty);
 
-                writer.Key("reward");
-                writer.Uint64(block.reward);
+                        writer.Key("reward");
+                        writer.Uint64(block.reward);
 
-                writer.Key("blockSize");
-                writer.Uint64(block.blockSize);
+                        writer.Key("blockSize");
+                        writer.Uint64(block.blockSize);
 
-                writer.Key("alreadyGeneratedCoins");
-                writer.String(std::to_string(block.alreadyGeneratedCoins));
+                        writer.Key("alreadyGeneratedCoins");
+                        writer.String(std::to_string(block.alreadyGeneratedCoins));
 
-                writer.Key("alreadyGeneratedTransactions");
-                writer.Uint64(block.alreadyGeneratedTransactions);
+                        writer.Key("alreadyGeneratedTransactions");
+                        writer.Uint64(block.alreadyGeneratedTransactions);
 
-                writer.Key("sizeMedian");
-                writer.Uint64(block.sizeMedian);
+                        writer.Key("sizeMedian");
+                        writer.Uint64(block.sizeMedian);
 
-                writer.Key("baseReward");
-                writer.Uint64(block.baseReward);
+                        writer.Key("baseReward");
+                        writer.Uint64(block.baseReward);
 
-                writer.Key("nonce");
-                writer.Uint64(block.nonce);
+                        writer.Key("nonce");
+                        writer.Uint64(block.nonce);
 
-                writer.Key("totalFeeAmount");
-                writer.Uint64(block.totalFeeAmount);
+                        writer.Key("totalFeeAmount");
+                        writer.Uint64(block.totalFeeAmount);
 
-                writer.Key("transactionsCumulativeSize");
-                writer.Uint64(block.transactionsCumulativeSize);
+                        writer.Key("transactionsCumulativeSize");
+                        writer.Uint64(block.transactionsCumulativeSize);
 
-                writer.Key("transactions");
-                writer.StartArray();
-                {
-                    for (const auto &tx : block.transactions)
-                    {
-                        writer.StartObject();
+                        writer.Key("transactions");
+                        writer.StartArray();
                         {
-                            writer.Key("blockHash");
-                            writer.String(Common::podToHex(block.hash));
-
-                            writer.Key("blockIndex");
-                            writer.Uint64(block.index);
-
-                            writer.Key("extra");
-                            writer.StartObject();
+                            for (const auto &tx : block.transactions)
                             {
-                                writer.Key("nonce");
-                                writer.StartArray();
+                                writer.StartObject();
                                 {
-                                    for (const auto &c : tx.extra.nonce)
-                                    {
-                                        writer.Uint64(c);
-                                    }
-                                }
-                                writer.EndArray();
+                                    writer.Key("blockHash");
+                                    writer.String(Common::podToHex(block.hash));
 
-                                writer.Key("publicKey");
-                                writer.String(Common::podToHex(tx.extra.publicKey));
+                                    writer.Key("blockIndex");
+                                    writer.Uint64(block.index);
 
-                                writer.Key("raw");
-                                writer.String(Common::toHex(tx.extra.raw));
-                            }
-                            writer.EndObject();
+                                    writer.Key("extra");
+                                    writer.StartObject();
+                                    {
+                                        writer.Key("nonce");
+                                        writer.StartArray();
+                                        {
+                                            for (const auto &c : tx.extra.nonce)
+                                            {
+                                                writer.Uint64(c);
+                                            }
+                                        }
+                                        writer.EndArray();
 
-                            writer.Key("fee");
-                            writer.Uint64(tx.fee);
+                                        writer.Key("publicKey");
+                                        writer.String(Common::podToHex(tx.extra.publicKey));
 
-                            writer.Key("hash");
-                            writer.String(Common::podToHex(tx.hash));
+                                        writer.Key("raw");
+                                        writer.String(Common::toHex(tx.extra.raw));
+                                    }
+                                    writer.EndObject();
 
-                            writer.Key("inBlockchain");
-                            writer.Bool(tx.inBlockchain);
+                                    writer.Key("fee");
+                                    writer.Uint64(tx.fee);
 
-                            writer.Key("inputs");
-                            writer.StartArray();
-                            {
-                                for (const auto &input : tx.inputs)
-                                {
-                                    const auto type = input.type() == typeid(CryptoNote::BaseInputDetails)
-                                        ? "ff"
-                                        : "02";
+                                    writer.Key("hash");
+                                    writer.String(Common::podToHex(tx.hash));
 
-                                    writer.StartObject();
-                                    {
-                                        writer.Key("type");
-                                        writer.String(type);
+                                    writer.Key("inBlockchain");
+                                    writer.Bool(tx.inBlockchain);
 
-                                        writer.Key("data");
-                                        writer.StartObject();
+                                    writer.Key("inputs");
+                                    writer.StartArray();
+                                    {
+                                        for (const auto &input : tx.inputs)
                                         {
-                                            if (input.type() == typeid(CryptoNote::BaseInputDetails))
-                                            {
-                                                const auto in = boost::get<CryptoNote::BaseInputDetails>(input);
+                                            const auto type = input.type() == typeid(CryptoNote::BaseInputDetails)
+                                                ? "ff"
+                                                : "02";
 
-                                                writer.Key("amount");
-                                                writer.Uint64(in.amount);
-
-                                                writer.Key("input");
-                                                writer.StartObject();
-                                                {
-                                                    writer.Key("height");
-                                                    writer.Uint64(in.input.blockIndex);
-                                                }
-                                                writer.EndObject();
-                                            }
-                                            else
+                                            writer.StartObject();
                                             {
-                                                const auto in = boost::get<CryptoNote::KeyInputDetails>(input);
+                                                writer.Key("type");
+                                                writer.String(type);
 
-                                                writer.Key("input");
+                                                writer.Key("data");
                                                 writer.StartObject();
                                                 {
-                                                    writer.Key("amount");
-                                                    writer.Uint64(in.input.amount);
+                                                    if (input.type() == typeid(CryptoNote::BaseInputDetails))
+                                                    {
+                                                        const auto in = boost::get<CryptoNote::BaseInputDetails>(input);
 
-                                                    writer.Key("k_image");
-                                                    writer.String(Common::podToHex(in.input.keyImage));
+                                                        writer.Key("amount");
+                                                        writer.Uint64(in.amount);
 
-                                                    writer.Key("key_offsets");
-                                                    writer.StartArray();
-                                                    {
-                                                        for (const auto &index : in.input.outputIndexes)
+                                                        writer.Key("input");
+                                                        writer.StartObject();
                                                         {
-                                                            writer.Uint(index);
+                                                            writer.Key("height");
+                                                            writer.Uint64(in.input.blockIndex);
                                                         }
+                                                        writer.EndObject();
                                                     }
-                                                    writer.EndArray();
+                                                    else
+                                                    {
+                                                        const auto in = boost::get<CryptoNote::KeyInputDetails>(input);
 
-                                                }
-                                                writer.EndObject();
+                                                        writer.Key("input");
+                                                        writer.StartObject();
+                                                        {
+                                                            writer.Key("amount");
+                                                            writer.Uint64(in.input.amount);
+
+                                                            writer.Key("k_image");
+                                                            writer.String(Common::podToHex(in.input.keyImage));
+
+                                                            writer.Key("key_offsets");
+                                                            writer.StartArray();
+                                                            {
+                                                                for (const auto &index : in.input.outputIndexes)
+                                                                {
+                                                                    writer.Uint(index);
+                                                                }
+                                                            }
+                                                            writer.EndArray();
 
-                                                writer.Key("mixin");
-                                                writer.Uint64(in.mixin);
+                                                        }
+                                                        writer.EndObject();
 
-                                                writer.Key("output");
-                                                writer.StartObject();
-                                                {
-                                                    writer.Key("transactionHash");
-                                                    writer.String(Common::podToHex(in.output.transactionHash));
+                                                        writer.Key("mixin");
+                                                        writer.Uint64(in.mixin);
 
-                                                    writer.Key("number");
-                                                    writer.Uint64(in.output.number);
+                                                        writer.Key("output");
+                                                        writer.StartObject();
+                                                        {
+                                                            writer.Key("transactionHash");
+                                                            writer.String(Common::podToHex(in.output.transactionHash));
+
+                                                            writer.Key("number");
+                                                            writer.Uint64(in.output.number);
+                                                        }
+                                                        writer.EndObject();
+                                                    }
                                                 }
                                                 writer.EndObject();
                                             }
+                                            writer.EndObject();
                                         }
-                                        writer.EndObject();
                                     }
-                                    writer.EndObject();
-                                }
-                            }
-                            writer.EndArray();
+                                    writer.EndArray();
 
-                            writer.Key("mixin");
-                            writer.Uint64(tx.mixin);
+                                    writer.Key("mixin");
+                                    writer.Uint64(tx.mixin);
 
-                            writer.Key("outputs");
-                            writer.StartArray();
-                            {
-                                for (const auto &output : tx.outputs)
-                                {
-                                    writer.StartObject();
+                                    writer.Key("outputs");
+                                    writer.StartArray();
                                     {
-                                        writer.Key("globalIndex");
-                                        writer.Uint64(output.globalIndex);
-
-                                        writer.Key("output");
-                                        writer.StartObject();
+                                        for (const auto &output : tx.outputs)
                                         {
-                                            writer.Key("amount");
-                                            writer.Uint64(output.output.amount);
-
-                                            writer.Key("target");
                                             writer.StartObject();
                                             {
-                                                writer.Key("data");
+                                                writer.Key("globalIndex");
+                                                writer.Uint64(output.globalIndex);
+
+                                                writer.Key("output");
                                                 writer.StartObject();
                                                 {
-                                                    writer.Key("key");
-                                                    writer.String(Common::podToHex(boost::get<CryptoNote::KeyOutput>(output.output.target).key));
+                                                    writer.Key("amount");
+                                                    writer.Uint64(output.output.amount);
+
+                                                    writer.Key("target");
+                                                    writer.StartObject();
+                                                    {
+                                                        writer.Key("data");
+                                                        writer.StartObject();
+                                                        {
+                                                            writer.Key("key");
+                                                            writer.String(Common::podToHex(boost::get<CryptoNote::KeyOutput>(output.output.target).key));
+                                                        }
+                                                        writer.EndObject();
+
+                                                        writer.Key("type");
+                                                        writer.String("02");
+                                                    }
+                                                    writer.EndObject();
                                                 }
                                                 writer.EndObject();
-
-                                                writer.Key("type");
-                                                writer.String("02");
                                             }
                                             writer.EndObject();
                                         }
-                                        writer.EndObject();
                                     }
-                                    writer.EndObject();
-                                }
-                            }
-                            writer.EndArray();
-
-                            writer.Key("paymentId");
-                            writer.String(Common::podToHex(tx.paymentId));
+                                    writer.EndArray();
 
-                            writer.Key("signatures");
-                            writer.StartArray();
-                            {
-                                int i = 0;
+                                    writer.Key("paymentId");
+                                    writer.String(Common::podToHex(tx.paymentId));
 
-                                for (const auto &sigs : tx.signatures)
-                                {
-                                    for (const auto &sig : sigs)
+                                    writer.Key("signatures");
+                                    writer.StartArray();
                                     {
-                                        writer.StartObject();
+                                        int i = 0;
+
+                                        for (const auto &sigs : tx.signatures)
                                         {
-                                            writer.Key("first");
-                                            writer.Uint64(i);
+                                            for (const auto &sig : sigs)
+                                            {
+                                                writer.StartObject();
+                                                {
+                                                    writer.Key("first");
+                                                    writer.Uint64(i);
+
+                                                    writer.Key("second");
+                                                    writer.String(Common::podToHex(sig));
+                                                }
+                                                writer.EndObject();
+                                            }
 
-                                            writer.Key("second");
-                                            writer.String(Common::podToHex(sig));
+                                            i++;
                                         }
-                                        writer.EndObject();
                                     }
+                                    writer.EndArray();
 
-                                    i++;
-                                }
-                            }
-                            writer.EndArray();
-
-                            writer.Key("signaturesSize");
-                            writer.Uint64(tx.signatures.size());
+                                    writer.Key("signaturesSize");
+                                    writer.Uint64(tx.signatures.size());
 
-                            writer.Key("size");
-                            writer.Uint64(tx.size);
+                                    writer.Key("size");
+                                    writer.Uint64(tx.size);
 
-                            writer.Key("timestamp");
-                            writer.Uint64(tx.timestamp);
+                                    writer.Key("timestamp");
+                                    writer.Uint64(tx.timestamp);
 
-                            writer.Key("totalInputsAmount");
-                            writer.Uint64(tx.totalInputsAmount);
+                                    writer.Key("totalInputsAmount");
+                                    writer.Uint64(tx.totalInputsAmount);
 
-                            writer.Key("totalOutputsAmount");
-                            writer.Uint64(tx.totalOutputsAmount);
+                                    writer.Key("totalOutputsAmount");
+                                    writer.Uint64(tx.totalOutputsAmount);
 
-                            writer.Key("unlockTime");
-                            writer.Uint64(tx.unlockTime);
+                                    writer.Key("unlockTime");
+                                    writer.Uint64(tx.unlockTime);
+                                }
+                                writer.EndObject();
+                            }
                         }
-                        writer.EndObject();
+                        writer.EndArray();
                     }
+                    writer.EndObject();
+
+                    flush();
                 }
-                writer.EndArray();
             }
-            writer.EndObject();
-        }
-    }
-    writer.EndArray();
+            writer.EndArray();
 
-    writer.Key("status");
-    writer.String("OK");
+            writer.Key("status");
+            writer.String("OK");
 
-    writer.EndObject();
+            writer.EndObject();
 
-    res.body = sb.GetString();
+        });
 
     return {SUCCESS, 200};
 }
@@ -4843,7 +5517,13 @@ std::tuple<Error, uint16_t> RpcServer::getGlobalIndexesDeprecated(
 
     std::vector<uint32_t> indexes;
 
-    const bool success = m_core->getTransactionGlobalIndexes(hash, indexes);
+    bool success;
+
+    {
+        const auto chainLock = m_core->lockChainForReading();
+
+        success = m_core->getTransactionGlobalIndexes(hash, indexes);
+    }
 
     if (!success)
     {
@@ -4884,49 +5564,26 @@ std::tuple<Error, uint16_t> RpcServer::getRawBlocks(
 
     writer.StartObject();
 
-    std::vector<Crypto::Hash> blockHashCheckpoints;
-
-    if (hasMember(body, "blockHashCheckpoints"))
-    {
-        for (const auto &jsonHash : getArrayFromJSON(body, "blockHashCheckpoints"))
-        {
-            std::string hashStr = jsonHash.GetString();
-
-            Crypto::Hash hash;
-            Common::podFromHex(hashStr, hash);
-
-            blockHashCheckpoints.push_back(hash);
-        }
-    }
-
-    const uint64_t startHeight = hasMember(body, "startHeight")
-        ? getUint64FromJSON(body, "startHeight")
-        : 0;
-
-    const uint64_t startTimestamp = hasMember(body, "startTimestamp")
-        ? getUint64FromJSON(body, "startTimestamp")
-        : 0;
+    std::vector<CryptoNote::RawBlock> blocks;
+    std::optional<WalletTypes::TopBlock> topBlockInfo;
 
-    const uint64_t blockCount = hasMember(body, "blockCount")
-        ? getUint64FromJSON(body, "blockCount")
-        : 100;
+    const auto request = parseWalletSyncRequest(body);
 
-    const bool skipCoinbaseTransactions = hasMember(body, "skipCoinbaseTransactions")
-        ? getBoolFromJSON(body, "skipCoinbaseTransactions")
-        : false;
+    bool success;
 
-    std::vector<CryptoNote::RawBlock> blocks;
-    std::optional<WalletTypes::TopBlock> topBlockInfo;
+    {
+        const auto chainLock = m_core->lockChainForReading();
 
-    const bool success = m_core->getRawBlocks(
-        blockHashCheckpoints,
-        startHeight,
-        startTimestamp,
-        blockCount,
-        skipCoinbaseTransactions,
-        blocks,
-        topBlockInfo
-    );
+        success = m_core->getRawBlocks(
+            request.blockHashCheckpoints,
+            request.startHeight,
+            request.startTimestamp,
+            request.blockCount,
+            request.skipCoinbaseTransactions,
+            blocks,
+            topBlockInfo
+        );
+    }
 
     if (!success)
     {
@@ -9,6 +9,7 @@
 #include "rapidjson/stringbuffer.h"
 #include "rapidjson/writer.h"
 
+#include <atomic>
 #include <cryptonotecore/Core.h>
 #include <cryptonoteprotocol/CryptoNoteProtocolHandlerCommon.h>
 #include <errors/Errors.h>
@@ -16,6 +17,7 @@
 #include <optional>
 #include <p2p/NetNode.h>
 #include <string>
+#include <unordered_map>
 
 enum class RpcMode
 {
@@ -57,6 +59,41 @@ class RpcServer
     /* Gets the IP/port combo the server is running on */
     std::tuple<std::string, uint16_t> getConnectionInfo();
 
+  private:
+    ///////////////////
+    /* Private types */
+    ///////////////////
+
+    /* The signature of every route handler */
+    using Handler = std::function<std::tuple<Error, uint16_t>(
+        const httplib::Request &req,
+        httplib::Response &res,
+        const rapidjson::Document &body)>;
+
+    /* A method which can be called through /json_rpc */
+    struct JsonRpcMethod
+    {
+        Handler handler;
+
+        RpcMode permissions;
+
+        bool syncRequired;
+    };
+
+    /* The body of /getwalletsyncdata, its binary form and /getrawblocks */
+    struct WalletSyncRequest
+    {
+        std::vector<Crypto::Hash> blockHashCheckpoints;
+
+        uint64_t startHeight;
+
+        uint64_t startTimestamp;
+
+        uint64_t blockCount;
+
+        bool skipCoinbaseTransactions;
+    };
+
   private:
     //////////////////////////////
     /* Private member functions */
@@ -68,17 +105,36 @@ class RpcServer
     std::optional<rapidjson::Document>
         getJsonBody(const httplib::Request &req, httplib::Response &res, bool bodyRequired);
 
-    /* Handles stuff like parsing json and then forwards onto the handler */
+    /* Handles stuff like parsing json and then forwards onto the handler.
+       Handlers run in parallel with each other and with block import, so
+       each one locks the chain for reading only while it reads from the
+       core, and writes its response after letting go of it. */
     void middleware(
         const httplib::Request &req,
         httplib::Response &res,
         RpcMode routePermissions,
         bool bodyRequired,
         bool syncRequired,
-        const std::function<std::tuple<Error, uint16_t>(
-            const httplib::Request &req,
-            httplib::Response &res,
-            const rapidjson::Document &body)>& handler);
+        const Handler &handler);
+
+    /* The checks and error handling done for every request once its body
+       has been parsed, before and around running the handler */
+    void runHandler(
+        const httplib::Request &req,
+        httplib::Response &res,
+        RpcMode routePermissions,
+        bool syncRequired,
+        const rapidjson::Document &body,
+        const Handler &handler);
+
+    /* Looks up the method in m_jsonRpcMethods and runs it. A batch array
+       of requests gets an array of responses, in the same order. A batch
+       larger than RPC_MAX_JSON_RPC_BATCH_SIZE gets a single error. */
+    std::tuple<Error, uint16_t>
+        jsonRpc(const httplib::Request &req, httplib::Response &res, const rapidjson::Document &body);
+
+    /* Copies the id of a JSON-RPC request into its response */
+    void setJsonRpcId(const rapidjson::Value &request, httplib::Response &res) const;
 
     void failRequest(int errorCode, const std::string& body, httplib::Response &res);
 
@@ -86,8 +142,40 @@ class RpcServer
 
     void failJsonRpcRequest(int64_t errorCode, const std::string &errorMessage, httplib::Response &res);
 
-    uint64_t calculateTotalFeeAmount(const std::vector<Crypto::Hash> &transactionHashes);
+    /* Sends the JSON as it is written, instead of building the whole
+       response in memory first. The writer calls flush between elements of
+       large arrays, which sends what has been written so far once there is
+       enough of it, and throws to stop the writer if the client has gone.
+       Runs after the handler returns, without the chain locked, so any
+       errors must be found before calling this, and the writer should fetch
+       large responses a chunk at a time as it goes. */
+    void streamJsonResponse(
+        httplib::Response &res,
+        std::function<void(
+            rapidjson::Writer<rapidjson::StringBuffer> &writer,
+            const std::function<void()> &flush)> write);
+
+    /* Waits until changed() is true for the chain's change id, or until
+       the long poll timeout. Must be called without the chain locked, as
+       nothing can change while it is. Each wait ties up an httplib worker,
+       so once RPC_MAX_LONG_POLLS requests are waiting, further ones return
+       straight away and are answered with the current state. */
+    void longPoll(const std::function<bool(uint64_t changeId)> &changed);
+
+    /* Waits until the top block isn't the one given, or until the long poll
+       timeout */
+    void waitForNewTopBlock(const Crypto::Hash &knownTopBlockHash);
 
+    /* Reads the top block index with the chain locked, for handlers which
+       need nothing else from it */
+    uint32_t getTopBlockIndex() const;
+
+    static WalletSyncRequest parseWalletSyncRequest(const rapidjson::Document &body);
+
+    uint64_t calculateTotalFeeAmount(const std::vector<std::vector<uint8_t>> &transactions);
+
+    /* Locks the chain while it reads the block, so must be called without
+       the chain locked */
     void generateBlockHeader(
         const Crypto::Hash &blockHash,
         rapidjson::Writer<rapidjson::StringBuffer> &writer,
@@ -204,6 +292,9 @@ class RpcServer
     std::tuple<Error, uint16_t>
         getWalletSyncData(const httplib::Request &req, httplib::Response &res, const rapidjson::Document &body);
 
+    std::tuple<Error, uint16_t>
+        getWalletSyncDataBinary(const httplib::Request &req, httplib::Response &res, const rapidjson::Document &body);
+
     std::tuple<Error, uint16_t>
         getGlobalIndexes(const httplib::Request &req, httplib::Response &res, const rapidjson::Document &body);
 
@@ -297,6 +388,12 @@ class RpcServer
     /* The thread running the server */
     std::thread m_serverThread;
 
+    /* Set when stopping, so long polling requests return */
+    std::atomic<bool> m_stopping = false;
+
+    /* How many requests are waiting in longPoll() */
+    std::atomic<size_t> m_longPolls = 0;
+
     /* The address to return from the /fee endpoint */
     const std::string m_feeAddress;
 
@@ -316,4 +413,7 @@ class RpcServer
 
     /* Use turtle api instead of xmr variant */
     const bool m_useTrtlApi;
+
+    /* The methods which can be called through /json_rpc, by name */
+    std::unordered_map<std::string, JsonRpcMethod> m_jsonRpcMethods;
 };
@@ -0,0 +1,82 @@
+// Copyright (c) 2018-2024, The DeroGold Developers
+//
+// Please see the included LICENSE file for more information.
+
+#include "WalletTypesSerialization.h"
+
+#include "serialization/CryptoNoteSerialization.h"
+#include "serialization/SerializationOverloads.h"
+
+namespace WalletTypes
+{
+    namespace
+    {
+        template<typename T> void serializeOptional(
+            std::optional<T> &value,
+            Common::StringView presentName,
+            Common::StringView name,
+            CryptoNote::ISerializer &serializer)
+        {
+            bool hasValue = value.has_value();
+
+            serializer(hasValue, presentName);
+
+            if (!hasValue)
+            {
+                value.reset();
+                return;
+            }
+
+            if (serializer.type() == CryptoNote::ISerializer::INPUT)
+            {
+                value.emplace();
+            }
+
+            serializer(*value, name);
+        }
+    } // namespace
+
+    void serialize(KeyOutput &output, CryptoNote::ISerializer &serializer)
+    {
+        serializer(output.key, "key");
+        serializer(output.amount, "amount");
+        serializeOptional(output.globalOutputIndex, "hasGlobalIndex", "globalIndex", serializer);
+    }
+
+    void serialize(RawCoinbaseTransaction &transaction, CryptoNote::ISerializer &serializer)
+    {
+        CryptoNote::serializeContainer(transaction.keyOutputs, "outputs", serializer);
+        serializer(transaction.hash, "hash");
+        serializer(transaction.transactionPublicKey, "txPublicKey");
+        serializer(transaction.unlockTime, "unlockTime");
+    }
+
+    void serialize(RawTransaction &transaction, CryptoNote::ISerializer &serializer)
+    {
+        serialize(static_cast<RawCoinbaseTransaction &>(transaction), serializer);
+        serializer(transaction.paymentID, "paymentID");
+        CryptoNote::serializeContainer(transaction.keyInputs, "inputs", serializer);
+    }
+
+    void serialize(WalletBlockInfo &block, CryptoNote::ISerializer &serializer)
+    {
+        serializeOptional(block.coinbaseTransaction, "hasCoinbaseTX", "coinbaseTX", serializer);
+        CryptoNote::serializeContainer(block.transactions, "transactions", serializer);
+        serializer(block.blockHeight, "blockHeight");
+        serializer(block.blockHash, "blockHash");
+        serializer(block.blockTimestamp, "blockTimestamp");
+    }
+
+    void serialize(TopBlock &topBlock, CryptoNote::ISerializer &serializer)
+    {
+        serializer(topBlock.hash, "hash");
+        serializer(topBlock.height, "height");
+    }
+
+    void serialize(WalletSyncData &syncData, CryptoNote::ISerializer &serializer)
+    {
+        CryptoNote::serializeContainer(syncData.blocks, "items", serializer);
+        serializeOptional(syncData.topBlock, "hasTopBlock", "topBlock", serializer);
+        serializer(syncData.synced, "synced");
+    }
+} // namespace WalletTypes
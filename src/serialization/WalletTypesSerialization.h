@@ -0,0 +1,28 @@
+// Copyright (c) 2018-2024, The DeroGold Developers
+//
+// Please see the included LICENSE file for more information.
+
+#pragma once
+
+#include "serialization/ISerializer.h"
+
+#include <WalletTypes.h>
+
+/* Binary serialization of the wallet sync data. With the binary serializer,
+   integers are varints, keys and hashes are their raw bytes, and strings and
+   arrays are prefixed with a varint length. The optional coinbase transaction
+   and top block are prefixed with a bool saying whether they are present. */
+namespace WalletTypes
+{
+    void serialize(KeyOutput &output, CryptoNote::ISerializer &serializer);
+
+    void serialize(RawCoinbaseTransaction &transaction, CryptoNote::ISerializer &serializer);
+
+    void serialize(RawTransaction &transaction, CryptoNote::ISerializer &serializer);
+
+    void serialize(WalletBlockInfo &block, CryptoNote::ISerializer &serializer);
+
+    void serialize(TopBlock &topBlock, CryptoNote::ISerializer &serializer);
+
+    void serialize(WalletSyncData &syncData, CryptoNote::ISerializer &serializer);
+} // namespace WalletTypes
@@ -11,7 +11,6 @@
 #include "CommonTypes.h"
 #include "INode.h"
 #include "WalletGreenTypes.h"
-#include "common/BlockingQueue.h"
 #include "cryptonotecore/CryptoNoteBasicImpl.h"
 #include "cryptonotecore/CryptoNoteFormatUtils.h"
 #include "cryptonotecore/TransactionApi.h"
@@ -19,6 +18,7 @@
 #include <config/Constants.h>
 #include <future>
 #include <numeric>
+#include <utilities/TaskScheduler.h>
 
 using namespace Crypto;
 using namespace Logging;
@@ -245,112 +245,88 @@ namespace CryptoNote
         {
         };
 
-        std::vector<PreprocessedTx> preprocessedTransactions;
-        std::mutex preprocessedTransactionsMutex;
+        std::vector<Tx> inputTransactions;
 
-        size_t workers = std::thread::hardware_concurrency();
-        if (workers == 0)
-        {
-            workers = 2;
-        }
+        size_t emptyBlockCount = 0;
 
-        BlockingQueue<Tx> inputQueue(workers * 2);
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            const auto &block = blocks[i].block;
 
-        std::atomic<bool> stopProcessing(false);
-        std::atomic<size_t> emptyBlockCount(0);
+            if (!block.is_initialized())
+            {
+                ++emptyBlockCount;
+                continue;
+            }
 
-        auto pushingThread = std::async(std::launch::async, [&] {
-            for (uint32_t i = 0; i < count && !stopProcessing; ++i)
+            // filter by syncStartTimestamp
+            if (m_syncStart.timestamp && block->timestamp < m_syncStart.timestamp)
             {
-                const auto &block = blocks[i].block;
+                ++emptyBlockCount;
+                continue;
+            }
 
-                if (!block.is_initialized())
-                {
-                    ++emptyBlockCount;
-                    continue;
-                }
+            TransactionBlockInfo blockInfo;
+            blockInfo.height = startHeight + i;
+            blockInfo.timestamp = block->timestamp;
+            blockInfo.transactionIndex = 0; // position in block
 
-                // filter by syncStartTimestamp
-                if (m_syncStart.timestamp && block->timestamp < m_syncStart.timestamp)
+            for (const auto &tx : blocks[i].transactions)
+            {
+                auto pubKey = tx->getTransactionPublicKey();
+                bool isLastTransactionInBlock = blockInfo.transactionIndex + 1 == blocks[i].transactions.size();
+
+                /* Need to ensure we add the last tx in the block even if it
+                 * has a null pub key, as we use this to indicate when we
+                 * have finished processing a block. */
+                if (pubKey == Constants::NULL_PUBLIC_KEY && !isLastTransactionInBlock)
                 {
-                    ++emptyBlockCount;
+                    ++blockInfo.transactionIndex;
                     continue;
                 }
 
-                TransactionBlockInfo blockInfo;
-                blockInfo.height = startHeight + i;
-                blockInfo.timestamp = block->timestamp;
-                blockInfo.transactionIndex = 0; // position in block
-
-                for (const auto &tx : blocks[i].transactions)
-                {
-                    auto pubKey = tx->getTransactionPublicKey();
-                    bool isLastTransactionInBlock = blockInfo.transactionIndex + 1 == blocks[i].transactions.size();
+                inputTransactions.push_back({blockInfo, tx.get(), isLastTransactionInBlock});
+                ++blockInfo.transactionIndex;
+            }
+        }
 
-                    /* Need to ensure we add the last tx in the block even if it
-                     * has a null pub key, as we use this to indicate when we
-                     * have finished processing a block. */
-                    if (pubKey == Constants::NULL_PUBLIC_KEY && !isLastTransactionInBlock)
-                    {
-                        ++blockInfo.transactionIndex;
-                        continue;
-                    }
+        /* Filled in place, so stays in block height and transaction index order */
+        std::vector<PreprocessedTx> preprocessedTransactions(inputTransactions.size());
 
-                    Tx item = {blockInfo, tx.get(), isLastTransactionInBlock};
-                    inputQueue.push(item);
-                    ++blockInfo.transactionIndex;
-                }
-            }
+        std::error_code processingError;
+        std::mutex processingErrorMutex;
 
-            inputQueue.close();
-        });
+        try
+        {
+            Utilities::TaskScheduler::shared().parallelFor(0, inputTransactions.size(), [&](const size_t i) {
+                auto &output = preprocessedTransactions[i];
+                static_cast<Tx &>(output) = inputTransactions[i];
 
-        auto processingFunction = [&] {
-            Tx item;
-            std::error_code ec;
-            while (!stopProcessing && inputQueue.pop(item))
-            {
-                PreprocessedTx output;
-                static_cast<Tx &>(output) = item;
+                const std::error_code ec = preprocessOutputs(output.blockInfo, *output.tx, output);
 
-                ec = preprocessOutputs(item.blockInfo, *item.tx, output);
                 if (ec)
                 {
-                    stopProcessing = true;
-                    break;
-                }
+                    std::scoped_lock<std::mutex> lock(processingErrorMutex);
 
-                std::lock_guard<std::mutex> lk(preprocessedTransactionsMutex);
-                preprocessedTransactions.push_back(std::move(output));
-            }
-            return ec;
-        };
+                    if (!processingError)
+                    {
+                        processingError = ec;
+                    }
+
+                    /* Skip the transactions which haven't been started */
+                    return false;
+                }
 
-        std::vector<std::future<std::error_code>> processingThreads;
-        for (size_t i = 0; i < workers; ++i)
+                return true;
+            });
+        }
+        catch (const std::system_error &e)
         {
-            processingThreads.push_back(std::async(std::launch::async, processingFunction));
+            processingError = e.code();
         }
-
-        std::error_code processingError;
-        for (auto &f : processingThreads)
+        catch (const std::exception &)
         {
-            try
-            {
-                std::error_code ec = f.get();
-                if (!processingError && ec)
-                {
-                    processingError = ec;
-                }
-            }
-            catch (const std::system_error &e)
-            {
-                processingError = e.code();
-            }
-            catch (const std::exception &)
-            {
-                processingError = std::make_error_code(std::errc::operation_canceled);
-            }
+            processingError = std::make_error_code(std::errc::operation_canceled);
         }
 
         if (processingError)
@@ -363,15 +339,6 @@ namespace CryptoNote
         std::vector<Crypto::Hash> blockHashes = getBlockHashes(blocks, count);
         m_observerManager.notify(&IBlockchainConsumerObserver::onBlocksAdded, this, blockHashes);
 
-        // sort by block height and transaction index in block
-        std::sort(
-            preprocessedTransactions.begin(),
-            preprocessedTransactions.end(),
-            [](const PreprocessedTx &a, const PreprocessedTx &b) {
-                return std::tie(a.blockInfo.height, a.blockInfo.transactionIndex)
-                       < std::tie(b.blockInfo.height, b.blockInfo.transactionIndex);
-            });
-
         uint32_t processedBlockCount = static_cast<uint32_t>(emptyBlockCount);
         try
         {
@@ -0,0 +1,230 @@
+// Copyright (c) 2018-2024, The DeroGold Developers
+//
+// Please see the included LICENSE file for more information.
+
+#include "UnitTest.h"
+
+#include <boost/uuid/random_generator.hpp>
+#include <config/CryptoNoteConfig.h>
+#include <cryptonoteprotocol/BlockDownloadScheduler.h>
+#include <vector>
+
+namespace UnitTest
+{
+    namespace
+    {
+        using CryptoNote::BlockDownloadScheduler;
+
+        /* Blocks which differ only in their nonce, so they have distinct hashes */
+        std::vector<CryptoNote::BlockTemplate> makeTemplates(const size_t count, const uint32_t firstNonce)
+        {
+            std::vector<CryptoNote::BlockTemplate> blockTemplates(count);
+
+            for (size_t i = 0; i < count; i++)
+            {
+                blockTemplates[i].majorVersion = CryptoNote::BLOCK_MAJOR_VERSION_1;
+                blockTemplates[i].nonce = firstNonce + static_cast<uint32_t>(i);
+            }
+
+            return blockTemplates;
+        }
+
+        std::vector<Crypto::Hash> hashesOf(const std::vector<CryptoNote::BlockTemplate> &blockTemplates)
+        {
+            std::vector<Crypto::Hash> hashes;
+
+            for (const auto &blockTemplate : blockTemplates)
+            {
+                hashes.push_back(CryptoNote::CachedBlock(blockTemplate).getBlockHash());
+            }
+
+            return hashes;
+        }
+
+        /* The downloaded blocks of count blocks from first */
+        std::unique_ptr<BlockDownloadScheduler::Blocks> makeBlocks(
+            const std::vector<CryptoNote::BlockTemplate> &blockTemplates,
+            const size_t first,
+            const size_t count)
+        {
+            auto blocks = std::make_unique<BlockDownloadScheduler::Blocks>();
+
+            blocks->blockTemplates.assign(
+                blockTemplates.begin() + first, blockTemplates.begin() + first + count);
+
+            blocks->rawBlocks.resize(count);
+
+            for (const auto &blockTemplate : blocks->blockTemplates)
+            {
+                blocks->cachedBlocks.emplace_back(blockTemplate);
+            }
+
+            return blocks;
+        }
+    } // namespace
+
+    void testBlockDownloadScheduler()
+    {
+        const uint32_t windowSize = CryptoNote::BLOCKS_SYNCHRONIZING_DEFAULT_COUNT;
+
+        const auto timeout = std::chrono::seconds(CryptoNote::BLOCK_DOWNLOAD_WINDOW_TIMEOUT_SECONDS);
+
+        const auto now = BlockDownloadScheduler::Clock::now();
+
+        boost::uuids::random_generator generateId;
+
+        const auto peerA = generateId();
+        const auto peerB = generateId();
+
+        const auto blockTemplates = makeTemplates(windowSize * 2 + windowSize / 2, 0);
+        const auto hashes = hashesOf(blockTemplates);
+
+        /* Windows answered out of order are handed back in chain order */
+        {
+            BlockDownloadScheduler scheduler;
+
+            CHECK(scheduler.addHashes(peerA, 1, hashes));
+            CHECK(scheduler.addHashes(peerB, 1, hashes));
+
+            const auto first = scheduler.assign(peerA, now);
+            const auto second = scheduler.assign(peerA, now);
+
+            CHECK(first && first->front() == hashes[0] && first->size() == windowSize);
+            CHECK(second && second->front() == hashes[windowSize]);
+
+            /* Peer A has as many requests in flight as it may have */
+            CHECK(!scheduler.assign(peerA, now));
+
+            const auto third = scheduler.assign(peerB, now);
+
+            CHECK(third && third->front() == hashes[windowSize * 2] && third->size() == windowSize / 2);
+
+            CHECK(scheduler.addBlocks(peerB, makeBlocks(blockTemplates, windowSize * 2, windowSize / 2)));
+            CHECK(!scheduler.takeReady());
+
+            CHECK(scheduler.addBlocks(peerA, makeBlocks(blockTemplates, 0, windowSize)));
+
+            auto ready = scheduler.takeReady();
+
+            CHECK(ready && ready->startHeight == 1 && ready->source == peerA);
+            CHECK(!scheduler.takeReady());
+
+            CHECK(scheduler.addBlocks(peerA, makeBlocks(blockTemplates, windowSize, windowSize)));
+
+            ready = scheduler.takeReady();
+
+            CHECK(ready && ready->startHeight == windowSize + 1 && ready->blocks->cachedBlocks.size() == windowSize);
+
+            ready = scheduler.takeReady();
+
+            CHECK(ready && ready->startHeight == windowSize * 2 + 1 && ready->source == peerB);
+            CHECK(scheduler.empty());
+            CHECK(!scheduler.isBusy(peerA) && !scheduler.isBusy(peerB));
+        }
+
+        /* Blocks other than the ones asked for are rejected */
+        {
+            BlockDownloadScheduler scheduler;
+
+            CHECK(scheduler.addHashes(peerA, 1, hashes));
+            CHECK(scheduler.assign(peerA, now));
+
+            CHECK(!scheduler.addBlocks(peerA, makeBlocks(blockTemplates, 1, windowSize)));
+            CHECK(!scheduler.addBlocks(peerB, makeBlocks(blockTemplates, 0, windowSize)));
+        }
+
+        /* A window which isn't answered in time goes to another peer */
+        {
+            BlockDownloadScheduler scheduler;
+
+            CHECK(scheduler.addHashes(peerA, 1, {hashes.begin(), hashes.begin() + windowSize}));
+            CHECK(scheduler.addHashes(peerB, 1, {hashes.begin(), hashes.begin() + windowSize}));
+
+            CHECK(scheduler.assign(peerA, now));
+            CHECK(!scheduler.assign(peerB, now + timeout / 2));
+
+            const auto reassigned = scheduler.assign(peerB, now + timeout);
+
+            CHECK(reassigned && reassigned->front() == hashes[0]);
+
+            CHECK(scheduler.addBlocks(peerB, makeBlocks(blockTemplates, 0, windowSize)));
+
+            /* The slow peer's answer is accepted, and thrown away */
+            CHECK(scheduler.addBlocks(peerA, makeBlocks(blockTemplates, 0, windowSize)));
+
+            const auto ready = scheduler.takeReady();
+
+            CHECK(ready && ready->source == peerB);
+            CHECK(!scheduler.takeReady());
+        }
+
+        /* The windows of a peer which disconnects go to another one straight away */
+        {
+            BlockDownloadScheduler scheduler;
+
+            CHECK(scheduler.addHashes(peerA, 1, {hashes.begin(), hashes.begin() + windowSize}));
+            CHECK(scheduler.addHashes(peerB, 1, {hashes.begin(), hashes.begin() + windowSize}));
+
+            CHECK(scheduler.assign(peerA, now));
+            CHECK(scheduler.isBusy(peerA));
+
+            scheduler.removePeer(peerA);
+
+            CHECK(!scheduler.isBusy(peerA));
+
+            const auto reassigned = scheduler.assign(peerB, now);
+
+            CHECK(reassigned && reassigned->front() == hashes[0]);
+
+            /* And it can't answer for it any more */
+            CHECK(!scheduler.addBlocks(peerA, makeBlocks(blockTemplates, 0, windowSize)));
+        }
+
+        /* A peer on another chain is only asked for the windows before the fork */
+        {
+            BlockDownloadScheduler scheduler;
+
+            const uint32_t forkIndex = windowSize + 10;
+
+            auto forkedHashes = hashes;
+            forkedHashes[forkIndex] = hashesOf(makeTemplates(1, 1000000)).front();
+
+            CHECK(scheduler.addHashes(peerA, 1, hashes));
+            CHECK(!scheduler.addHashes(peerB, 1, forkedHashes));
+
+            CHECK(!scheduler.needsHashes(peerB, 1000));
+            CHECK(scheduler.needsHashes(peerA, 1000));
+
+            const auto beforeFork = scheduler.assign(peerB, now);
+
+            CHECK(beforeFork && beforeFork->front() == hashes[0]);
+            CHECK(!scheduler.assign(peerB, now));
+
+            /* The scheduled hashes are unchanged */
+            CHECK(scheduler.lastHash() == hashes.back());
+        }
+
+        /* A chain entry can carry on from the hash the peer was asked for,
+           even once more hashes are scheduled after it */
+        {
+            BlockDownloadScheduler scheduler;
+
+            CHECK(scheduler.addHashes(peerA, 1, {hashes.begin(), hashes.begin() + windowSize}));
+
+            scheduler.setChainRequested(peerB, scheduler.lastHash());
+
+            CHECK(scheduler.isBusy(peerB));
+
+            CHECK(scheduler.addHashes(peerA, windowSize + 1, {hashes.begin() + windowSize, hashes.end()}));
+
+            CHECK(scheduler.isChainStart(peerB, hashes[windowSize - 1]));
+            CHECK(!scheduler.isChainStart(peerB, hashes.back()));
+            CHECK(!scheduler.isChainStart(peerA, hashes[windowSize - 1]));
+
+            CHECK(scheduler.addHashes(peerB, windowSize, {hashes.begin() + windowSize - 1, hashes.end()}));
+
+            CHECK(!scheduler.isBusy(peerB));
+            CHECK(!scheduler.isChainStart(peerB, hashes[windowSize - 1]));
+        }
+    }
+} // namespace UnitTest
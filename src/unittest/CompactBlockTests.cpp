@@ -0,0 +1,267 @@
+// Copyright (c) 2018-2024, The DeroGold Developers
+//
+// Please see the included LICENSE file for more information.
+
+#include "UnitTest.h"
+
+#include <common/CryptoNoteTools.h>
+#include <config/CryptoNoteConfig.h>
+#include <crypto/random.h>
+#include <cryptonoteprotocol/CompactBlock.h>
+#include <unordered_map>
+#include <vector>
+
+namespace UnitTest
+{
+    namespace
+    {
+        using namespace CryptoNote;
+
+        BinaryArray randomTransaction()
+        {
+            BinaryArray transaction(100);
+            Random::randomBytes(transaction.size(), transaction.data());
+            return transaction;
+        }
+
+        /* A block with count made up transactions, which only their hashes
+           are taken from */
+        RawBlockLegacy makeBlock(const size_t count)
+        {
+            BlockTemplate blockTemplate {};
+            blockTemplate.majorVersion = BLOCK_MAJOR_VERSION_1;
+            blockTemplate.timestamp = 1234;
+
+            RawBlockLegacy block;
+
+            for (size_t i = 0; i < count; i++)
+            {
+                block.transactions.push_back(randomTransaction());
+                blockTemplate.transactionHashes.push_back(getBinaryArrayHash(block.transactions.back()));
+            }
+
+            block.blockTemplate = toBinaryArray(blockTemplate);
+
+            return block;
+        }
+
+        /* A pool holding the given transactions */
+        struct Pool
+        {
+            std::vector<Crypto::Hash> hashes;
+
+            std::unordered_map<Crypto::Hash, BinaryArray> transactions;
+
+            void add(const BinaryArray &transaction)
+            {
+                const auto hash = getBinaryArrayHash(transaction);
+                hashes.push_back(hash);
+                transactions[hash] = transaction;
+            }
+
+            std::optional<BinaryArray> get(const Crypto::Hash &hash) const
+            {
+                const auto it = transactions.find(hash);
+
+                if (it == transactions.end())
+                {
+                    return std::nullopt;
+                }
+
+                return it->second;
+            }
+        };
+
+        /* Sends the block as a compact block to a peer knowing all but the
+           prefilled transactions, and rebuilds it from the pool */
+        std::optional<PendingCompactBlock> relay(
+            const RawBlockLegacy &block,
+            const std::vector<size_t> &prefilled,
+            const Pool &pool)
+        {
+            const auto compact = CompactBlock::makeRelay(block, Random::randomValue<uint64_t>(), 10, 1);
+
+            if (!compact)
+            {
+                return std::nullopt;
+            }
+
+            auto request = CompactBlock::makePeerBlock(*compact, block.transactions, [&](const Crypto::Hash &hash) {
+                for (const auto index : prefilled)
+                {
+                    if (getBinaryArrayHash(block.transactions[index]) == hash)
+                    {
+                        return true;
+                    }
+                }
+
+                return false;
+            });
+
+            BlockTemplate blockTemplate;
+
+            if (!CompactBlock::parse(request, blockTemplate))
+            {
+                return std::nullopt;
+            }
+
+            return CompactBlock::rebuild(
+                std::move(request), std::move(blockTemplate), pool.hashes, [&pool](const Crypto::Hash &hash) {
+                    return pool.get(hash);
+                });
+        }
+    } // namespace
+
+    void testCompactBlock()
+    {
+        const auto block = makeBlock(8);
+
+        /* Rebuilt from the prefilled transactions and the pool, apart from
+           the ones the pool doesn't have, which are asked for */
+        {
+            Pool pool;
+
+            for (size_t i = 0; i < block.transactions.size(); i++)
+            {
+                if (i != 0 && i != 3 && i != 5)
+                {
+                    pool.add(block.transactions[i]);
+                }
+            }
+
+            /* Transactions which aren't in the block don't get in the way */
+            for (int i = 0; i < 100; i++)
+            {
+                pool.add(randomTransaction());
+            }
+
+            auto rebuilt = relay(block, {0, 3}, pool);
+
+            CHECK(rebuilt);
+            CHECK(rebuilt->request.prefilledIndexes == std::vector<uint32_t>({0, 3}));
+            CHECK(rebuilt->request.shortIds.size() == 6 * COMPACT_BLOCK_SHORT_ID_SIZE);
+            CHECK(rebuilt->missingIndexes == std::vector<uint32_t>({5}));
+            CHECK(rebuilt->poolIndexes == std::vector<uint32_t>({1, 2, 4, 6, 7}));
+
+            CHECK(!CompactBlock::addMissingTransactions(*rebuilt, {}));
+            CHECK(CompactBlock::addMissingTransactions(*rebuilt, {block.transactions[5]}));
+
+            CHECK(CompactBlock::check(*rebuilt) == CompactBlock::CheckResult::Valid);
+            CHECK(rebuilt->transactions == block.transactions);
+            CHECK(toBinaryArray(rebuilt->blockTemplate) == block.blockTemplate);
+        }
+
+        /* A short id shared by two pool transactions can't be told apart */
+        {
+            Pool pool;
+
+            for (const auto &transaction : block.transactions)
+            {
+                pool.add(transaction);
+            }
+
+            pool.hashes.push_back(pool.hashes[2]);
+
+            const auto rebuilt = relay(block, {}, pool);
+
+            CHECK(rebuilt && rebuilt->missingIndexes == std::vector<uint32_t>({2}));
+        }
+
+        /* A transaction mined or dropped between listing the pool hashes
+           and looking it up is asked for like any other missing one */
+        {
+            Pool pool;
+
+            for (const auto &transaction : block.transactions)
+            {
+                pool.add(transaction);
+            }
+
+            pool.transactions.erase(pool.hashes[6]);
+
+            const auto rebuilt = relay(block, {}, pool);
+
+            CHECK(rebuilt && rebuilt->missingIndexes == std::vector<uint32_t>({6}));
+            CHECK(rebuilt->poolIndexes == std::vector<uint32_t>({0, 1, 2, 3, 4, 5, 7}));
+        }
+
+        /* A pool transaction with the same short id as one in the block is
+           only found out once the block hash doesn't match. Every pool
+           transaction is then asked for. */
+        {
+            Pool pool;
+
+            for (const auto &transaction : block.transactions)
+            {
+                pool.add(transaction);
+            }
+
+            pool.transactions[pool.hashes[4]] = randomTransaction();
+
+            auto rebuilt = relay(block, {1}, pool);
+
+            CHECK(rebuilt && rebuilt->missingIndexes.empty());
+
+            CHECK(CompactBlock::check(*rebuilt) == CompactBlock::CheckResult::Collision);
+            CHECK(rebuilt->missingIndexes == std::vector<uint32_t>({0, 2, 3, 4, 5, 6, 7}));
+            CHECK(rebuilt->poolIndexes.empty());
+            CHECK(rebuilt->transactions[4].empty());
+
+            std::vector<BinaryArray> asked;
+
+            for (const auto index : rebuilt->missingIndexes)
+            {
+                asked.push_back(block.transactions[index]);
+            }
+
+            /* The wrong transactions again, and there's nobody else to blame */
+            auto wrong = asked;
+            wrong[3] = randomTransaction();
+
+            auto badAnswer = *rebuilt;
+
+            CHECK(CompactBlock::addMissingTransactions(badAnswer, std::move(wrong)));
+            CHECK(CompactBlock::check(badAnswer) == CompactBlock::CheckResult::Invalid);
+
+            CHECK(CompactBlock::addMissingTransactions(*rebuilt, std::move(asked)));
+            CHECK(CompactBlock::check(*rebuilt) == CompactBlock::CheckResult::Valid);
+            CHECK(rebuilt->transactions == block.transactions);
+        }
+
+        /* Prefilled indexes must be in ascending order, and in the block */
+        {
+            const auto compact = CompactBlock::makeRelay(block, 0, 10, 1);
+
+            CHECK(compact);
+
+            const auto request =
+                CompactBlock::makePeerBlock(*compact, block.transactions, [&](const Crypto::Hash &hash) {
+                    return hash == compact->transactionHashes[2] || hash == compact->transactionHashes[6];
+                });
+
+            BlockTemplate blockTemplate;
+
+            CHECK(CompactBlock::parse(request, blockTemplate));
+
+            auto unordered = request;
+            std::swap(unordered.prefilledIndexes[0], unordered.prefilledIndexes[1]);
+            CHECK(!CompactBlock::parse(unordered, blockTemplate));
+
+            auto repeated = request;
+            repeated.prefilledIndexes[1] = repeated.prefilledIndexes[0];
+            CHECK(!CompactBlock::parse(repeated, blockTemplate));
+
+            auto outOfRange = request;
+            outOfRange.prefilledIndexes[1] = static_cast<uint32_t>(block.transactions.size());
+            CHECK(!CompactBlock::parse(outOfRange, blockTemplate));
+
+            auto unmatched = request;
+            unmatched.prefilledTransactions.pop_back();
+            CHECK(!CompactBlock::parse(unmatched, blockTemplate));
+
+            auto partialId = request;
+            partialId.shortIds.pop_back();
+            CHECK(!CompactBlock::parse(partialId, blockTemplate));
+        }
+    }
+} // namespace UnitTest
@@ -0,0 +1,148 @@
+// Copyright (c) 2018-2024, The DeroGold Developers
+//
+// Please see the included LICENSE file for more information.
+
+#include "TestCore.h"
+#include "UnitTest.h"
+
+#include <common/CryptoNoteTools.h>
+#include <crypto/crypto.h>
+#include <crypto/random.h>
+#include <cryptonotecore/AddBlockErrors.h>
+#include <cryptonotecore/BlockValidationErrors.h>
+#include <logging/DummyLogger.h>
+#include <vector>
+
+namespace UnitTest
+{
+    namespace
+    {
+        std::vector<std::error_code> addSequentially(
+            CryptoNote::Core &core,
+            const std::vector<CryptoNote::BlockTemplate> &blockTemplates,
+            const std::vector<CryptoNote::RawBlock> &rawBlocks)
+        {
+            std::vector<std::error_code> results;
+
+            for (size_t i = 0; i < rawBlocks.size(); i++)
+            {
+                results.push_back(
+                    core.addBlock(CryptoNote::CachedBlock(blockTemplates[i]), CryptoNote::RawBlock(rawBlocks[i])));
+            }
+
+            return results;
+        }
+
+        std::vector<std::error_code> addPipelined(
+            CryptoNote::Core &core,
+            const std::vector<CryptoNote::BlockTemplate> &blockTemplates,
+            const std::vector<CryptoNote::RawBlock> &rawBlocks,
+            const size_t stopAfter)
+        {
+            std::vector<CryptoNote::CachedBlock> cachedBlocks;
+
+            for (const auto &blockTemplate : blockTemplates)
+            {
+                cachedBlocks.emplace_back(blockTemplate);
+            }
+
+            std::vector<std::error_code> results;
+
+            core.addBlocks(
+                cachedBlocks,
+                std::vector<CryptoNote::RawBlock>(rawBlocks),
+                [&](const CryptoNote::CachedBlock &, const std::error_code &result) {
+                    results.push_back(result);
+                    return results.size() < stopAfter;
+                });
+
+            return results;
+        }
+    } // namespace
+
+    /* Feeds the same blocks to a core one at a time, and to cores through
+       the validation pipeline, and checks they end up in the same state */
+    void testBlockValidationPipeline()
+    {
+        System::Dispatcher dispatcher;
+
+        const std::shared_ptr<Logging::ILogger> logger = std::make_shared<Logging::DummyLogger>();
+
+        const CryptoNote::Currency currency = CryptoNote::CurrencyBuilder(logger).currency();
+
+        Crypto::PublicKey minerKeyA, minerKeyB;
+        Crypto::SecretKey secretKey;
+
+        Crypto::generate_keys(minerKeyA, secretKey);
+        Crypto::generate_keys(minerKeyB, secretKey);
+
+        std::vector<CryptoNote::RawBlock> rawBlocks;
+
+        /* Two chains from the genesis block, the second one longer, so
+           adding it switches the main chain part way through */
+        {
+            TestCore chainA(currency, dispatcher, logger);
+            TestCore chainB(currency, dispatcher, logger);
+
+            for (int i = 0; i < 30; i++)
+            {
+                rawBlocks.push_back(chainA.mineBlock(minerKeyA));
+            }
+
+            /* An alternative to the 11th block, paying the miner too much */
+            CryptoNote::BlockTemplate overpaid;
+            CryptoNote::fromBinaryArray(overpaid, rawBlocks[10].block);
+            overpaid.baseTransaction.outputs[0].amount++;
+            rawBlocks.push_back({CryptoNote::toBinaryArray(overpaid), {}});
+
+            for (int i = 0; i < 35; i++)
+            {
+                rawBlocks.push_back(chainB.mineBlock(minerKeyB));
+            }
+        }
+
+        /* A block whose parent we don't have */
+        CryptoNote::BlockTemplate orphan;
+        CryptoNote::fromBinaryArray(orphan, rawBlocks.back().block);
+        Random::randomBytes(sizeof(orphan.previousBlockHash.data), orphan.previousBlockHash.data);
+        rawBlocks.push_back({CryptoNote::toBinaryArray(orphan), {}});
+
+        /* And one we already have */
+        rawBlocks.push_back(rawBlocks[3]);
+
+        std::vector<CryptoNote::BlockTemplate> blockTemplates(rawBlocks.size());
+
+        for (size_t i = 0; i < rawBlocks.size(); i++)
+        {
+            CHECK(CryptoNote::fromBinaryArray(blockTemplates[i], rawBlocks[i].block));
+        }
+
+        TestCore sequential(currency, dispatcher, logger);
+        TestCore pipelined(currency, dispatcher, logger);
+
+        const auto expected = addSequentially(sequential.core(), blockTemplates, rawBlocks);
+        const auto results = addPipelined(pipelined.core(), blockTemplates, rawBlocks, rawBlocks.size());
+
+        CHECK(expected.front() == CryptoNote::error::AddBlockErrorCode::ADDED_TO_MAIN);
+        CHECK(expected[30] == CryptoNote::error::BlockValidationError::BLOCK_REWARD_MISMATCH);
+        CHECK(expected[31] == CryptoNote::error::AddBlockErrorCode::ADDED_TO_ALTERNATIVE);
+        CHECK(expected[61] == CryptoNote::error::AddBlockErrorCode::ADDED_TO_ALTERNATIVE_AND_SWITCHED);
+        CHECK(expected[65] == CryptoNote::error::AddBlockErrorCode::ADDED_TO_MAIN);
+        CHECK(expected[66] == CryptoNote::error::AddBlockErrorCode::REJECTED_AS_ORPHANED);
+        CHECK(expected[67] == CryptoNote::error::AddBlockErrorCode::ALREADY_EXISTS);
+
+        CHECK(results == expected);
+
+        CHECK(pipelined.core().getTopBlockIndex() == 35);
+        CHECK(pipelined.core().getTopBlockHash() == sequential.core().getTopBlockHash());
+        CHECK(pipelined.core().getTopBlockHash() == CryptoNote::CachedBlock(blockTemplates[65]).getBlockHash());
+
+        /* Stopping part way leaves the rest of the blocks unadded */
+        TestCore stopped(currency, dispatcher, logger);
+
+        const auto stoppedResults = addPipelined(stopped.core(), blockTemplates, rawBlocks, 10);
+
+        CHECK(stoppedResults.size() == 10);
+        CHECK(stopped.core().getTopBlockIndex() == 10);
+    }
+} // namespace UnitTest
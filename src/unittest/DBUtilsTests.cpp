@@ -0,0 +1,469 @@
+// Copyright (c) 2018-2024, The DeroGold Developers
+//
+// Please see the included LICENSE file for more information.
+
+#include "UnitTest.h"
+
+#include <crypto/random.h>
+#include <cryptonotecore/DBUtils.h>
+#include <cryptonotecore/DatabaseCacheData.h>
+#include <serialization/WalletTypesSerialization.h>
+#include <set>
+#include <vector>
+
+namespace UnitTest
+{
+    namespace
+    {
+        const std::vector<std::string> &keyPrefixes()
+        {
+            using namespace CryptoNote;
+
+            static const std::vector<std::string> prefixes {
+                DB::BLOCK_INDEX_TO_KEY_IMAGE_PREFIX,
+                DB::BLOCK_INDEX_TO_TX_HASHES_PREFIX,
+                DB::BLOCK_INDEX_TO_RAW_BLOCK_PREFIX,
+                DB::BLOCK_HASH_TO_BLOCK_INDEX_PREFIX,
+                DB::BLOCK_INDEX_TO_BLOCK_INFO_PREFIX,
+                DB::KEY_IMAGE_TO_BLOCK_INDEX_PREFIX,
+                DB::BLOCK_INDEX_TO_BLOCK_HASH_PREFIX,
+                DB::TRANSACTION_HASH_TO_TRANSACTION_INFO_PREFIX,
+                DB::KEY_OUTPUT_AMOUNT_PREFIX,
+                DB::CLOSEST_TIMESTAMP_BLOCK_INDEX_PREFIX,
+                DB::PAYMENT_ID_TO_TX_HASH_PREFIX,
+                DB::TIMESTAMP_TO_BLOCKHASHES_PREFIX,
+                DB::KEY_OUTPUT_AMOUNTS_COUNT_PREFIX,
+                DB::KEY_OUTPUT_KEY_PREFIX,
+                DB::BLOCK_INDEX_TO_WALLET_BLOCK_PREFIX,
+            };
+
+            return prefixes;
+        }
+
+        /* Keys the way KVBinaryOutputStreamSerializer writes them, which is
+           how every KV binary DB was written before keys were built by hand */
+        template<class Key> std::string legacyKey(const std::string &keyPrefix, const Key &key)
+        {
+            return CryptoNote::DB::serialize(std::make_pair(keyPrefix, key), keyPrefix);
+        }
+
+        template<class Key> bool sameAsSerializer(const std::string &keyPrefix, const Key &key)
+        {
+            CryptoNote::DB::KVBinary::SizeCounter counter;
+            CryptoNote::DB::KVBinary::appendKey(counter, keyPrefix, key);
+
+            const std::string rawKey = CryptoNote::DB::serializeKey(keyPrefix, key);
+
+            return rawKey == legacyKey(keyPrefix, key) && counter.size == rawKey.size();
+        }
+
+        /* Writes the value the way a compact DB stores it, reads it back into
+           stored, and checks writing that again gives the same bytes */
+        template<class Value>
+        bool compactRoundTrip(const std::string &keyPrefix, const Value &value, Value &stored)
+        {
+            using namespace CryptoNote;
+
+            const auto [rawKey, rawValue] = DB::serialize(DB::Format::Compact, keyPrefix, uint32_t(1), value);
+
+            DB::deserialize(DB::Format::Compact, rawValue, stored, keyPrefix);
+
+            return rawKey == DB::Compact::serializeKey(keyPrefix, uint32_t(1))
+                   && DB::Compact::serializeValue(stored) == rawValue;
+        }
+
+        Crypto::Hash randomHash()
+        {
+            Crypto::Hash hash;
+            Random::randomBytes(sizeof(hash.data), hash.data);
+            return hash;
+        }
+    } // namespace
+
+    void testKVBinaryKeys()
+    {
+        using namespace CryptoNote;
+
+        Crypto::Hash hash;
+        Random::randomBytes(sizeof(hash.data), hash.data);
+
+        Crypto::KeyImage keyImage;
+        Random::randomBytes(sizeof(keyImage.data), keyImage.data);
+
+        for (const auto &keyPrefix : keyPrefixes())
+        {
+            CHECK(sameAsSerializer(keyPrefix, uint32_t(0)));
+            CHECK(sameAsSerializer(keyPrefix, uint32_t(0xdeadbeef)));
+            CHECK(sameAsSerializer(keyPrefix, uint64_t(0)));
+            CHECK(sameAsSerializer(keyPrefix, uint64_t(0x0123456789abcdef)));
+            CHECK(sameAsSerializer(keyPrefix, hash));
+            CHECK(sameAsSerializer(keyPrefix, keyImage));
+            CHECK(sameAsSerializer(keyPrefix, DB::LAST_BLOCK_INDEX_KEY));
+            CHECK(sameAsSerializer(keyPrefix, DB::KEY_OUTPUT_AMOUNTS_COUNT_KEY));
+            CHECK(sameAsSerializer(keyPrefix, DB::TRANSACTIONS_COUNT_KEY));
+            CHECK(sameAsSerializer(keyPrefix, std::make_pair(uint64_t(5000000), uint32_t(12345))));
+            CHECK(sameAsSerializer(keyPrefix, std::make_pair(uint64_t(0), uint64_t(1) << 40)));
+        }
+
+        /* Strings long enough to need each size encoding */
+        for (const size_t size : {0, 1, 63, 64, 16383, 16384, 100000})
+        {
+            CHECK(sameAsSerializer(DB::PAYMENT_ID_TO_TX_HASH_PREFIX, std::string(size, 'x')));
+        }
+
+        /* And a prefix long enough to need a word sized length */
+        CHECK(sameAsSerializer(std::string(100, 'p'), hash));
+    }
+
+    /* Compact keys sort the way the numbers in them do, so iterating a table
+       goes in block and output order */
+    void testCompactKeys()
+    {
+        using namespace CryptoNote;
+
+        const std::string &prefix = DB::KEY_OUTPUT_AMOUNT_PREFIX;
+
+        const auto key32 = [&](const uint32_t value) { return DB::Compact::serializeKey(prefix, value); };
+        const auto key64 = [&](const uint64_t value) { return DB::Compact::serializeKey(prefix, value); };
+
+        const auto keyPair = [&](const uint64_t amount, const uint32_t index) {
+            return DB::Compact::serializeKey(prefix, std::make_pair(amount, index));
+        };
+
+        CHECK(key32(0x01020304) == prefix + std::string("\x01\x02\x03\x04", 4));
+        CHECK(key64(1) == prefix + std::string(7, '\0') + "\x01");
+
+        CHECK(key32(0) < key32(1));
+        CHECK(key32(127) < key32(128));
+        CHECK(key32(255) < key32(256));
+        CHECK(key32(0xffff) < key32(0x10000));
+        CHECK(key32(0x7fffffff) < key32(0x80000000));
+        CHECK(key32(0xfffffffe) < key32(0xffffffff));
+
+        CHECK(key64(0xff) < key64(0x100));
+        CHECK(key64(0xffffffff) < key64(uint64_t(1) << 32));
+        CHECK(key64(0x7fffffffffffffff) < key64(0x8000000000000000));
+
+        /* By amount, then by index */
+        CHECK(keyPair(1, 0xffffffff) < keyPair(2, 0));
+        CHECK(keyPair(5, 1) < keyPair(5, 256));
+        CHECK(keyPair(0xff, 7) < keyPair(0x100, 0));
+
+        for (uint32_t i = 0; i < 1000; i++)
+        {
+            const uint32_t a = Random::randomValue<uint32_t>();
+            const uint32_t b = Random::randomValue<uint32_t>();
+
+            CHECK((a < b) == (key32(a) < key32(b)));
+
+            const uint64_t c = Random::randomValue<uint64_t>();
+            const uint64_t d = Random::randomValue<uint64_t>();
+
+            CHECK((c < d) == (key64(c) < key64(d)));
+        }
+
+        /* Hashes and key images are stored as they are */
+        const Crypto::Hash hash = randomHash();
+
+        CHECK(DB::Compact::serializeKey(DB::BLOCK_HASH_TO_BLOCK_INDEX_PREFIX, hash)
+              == DB::BLOCK_HASH_TO_BLOCK_INDEX_PREFIX
+                     + std::string(reinterpret_cast<const char *>(hash.data), sizeof(hash.data)));
+
+        Crypto::KeyImage keyImage;
+        Random::randomBytes(sizeof(keyImage.data), keyImage.data);
+
+        CHECK(DB::Compact::serializeKey(DB::KEY_IMAGE_TO_BLOCK_INDEX_PREFIX, keyImage).size()
+              == DB::KEY_IMAGE_TO_BLOCK_INDEX_PREFIX.size() + sizeof(keyImage.data));
+
+        /* The named keys can't be mistaken for another key in their table */
+        CHECK(DB::Compact::serializeKey(DB::BLOCK_INDEX_TO_BLOCK_HASH_PREFIX, DB::LAST_BLOCK_INDEX_KEY).size()
+              != DB::Compact::serializeKey(DB::BLOCK_INDEX_TO_BLOCK_HASH_PREFIX, uint32_t(0)).size());
+        CHECK(DB::Compact::serializeKey(DB::KEY_OUTPUT_AMOUNTS_COUNT_PREFIX, DB::KEY_OUTPUT_AMOUNTS_COUNT_KEY).size()
+              != DB::Compact::serializeKey(DB::KEY_OUTPUT_AMOUNTS_COUNT_PREFIX, uint32_t(0)).size());
+        CHECK(DB::Compact::serializeKey(DB::TRANSACTION_HASH_TO_TRANSACTION_INFO_PREFIX, DB::TRANSACTIONS_COUNT_KEY)
+                  .size()
+              != DB::Compact::serializeKey(DB::TRANSACTION_HASH_TO_TRANSACTION_INFO_PREFIX, hash).size());
+    }
+
+    /* Every type of value a compact DB stores reads back as it was written */
+    void testCompactValues()
+    {
+        using namespace CryptoNote;
+
+        {
+            std::unordered_set<Crypto::KeyImage> keyImages;
+
+            for (int i = 0; i < 3; i++)
+            {
+                Crypto::KeyImage keyImage;
+                Random::randomBytes(sizeof(keyImage.data), keyImage.data);
+                keyImages.insert(keyImage);
+            }
+
+            std::unordered_set<Crypto::KeyImage> stored;
+
+            CHECK(compactRoundTrip(DB::BLOCK_INDEX_TO_KEY_IMAGE_PREFIX, keyImages, stored));
+            CHECK(stored == keyImages);
+        }
+
+        {
+            uint32_t stored = 0;
+
+            CHECK(compactRoundTrip(DB::KEY_IMAGE_TO_BLOCK_INDEX_PREFIX, uint32_t(0xdeadbeef), stored));
+            CHECK(stored == 0xdeadbeef);
+        }
+
+        {
+            uint64_t stored = 0;
+
+            CHECK(compactRoundTrip(DB::KEY_OUTPUT_AMOUNTS_COUNT_PREFIX, uint64_t(0x0123456789abcdef), stored));
+            CHECK(stored == 0x0123456789abcdef);
+        }
+
+        {
+            const Crypto::Hash hash = randomHash();
+            Crypto::Hash stored;
+
+            CHECK(compactRoundTrip(DB::PAYMENT_ID_TO_TX_HASH_PREFIX, hash, stored));
+            CHECK(stored == hash);
+        }
+
+        {
+            const std::vector<Crypto::Hash> hashes {randomHash(), randomHash(), randomHash()};
+            std::vector<Crypto::Hash> stored;
+
+            CHECK(compactRoundTrip(DB::BLOCK_INDEX_TO_TX_HASHES_PREFIX, hashes, stored));
+            CHECK(stored == hashes);
+        }
+
+        {
+            ExtendedTransactionInfo transaction;
+            transaction.blockIndex = 123456;
+            transaction.transactionIndex = 3;
+            transaction.transactionHash = randomHash();
+            transaction.unlockTime = 654321;
+
+            KeyOutput output;
+            Random::randomBytes(sizeof(output.key.data), output.key.data);
+            transaction.outputs.push_back(output);
+
+            transaction.globalIndexes = {10, 20};
+            transaction.amountToKeyIndexes[100] = {10};
+            transaction.amountToKeyIndexes[2000] = {20};
+
+            ExtendedTransactionInfo stored;
+
+            CHECK(compactRoundTrip(DB::TRANSACTION_HASH_TO_TRANSACTION_INFO_PREFIX, transaction, stored));
+            CHECK(stored.blockIndex == transaction.blockIndex);
+            CHECK(stored.transactionIndex == transaction.transactionIndex);
+            CHECK(stored.transactionHash == transaction.transactionHash);
+            CHECK(stored.unlockTime == transaction.unlockTime);
+            CHECK(stored.outputs.size() == 1);
+            CHECK(boost::get<KeyOutput>(stored.outputs[0]).key == output.key);
+            CHECK(stored.globalIndexes == transaction.globalIndexes);
+            CHECK(stored.amountToKeyIndexes == transaction.amountToKeyIndexes);
+        }
+
+        {
+            CachedBlockInfo block;
+            block.blockHash = randomHash();
+            block.timestamp = 1700000000;
+            block.cumulativeDifficulty = 0x0123456789;
+            block.alreadyGeneratedCoins = 987654321;
+            block.alreadyGeneratedTransactions = 4567;
+            block.blockSize = 300;
+
+            CachedBlockInfo stored;
+
+            CHECK(compactRoundTrip(DB::BLOCK_INDEX_TO_BLOCK_INFO_PREFIX, block, stored));
+            CHECK(stored.blockHash == block.blockHash);
+            CHECK(stored.timestamp == block.timestamp);
+            CHECK(stored.cumulativeDifficulty == block.cumulativeDifficulty);
+            CHECK(stored.alreadyGeneratedCoins == block.alreadyGeneratedCoins);
+            CHECK(stored.alreadyGeneratedTransactions == block.alreadyGeneratedTransactions);
+            CHECK(stored.blockSize == block.blockSize);
+        }
+
+        {
+            PackedOutIndex index;
+            index.blockIndex = 123456;
+            index.transactionIndex = 7;
+            index.outputIndex = 2;
+
+            PackedOutIndex stored;
+            stored.packedValue = 0;
+
+            CHECK(compactRoundTrip(DB::KEY_OUTPUT_AMOUNT_PREFIX, index, stored));
+            CHECK(stored.packedValue == index.packedValue);
+        }
+
+        {
+            KeyOutputInfo output;
+            Random::randomBytes(sizeof(output.publicKey.data), output.publicKey.data);
+            output.transactionHash = randomHash();
+            output.unlockTime = 42;
+            output.outputIndex = 5;
+
+            KeyOutputInfo stored;
+
+            CHECK(compactRoundTrip(DB::KEY_OUTPUT_KEY_PREFIX, output, stored));
+            CHECK(stored.publicKey == output.publicKey);
+            CHECK(stored.transactionHash == output.transactionHash);
+            CHECK(stored.unlockTime == output.unlockTime);
+            CHECK(stored.outputIndex == output.outputIndex);
+        }
+
+        {
+            RawBlock block;
+            block.block.resize(200);
+            Random::randomBytes(block.block.size(), block.block.data());
+            block.transactions = {BinaryArray(50, 1), BinaryArray(70, 2)};
+
+            RawBlock stored;
+
+            CHECK(compactRoundTrip(DB::BLOCK_INDEX_TO_RAW_BLOCK_PREFIX, block, stored));
+            CHECK(stored.block == block.block);
+            CHECK(stored.transactions == block.transactions);
+        }
+
+        {
+            WalletTypes::WalletBlockInfo block;
+            block.blockHeight = 123456;
+            block.blockHash = randomHash();
+            block.blockTimestamp = 1700000000;
+
+            WalletTypes::RawTransaction transaction;
+            transaction.keyOutputs.push_back({{}, 100, 1});
+            transaction.hash = randomHash();
+            transaction.paymentID = std::string(64, 'b');
+            block.transactions.push_back(transaction);
+
+            WalletTypes::WalletBlockInfo stored;
+
+            CHECK(compactRoundTrip(DB::BLOCK_INDEX_TO_WALLET_BLOCK_PREFIX, block, stored));
+            CHECK(stored.blockHeight == block.blockHeight);
+            CHECK(stored.blockHash == block.blockHash);
+            CHECK(stored.blockTimestamp == block.blockTimestamp);
+            CHECK(stored.transactions.size() == 1);
+            CHECK(stored.transactions[0].hash == transaction.hash);
+            CHECK(stored.transactions[0].paymentID == transaction.paymentID);
+            CHECK(stored.transactions[0].keyOutputs.size() == 1);
+        }
+    }
+
+    /* Every kind of key a table stores has to be moved to that table's
+       column family when migrating, and nothing else may be */
+    void testColumnFamilyClassification()
+    {
+        using namespace CryptoNote;
+
+        Crypto::Hash hash;
+        Random::randomBytes(sizeof(hash.data), hash.data);
+
+        Crypto::KeyImage keyImage;
+        Random::randomBytes(sizeof(keyImage.data), keyImage.data);
+
+        for (const auto &keyPrefix : keyPrefixes())
+        {
+            const std::string &columnFamily = DB::columnFamily(keyPrefix);
+
+            CHECK(!columnFamily.empty());
+
+            CHECK(DB::columnFamilyOfKey(legacyKey(keyPrefix, uint32_t(0))) == columnFamily);
+            CHECK(DB::columnFamilyOfKey(legacyKey(keyPrefix, uint32_t(123456789))) == columnFamily);
+            CHECK(DB::columnFamilyOfKey(legacyKey(keyPrefix, uint64_t(1) << 40)) == columnFamily);
+            CHECK(DB::columnFamilyOfKey(legacyKey(keyPrefix, hash)) == columnFamily);
+            CHECK(DB::columnFamilyOfKey(legacyKey(keyPrefix, keyImage)) == columnFamily);
+            CHECK(DB::columnFamilyOfKey(legacyKey(keyPrefix, DB::LAST_BLOCK_INDEX_KEY)) == columnFamily);
+            CHECK(DB::columnFamilyOfKey(legacyKey(keyPrefix, DB::KEY_OUTPUT_AMOUNTS_COUNT_KEY)) == columnFamily);
+            CHECK(DB::columnFamilyOfKey(legacyKey(keyPrefix, std::make_pair(uint64_t(5000), uint32_t(7))))
+                  == columnFamily);
+
+            /* And the way they're written now */
+            CHECK(DB::columnFamilyOfKey(DB::serializeKey(keyPrefix, hash)) == columnFamily);
+        }
+
+        /* Keys outside any table stay in the default column family */
+        CHECK(DB::columnFamilyOfKey("db_scheme_version").empty());
+        CHECK(DB::columnFamilyOfKey("column_families_migrated").empty());
+        CHECK(DB::columnFamilyOfKey("").empty());
+        CHECK(DB::columnFamilyOfKey(DB::serialize(std::string("value"), "unknown")).empty());
+
+        /* Every table has its own column family */
+        const std::set<std::string> unique(DB::columnFamilies().begin(), DB::columnFamilies().end());
+
+        CHECK(unique.size() == DB::columnFamilies().size());
+        CHECK(unique.size() == keyPrefixes().size());
+        CHECK(unique.count("") == 0);
+    }
+
+    /* The stored wallet scan record keeps what wallets scan, and drops the
+       ring members */
+    void testWalletScanRecord()
+    {
+        using namespace CryptoNote;
+
+        WalletTypes::WalletBlockInfo block;
+
+        block.blockHeight = 123456;
+        Random::randomBytes(sizeof(block.blockHash.data), block.blockHash.data);
+        block.blockTimestamp = 1700000000;
+
+        block.coinbaseTransaction.emplace();
+        block.coinbaseTransaction->keyOutputs.push_back({{}, 5000, 77});
+        Random::randomBytes(sizeof(block.coinbaseTransaction->hash.data), block.coinbaseTransaction->hash.data);
+        block.coinbaseTransaction->unlockTime = 123466;
+
+        WalletTypes::RawTransaction transaction;
+
+        transaction.keyOutputs.push_back({{}, 100, 1});
+        transaction.keyOutputs.push_back({{}, 200, 2});
+        Random::randomBytes(sizeof(transaction.hash.data), transaction.hash.data);
+        Random::randomBytes(sizeof(transaction.transactionPublicKey.data), transaction.transactionPublicKey.data);
+        transaction.paymentID = std::string(64, 'a');
+
+        KeyInput input;
+        input.amount = 300;
+        Random::randomBytes(sizeof(input.keyImage.data), input.keyImage.data);
+        input.outputIndexes = {5, 10, 15};
+        transaction.keyInputs.push_back(input);
+
+        block.transactions.push_back(transaction);
+
+        WalletTypes::WalletBlockInfo stored;
+        DB::deserialize(DB::serialize(block, "walletBlock"), stored, "walletBlock");
+
+        CHECK(stored.blockHeight == block.blockHeight);
+        CHECK(stored.blockHash == block.blockHash);
+        CHECK(stored.blockTimestamp == block.blockTimestamp);
+
+        CHECK(stored.coinbaseTransaction.has_value());
+        CHECK(stored.coinbaseTransaction->hash == block.coinbaseTransaction->hash);
+        CHECK(stored.coinbaseTransaction->unlockTime == block.coinbaseTransaction->unlockTime);
+        CHECK(stored.coinbaseTransaction->keyOutputs.size() == 1);
+        CHECK(stored.coinbaseTransaction->keyOutputs[0].globalOutputIndex == std::optional<uint64_t>(77));
+
+        CHECK(stored.transactions.size() == 1);
+
+        const auto &storedTransaction = stored.transactions[0];
+
+        CHECK(storedTransaction.hash == transaction.hash);
+        CHECK(storedTransaction.transactionPublicKey == transaction.transactionPublicKey);
+        CHECK(storedTransaction.keyOutputs.size() == 2);
+        CHECK(storedTransaction.keyOutputs[1].amount == 200);
+        CHECK(storedTransaction.keyOutputs[1].globalOutputIndex == std::optional<uint64_t>(2));
+        CHECK(storedTransaction.paymentID == transaction.paymentID);
+        CHECK(storedTransaction.keyInputs.size() == 1);
+        CHECK(storedTransaction.keyInputs[0].keyImage == input.keyImage);
+        CHECK(storedTransaction.keyInputs[0].amount == input.amount);
+        CHECK(storedTransaction.keyInputs[0].outputIndexes.empty());
+
+        /* Smaller than the full wallet sync serialization */
+        std::string full;
+        Common::StringOutputStream stream(full);
+        BinaryOutputStreamSerializer serializer(stream);
+        serializer(block, "walletBlock");
+
+        CHECK(DB::serialize(block, "walletBlock").size() < full.size());
+    }
+} // namespace UnitTest
@@ -0,0 +1,107 @@
+// Copyright (c) 2018-2024, The DeroGold Developers
+//
+// Please see the included LICENSE file for more information.
+
+#include "UnitTest.h"
+
+#include <crypto/random.h>
+#include <p2p/KnownInventory.h>
+#include <vector>
+
+namespace UnitTest
+{
+    namespace
+    {
+        std::vector<Crypto::Hash> randomHashes(const size_t count)
+        {
+            std::vector<Crypto::Hash> hashes(count);
+
+            for (auto &hash : hashes)
+            {
+                Random::randomBytes(sizeof(hash.data), hash.data);
+            }
+
+            return hashes;
+        }
+    } // namespace
+
+    void testKnownInventory()
+    {
+        using CryptoNote::KnownInventory;
+
+        const auto hashes = randomHashes(30);
+
+        /* A hash is only new the first time */
+        {
+            KnownInventory inventory(10);
+
+            CHECK(!inventory.contains(hashes[0]));
+            CHECK(inventory.add(hashes[0]));
+            CHECK(inventory.contains(hashes[0]));
+            CHECK(!inventory.add(hashes[0]));
+        }
+
+        /* Filling half the limit starts over, keeping the filled half
+           until the next half is filled */
+        {
+            KnownInventory inventory(10);
+
+            for (size_t i = 0; i < 5; i++)
+            {
+                CHECK(inventory.add(hashes[i]));
+            }
+
+            for (size_t i = 0; i < 5; i++)
+            {
+                CHECK(inventory.contains(hashes[i]));
+            }
+
+            for (size_t i = 5; i < 9; i++)
+            {
+                CHECK(inventory.add(hashes[i]));
+            }
+
+            /* Both halves are known */
+            CHECK(inventory.contains(hashes[0]) && inventory.contains(hashes[8]));
+
+            /* Adding a known hash doesn't count towards the next half */
+            CHECK(!inventory.add(hashes[2]));
+            CHECK(inventory.contains(hashes[0]));
+
+            CHECK(inventory.add(hashes[9]));
+
+            for (size_t i = 0; i < 5; i++)
+            {
+                CHECK(!inventory.contains(hashes[i]));
+            }
+
+            for (size_t i = 5; i < 10; i++)
+            {
+                CHECK(inventory.contains(hashes[i]));
+            }
+
+            /* A forgotten hash is new again */
+            CHECK(inventory.add(hashes[0]));
+        }
+
+        /* Never remembers more than the limit */
+        {
+            KnownInventory inventory(10);
+
+            for (const auto &hash : hashes)
+            {
+                inventory.add(hash);
+            }
+
+            size_t known = 0;
+
+            for (const auto &hash : hashes)
+            {
+                known += inventory.contains(hash);
+            }
+
+            CHECK(known <= 10);
+            CHECK(inventory.contains(hashes.back()));
+        }
+    }
+} // namespace UnitTest
@@ -0,0 +1,72 @@
+// Copyright (c) 2018-2024, The DeroGold Developers
+//
+// Please see the included LICENSE file for more information.
+
+#include "UnitTest.h"
+
+#include <common/Math.h>
+#include <crypto/random.h>
+#include <deque>
+#include <limits>
+#include <vector>
+
+namespace UnitTest
+{
+    namespace
+    {
+        /* Pushes random values, now and then clearing the window, and checks
+           the median after every change against sorting the window again */
+        bool matchesMedianValue(const size_t capacity, const uint64_t maxValue, const size_t pushes)
+        {
+            Common::MedianWindow<uint64_t> window(capacity);
+
+            std::deque<uint64_t> expected;
+
+            for (size_t i = 0; i < pushes; i++)
+            {
+                if (Random::randomValue<size_t>(0, 999) == 0)
+                {
+                    window.clear();
+                    expected.clear();
+                }
+
+                const uint64_t value = Random::randomValue<uint64_t>(0, maxValue);
+
+                window.push(value);
+                expected.push_back(value);
+
+                if (expected.size() > capacity)
+                {
+                    expected.pop_front();
+                }
+
+                std::vector<uint64_t> values(expected.begin(), expected.end());
+
+                if (window.size() != expected.size() || window.median() != Common::medianValue(values))
+                {
+                    return false;
+                }
+            }
+
+            return true;
+        }
+    } // namespace
+
+    void testMedianWindow()
+    {
+        Common::MedianWindow<uint64_t> empty(10);
+
+        CHECK(empty.empty());
+        CHECK(empty.median() == 0);
+
+        for (const size_t capacity : {1, 2, 3, 4, 7, 100, 1000})
+        {
+            /* Few distinct values, so most pushes and pops hit duplicates */
+            CHECK(matchesMedianValue(capacity, 3, 5000));
+
+            CHECK(matchesMedianValue(capacity, 1000, 5000));
+
+            CHECK(matchesMedianValue(capacity, std::numeric_limits<uint32_t>::max(), 5000));
+        }
+    }
+} // namespace UnitTest
@@ -0,0 +1,133 @@
+// Copyright (c) 2018-2024, The DeroGold Developers
+//
+// Please see the included LICENSE file for more information.
+
+#include "UnitTest.h"
+
+#include <crypto/random.h>
+#include <cryptonotecore/SpentKeyImageIndex.h>
+#include <vector>
+
+namespace UnitTest
+{
+    namespace
+    {
+        std::vector<Crypto::KeyImage> randomKeyImages(const size_t count)
+        {
+            std::vector<Crypto::KeyImage> keyImages(count);
+
+            for (auto &keyImage : keyImages)
+            {
+                Random::randomBytes(sizeof(keyImage.data), keyImage.data);
+            }
+
+            return keyImages;
+        }
+    } // namespace
+
+    void testSpentKeyImageIndex()
+    {
+        using CryptoNote::SpentKeyImageIndex;
+
+        /* The filter may send lookups of unspent key images to the database,
+           but must never claim a spent one is unspent */
+        {
+            SpentKeyImageIndex index(SpentKeyImageIndex::Mode::Filter);
+
+            const auto spent = randomKeyImages(200000);
+
+            index.insert(spent, 10);
+
+            size_t falseNegatives = 0;
+
+            for (const auto &keyImage : spent)
+            {
+                falseNegatives += index.find(keyImage, 10) != SpentKeyImageIndex::LookupResult::Unknown;
+            }
+
+            CHECK(falseNegatives == 0);
+
+            /* Most unspent key images are answered without the database */
+            size_t answered = 0;
+
+            for (const auto &keyImage : randomKeyImages(10000))
+            {
+                answered += index.find(keyImage, 10) == SpentKeyImageIndex::LookupResult::NotSpent;
+            }
+
+            CHECK(answered > 9000);
+
+            /* Inserting them again doesn't count them twice */
+            const uint64_t size = index.size();
+
+            CHECK(size <= spent.size());
+            CHECK(size > spent.size() - 100);
+
+            index.insert(spent, 11);
+
+            CHECK(index.size() == size);
+
+            index.clear();
+
+            CHECK(index.size() == 0);
+            CHECK(index.find(spent.front(), 10) == SpentKeyImageIndex::LookupResult::NotSpent);
+        }
+
+        /* Full mode knows the block each key image was spent in */
+        {
+            SpentKeyImageIndex index(SpentKeyImageIndex::Mode::Full);
+
+            const auto spent = randomKeyImages(1000);
+            const auto unspent = randomKeyImages(10);
+
+            index.insert(spent, 20);
+            index.insert(spent, 20);
+
+            CHECK(index.size() == spent.size());
+            CHECK(index.complete());
+
+            CHECK(index.find(spent[0], 20) == SpentKeyImageIndex::LookupResult::Spent);
+            CHECK(index.find(spent[0], 19) == SpentKeyImageIndex::LookupResult::NotSpent);
+            CHECK(index.find(unspent[0], 20) == SpentKeyImageIndex::LookupResult::NotSpent);
+
+            index.remove({spent[0]});
+
+            CHECK(index.size() == spent.size() - 1);
+            CHECK(index.find(spent[0], 20) == SpentKeyImageIndex::LookupResult::NotSpent);
+        }
+
+        /* Once full mode is out of room, key images it doesn't have may be
+           spent, and have to go to the database */
+        {
+            SpentKeyImageIndex index(SpentKeyImageIndex::Mode::Full, 100);
+
+            const auto spent = randomKeyImages(150);
+            const auto unspent = randomKeyImages(10);
+
+            index.insert(spent, 5);
+
+            CHECK(!index.complete());
+            CHECK(index.size() == 100);
+
+            size_t spentAnswers = 0;
+            size_t falseNegatives = 0;
+
+            for (const auto &keyImage : spent)
+            {
+                const auto result = index.find(keyImage, 5);
+
+                spentAnswers += result == SpentKeyImageIndex::LookupResult::Spent;
+                falseNegatives += result == SpentKeyImageIndex::LookupResult::NotSpent;
+            }
+
+            CHECK(spentAnswers == 100);
+            CHECK(falseNegatives == 0);
+            CHECK(index.find(unspent[0], 5) == SpentKeyImageIndex::LookupResult::Unknown);
+
+            index.clear();
+
+            CHECK(index.complete());
+            CHECK(index.find(unspent[0], 5) == SpentKeyImageIndex::LookupResult::NotSpent);
+        }
+    }
+} // namespace UnitTest
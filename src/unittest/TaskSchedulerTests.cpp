@@ -0,0 +1,133 @@
+// Copyright (c) 2018-2024, The DeroGold Developers
+//
+// Please see the included LICENSE file for more information.
+
+#include "UnitTest.h"
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <stdexcept>
+#include <utilities/TaskScheduler.h>
+#include <vector>
+
+namespace UnitTest
+{
+    void testTaskScheduler()
+    {
+        /* Every iteration runs exactly once */
+        {
+            Utilities::TaskScheduler scheduler(4);
+
+            std::vector<std::atomic<int>> runs(10000);
+
+            CHECK(scheduler.parallelFor(0, runs.size(), [&](size_t i) {
+                runs[i]++;
+                return true;
+            }));
+
+            size_t runOnce = 0;
+
+            for (const auto &count : runs)
+            {
+                runOnce += count == 1;
+            }
+
+            CHECK(runOnce == runs.size());
+
+            CHECK(scheduler.parallelFor(5, 5, [](size_t) { return false; }));
+        }
+
+        /* Returning false skips the iterations which haven't started */
+        {
+            Utilities::TaskScheduler scheduler(4);
+
+            std::atomic<size_t> ran = 0;
+
+            CHECK(!scheduler.parallelFor(0, 100000, [&](size_t i) {
+                ran++;
+                return i != 10;
+            }));
+
+            CHECK(ran < 100000);
+        }
+
+        /* An exception stops the loop and is rethrown to the caller */
+        {
+            Utilities::TaskScheduler scheduler(4);
+
+            bool thrown = false;
+
+            try
+            {
+                scheduler.parallelFor(0, 1000, [](size_t i) {
+                    if (i == 500)
+                    {
+                        throw std::runtime_error("iteration failed");
+                    }
+
+                    return true;
+                });
+            }
+            catch (const std::runtime_error &)
+            {
+                thrown = true;
+            }
+
+            CHECK(thrown);
+        }
+
+        /* Loops inside tasks and inside other loops complete, even when
+           every worker is busy running the outer ones */
+        {
+            Utilities::TaskScheduler scheduler(2);
+
+            std::atomic<size_t> sum = 0;
+
+            std::vector<std::future<bool>> results;
+
+            for (int task = 0; task < 8; task++)
+            {
+                results.push_back(scheduler.submit([&] {
+                    return scheduler.parallelFor(0, 16, [&](size_t) {
+                        return scheduler.parallelFor(0, 16, [&](size_t j) {
+                            sum += j;
+                            return true;
+                        });
+                    });
+                }));
+            }
+
+            for (auto &result : results)
+            {
+                CHECK(result.get());
+            }
+
+            CHECK(sum == 8 * 16 * (15 * 16 / 2));
+        }
+
+        /* Tasks still queued when the scheduler is destroyed are run first,
+           so their futures are fulfilled */
+        {
+            std::atomic<size_t> ran = 0;
+
+            std::vector<std::future<void>> results;
+
+            {
+                Utilities::TaskScheduler scheduler(2);
+
+                for (int i = 0; i < 1000; i++)
+                {
+                    results.push_back(scheduler.submit([&] { ran++; }));
+                }
+            }
+
+            CHECK(ran == 1000);
+
+            for (auto &result : results)
+            {
+                CHECK(result.wait_for(std::chrono::seconds(0)) == std::future_status::ready);
+            }
+        }
+    }
+} // namespace UnitTest
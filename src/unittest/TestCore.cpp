@@ -0,0 +1,106 @@
+// Copyright (c) 2018-2024, The DeroGold Developers
+//
+// Please see the included LICENSE file for more information.
+
+#include "TestCore.h"
+
+#include <common/CryptoNoteTools.h>
+#include <common/FileSystemShim.h>
+#include <common/StringTools.h>
+#include <crypto/random.h>
+#include <cryptonotecore/Checkpoints.h>
+#include <cryptonotecore/DatabaseBlockchainCacheFactory.h>
+#include <stdexcept>
+
+namespace UnitTest
+{
+    TestCore::TestCore(
+        const CryptoNote::Currency &currency,
+        System::Dispatcher &dispatcher,
+        const std::shared_ptr<Logging::ILogger> &logger)
+    {
+        m_directory = (fs::temp_directory_path()
+                       / ("derogold-unittest-" + std::to_string(Random::randomValue<uint64_t>())))
+                          .string();
+
+        fs::create_directories(m_directory);
+
+        CryptoNote::DataBaseConfig config(m_directory, 2, 100, 8, 8, 8, false, false);
+
+        m_database = std::make_unique<CryptoNote::RocksDBWrapper>(logger, config);
+        m_database->init();
+
+        CryptoNote::Checkpoints checkpoints(logger);
+        checkpoints.addCheckpoint(CHECKPOINT_ZONE_END, Common::podToHex(Crypto::Hash()));
+
+        m_core = std::make_unique<CryptoNote::Core>(
+            currency,
+            logger,
+            std::move(checkpoints),
+            dispatcher,
+            std::make_unique<CryptoNote::DatabaseBlockchainCacheFactory>(*m_database, logger),
+            2);
+
+        m_core->load();
+    }
+
+    TestCore::~TestCore()
+    {
+        m_core.reset();
+
+        m_database->shutdown();
+        m_database.reset();
+
+        std::error_code ignored;
+        fs::remove_all(m_directory, ignored);
+    }
+
+    CryptoNote::Core &TestCore::core()
+    {
+        return *m_core;
+    }
+
+    CryptoNote::RawBlock TestCore::mineBlock(const Crypto::PublicKey &minerKey)
+    {
+        CryptoNote::BlockTemplate blockTemplate;
+        uint64_t difficulty = 0;
+        uint32_t height = 0;
+
+        const auto [success, error] =
+            m_core->getBlockTemplate(blockTemplate, minerKey, minerKey, {}, difficulty, height);
+
+        if (!success)
+        {
+            throw std::runtime_error("Failed to create block template: " + error);
+        }
+
+        if (height >= CHECKPOINT_ZONE_END)
+        {
+            throw std::runtime_error("Mined past the checkpoint zone");
+        }
+
+        CryptoNote::RawBlock rawBlock;
+        rawBlock.block = CryptoNote::toBinaryArray(blockTemplate);
+
+        for (const auto &hash : blockTemplate.transactionHashes)
+        {
+            const auto [found, transaction] = m_core->getPoolTransaction(hash);
+
+            if (!found)
+            {
+                throw std::runtime_error("Block template transaction isn't in the pool");
+            }
+
+            rawBlock.transactions.push_back(transaction);
+        }
+
+        const auto result = m_core->addBlock(CryptoNote::RawBlock(rawBlock));
+
+        if (result != CryptoNote::error::AddBlockErrorCode::ADDED_TO_MAIN)
+        {
+            throw std::runtime_error("Failed to add mined block: " + result.message());
+        }
+
+        return rawBlock;
+    }
+} // namespace UnitTest
@@ -0,0 +1,52 @@
+// Copyright (c) 2018-2024, The DeroGold Developers
+//
+// Please see the included LICENSE file for more information.
+
+#pragma once
+
+#include <CryptoNote.h>
+#include <cryptonotecore/Core.h>
+#include <cryptonotecore/Currency.h>
+#include <cryptonotecore/RocksDBWrapper.h>
+#include <logging/ILogger.h>
+#include <memory>
+#include <string>
+#include <system/Dispatcher.h>
+
+namespace UnitTest
+{
+    /* A core with its own database in a temporary directory, which is
+       removed again when it is destroyed.
+
+       Everything below TestCore::CHECKPOINT_ZONE_END is in the checkpoint
+       zone, so blocks can be made without doing the proof of work. */
+    class TestCore
+    {
+      public:
+        static constexpr uint32_t CHECKPOINT_ZONE_END = 1000;
+
+        TestCore(
+            const CryptoNote::Currency &currency,
+            System::Dispatcher &dispatcher,
+            const std::shared_ptr<Logging::ILogger> &logger);
+
+        ~TestCore();
+
+        TestCore(const TestCore &) = delete;
+
+        TestCore &operator=(const TestCore &) = delete;
+
+        CryptoNote::Core &core();
+
+        /* Adds a block paying the miner key on top of the main chain, with
+           whatever is in the pool, and returns it */
+        CryptoNote::RawBlock mineBlock(const Crypto::PublicKey &minerKey);
+
+      private:
+        std::string m_directory;
+
+        std::unique_ptr<CryptoNote::RocksDBWrapper> m_database;
+
+        std::unique_ptr<CryptoNote::Core> m_core;
+    };
+} // namespace UnitTest
@@ -0,0 +1,27 @@
+// Copyright (c) 2018-2024, The DeroGold Developers
+//
+// Please see the included LICENSE file for more information.
+
+#include "UnitTest.h"
+
+#include <iostream>
+
+namespace UnitTest
+{
+    namespace
+    {
+        size_t failures = 0;
+    }
+
+    void fail(const char *file, const int line, const std::string &expression)
+    {
+        failures++;
+
+        std::cout << file << ":" << line << ": check failed: " << expression << std::endl;
+    }
+
+    size_t failureCount()
+    {
+        return failures;
+    }
+} // namespace UnitTest
@@ -0,0 +1,54 @@
+// Copyright (c) 2018-2024, The DeroGold Developers
+//
+// Please see the included LICENSE file for more information.
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace UnitTest
+{
+    /* Records a failed check. The run carries on, and fails at the end. */
+    void fail(const char *file, int line, const std::string &expression);
+
+    size_t failureCount();
+
+    /* The tests, one function per class under test */
+    void testBlockValidationPipeline();
+
+    void testTaskScheduler();
+
+    void testSpentKeyImageIndex();
+
+    void testColumnFamilyClassification();
+
+    void testKVBinaryKeys();
+
+    void testCompactKeys();
+
+    void testCompactValues();
+
+    void testMedianWindow();
+
+    void testWalletTypesSerialization();
+
+    void testWalletScanRecord();
+
+    void testBlockDownloadScheduler();
+
+    void testKnownInventory();
+
+    void testCompactBlock();
+
+    void testWalletSyncCache();
+} // namespace UnitTest
+
+#define CHECK(expression)                                       \
+    do                                                          \
+    {                                                           \
+        if (!(expression))                                      \
+        {                                                       \
+            UnitTest::fail(__FILE__, __LINE__, #expression);    \
+        }                                                       \
+    } while (false)
@@ -0,0 +1,153 @@
+// Copyright (c) 2018-2024, The DeroGold Developers
+//
+// Please see the included LICENSE file for more information.
+
+#include "UnitTest.h"
+
+#include <crypto/random.h>
+#include <cryptonotecore/WalletSyncCache.h>
+#include <vector>
+
+namespace UnitTest
+{
+    namespace
+    {
+        WalletTypes::WalletBlockInfo makeBlock(const uint64_t blockHeight)
+        {
+            WalletTypes::WalletBlockInfo block;
+
+            block.blockHeight = blockHeight;
+            block.blockTimestamp = 1700000000 + blockHeight;
+            Random::randomBytes(sizeof(block.blockHash.data), block.blockHash.data);
+
+            block.coinbaseTransaction.emplace();
+            block.coinbaseTransaction->unlockTime = blockHeight + 10;
+
+            return block;
+        }
+
+        /* Inserts a copy of the block, returning its hash */
+        Crypto::Hash insert(CryptoNote::WalletSyncCache &cache, const WalletTypes::WalletBlockInfo &block)
+        {
+            auto copy = block;
+            cache.insert(std::move(copy));
+            return block.blockHash;
+        }
+    } // namespace
+
+    void testWalletSyncCache()
+    {
+        using CryptoNote::WalletSyncCache;
+
+        /* A cached block is returned for its own hash only */
+        {
+            WalletSyncCache cache(10);
+
+            const auto block = makeBlock(100);
+            const auto hash = insert(cache, block);
+
+            const auto cached = cache.get(100, hash);
+
+            CHECK(cached);
+            CHECK(cached->blockHeight == 100);
+            CHECK(cached->blockTimestamp == block.blockTimestamp);
+            CHECK(cached->coinbaseTransaction && cached->coinbaseTransaction->unlockTime == 110);
+
+            CHECK(!cache.get(101, hash));
+            CHECK(!cache.get(100, makeBlock(100).blockHash));
+        }
+
+        /* A new block at the height, as when another chain becomes the main
+           chain, replaces the old one, which isn't returned any more */
+        {
+            WalletSyncCache cache(10);
+
+            const auto oldHash = insert(cache, makeBlock(50));
+
+            /* Core removes the blocks from the height up before adding one */
+            cache.removeFrom(50);
+            const auto newHash = insert(cache, makeBlock(50));
+
+            CHECK(!cache.get(50, oldHash));
+            CHECK(cache.get(50, newHash));
+
+            /* Even if it is only replaced, and not removed first */
+            const auto newestHash = insert(cache, makeBlock(50));
+
+            CHECK(!cache.get(50, newHash));
+            CHECK(cache.get(50, newestHash));
+        }
+
+        /* Popping blocks removes them and every block above */
+        {
+            WalletSyncCache cache(10);
+
+            std::vector<Crypto::Hash> hashes;
+
+            for (uint64_t height = 0; height < 5; height++)
+            {
+                hashes.push_back(insert(cache, makeBlock(height)));
+            }
+
+            cache.removeFrom(3);
+
+            CHECK(cache.get(2, hashes[2]));
+            CHECK(!cache.get(3, hashes[3]));
+            CHECK(!cache.get(4, hashes[4]));
+
+            cache.clear();
+
+            CHECK(!cache.get(0, hashes[0]));
+        }
+
+        /* Only the most recent capacity blocks are kept */
+        {
+            WalletSyncCache cache(5);
+
+            std::vector<Crypto::Hash> hashes;
+
+            for (uint64_t height = 0; height < 10; height++)
+            {
+                hashes.push_back(insert(cache, makeBlock(height)));
+            }
+
+            for (uint64_t height = 0; height < 10; height++)
+            {
+                CHECK(static_cast<bool>(cache.get(height, hashes[height])) == (height >= 5));
+            }
+
+            /* Older than everything cached, so not worth evicting for */
+            const auto oldHash = insert(cache, makeBlock(2));
+
+            CHECK(!cache.get(2, oldHash));
+            CHECK(cache.get(5, hashes[5]));
+        }
+
+        /* Blocks too far below the network height would be evicted before
+           wallets ask for them */
+        {
+            WalletSyncCache cache(5);
+
+            CHECK(cache.enabled());
+            CHECK(cache.wants(0));
+
+            cache.setNetworkHeight(100);
+
+            CHECK(cache.wants(95));
+            CHECK(cache.wants(120));
+            CHECK(!cache.wants(94));
+        }
+
+        /* A capacity of 0 turns the cache off */
+        {
+            WalletSyncCache cache(0);
+
+            CHECK(!cache.enabled());
+            CHECK(!cache.wants(0));
+
+            const auto hash = insert(cache, makeBlock(0));
+
+            CHECK(!cache.get(0, hash));
+        }
+    }
+} // namespace UnitTest
@@ -0,0 +1,232 @@
+// Copyright (c) 2018-2024, The DeroGold Developers
+//
+// Please see the included LICENSE file for more information.
+
+#include "UnitTest.h"
+
+#include <common/CryptoNoteTools.h>
+#include <crypto/random.h>
+#include <serialization/WalletTypesSerialization.h>
+
+namespace UnitTest
+{
+    namespace
+    {
+        template<class T> T randomPod()
+        {
+            T value;
+            Random::randomBytes(sizeof(value.data), value.data);
+            return value;
+        }
+
+        std::vector<WalletTypes::KeyOutput> randomOutputs(const size_t count)
+        {
+            std::vector<WalletTypes::KeyOutput> outputs;
+
+            for (size_t i = 0; i < count; i++)
+            {
+                WalletTypes::KeyOutput output;
+
+                output.key = randomPod<Crypto::PublicKey>();
+                output.amount = Random::randomValue<uint64_t>();
+
+                /* Only sometimes known */
+                if (i % 2 == 0)
+                {
+                    output.globalOutputIndex = Random::randomValue<uint64_t>();
+                }
+
+                outputs.push_back(output);
+            }
+
+            return outputs;
+        }
+
+        WalletTypes::WalletSyncData randomSyncData()
+        {
+            WalletTypes::WalletSyncData syncData;
+
+            for (size_t i = 0; i < 3; i++)
+            {
+                WalletTypes::WalletBlockInfo block;
+
+                /* The middle block is fetched without its coinbase transaction */
+                if (i != 1)
+                {
+                    WalletTypes::RawCoinbaseTransaction coinbase;
+
+                    coinbase.keyOutputs = randomOutputs(3);
+                    coinbase.hash = randomPod<Crypto::Hash>();
+                    coinbase.transactionPublicKey = randomPod<Crypto::PublicKey>();
+                    coinbase.unlockTime = Random::randomValue<uint64_t>();
+
+                    block.coinbaseTransaction = coinbase;
+                }
+
+                for (size_t j = 0; j < i * 2; j++)
+                {
+                    WalletTypes::RawTransaction transaction;
+
+                    transaction.keyOutputs = randomOutputs(j + 1);
+                    transaction.hash = randomPod<Crypto::Hash>();
+                    transaction.transactionPublicKey = randomPod<Crypto::PublicKey>();
+                    transaction.unlockTime = j;
+                    transaction.paymentID = j % 2 == 0 ? "" : std::string(64, 'a');
+
+                    for (size_t k = 0; k < j + 1; k++)
+                    {
+                        CryptoNote::KeyInput input;
+
+                        input.amount = Random::randomValue<uint64_t>();
+                        input.outputIndexes = {1, 200, 70000, 0xffffffff};
+                        input.keyImage = randomPod<Crypto::KeyImage>();
+
+                        transaction.keyInputs.push_back(input);
+                    }
+
+                    block.transactions.push_back(transaction);
+                }
+
+                block.blockHeight = 1000000 + i;
+                block.blockHash = randomPod<Crypto::Hash>();
+                block.blockTimestamp = Random::randomValue<uint64_t>();
+
+                syncData.blocks.push_back(block);
+            }
+
+            syncData.topBlock = WalletTypes::TopBlock {randomPod<Crypto::Hash>(), 1000002};
+
+            return syncData;
+        }
+
+        bool sameOutputs(const std::vector<WalletTypes::KeyOutput> &a, const std::vector<WalletTypes::KeyOutput> &b)
+        {
+            if (a.size() != b.size())
+            {
+                return false;
+            }
+
+            for (size_t i = 0; i < a.size(); i++)
+            {
+                if (a[i].key != b[i].key || a[i].amount != b[i].amount
+                    || a[i].globalOutputIndex != b[i].globalOutputIndex)
+                {
+                    return false;
+                }
+            }
+
+            return true;
+        }
+
+        bool sameTransaction(const WalletTypes::RawCoinbaseTransaction &a, const WalletTypes::RawCoinbaseTransaction &b)
+        {
+            return sameOutputs(a.keyOutputs, b.keyOutputs) && a.hash == b.hash
+                   && a.transactionPublicKey == b.transactionPublicKey && a.unlockTime == b.unlockTime;
+        }
+
+        bool sameTransaction(const WalletTypes::RawTransaction &a, const WalletTypes::RawTransaction &b)
+        {
+            if (!sameTransaction(
+                    static_cast<const WalletTypes::RawCoinbaseTransaction &>(a),
+                    static_cast<const WalletTypes::RawCoinbaseTransaction &>(b))
+                || a.paymentID != b.paymentID || a.keyInputs.size() != b.keyInputs.size())
+            {
+                return false;
+            }
+
+            for (size_t i = 0; i < a.keyInputs.size(); i++)
+            {
+                if (a.keyInputs[i].amount != b.keyInputs[i].amount
+                    || a.keyInputs[i].outputIndexes != b.keyInputs[i].outputIndexes
+                    || a.keyInputs[i].keyImage != b.keyInputs[i].keyImage)
+                {
+                    return false;
+                }
+            }
+
+            return true;
+        }
+
+        bool sameSyncData(const WalletTypes::WalletSyncData &a, const WalletTypes::WalletSyncData &b)
+        {
+            if (a.blocks.size() != b.blocks.size() || a.synced != b.synced
+                || a.topBlock.has_value() != b.topBlock.has_value())
+            {
+                return false;
+            }
+
+            if (a.topBlock && (a.topBlock->hash != b.topBlock->hash || a.topBlock->height != b.topBlock->height))
+            {
+                return false;
+            }
+
+            for (size_t i = 0; i < a.blocks.size(); i++)
+            {
+                const auto &blockA = a.blocks[i];
+                const auto &blockB = b.blocks[i];
+
+                if (blockA.blockHeight != blockB.blockHeight || blockA.blockHash != blockB.blockHash
+                    || blockA.blockTimestamp != blockB.blockTimestamp
+                    || blockA.coinbaseTransaction.has_value() != blockB.coinbaseTransaction.has_value()
+                    || blockA.transactions.size() != blockB.transactions.size())
+                {
+                    return false;
+                }
+
+                if (blockA.coinbaseTransaction
+                    && !sameTransaction(*blockA.coinbaseTransaction, *blockB.coinbaseTransaction))
+                {
+                    return false;
+                }
+
+                for (size_t j = 0; j < blockA.transactions.size(); j++)
+                {
+                    if (!sameTransaction(blockA.transactions[j], blockB.transactions[j]))
+                    {
+                        return false;
+                    }
+                }
+            }
+
+            return true;
+        }
+
+        bool roundTrips(const WalletTypes::WalletSyncData &syncData)
+        {
+            const CryptoNote::BinaryArray binary = CryptoNote::toBinaryArray(syncData);
+
+            WalletTypes::WalletSyncData parsed;
+
+            if (!CryptoNote::fromBinaryArray(parsed, binary))
+            {
+                return false;
+            }
+
+            return sameSyncData(syncData, parsed) && CryptoNote::toBinaryArray(parsed) == binary;
+        }
+    } // namespace
+
+    void testWalletTypesSerialization()
+    {
+        WalletTypes::WalletSyncData syncData = randomSyncData();
+
+        CHECK(roundTrips(syncData));
+
+        /* What a synced wallet gets */
+        WalletTypes::WalletSyncData synced;
+        synced.topBlock = syncData.topBlock;
+        synced.synced = true;
+
+        CHECK(roundTrips(synced));
+
+        CHECK(roundTrips(WalletTypes::WalletSyncData()));
+
+        /* Truncated data is rejected */
+        CryptoNote::BinaryArray binary = CryptoNote::toBinaryArray(syncData);
+        binary.resize(binary.size() / 2);
+
+        WalletTypes::WalletSyncData parsed;
+
+        CHECK(!CryptoNote::fromBinaryArray(parsed, binary));
+    }
+} // namespace UnitTest
@@ -0,0 +1,66 @@
+// Copyright (c) 2018-2024, The DeroGold Developers
+//
+// Please see the included LICENSE file for more information.
+
+#include "UnitTest.h"
+
+#include <algorithm>
+#include <config/CliHeader.h>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+int main(int argc, char **argv)
+{
+    const std::vector<std::pair<std::string, std::function<void()>>> tests = {
+        {"BlockValidationPipeline", UnitTest::testBlockValidationPipeline},
+        {"TaskScheduler", UnitTest::testTaskScheduler},
+        {"SpentKeyImageIndex", UnitTest::testSpentKeyImageIndex},
+        {"ColumnFamilyClassification", UnitTest::testColumnFamilyClassification},
+        {"KVBinaryKeys", UnitTest::testKVBinaryKeys},
+        {"CompactKeys", UnitTest::testCompactKeys},
+        {"CompactValues", UnitTest::testCompactValues},
+        {"MedianWindow", UnitTest::testMedianWindow},
+        {"WalletTypesSerialization", UnitTest::testWalletTypesSerialization},
+        {"WalletScanRecord", UnitTest::testWalletScanRecord},
+        {"BlockDownloadScheduler", UnitTest::testBlockDownloadScheduler},
+        {"KnownInventory", UnitTest::testKnownInventory},
+        {"CompactBlock", UnitTest::testCompactBlock},
+        {"WalletSyncCache", UnitTest::testWalletSyncCache},
+    };
+
+    std::cout << CryptoNote::getProjectCLIHeader() << std::endl;
+
+    /* Optionally only run the tests whose name is given */
+    const std::vector<std::string> selected(argv + 1, argv + argc);
+
+    for (const auto &[name, test] : tests)
+    {
+        if (!selected.empty() && std::find(selected.begin(), selected.end(), name) == selected.end())
+        {
+            continue;
+        }
+
+        std::cout << "Running " << name << std::endl;
+
+        try
+        {
+            test();
+        }
+        catch (const std::exception &e)
+        {
+            UnitTest::fail(__FILE__, __LINE__, name + " threw: " + e.what());
+        }
+    }
+
+    if (UnitTest::failureCount() != 0)
+    {
+        std::cout << std::endl << UnitTest::failureCount() << " checks failed" << std::endl;
+        return 1;
+    }
+
+    std::cout << std::endl << "All tests passed" << std::endl;
+
+    return 0;
+}
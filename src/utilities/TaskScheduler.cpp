@@ -0,0 +1,285 @@
+// Copyright (c) 2018-2024, The DeroGold Developers
+//
+// Please see the included LICENSE file for more information.
+
+////////////////////////////////////
+#include <utilities/TaskScheduler.h>
+////////////////////////////////////
+
+#include <algorithm>
+#include <exception>
+
+namespace Utilities
+{
+    namespace
+    {
+        /* The scheduler and queue index of the worker running on this thread,
+           so tasks pushed from inside a task go to the workers own queue */
+        thread_local TaskScheduler *currentScheduler = nullptr;
+
+        thread_local size_t currentWorkerIndex = 0;
+
+        /* The state of a parallelFor() loop, shared between the caller and
+           the helper tasks it pushed */
+        struct LoopState
+        {
+            /* The next iteration to claim */
+            std::atomic<size_t> next;
+
+            size_t end;
+
+            size_t total;
+
+            /* Amount of iterations claimed and either run or skipped */
+            std::atomic<size_t> completed = 0;
+
+            std::atomic<bool> cancelled = false;
+
+            /* Only called for claimed iterations, and the caller doesn't return
+               until every iteration is completed, so it outlives its use */
+            const std::function<bool(size_t)> *body;
+
+            std::exception_ptr error;
+
+            std::mutex mutex;
+
+            std::condition_variable finished;
+        };
+
+        void runIterations(LoopState &state)
+        {
+            while (true)
+            {
+                const size_t i = state.next++;
+
+                if (i >= state.end)
+                {
+                    return;
+                }
+
+                /* Still have to count skipped iterations, so the caller knows
+                   when it's safe to return */
+                if (!state.cancelled)
+                {
+                    try
+                    {
+                        if (!(*state.body)(i))
+                        {
+                            state.cancelled = true;
+                        }
+                    }
+                    catch (...)
+                    {
+                        std::scoped_lock<std::mutex> lock(state.mutex);
+
+                        if (!state.error)
+                        {
+                            state.error = std::current_exception();
+                        }
+
+                        state.cancelled = true;
+                    }
+                }
+
+                if (++state.completed == state.total)
+                {
+                    std::scoped_lock<std::mutex> lock(state.mutex);
+                    state.finished.notify_all();
+                }
+            }
+        }
+    } // namespace
+
+    TaskScheduler::TaskScheduler() : TaskScheduler(std::thread::hardware_concurrency())
+    {
+    }
+
+    TaskScheduler::TaskScheduler(uint64_t threadCount) :
+        m_shouldStop(false),
+        m_pendingTasks(0),
+        m_nextQueue(0)
+    {
+        if (threadCount == 0)
+        {
+            threadCount = 1;
+        }
+
+        for (uint64_t i = 0; i < threadCount; i++)
+        {
+            m_queues.push_back(std::make_unique<WorkerQueue>());
+        }
+
+        /* Launch our worker threads once all the queues exist, since they
+           steal from each other */
+        for (uint64_t i = 0; i < threadCount; i++)
+        {
+            m_threads.push_back(std::thread(&TaskScheduler::workerLoop, this, i));
+        }
+    }
+
+    TaskScheduler::~TaskScheduler()
+    {
+        {
+            std::scoped_lock<std::mutex> lock(m_sleepMutex);
+
+            /* Signal threads to stop */
+            m_shouldStop = true;
+        }
+
+        /* Wake them all up */
+        m_haveTask.notify_all();
+
+        /* Wait for them to stop */
+        for (auto &thread : m_threads)
+        {
+            thread.join();
+        }
+    }
+
+    bool TaskScheduler::parallelFor(size_t begin, size_t end, const std::function<bool(size_t)> &body)
+    {
+        if (begin >= end)
+        {
+            return true;
+        }
+
+        auto state = std::make_shared<LoopState>();
+
+        state->next = begin;
+        state->end = end;
+        state->total = end - begin;
+        state->body = &body;
+
+        /* We take iterations too, so one less helper than iterations is enough */
+        const size_t helpers = std::min<size_t>(m_threads.size(), state->total - 1);
+
+        for (size_t i = 0; i < helpers; i++)
+        {
+            /* A helper which only starts after the loop is finished finds no
+               iterations left, and just drops its reference to the state */
+            push([state] { runIterations(*state); });
+        }
+
+        runIterations(*state);
+
+        /* Only iterations which were claimed by a helper can still be running.
+           We don't wait for helpers which haven't started yet - they may be
+           queued behind tasks waiting on us. */
+        std::unique_lock<std::mutex> lock(state->mutex);
+
+        state->finished.wait(lock, [&] { return state->completed == state->total; });
+
+        if (state->error)
+        {
+            std::rethrow_exception(state->error);
+        }
+
+        return !state->cancelled;
+    }
+
+    uint64_t TaskScheduler::threadCount() const
+    {
+        return m_threads.size();
+    }
+
+    TaskScheduler &TaskScheduler::shared()
+    {
+        static TaskScheduler scheduler;
+        return scheduler;
+    }
+
+    void TaskScheduler::push(std::function<void()> task)
+    {
+        /* Tasks pushed by a worker go on its own queue, where it will likely
+           pick them up next while the data is still in cache. Anyone else
+           spreads them over the queues. */
+        const size_t queueIndex = currentScheduler == this
+            ? currentWorkerIndex
+            : m_nextQueue++ % m_queues.size();
+
+        /* Counted before it's published, as a worker can take it and
+           decrement the count as soon as it's in the queue */
+        {
+            std::scoped_lock<std::mutex> lock(m_sleepMutex);
+            m_pendingTasks++;
+        }
+
+        {
+            auto &queue = *m_queues[queueIndex];
+
+            std::scoped_lock<std::mutex> lock(queue.mutex);
+
+            queue.tasks.push_back(std::move(task));
+        }
+
+        /* Wake up a thread to process the task */
+        m_haveTask.notify_one();
+    }
+
+    bool TaskScheduler::tryPop(size_t workerIndex, std::function<void()> &task)
+    {
+        {
+            auto &queue = *m_queues[workerIndex];
+
+            std::scoped_lock<std::mutex> lock(queue.mutex);
+
+            if (!queue.tasks.empty())
+            {
+                task = std::move(queue.tasks.back());
+                queue.tasks.pop_back();
+                return true;
+            }
+        }
+
+        for (size_t offset = 1; offset < m_queues.size(); offset++)
+        {
+            auto &queue = *m_queues[(workerIndex + offset) % m_queues.size()];
+
+            std::scoped_lock<std::mutex> lock(queue.mutex);
+
+            if (!queue.tasks.empty())
+            {
+                task = std::move(queue.tasks.front());
+                queue.tasks.pop_front();
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    void TaskScheduler::workerLoop(size_t workerIndex)
+    {
+        currentScheduler = this;
+        currentWorkerIndex = workerIndex;
+
+        std::function<void()> task;
+
+        while (true)
+        {
+            if (tryPop(workerIndex, task))
+            {
+                m_pendingTasks--;
+
+                task();
+
+                /* Release anything the task captured */
+                task = nullptr;
+
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(m_sleepMutex);
+
+            /* Wait for a task to be pushed or to be stopped */
+            m_haveTask.wait(lock, [&] { return m_shouldStop || m_pendingTasks > 0; });
+
+            /* Finish off any queued tasks before stopping, so their futures
+               are fulfilled */
+            if (m_shouldStop && m_pendingTasks == 0)
+            {
+                return;
+            }
+        }
+    }
+}
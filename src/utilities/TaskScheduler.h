@@ -0,0 +1,130 @@
+// Copyright (c) 2018-2024, The DeroGold Developers
+//
+// Please see the included LICENSE file for more information.
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace Utilities
+{
+    /* A pool of worker threads, each with their own queue of tasks. Workers
+       take tasks from the back of their own queue, and when that is empty,
+       steal from the front of the other workers queues, so there is no single
+       lock every task has to pass through. */
+    class TaskScheduler
+    {
+        public:
+            /////////////////
+            /* CONSTRUCTOR */
+            /////////////////
+
+            TaskScheduler();
+
+            TaskScheduler(uint64_t threadCount);
+
+            ////////////////
+            /* DESTRUCTOR */
+            ////////////////
+
+            /* Runs any tasks still queued, then stops the workers */
+            ~TaskScheduler();
+
+            TaskScheduler(const TaskScheduler &) = delete;
+
+            TaskScheduler &operator=(const TaskScheduler &) = delete;
+
+            /////////////////////////////
+            /* PUBLIC MEMBER FUNCTIONS */
+            /////////////////////////////
+
+            /* Queue a task to run on one of the workers. The future holds the
+               return value, or the exception the task threw. */
+            template<typename Function>
+            std::future<std::invoke_result_t<Function>> submit(Function &&function)
+            {
+                using ReturnValue = std::invoke_result_t<Function>;
+
+                /* std::function must be copyable, packaged_task is not */
+                auto task = std::make_shared<std::packaged_task<ReturnValue()>>(std::forward<Function>(function));
+
+                std::future<ReturnValue> result = task->get_future();
+
+                push([task] { (*task)(); });
+
+                return result;
+            }
+
+            /* Calls body(i) for every i in [begin, end), spread over the workers
+               and the calling thread, and returns once they have all completed.
+               If any call returns false, iterations which have not started yet
+               are skipped, and false is returned. If any call throws, the rest
+               are skipped and the exception is rethrown here.
+
+               The calling thread takes iterations itself, so this completes
+               even when every worker is busy, and may be called from inside
+               a task. */
+            bool parallelFor(size_t begin, size_t end, const std::function<bool(size_t)> &body);
+
+            uint64_t threadCount() const;
+
+            /* Scheduler shared by anything that doesn't need its own thread
+               count, with one worker per core */
+            static TaskScheduler &shared();
+
+        private:
+
+            //////////////////////////////
+            /* PRIVATE MEMBER FUNCTIONS */
+            //////////////////////////////
+
+            void push(std::function<void()> task);
+
+            /* Takes a task from the back of our own queue, or steals one from
+               the front of another workers queue */
+            bool tryPop(size_t workerIndex, std::function<void()> &task);
+
+            void workerLoop(size_t workerIndex);
+
+            //////////////////////////////
+            /* PRIVATE MEMBER VARIABLES */
+            //////////////////////////////
+
+            struct WorkerQueue
+            {
+                std::mutex mutex;
+
+                std::deque<std::function<void()>> tasks;
+            };
+
+            /* One task queue per worker */
+            std::vector<std::unique_ptr<WorkerQueue>> m_queues;
+
+            /* The work threads */
+            std::vector<std::thread> m_threads;
+
+            /* Whether we're stopping */
+            std::atomic<bool> m_shouldStop;
+
+            /* Amount of tasks pushed but not yet taken by a worker. Counted
+               before the task is queued, so never less than the queued tasks. */
+            std::atomic<uint64_t> m_pendingTasks;
+
+            /* Queue to push the next task from a non worker thread to */
+            std::atomic<uint64_t> m_nextQueue;
+
+            /* Lets idle workers sleep until a task is pushed */
+            std::mutex m_sleepMutex;
+
+            std::condition_variable m_haveTask;
+    };
+}
@@ -14,8 +14,6 @@
 #include <future>
 #include <iostream>
 #include <logger/Logger.h>
-#include <utilities/ThreadSafeDeque.h>
-#include <utilities/ThreadSafeQueue.h>
 #include <utilities/Utilities.h>
 #include <walletbackend/Constants.h>
 
@@ -91,10 +89,6 @@ WalletSynchronizer &WalletSynchronizer::operator=(WalletSynchronizer &&old)
 
     m_subWallets = std::move(old.m_subWallets);
 
-    m_blockProcessingQueue = std::move(old.m_blockProcessingQueue);
-
-    m_processedBlocks = std::move(old.m_processedBlocks);
-
     m_threadCount = std::move(old.m_threadCount);
 
     return *this;
@@ -120,48 +114,25 @@ void WalletSynchronizer::mainLoop()
 
         if (!blocks.empty())
         {
-            m_blockProcessingQueue.push_back_n(blocks.begin(), blocks.end());
+            std::vector<BlockInputsAndOwners> ourInputs(blocks.size());
 
-            /* Tell the child threads to wake up */
-            m_haveBlocksToProcess.notify_all();
-
-            const size_t chunkSize = blocks.size();
+            /* Find our outputs in each block in parallel - this is the slow
+               part, and doesn't depend on the previous blocks */
+            const bool processed = m_scheduler->parallelFor(0, blocks.size(), [&](const size_t i) {
+                return processBlock(std::get<0>(blocks[i]), ourInputs[i]);
+            });
 
+            /* Only fails if we're stopping */
+            if (!processed)
             {
-                /* *possibly* should use another mutex here for the different
-                    condition variable? I think it's fine since we're only
-                    stopping the child threads from aquiring the mutex for
-                    a very short time (since the check will fail when not all
-                    blocks are available) */
-                std::unique_lock<std::mutex> lock(m_mutex);
-
-                m_haveProcessedBlocksToHandle.wait(lock, [&] {
-                    if (m_shouldStop)
-                    {
-                        return true;
-                    }
-
-                    /* Wait until all the blocks have been added to the queue */
-                    return m_processedBlocks.size() == chunkSize;
-                });
-
-                if (m_shouldStop)
-                {
-                    return;
-                }
+                return;
             }
 
-            /* Nothing else should be pushing to the queue here, since the
-               child threads are waiting for a new chunk, so don't need to
-               use mutex to access */
-            while (!m_processedBlocks.empty_unsafe() && !m_shouldStop)
+            /* Then store them in the order they arrived in, which is needed
+               to correctly handle network forks */
+            for (size_t i = 0; i < blocks.size() && !m_shouldStop; i++)
             {
-                const auto [block, ourInputs, arrivalIndex] = m_processedBlocks.top_unsafe();
-                completeBlockProcessing(block, ourInputs);
-                if (!m_processedBlocks.empty_unsafe() && !m_shouldStop)
-                {
-                    m_processedBlocks.pop_unsafe();
-                }
+                completeBlockProcessing(std::get<0>(blocks[i]), ourInputs[i]);
             }
         }
 
@@ -183,124 +154,62 @@ void WalletSynchronizer::mainLoop()
     }
 }
 
-void WalletSynchronizer::blockProcessingThread()
+bool WalletSynchronizer::processBlock(const WalletTypes::WalletBlockInfo &block, BlockInputsAndOwners &ourInputs) const
 {
-    /* Take the max chunk size, split by the threads, divided by 2. So in
-       theory, each thread processes 2 chunks. This is to decrease locking,
-       while also trying to stop slower threads from delaying the system. */
-    size_t chunkSize = Constants::BLOCK_PROCESSING_CHUNK / m_threadCount / 2;
-
-    if (chunkSize == 0)
+    if (m_shouldStop)
     {
-        chunkSize = 1;
+        return false;
     }
 
-    /* No point splitting into chunks if we're only using 1 thread */
-    if (m_threadCount == 1)
-    {
-        chunkSize = Constants::BLOCK_PROCESSING_CHUNK;
-    }
+    Logger::logger.log("Processing block " + std::to_string(block.blockHeight), Logger::DEBUG, {Logger::SYNC});
 
-    std::vector<SemiProcessedBlock> processedBlocks;
+    ourInputs = processBlockOutputs(block);
 
-    while (!m_shouldStop)
+    std::unordered_map<Crypto::Hash, std::vector<uint64_t>> globalIndexes;
+
+    for (auto &[publicKey, input] : ourInputs)
     {
+        if (!m_subWallets->isViewWallet() && !input.globalOutputIndex)
         {
-            std::unique_lock<std::mutex> lock(m_mutex);
-
-            /* Wait for blocks to be available */
-            m_haveBlocksToProcess.wait(lock, [&] {
-                if (m_shouldStop)
-                {
-                    return true;
-                }
-
-                return m_blockProcessingQueue.size() > 0;
-            });
-
-            if (m_shouldStop)
+            if (globalIndexes.empty())
             {
-                return;
+                globalIndexes = getGlobalIndexes(block.blockHeight);
             }
-        }
 
-        auto chunk = m_blockProcessingQueue.front_n_and_remove(chunkSize);
+            auto it = globalIndexes.find(input.parentTransactionHash);
 
-        /* Process blocks while we've got more to process */
-        while (!chunk.empty() && !m_shouldStop)
-        {
-            for (const auto &[block, arrivalIndex] : chunk)
-            {
-                Logger::logger.log(
-                    "Processing block " + std::to_string(block.blockHeight), Logger::DEBUG, {Logger::SYNC});
-
-                auto ourInputs = processBlockOutputs(block);
+            /* Daemon returns indexes for hashes in a range. If we don't
+               find our hash, either the chain has forked, or the daemon
+               is faulty. Print a warning message, then return so we
+               can fetch new blocks, in the likely case the daemon has
+               forked.
 
-                std::unordered_map<Crypto::Hash, std::vector<uint64_t>> globalIndexes;
-
-                for (auto &[publicKey, input] : ourInputs)
+               Also need to check there are enough indexes for the one we want */
+            while (it == globalIndexes.end() || it->second.size() <= input.transactionIndex)
+            {
+                if (m_shouldStop)
                 {
-                    if (!m_subWallets->isViewWallet() && !input.globalOutputIndex)
-                    {
-                        if (globalIndexes.empty())
-                        {
-                            globalIndexes = getGlobalIndexes(block.blockHeight);
-                        }
-
-                        auto it = globalIndexes.find(input.parentTransactionHash);
-
-                        /* Daemon returns indexes for hashes in a range. If we don't
-                           find our hash, either the chain has forked, or the daemon
-                           is faulty. Print a warning message, then return so we
-                           can fetch new blocks, in the likely case the daemon has
-                           forked.
-
-                           Also need to check there are enough indexes for the one we want */
-                        while (it == globalIndexes.end() || it->second.size() <= input.transactionIndex)
-                        {
-                            if (m_shouldStop)
-                            {
-                                return;
-                            }
-
-                            Logger::logger.log(
-                                "Warning: Failed to get correct global indexes from daemon."
-                                "\nThe daemon may have gone offline or the chain may have just forked.",
-                                Logger::FATAL,
-                                {Logger::SYNC, Logger::DAEMON});
-
-                            std::this_thread::sleep_for(std::chrono::seconds(5));
-
-                            globalIndexes = getGlobalIndexes(block.blockHeight);
-
-                            it = globalIndexes.find(input.parentTransactionHash);
-                        }
-
-                        input.globalOutputIndex = it->second[input.transactionIndex];
-                    }
+                    return false;
                 }
 
-                processedBlocks.push_back({block, ourInputs, arrivalIndex});
-            }
+                Logger::logger.log(
+                    "Warning: Failed to get correct global indexes from daemon."
+                    "\nThe daemon may have gone offline or the chain may have just forked.",
+                    Logger::FATAL,
+                    {Logger::SYNC, Logger::DAEMON});
 
-            chunk = m_blockProcessingQueue.front_n_and_remove(chunkSize);
-        }
+                std::this_thread::sleep_for(std::chrono::seconds(5));
 
-        /* Push our processed blocks */
-        if (!processedBlocks.empty())
-        {
-            /* Store this chunks worth of blocks */
-            m_processedBlocks.push_n(processedBlocks.begin(), processedBlocks.end());
+                globalIndexes = getGlobalIndexes(block.blockHeight);
 
-            /* Notify the parent thread we've pushed data to the queue */
-            m_haveProcessedBlocksToHandle.notify_all();
+                it = globalIndexes.find(input.parentTransactionHash);
+            }
 
-            /* Empty the processed blocks */
-            processedBlocks.clear();
+            input.globalOutputIndex = it->second[input.transactionIndex];
         }
-
-        /* Then go back to waiting for more data */
     }
+
+    return true;
 }
 
 std::vector<std::tuple<Crypto::PublicKey, WalletTypes::TransactionInput>>
@@ -677,17 +586,10 @@ void WalletSynchronizer::start()
     }
 
     m_blockDownloader.start();
-    m_blockProcessingQueue.start();
-    m_processedBlocks.start();
-
-    m_syncThread = std::thread(&WalletSynchronizer::mainLoop, this);
 
-    m_syncThreads.clear();
+    m_scheduler = std::make_unique<Utilities::TaskScheduler>(m_threadCount);
 
-    for (unsigned int i = 0; i < m_threadCount; i++)
-    {
-        m_syncThreads.push_back(std::thread(&WalletSynchronizer::blockProcessingThread, this));
-    }
+    m_syncThread = std::thread(&WalletSynchronizer::mainLoop, this);
 }
 
 void WalletSynchronizer::stop()
@@ -699,14 +601,6 @@ void WalletSynchronizer::stop()
 
     /* Tell the block downloader to stop and wait for it */
     m_blockDownloader.stop();
-    m_blockProcessingQueue.stop();
-    m_processedBlocks.stop();
-
-    m_haveBlocksToProcess.notify_all();
-    m_haveProcessedBlocksToHandle.notify_all();
-
-    m_blockProcessingQueue.clear();
-    m_processedBlocks.clear();
 
     /* Wait for the block downloader thread to finish (if applicable) */
     if (m_syncThread.joinable())
@@ -714,14 +608,8 @@ void WalletSynchronizer::stop()
         m_syncThread.join();
     }
 
-    /* Wait for each child thread to finish */
-    for (auto &thread : m_syncThreads)
-    {
-        if (thread.joinable())
-        {
-            thread.join();
-        }
-    }
+    /* Nothing is using the block processing workers now, stop them */
+    m_scheduler.reset();
 }
 
 void WalletSynchronizer::reset(uint64_t startHeight)
@@ -9,16 +9,13 @@
 #include <memory>
 #include <nigel/Nigel.h>
 #include <subwallets/SubWallets.h>
-#include <utilities/ThreadSafeDeque.h>
-#include <utilities/ThreadSafePriorityQueue.h>
+#include <utilities/TaskScheduler.h>
 #include <walletbackend/BlockDownloader.h>
 #include <walletbackend/EventHandler.h>
 #include <walletbackend/SynchronizationStatus.h>
 
 typedef std::vector<std::tuple<Crypto::PublicKey, WalletTypes::TransactionInput>> BlockInputsAndOwners;
 
-typedef std::tuple<WalletTypes::WalletBlockInfo, BlockInputsAndOwners, uint32_t> SemiProcessedBlock;
-
 /* Used to store the data we have accumulating when scanning a specific
    block. We can't add the items directly, because we may stop midway
    through. If so, we need to not add anything. */
@@ -35,17 +32,6 @@ struct BlockScanTmpInfo
     std::vector<std::tuple<Crypto::PublicKey, Crypto::KeyImage>> keyImagesToMarkSpent;
 };
 
-class OrderByArrivalIndex
-{
-  public:
-    /* Ordering based on the arrival index of the blocks, not on the block
-       height. This is needed to ensure correct handling of network forks. */
-    bool operator()(SemiProcessedBlock a, SemiProcessedBlock b)
-    {
-        return std::get<2>(a) > std::get<2>(b);
-    }
-};
-
 class WalletSynchronizer
 {
   public:
@@ -116,7 +102,9 @@ class WalletSynchronizer
 
     void mainLoop();
 
-    void blockProcessingThread();
+    /* Finds our outputs in the block, along with their global indexes.
+       Returns false if we were stopped before finishing. */
+    bool processBlock(const WalletTypes::WalletBlockInfo &block, BlockInputsAndOwners &ourInputs) const;
 
     std::vector<std::tuple<Crypto::PublicKey, WalletTypes::TransactionInput>>
         processBlockOutputs(const WalletTypes::WalletBlockInfo &block) const;
@@ -178,28 +166,10 @@ class WalletSynchronizer
     /* The sub wallets (shared with the main class) */
     std::shared_ptr<SubWallets> m_subWallets;
 
-    /* Stores blocks for processing by processing threads */
-    ThreadSafeDeque<std::tuple<WalletTypes::WalletBlockInfo, uint32_t>> m_blockProcessingQueue;
-
-    /* Synchronizes the child threads waiting for blocks to process
-       and the parent pushing blocks in */
-    std::condition_variable m_haveBlocksToProcess;
-
-    /* Synchronizes the child threads pushing blocks into the priority
-       queue and the parent thread waiting for them all to arrive */
-    std::condition_variable m_haveProcessedBlocksToHandle;
-
-    std::mutex m_mutex;
-
-    /* yeah.... that's a thread safe queue, which holds a block, and it's
-       corresponding inputs, and the subwallet public key that each input
-       belongs to. The blocks which arrived earlier come at the front of
-       the queue. */
-    ThreadSafePriorityQueue<SemiProcessedBlock, OrderByArrivalIndex> m_processedBlocks;
-
     /* Amount of sync threads to run */
     unsigned int m_threadCount;
 
-    /* Stores thread ids of the block output processing threads */
-    std::vector<std::thread> m_syncThreads;
+    /* Processes the outputs of the fetched blocks in parallel. Created
+       with m_threadCount workers when we are started. */
+    std::unique_ptr<Utilities::TaskScheduler> m_scheduler;
 };